@@ -46,25 +46,24 @@
  * 06/04/09 - update the range sampling rate from new PRM file to solve    *
  * confict of rng_samp_rate between LED file and PRM file in FBD mode.     *
  * 04/28/10 - modified to work with envisat - M.Wei			   *
+ * 10/17/26 - start each point from the zero Doppler time of the previous  *
+ *            one and refine it with Newton iterations on the range rate;  *
+ *            the golden section search is only the fallback               *
+ * 10/17/26 - -dem reads a DEM grid directly, blocks of rows are converted *
+ *            on -nthreads threads and written in order to stdout or to    *
+ *            range and azimuth grids (-G)                                 *
+ * 10/17/26 - orbit sampling and the zero Doppler search moved to the      *
+ *            library orbit object (sat_orbit.c)                           *
  ****************************************************************************/
 
 #include "gmtsar.h"
 #include "llt2xyz.h"
 #include "orbit.h"
 
-#define R 0.61803399
-#define C 0.382
-#define SHFT2(a, b, c)                                                                                                           \
-	(a) = (b);                                                                                                                   \
-	(b) = (c);
-#define SHFT3(a, b, c, d)                                                                                                        \
-	(a) = (b);                                                                                                                   \
-	(b) = (c);                                                                                                                   \
-	(c) = (d);
-#define TOL 2
-
 char *USAGE = " \n Usage: "
-              "SAT_llt2rat master.PRM prec [-bo[s|d]] < inputfile > outputfile  \n\n"
+              "SAT_llt2rat master.PRM prec [-bo[s|d]] < inputfile > outputfile  \n"
+              "        SAT_llt2rat master.PRM prec -dem dem.grd [-bo[s|d]] [-nthreads n] > outputfile  \n"
+              "        SAT_llt2rat master.PRM prec -dem dem.grd -G range.grd azimuth.grd [-nthreads n] \n\n"
               "             master.PRM   -  parameter file for master image and points "
               "to LED orbit file \n"
               "             precise      -  (0) standard back geocoding, (1) - "
@@ -74,44 +73,33 @@ char *USAGE = " \n Usage: "
               "default] \n"
               "             -bos or -bod -  binary single or double precision output (only output results within \n"
               "                             data coverage, PRM num_lines, num_rng_bins ) \n"
+              "             -dem dem.grd -  read lon, lat, elevation from the nodes of a grid instead of \n"
+              "                             inputfile, NaN nodes are skipped as by gmt grd2xyz -s \n"
+              "             -G range.grd azimuth.grd - with -dem, write range and azimuth on the nodes \n"
+              "                             of the grid instead of outputfile \n"
+              "             -nthreads n  -  with -dem, number of threads converting blocks of rows (default 1) \n"
               " \n"
-              " example: SAT_llt2rat master.PRM 0 < topo.llt > topo.ratll    \n";
+              " example: SAT_llt2rat master.PRM 0 < topo.llt > topo.ratll    \n"
+              "          SAT_llt2rat master.PRM 1 -dem dem.grd -bod -nthreads 8 > trans.dat \n";
 
-int npad = 8000;
+#define BLOCK_ROWS 16 /* rows of the DEM handed to a thread at a time */
 
-EXTERN_MSC void read_orb(FILE *, struct SAT_ORB *);
-EXTERN_MSC void set_prm_defaults(struct PRM *);
-EXTERN_MSC void hermite_c(double *, double *, double *, int, int, double, double *, int *);
 EXTERN_MSC void set_prm_defaults(struct PRM *);
-EXTERN_MSC void interpolate_SAT_orbit_slow(struct SAT_ORB *orb, double time, double *, double *, double *, int *);
-EXTERN_MSC void polyfit(double *, double *, double *, int *, int *);
+void llt2rat_grid(struct SAT_ORBIT *so, int precise, char *demfile, int otype, char *rngfile, char *azifile, int nthreads,
+                  char *prog);
+void put_record(struct SAT_ORBIT *so, int otype, double *rec);
 
 int main(int argc, char **argv) {
 
 	FILE *fprm1 = NULL;
 	int otype;
-	double rln, rlt, rht, dr, t1, t11, t2, tm;
-	double ts, rng0;
-	double xp[3];
-	double xt[3];
-	double rp[3];
-	double dd[5]; /* dummy for output  double precision */
-	float ds[5];  /* dummy for output  single precision */
-	double r0, rf, a0, af;
-	double fll, rdd, daa, drr, dopc;
-	double dt, dtt, xs, ys, zs;
-	double time[20], rng[20], d[3]; /* arrays used for polynomial refinement of min range */
-	int ir, k, ntt = 10, nc = 3;    /* size of arrays used for polynomial refinement */
-	int j, nrec, precise = 0;
-	int goldop();
-	int stai, endi, midi;
-	double **orb_pos = NULL;
+	double llt[3]; /* lon, lat, elevation of one point */
+	double rec[5]; /* range, azimuth, elevation, lon, lat of one point */
+	int n, precise = 0, seeded = 0, nthreads = 1;
+	double tseed = 0.;
+	char *demfile = NULL, *rngfile = NULL, *azifile = NULL;
 	struct PRM prm;
-	struct SAT_ORB *orb = NULL;
-	char name[128], value[128];
-	double rsr;
-	FILE *ldrfile = NULL;
-	int calorb_alos(struct SAT_ORB *, double **orb_pos, double ts, double t1, int nrec);
+	struct SAT_ORBIT *so = NULL;
 
 #ifdef _WIN32		/* Set all I/O to binary mode */
 	_setmode(_fileno(stdin), _O_BINARY);
@@ -122,7 +110,7 @@ int main(int argc, char **argv) {
 
 	/* Make sure usage is correct and files can be opened  */
 
-	if (argc < 3 || argc > 4) {
+	if (argc < 3) {
 		fprintf(stderr, "%s\n", USAGE);
 		exit(-1);
 	}
@@ -132,17 +120,30 @@ int main(int argc, char **argv) {
 	 * binary    */
 
 	otype = 1;
-	if (argc == 4) {
-		if (!strcmp(argv[3], "-bos"))
+	for (n = 3; n < argc; n++) {
+		if (!strcmp(argv[n], "-bos"))
 			otype = 2;
-		else if (!strcmp(argv[3], "-bod"))
+		else if (!strcmp(argv[n], "-bod"))
 			otype = 3;
+		else if (!strcmp(argv[n], "-dem") && n + 1 < argc)
+			demfile = argv[++n];
+		else if (!strcmp(argv[n], "-G") && n + 2 < argc) {
+			rngfile = argv[++n];
+			azifile = argv[++n];
+		}
+		else if (!strcmp(argv[n], "-nthreads") && n + 1 < argc) {
+			nthreads = atoi(argv[++n]);
+			if (nthreads < 1)
+				nthreads = 1;
+		}
 		else {
-			fprintf(stderr, " %s *** option not recognized ***\n\n", argv[2]);
+			fprintf(stderr, " %s *** option not recognized ***\n\n", argv[n]);
 			fprintf(stderr, "%s", USAGE);
 			exit(1);
 		}
 	}
+	if (rngfile != NULL && demfile == NULL)
+		die("-G needs a grid from -dem", "");
 
 	/*  open and read the parameter file */
 
@@ -160,287 +161,152 @@ int main(int argc, char **argv) {
 
 	fclose(fprm1);
 
-	/*  get the orbit data */
-
-	ldrfile = fopen(prm.led_file, "r");
-	if (ldrfile == NULL)
-		die("can't open ", prm.led_file);
-	orb = (struct SAT_ORB *)malloc(sizeof(struct SAT_ORB));
-	read_orb(ldrfile, orb);
-
-	dr = 0.5 * SOL / prm.fs;
-	r0 = -10.;
-	rf = prm.num_rng_bins + 10.;
-	a0 = -20.;
-	af = prm.num_patches * prm.num_valid_az + 20.;
+	/*  read the orbit and sample it once for all the points */
 
-	/* compute the flattening */
+	so = sat_orbit_create(&prm);
 
-	fll = (prm.ra - prm.rc) / prm.ra;
-
-	/* compute the start time, stop time and increment */
-
-	t1 = 86400. * prm.clock_start + (prm.nrows - prm.num_valid_az) / (2. * prm.prf);
-	t2 = t1 + prm.num_patches * prm.num_valid_az / prm.prf;
-
-	/* sample the orbit only every 2th point or about 8 m along track */
-	/* if this is S1A which has a low PRF sample 2 times more often */
-
-	ts = 2. / prm.prf;
-	if (prm.prf < 600.) {
-		ts = 2. / (2. * prm.prf);
-		npad = 20000;
+	if (demfile != NULL) {
+		llt2rat_grid(so, precise, demfile, otype, rngfile, azifile, nthreads, argv[0]);
 	}
-	nrec = (int)((t2 - t1) / ts);
-
-	/* allocate storage for an array of pointers  */
-
-	orb_pos = malloc(4 * sizeof(double *));
-
-	/* for each pointer, allocate storage for an array of floats  */
-
-	for (j = 0; j < 4; j++) {
-		orb_pos[j] = malloc((nrec + 2 * npad) * sizeof(double));
-	}
-
-	/* read in the postion of the orbit */
-
-	(void)calorb_alos(orb, orb_pos, ts, t1, nrec);
-
-	/* read the llt points and convert to xyz.  */
-
-	while (scanf(" %lf %lf %lf ", &rln, &rlt, &rht) == 3) {
-		rp[0] = rlt;
-		rp[1] = rln;
-		rp[2] = rht;
-		plh2xyz(rp, xp, prm.ra, fll);
-		if (rp[1] > 180.)
-			rp[1] = rp[1] - 360.;
-		xt[0] = -1.0;
-
-		/* compute the topography due to the difference between the local radius and
-		 * center radius */
-
-		rp[2] = sqrt(xp[0] * xp[0] + xp[1] * xp[1] + xp[2] * xp[2]) - prm.RE;
-
-		/* minimum for each point */
-
-		stai = 0;
-		endi = nrec + npad * 2 - 1;
-		midi = (stai + (endi - stai) * C);
-
-		(void)goldop(ts, t1, orb_pos, stai, endi, midi, xp[0], xp[1], xp[2], &rng0, &tm);
-
-		if (precise == 1) {
-
-			/* refine this minimum range and azimuth with a polynomial fit */
-			dt = 1. / ntt; /* make the polynomial 1 second long */
-			for (k = 0; k < ntt; k++) {
-				time[k] = dt * (k - ntt / 2 + .5);
-				t11 = tm + time[k];
-				interpolate_SAT_orbit_slow(orb, t11, &xs, &ys, &zs, &ir);
-				rng[k] = sqrt((xp[0] - xs) * (xp[0] - xs) + (xp[1] - ys) * (xp[1] - ys) + (xp[2] - zs) * (xp[2] - zs)) - rng0;
-			}
-
-			/* fit a second order polynomial to the range versus time function and
-			 * update the tm and rng0 */
-			polyfit(time, rng, d, &ntt, &nc);
-			dtt = -d[1] / (2. * d[2]);
-			tm = tm + dtt;
-			interpolate_SAT_orbit_slow(orb, tm, &xs, &ys, &zs, &ir);
-			rng0 = sqrt((xp[0] - xs) * (xp[0] - xs) + (xp[1] - ys) * (xp[1] - ys) + (xp[2] - zs) * (xp[2] - zs));
-		}
-		/* compute the range and azimuth in pixel space */
-		xt[0] = rng0;
-		xt[1] = tm;
-		xt[0] = (xt[0] - prm.near_range) / dr - (prm.rshift + prm.sub_int_r) + prm.chirp_ext;
-		xt[1] = prm.prf * (xt[1] - t1) - (prm.ashift + prm.sub_int_a);
-
-		/* For Envisat correct for biases based on Pinon reflector analysis */
-		if (prm.SC_identity == 4) {
-			xt[0] = xt[0] + 8.4;
-			xt[1] = xt[1] + 4;
-		}
-
-		/* compute the azimuth and range correction if the Doppler is not zero */
-
-		if (prm.fd1 != 0.) {
-			dopc = prm.fd1 + prm.fdd1 * (prm.near_range + dr * prm.num_rng_bins / 2.);
-			rdd = (prm.vel * prm.vel) / rng0;
-			daa = -0.5 * (prm.lambda * dopc) / rdd;
-			drr = 0.5 * rdd * daa * daa / dr;
-			daa = prm.prf * daa;
-			xt[0] = xt[0] + drr;
-			xt[1] = xt[1] + daa;
-		}
-
-		if ((xt[0] < r0 || xt[0] > rf || xt[1] < a0 || xt[1] > af) && (otype > 1))
-			continue;
+	else {
+		/* read the llt points and convert them */
 
-		if (otype == 1) {
-			fprintf(stdout, "%.9f %.9f %.9f %.9f %.9f \n", xt[0], xt[1], rp[2], rp[1], rp[0]);
-		}
-		else if (otype == 2) {
-			ds[0] = (float)xt[0];
-			ds[1] = (float)xt[1];
-			ds[2] = (float)rp[2];
-			ds[3] = (float)rp[1];
-			ds[4] = (float)rp[0];
-			fwrite(ds, sizeof(float), 5, stdout);
-		}
-		else if (otype == 3) {
-			dd[0] = xt[0];
-			dd[1] = xt[1];
-			dd[2] = rp[2];
-			dd[3] = rp[1];
-			dd[4] = rp[0];
-			fwrite(dd, sizeof(double), 5, stdout);
+		while (scanf(" %lf %lf %lf ", &llt[0], &llt[1], &llt[2]) == 3) {
+			sat_orbit_point(so, precise, llt, &seeded, &tseed, rec);
+			put_record(so, otype, rec);
 		}
 	}
 	fflush(stdout);		/* Make sure output buffer is flushed  */
 
-	/* free the orb_pos array  */
-	for (j = 0; j < 4; j++) {
-		free(orb_pos[j]);
-	}
-	free(orb_pos);
-	free(orb);
+	sat_orbit_destroy(so);
 	return (0);
 }
 
 /*    subfunctions    */
 
-int goldop(double ts, double t1, double **orb_pos, int ax, int bx, int cx, double xpx, double xpy, double xpz, double *rng,
-           double *tm) {
-
-	/* use golden section search to find the minimum range between the target and
-	 * the orbit */
-	/* xpx, xpy, xpz is the position of the target in cartesian coordinate */
-	/* ax is stai; bx is endi; cx is midi it's easy to tangle */
-
-	double f1, f2;
-	int x0, x1, x2, x3;
-	int xmin;
-	double dist();
-
-	x0 = ax;
-	x3 = bx;
-	//      if (fabs(bx-cx) > fabs(cx-ax)) {
-	if (abs(bx - cx) > abs(cx - ax)) {
-		x1 = cx;
-		x2 = cx + (int)fabs((C * (bx - cx)));
-	}
-	else {
-		x2 = cx;
-		x1 = cx - (int)fabs((C * (cx - ax))); /* make x0 to x1 the smaller segment */
-	}
+/* write one point to stdout, binary output only keeps the data coverage */
+void put_record(struct SAT_ORBIT *so, int otype, double *rec) {
 
-	f1 = dist(xpx, xpy, xpz, x1, orb_pos);
-	f2 = dist(xpx, xpy, xpz, x2, orb_pos);
+	float ds[5]; /* dummy for output  single precision */
+	double r0, rf, a0, af;
+	int k;
 
-	while ((x3 - x0) > TOL && (x2 != x1)) {
-		if (f2 < f1) {
-			SHFT3(x0, x1, x2, (int)(R * x3 + C * x1));
-			SHFT2(f1, f2, dist(xpx, xpy, xpz, x2, orb_pos));
-		}
-		else {
-			SHFT3(x3, x2, x1, (int)(R * x0 + C * x2));
-			SHFT2(f2, f1, dist(xpx, xpy, xpz, x1, orb_pos));
-		}
-	}
+	r0 = -10.;
+	rf = so->prm.num_rng_bins + 10.;
+	a0 = -20.;
+	af = so->prm.num_patches * so->prm.num_valid_az + 20.;
+
+	if ((rec[0] < r0 || rec[0] > rf || rec[1] < a0 || rec[1] > af) && (otype > 1))
+		return;
 
-	if (f1 < f2) {
-        if (x1 <= bx && x1 >= ax) {
-		    xmin = x1;
-        }
-        else{
-            xmin = abs(x1-bx) > abs(x1-ax) ? ax : bx;
-        }
-		*tm = orb_pos[0][x1];
-		*rng = f1;
+	if (otype == 1) {
+		fprintf(stdout, "%.9f %.9f %.9f %.9f %.9f \n", rec[0], rec[1], rec[2], rec[3], rec[4]);
 	}
-	else {
-        if (x2 <= bx && x2 >= ax) {
-		    xmin = x2;
-        }
-        else {
-            xmin = abs(x2-bx) > abs(x2-ax) ? ax : bx;
-        }
-		*tm = orb_pos[0][x2];
-		*rng = f2;
+	else if (otype == 2) {
+		for (k = 0; k < 5; k++)
+			ds[k] = (float)rec[k];
+		fwrite(ds, sizeof(float), 5, stdout);
+	}
+	else if (otype == 3) {
+		fwrite(rec, sizeof(double), 5, stdout);
 	}
-
-	return (xmin);
-}
-
-double dist(double x, double y, double z, int n, double **orb_pos) {
-
-	double d, dx, dy, dz;
-
-	dx = x - orb_pos[1][n];
-	dy = y - orb_pos[2][n];
-	dz = z - orb_pos[3][n];
-	d = sqrt(dx * dx + dy * dy + dz * dz);
-
-	return (d);
 }
 
-int calorb_alos(struct SAT_ORB *orb, double **orb_pos, double ts, double t1, int nrec)
-/* function to calculate every position in the orbit   */
-
-{
-	int i, k, nval;
-	// int     npad = 8000;   /* number of buffer points to add before and after
-	// the acquisition */
-	int ir;            /* return code: 0 = ok; 1 = interp not in center; 2 = time out of
-	                      range */
-	double xs, ys, zs; /* position at time */
-	double *pt, *px, *py, *pz, *pvx, *pvy, *pvz;
-	double pt0;
-	double time;
-
-	px = (double *)malloc(orb->nd * sizeof(double));
-	py = (double *)malloc(orb->nd * sizeof(double));
-	pz = (double *)malloc(orb->nd * sizeof(double));
-	pvx = (double *)malloc(orb->nd * sizeof(double));
-	pvy = (double *)malloc(orb->nd * sizeof(double));
-	pvz = (double *)malloc(orb->nd * sizeof(double));
-	pt = (double *)malloc(orb->nd * sizeof(double));
-
-	pt0 = 86400. * orb->id + orb->sec;
-	for (k = 0; k < orb->nd; k++) {
-		pt[k] = pt0 + k * orb->dsec;
-		px[k] = orb->points[k].px;
-		py[k] = orb->points[k].py;
-		pz[k] = orb->points[k].pz;
-		pvx[k] = orb->points[k].vx;
-		pvy[k] = orb->points[k].vy;
-		pvz[k] = orb->points[k].vz;
+/* convert every node of a DEM grid; threads take blocks of BLOCK_ROWS rows and
+ * each block is written as soon as the blocks before it are out, so stdout gets
+ * the points in the order gmt grd2xyz -s would give them */
+void llt2rat_grid(struct SAT_ORBIT *so, int precise, char *demfile, int otype, char *rngfile, char *azifile, int nthreads,
+                  char *prog) {
+
+	void *API = NULL;
+	struct GMT_GRID *DEM = NULL, *RNG = NULL, *AZI = NULL;
+	int64_t nx, ny, ib, nblocks;
+	double x0, y0, dx, dy;
+
+	if ((API = GMT_Create_Session(prog, 0U, 0U, NULL)) == NULL)
+		die("cannot start a GMT session", "");
+	if ((DEM = GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_ALL, NULL, demfile, NULL)) == NULL)
+		die("cannot open DEM ", demfile);
+	if (rngfile != NULL) {
+		if ((RNG = GMT_Duplicate_Data(API, GMT_IS_GRID, GMT_DUPLICATE_DATA, DEM)) == NULL)
+			die("error creating output grid", rngfile);
+		if ((AZI = GMT_Duplicate_Data(API, GMT_IS_GRID, GMT_DUPLICATE_DATA, DEM)) == NULL)
+			die("error creating output grid", azifile);
 	}
 
-	nval = 6;
-
-	/* loop to get orbit position of every point and store them into orb_pos */
-	for (i = 0; i < nrec + npad * 2; i++) {
-		time = t1 - npad * ts + i * ts;
-		orb_pos[0][i] = time;
-
-		hermite_c(pt, px, pvx, orb->nd, nval, time, &xs, &ir);
-		hermite_c(pt, py, pvy, orb->nd, nval, time, &ys, &ir);
-		hermite_c(pt, pz, pvz, orb->nd, nval, time, &zs, &ir);
+	/* node coordinates, top row first */
+	nx = DEM->header->n_columns;
+	ny = DEM->header->n_rows;
+	dx = DEM->header->inc[GMT_X];
+	dy = DEM->header->inc[GMT_Y];
+	x0 = DEM->header->wesn[GMT_XLO] + 0.5 * DEM->header->registration * dx;
+	y0 = DEM->header->wesn[GMT_YHI] - 0.5 * DEM->header->registration * dy;
+
+	nblocks = (ny + BLOCK_ROWS - 1) / BLOCK_ROWS;
+#pragma omp parallel num_threads(nthreads)
+	{
+		int64_t i, j, k, n, i0, nrows;
+		int seeded = 0, rseeded = 0, first;
+		double tseed = 0., trow = 0., llt[3], pt[5];
+		double *rec = NULL; /* records of one block for stdout */
+
+		if (RNG == NULL && (rec = (double *)malloc(5 * (size_t)nx * BLOCK_ROWS * sizeof(double))) == NULL)
+			die("memory allocation!", "");
+
+#pragma omp for ordered schedule(dynamic, 1)
+		for (ib = 0; ib < nblocks; ib++) {
+			i0 = ib * BLOCK_ROWS;
+			nrows = (i0 + BLOCK_ROWS > ny) ? ny - i0 : BLOCK_ROWS;
+			n = 0;
+			for (i = i0; i < i0 + nrows; i++) {
+				/* the first point of a row starts from the first point of the row above */
+				seeded = rseeded;
+				tseed = trow;
+				first = 1;
+				for (j = 0; j < nx; j++) {
+					k = i * nx + j;
+					if (isnan(DEM->data[k])) {
+						if (RNG != NULL)
+							RNG->data[k] = AZI->data[k] = NAN;
+						continue;
+					}
+					llt[0] = x0 + j * dx;
+					llt[1] = y0 - i * dy;
+					llt[2] = DEM->data[k];
+					sat_orbit_point(so, precise, llt, &seeded, &tseed, pt);
+					if (first) {
+						rseeded = seeded;
+						trow = tseed;
+						first = 0;
+					}
+					if (RNG != NULL) {
+						RNG->data[k] = (float)pt[0];
+						AZI->data[k] = (float)pt[1];
+					}
+					else {
+						memcpy(&rec[5 * n], pt, 5 * sizeof(double));
+						n++;
+					}
+				}
+			}
+#pragma omp ordered
+			for (k = 0; k < n; k++)
+				put_record(so, otype, &rec[5 * k]);
+		}
 
-		orb_pos[1][i] = xs;
-		orb_pos[2][i] = ys;
-		orb_pos[3][i] = zs;
+		free(rec);
 	}
 
-	free((double *)px);
-	free((double *)py);
-	free((double *)pz);
-	free((double *)pt);
-	free((double *)pvx);
-	free((double *)pvy);
-	free((double *)pvz);
-
-	return orb->nd;
+	if (RNG != NULL) {
+		if (GMT_Write_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_ALL, NULL, rngfile, RNG))
+			die("cannot create ", rngfile);
+		if (GMT_Write_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_ALL, NULL, azifile, AZI))
+			die("cannot create ", azifile);
+		if (GMT_Destroy_Data(API, &RNG) || GMT_Destroy_Data(API, &AZI))
+			die("error freeing data", "");
+	}
+	if (GMT_Destroy_Data(API, &DEM))
+		die("error freeing data", demfile);
+	if (GMT_Destroy_Session(API))
+		die("error closing the GMT session", "");
 }
@@ -42,10 +42,12 @@
  * to read the array.                                                      *
  * 06/15/09 - modifed to correct the contradiction of range sampling rate  *
  * between FBS and FBD mode.
+ * 10/17/26 - keeps the sampled orbit of the last few PRMs in a library  *
+ *            orbit object (sat_orbit.c) instead of rebuilding it on     *
+ *            every call; results are the same as before                 *
  ****************************************************************************/
 
 #include "gmtsar.h"
-#include "llt2xyz.h"
 #include "orbit.h"
 
 #define R 0.61803399
@@ -58,133 +60,23 @@
 	(b) = (c);                                                                                                                   \
 	(c) = (d);
 #define TOL 3
-void set_prm_defaults(struct PRM *);
-void read_orb(FILE *, struct SAT_ORB *);
-void hermite_c(double *, double *, double *, int, int, double, double *, int *);
+#define NCACHE 4 /* orbits kept between calls */
 
-EXTERN_MSC void llt2rat_sub(struct PRM *prm, double *target_llt, double *target_rat);
-void llt2rat_sub(struct PRM *prm, double *target_llt, double *target_rat) {
-
-	double rln, rlt, rht, dr, t1, t2, tm;
-	// double ts,rng, thet, relp, telp;
-	double ts, rng;
-	double xp[3];
-	double xt[3];
-	double rp[3];
-	/* double r0,rf,a0,af; */
-	// double rad=PI/180.;
-	double fll, rdd, daa, drr;
-	int j, nrec, npad = 8000;
-	int goldop();
-	int stai, endi, midi;
-	double **orb_pos;
-	//struct PRM prm;
-	struct SAT_ORB *orb;
-	FILE *ldrfile;
-	//FILE *fprm1;
-	int calorb_alos(struct SAT_ORB *, double **orb_pos, double ts, double t1, int nrec);
-	double rsr;
-	char value[128], name[128];
-
-	/*  get the orbit data */
-	ldrfile = fopen(prm->led_file, "r");
-	if (ldrfile == NULL)
-		die("can't open LED file", prm->led_file);
-	orb = (struct SAT_ORB *)malloc(sizeof(struct SAT_ORB));
-	read_orb(ldrfile, orb);
-
-	dr = 0.5 * SOL / prm->fs;
-#if 0
-        r0 = -10.;
-        rf = prm->num_rng_bins + 10.;
-        a0 = -20.;
-        af = prm->num_patches * prm->num_valid_az + 20.;
-#endif
-	/* compute the flattening */
-	fll = (prm->ra - prm->rc) / prm->ra;
-
-	/* compute the start time, stop time and increment */
-	t1 = 86400. * prm->clock_start + (prm->nrows - prm->num_valid_az) / (2. * prm->prf);
-	t2 = t1 + prm->num_patches * prm->num_valid_az / prm->prf;
-
-	/* sample the orbit only every 2th point or about 8 m along track */
-	ts = 2. / prm->prf;
-	nrec = (int)((t2 - t1) / ts);
-
-	/* allocate memory for the orbit postion into a 2-dimensional array. It's
-	   about nrec+-npad * 4 * 4bytes = 320 KB the first "4" means space and time
-	   dimension : t, x, y, z         */
-
-	/* allocate storage for an array of pointers  */
-	orb_pos = malloc(4 * sizeof(double *));
-
-	/* for each pointer, allocate storage for an array of floats  */
-	for (j = 0; j < 4; j++) {
-		orb_pos[j] = malloc((nrec + 2 * npad) * sizeof(double));
-	}
-
-	/* read in the postion of the orbit */
-	(void)calorb_alos(orb, orb_pos, ts, t1, nrec);
-
-	/* read the llt points and convert to xyz.  */
-	rlt = target_llt[0];
-	rln = target_llt[1];
-	rht = target_llt[2];
-	rp[0] = rlt;
-	rp[1] = rln;
-	rp[2] = rht;
-	plh2xyz(rp, xp, prm->ra, fll);
-	xt[0] = -1.0;
-
-	/* compute the topography due to the difference between the local radius and
-	 * center radius */
-	// thet = rlt * rad;
-	// if(prm.rc > 6350000. && prm.ra > 6350000. && prm.RE > 6350000.) {
-	// relp=1./sqrt((cos(thet)/prm.ra)*(cos(thet)/prm.ra)+(sin(thet)/prm.rc)*(sin(thet)/prm.rc));
-	// telp=relp-prm.RE;
-	//}
-	// else {
-	// telp=0.;
-	//}
-	// rp[2]=rht + telp;
-	rp[2] = sqrt(xp[0] * xp[0] + xp[1] * xp[1] + xp[2] * xp[2]) - prm->RE;
-
-	/* minimum for each point */
-	stai = 0;
-	endi = nrec + npad * 2 - 1;
-	midi = (stai + (endi - stai) * C);
-	(void)goldop(ts, t1, orb_pos, stai, endi, midi, xp[0], xp[1], xp[2], &rng, &tm);
-	xt[0] = rng;
-	xt[1] = tm;
-
-	/* compute the range and azimuth in pixel space and correct for an azimuth
-	 * bias*/
-	xt[0] = (xt[0] - prm->near_range) / dr - (prm->rshift + prm->sub_int_r) + prm->chirp_ext;
-	xt[1] = prm->prf * (xt[1] - t1) - (prm->ashift + prm->sub_int_a);
+/*    subfunctions    */
 
-	/* compute the azimuth and range correction if the Doppler is not zero */
+static double dist(double x, double y, double z, int n, double **orb_pos) {
 
-	if (prm->fd1 != 0.) {
-		rdd = (prm->vel * prm->vel) / rng;
-		daa = -0.5 * (prm->lambda * prm->fd1) / rdd;
-		drr = 0.5 * rdd * daa * daa / dr;
-		daa = prm->prf * daa;
-		xt[0] = xt[0] + drr;
-		xt[1] = xt[1] + daa;
-	}
+	double d, dx, dy, dz;
 
-	target_rat[0] = xt[0];
-	target_rat[1] = xt[1];
-	target_rat[2] = rp[2];
+	dx = x - orb_pos[1][n];
+	dy = y - orb_pos[2][n];
+	dz = z - orb_pos[3][n];
+	d = sqrt(dx * dx + dy * dy + dz * dz);
 
-	free(orb_pos);
-	free(orb);
+	return (d);
 }
 
-/*    subfunctions    */
-
-int goldop(double ts, double t1, double **orb_pos, int ax, int bx, int cx, double xpx, double xpy, double xpz, double *rng,
-           double *tm) {
+static int goldop(double **orb_pos, int ax, int bx, int cx, double xpx, double xpy, double xpz, double *rng, double *tm) {
 
 	/* use golden section search to find the minimum range between the target and
 	 * the orbit */
@@ -194,11 +86,9 @@ int goldop(double ts, double t1, double **orb_pos, int ax, int bx, int cx, doubl
 	double f1, f2;
 	int x0, x1, x2, x3;
 	int xmin;
-	double dist();
 
 	x0 = ax;
 	x3 = bx;
-	// if (fabs(bx-cx) > fabs(cx-ax)) {
 	if (abs(bx - cx) > abs(cx - ax)) {
 		x1 = cx;
 		x2 = cx + (int)fabs((C * (bx - cx)));
@@ -235,74 +125,85 @@ int goldop(double ts, double t1, double **orb_pos, int ax, int bx, int cx, doubl
 	return (xmin);
 }
 
-double dist(double x, double y, double z, int n, double **orb_pos) {
+/* the orbit of prm sampled every 2 / prf seconds with 8000 samples of padding, */
+/* taken from the cache if an orbit of the same LED file and scene times is there */
+/* (SAT_baseline alternates between the reference and each repeat PRM); */
+/* the cache is not thread safe and is kept until the program exits */
+static struct SAT_ORBIT *cached_orbit(struct PRM *prm) {
+	static struct SAT_ORBIT *cache[NCACHE];
+	static int age[NCACHE], tick = 0;
+	struct SAT_ORBIT *so;
+	double ts, t1;
+	int k, slot;
 
-	double d, dx, dy, dz;
+	ts = 2. / prm->prf;
+	t1 = 86400. * prm->clock_start + (prm->nrows - prm->num_valid_az) / (2. * prm->prf);
 
-	dx = x - orb_pos[1][n];
-	dy = y - orb_pos[2][n];
-	dz = z - orb_pos[3][n];
-	d = sqrt(dx * dx + dy * dy + dz * dz);
+	slot = 0;
+	for (k = 0; k < NCACHE; k++) {
+		so = cache[k];
+		if (so != NULL && !strcmp(so->prm.led_file, prm->led_file) && so->ts == ts && so->t1 == t1 &&
+		    so->prm.num_patches == prm->num_patches && so->prm.num_valid_az == prm->num_valid_az) {
+			age[k] = ++tick;
+			return (so);
+		}
+		if (age[k] < age[slot])
+			slot = k;
+	}
 
-	return (d);
+	sat_orbit_destroy(cache[slot]);
+	cache[slot] = sat_orbit_create_sampled(prm, ts, 8000);
+	age[slot] = ++tick;
+
+	return (cache[slot]);
 }
 
-int calorb_alos(struct SAT_ORB *orb, double **orb_pos, double ts, double t1, int nrec)
-/* function to calculate every position in the orbit   */
+/* target_llt is lat, lon, elevation; target_rat gets range, azimuth, elevation */
+EXTERN_MSC void llt2rat_sub(struct PRM *prm, double *target_llt, double *target_rat);
+void llt2rat_sub(struct PRM *prm, double *target_llt, double *target_rat) {
 
-{
-	int i, k, nval;
-	int npad = 8000;   /* number of buffer points to add before and after the
-	                      acquisition */
-	int ir;            /* return code: 0 = ok; 1 = interp not in center; 2 = time out of
-	                      range */
-	double xs, ys, zs; /* position at time */
-	double *pt, *px, *py, *pz, *pvx, *pvy, *pvz;
-	double pt0;
-	double time;
+	struct SAT_ORBIT *so;
+	double rng, tm, dr, fll;
+	double xp[3], xt[2], rp[3];
+	double rdd, daa, drr;
+	int stai, endi, midi;
 
-	px = (double *)malloc(orb->nd * sizeof(double));
-	py = (double *)malloc(orb->nd * sizeof(double));
-	pz = (double *)malloc(orb->nd * sizeof(double));
-	pvx = (double *)malloc(orb->nd * sizeof(double));
-	pvy = (double *)malloc(orb->nd * sizeof(double));
-	pvz = (double *)malloc(orb->nd * sizeof(double));
-	pt = (double *)malloc(orb->nd * sizeof(double));
+	so = cached_orbit(prm);
+	dr = 0.5 * SOL / prm->fs;
+	fll = (prm->ra - prm->rc) / prm->ra;
 
-	pt0 = 86400. * orb->id + orb->sec;
-	for (k = 0; k < orb->nd; k++) {
-		pt[k] = pt0 + k * orb->dsec;
-		px[k] = orb->points[k].px;
-		py[k] = orb->points[k].py;
-		pz[k] = orb->points[k].pz;
-		pvx[k] = orb->points[k].vx;
-		pvy[k] = orb->points[k].vy;
-		pvz[k] = orb->points[k].vz;
-	}
+	/* read the llt points and convert to xyz.  */
+	rp[0] = target_llt[0];
+	rp[1] = target_llt[1];
+	rp[2] = target_llt[2];
+	plh2xyz(rp, xp, prm->ra, fll);
 
-	nval = 6;
+	/* compute the topography due to the difference between the local radius and
+	 * center radius */
+	rp[2] = sqrt(xp[0] * xp[0] + xp[1] * xp[1] + xp[2] * xp[2]) - prm->RE;
 
-	/* loop to get orbit position of every point and store them into orb_pos */
-	for (i = 0; i < nrec + npad * 2; i++) {
-		time = t1 - npad * ts + i * ts;
-		orb_pos[0][i] = time;
+	/* minimum for each point */
+	stai = 0;
+	endi = so->nsamp - 1;
+	midi = (stai + (endi - stai) * C);
+	(void)goldop(so->orb_pos, stai, endi, midi, xp[0], xp[1], xp[2], &rng, &tm);
 
-		hermite_c(pt, px, pvx, orb->nd, nval, time, &xs, &ir);
-		hermite_c(pt, py, pvy, orb->nd, nval, time, &ys, &ir);
-		hermite_c(pt, pz, pvz, orb->nd, nval, time, &zs, &ir);
+	/* compute the range and azimuth in pixel space and correct for an azimuth
+	 * bias*/
+	xt[0] = (rng - prm->near_range) / dr - (prm->rshift + prm->sub_int_r) + prm->chirp_ext;
+	xt[1] = prm->prf * (tm - so->t1) - (prm->ashift + prm->sub_int_a);
 
-		orb_pos[1][i] = xs;
-		orb_pos[2][i] = ys;
-		orb_pos[3][i] = zs;
+	/* compute the azimuth and range correction if the Doppler is not zero */
+	if (prm->fd1 != 0.) {
+		rdd = (prm->vel * prm->vel) / rng;
+		daa = -0.5 * (prm->lambda * prm->fd1) / rdd;
+		drr = 0.5 * rdd * daa * daa / dr;
+		daa = prm->prf * daa;
+		xt[0] = xt[0] + drr;
+		xt[1] = xt[1] + daa;
 	}
 
-	free((double *)px);
-	free((double *)py);
-	free((double *)pz);
-	free((double *)pt);
-	free((double *)pvx);
-	free((double *)pvy);
-	free((double *)pvz);
-
-	return orb->nd;
+	target_rat[0] = xt[0];
+	target_rat[1] = xt[1];
+	target_rat[2] = rp[2];
 }
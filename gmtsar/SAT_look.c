@@ -51,23 +51,16 @@
  *            long swath, the start time should be in  the first frame so  *
  *            PRM file.                                                    *
  * 12/03/10 - modified to work with ENVISAT, Matt Wei                      *
+ * 10/17/26 - start each point from the zero Doppler time of the previous  *
+ *            one, golden section search only when Newton fails            *
+ * 10/17/26 - orbit sampling and search moved to the library orbit object  *
+ *            (sat_orbit.c)                                                *
  ****************************************************************************/
 
 #include "gmtsar.h"
 #include "llt2xyz.h"
 #include "orbit.h"
 
-#define R 0.61803399
-#define C 0.382
-#define SHFT2(a, b, c)                                                                                                           \
-	(a) = (b);                                                                                                                   \
-	(b) = (c);
-#define SHFT3(a, b, c, d)                                                                                                        \
-	(a) = (b);                                                                                                                   \
-	(b) = (c);                                                                                                                   \
-	(c) = (d);
-#define TOL 3
-
 char *USAGE = " \n Usage: "
               "SAT_look master.PRM [-bo[s|d]] < inputfile > outputfile  \n\n"
               "             master.PRM   -  parameter file for master image and points "
@@ -80,16 +73,14 @@ char *USAGE = " \n Usage: "
               "  Note that the output elevation is the one above reference radius "
               "specified in the PRM file\n";
 
-EXTERN_MSC void read_orb(FILE *, struct SAT_ORB *);
-EXTERN_MSC void hermite_c(double *, double *, double *, int, int, double, double *, int *);
 EXTERN_MSC void set_prm_defaults(struct PRM *);
 
 int main(int argc, char **argv) {
 
 	FILE *fprm1;
 	int otype;
-	double rln, rlt, rht, t1, t2, tm;
-	double ts, rng, thet, relp, telp;
+	double rln, rlt, rht, tm;
+	double rng, thet, relp, telp;
 	double xp[3];
 	/* double xt[3],dr; */
 	double rp[3];
@@ -97,17 +88,13 @@ int main(int argc, char **argv) {
 	float ds[6];  /* dummy for output  single precision */
 	/* double r0,rf,a0,af; */
 	double rad = PI / 180.;
-	double fll;
-	int i, j, k, nrec, npad = 8000;
-	int goldop();
-	int stai, endi, midi, xmin;
+	int i, j, k;
+	int xmin, seeded = 0;
+	double tseed = 0.;
 	double **orb_pos;
 	struct PRM prm;
-	struct SAT_ORB *orb;
-	FILE *ldrfile;
-	int calorb_alos(struct SAT_ORB *, double **orb_pos, double ts, double t1, int nrec);
+	struct SAT_ORBIT *so = NULL;
 	double len, unit_x, unit_y, unit_z;
-	double dist();
 
 	double Rx[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
 	double Rz[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
@@ -177,57 +164,9 @@ int main(int argc, char **argv) {
 
 	fclose(fprm1);
 
-	/*  get the orbit data */
-	ldrfile = fopen(prm.led_file, "r");
-	if (ldrfile == NULL)
-		die("can't open ", prm.led_file);
-	orb = (struct SAT_ORB *)malloc(sizeof(struct SAT_ORB));
-	read_orb(ldrfile, orb);
-
-#if 0
-	dr = 0.5*SOL/prm.fs;
-        r0 = -10.;
-        rf = prm.num_rng_bins + 10.;
-        a0 = -20.;
-        af = prm.num_patches * prm.num_valid_az + 20.;
-#endif
-	/* compute the flattening */
-
-	fll = (prm.ra - prm.rc) / prm.ra;
-
-	/* compute the start time, stop time and increment */
-
-	t1 = 86400. * prm.clock_start + (prm.nrows - prm.num_valid_az) / (2. * prm.prf);
-	t2 = t1 + prm.num_patches * prm.num_valid_az / prm.prf;
-
-	/* sample the orbit only every 2th point or about 8 m along track */
-
-	ts = 2. / prm.prf;
-	nrec = (int)((t2 - t1) / ts);
-
-	/* allocate memory for the orbit postion into a 2-dimensional array. It's
-	   about nrec+-npad * 4 * 4bytes = 320 KB the first "4" means space and time
-	   dimension : t, x, y, z         */
-
-	/* allocate storage for an array of pointers  */
-	orb_pos = malloc(4 * sizeof(double *));
-
-	/* for each pointer, allocate storage for an array of floats  */
-	for (j = 0; j < 4; j++) {
-		orb_pos[j] = malloc((nrec + 2 * npad) * sizeof(double));
-	}
-
-	/* read in the postion of the orbit */
-	/*        fprintf(stderr,"ts=%lf,t1=%lf,nrec=%d\n",ts,t1,nrec);   */
-
-	(void)calorb_alos(orb, orb_pos, ts, t1, nrec);
-
-	/* look at the orb_pos
-	        for(i=0;i<4;i++) {
-	          for (j=0;j<nrec+2*npad;j=j+100) {
-	            fprintf(stderr,"%d,  %lf\n",j,orb_pos[i][j]); }
-	        }
-	*/
+	/*  read the orbit and sample it once for all the points */
+	so = sat_orbit_create(&prm);
+	orb_pos = so->orb_pos;
 
 	/* read the llt points and convert to xyz.  */
 
@@ -236,7 +175,7 @@ int main(int argc, char **argv) {
 		rp[0] = rlt;
 		rp[1] = rln;
 		rp[2] = rht;
-		plh2xyz(rp, xp, prm.ra, fll);
+		plh2xyz(rp, xp, prm.ra, so->fll);
 		if (rp[1] > 180.)
 			rp[1] = rp[1] - 360.;
 		/* xt[0]=-1.0;  */
@@ -254,13 +193,8 @@ int main(int argc, char **argv) {
 		}
 		rp[2] = rht + telp;
 
-		/* minimum for each point */
-
-		stai = 0;
-		endi = nrec + npad * 2 - 1;
-		midi = (stai + (endi - stai) * C);
-
-		xmin = goldop(ts, t1, orb_pos, stai, endi, midi, xp[0], xp[1], xp[2], &rng, &tm);
+		/* orbit sample closest to the point */
+		xmin = sat_orbit_zero_doppler(so, xp, 0, &seeded, &tseed, &tm, &rng);
 
 		/* xt[0]=rng;
 		xt[1]=tm; */
@@ -273,7 +207,7 @@ int main(int argc, char **argv) {
 		  fprintf(stderr,"x y z of the satellite minimum: %f, %f,
 		  %f\n",orb_pos[1][xmin],orb_pos[2][xmin],orb_pos[3][xmin]);   */
 
-		len = dist(xp[0], xp[1], xp[2], xmin, orb_pos);
+		len = rng;
 		unit_x = (orb_pos[1][xmin] - xp[0]) / len;
 		unit_y = (orb_pos[2][xmin] - xp[1]) / len;
 		unit_z = (orb_pos[3][xmin] - xp[2]) / len;
@@ -390,137 +324,6 @@ int main(int argc, char **argv) {
 		}
 	}
 
-	/* free the orb_pos array  */
-	for (j = 0; j < 4; j++) {
-		free(orb_pos[j]);
-	}
-	free(orb_pos);
-	free(orb);
+	sat_orbit_destroy(so);
 	return (0);
 }
-
-/*    subfunctions    */
-
-int goldop(double ts, double t1, double **orb_pos, int ax, int bx, int cx, double xpx, double xpy, double xpz, double *rng,
-           double *tm) {
-
-	/* use golden section search to find the minimum range between the target and
-	 * the orbit */
-	/* xpx, xpy, xpz is the position of the target in cartesian coordinate */
-	/* ax is stai; bx is endi; cx is midi it's easy to tangle */
-
-	double f1, f2;
-	int x0, x1, x2, x3;
-	int xmin;
-	double dist();
-
-	x0 = ax;
-	x3 = bx;
-	// if (fabs(bx-cx) > fabs(cx-ax)) {
-	if (abs(bx - cx) > abs(cx - ax)) {
-		x1 = cx;
-		x2 = cx + (int)fabs((C * (bx - cx)));
-	}
-	else {
-		x2 = cx;
-		x1 = cx - (int)fabs((C * (cx - ax))); /* make x0 to x1 the smaller segment */
-	}
-
-	f1 = dist(xpx, xpy, xpz, x1, orb_pos);
-	f2 = dist(xpx, xpy, xpz, x2, orb_pos);
-
-	while ((x3 - x0) > TOL && fabs(f1-f2) > 1e-6) {
-		if (f2 < f1) {
-			SHFT3(x0, x1, x2, (int)(R * x3 + C * x1));
-			SHFT2(f1, f2, dist(xpx, xpy, xpz, x2, orb_pos));
-		}
-		else {
-			SHFT3(x3, x2, x1, (int)(R * x0 + C * x2));
-			SHFT2(f2, f1, dist(xpx, xpy, xpz, x1, orb_pos));
-		}
-	}
-	if (f1 < f2) {
-		xmin = x1;
-		*tm = orb_pos[0][x1];
-		*rng = f1;
-	}
-	else {
-		xmin = x2;
-		*tm = orb_pos[0][x2];
-		*rng = f2;
-	}
-
-	return (xmin);
-}
-
-double dist(double x, double y, double z, int n, double **orb_pos) {
-
-	double d, dx, dy, dz;
-
-	dx = x - orb_pos[1][n];
-	dy = y - orb_pos[2][n];
-	dz = z - orb_pos[3][n];
-	d = sqrt(dx * dx + dy * dy + dz * dz);
-
-	return (d);
-}
-
-int calorb_alos(struct SAT_ORB *orb, double **orb_pos, double ts, double t1, int nrec)
-/* function to calculate every position in the orbit   */
-
-{
-	int i, k, nval;
-	int npad = 8000;   /* number of buffer points to add before and after the
-	                      acquisition */
-	int ir;            /* return code: 0 = ok; 1 = interp not in center; 2 = time out of
-	                      range */
-	double xs, ys, zs; /* position at time */
-	double *pt, *px, *py, *pz, *pvx, *pvy, *pvz;
-	double pt0;
-	double time;
-
-	px = (double *)malloc(orb->nd * sizeof(double));
-	py = (double *)malloc(orb->nd * sizeof(double));
-	pz = (double *)malloc(orb->nd * sizeof(double));
-	pvx = (double *)malloc(orb->nd * sizeof(double));
-	pvy = (double *)malloc(orb->nd * sizeof(double));
-	pvz = (double *)malloc(orb->nd * sizeof(double));
-	pt = (double *)malloc(orb->nd * sizeof(double));
-
-	pt0 = 86400. * orb->id + orb->sec;
-	for (k = 0; k < orb->nd; k++) {
-		pt[k] = pt0 + k * orb->dsec;
-		px[k] = orb->points[k].px;
-		py[k] = orb->points[k].py;
-		pz[k] = orb->points[k].pz;
-		pvx[k] = orb->points[k].vx;
-		pvy[k] = orb->points[k].vy;
-		pvz[k] = orb->points[k].vz;
-	}
-
-	nval = 6;
-
-	/* loop to get orbit position of every point and store them into orb_pos */
-	for (i = 0; i < nrec + npad * 2; i++) {
-		time = t1 - npad * ts + i * ts;
-		orb_pos[0][i] = time;
-
-		hermite_c(pt, px, pvx, orb->nd, nval, time, &xs, &ir);
-		hermite_c(pt, py, pvy, orb->nd, nval, time, &ys, &ir);
-		hermite_c(pt, pz, pvz, orb->nd, nval, time, &zs, &ir);
-
-		orb_pos[1][i] = xs;
-		orb_pos[2][i] = ys;
-		orb_pos[3][i] = zs;
-	}
-
-	free((double *)px);
-	free((double *)py);
-	free((double *)pz);
-	free((double *)pt);
-	free((double *)pvx);
-	free((double *)pvy);
-	free((double *)pvz);
-
-	return orb->nd;
-}
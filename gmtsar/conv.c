@@ -141,7 +141,7 @@ int read_SLC_float(float *cf2, int xdim, FILE *f_input, int yarr, float *buffer,
 int main(int argc, char **argv) {
 	int idec, jdec;
 	int iout, jout;
-	int i, j, ic, jc, norm, ic0, ic1;
+	int i, j, k, ic, jc, norm, ic0, ic1, nrow, nout;
 	int ydim = 0, xdim = 0; /* size of input file */
 	int xarr, yarr, narr, yarr2;
 	int nbuff, ibuff, imove;
@@ -153,7 +153,9 @@ int main(int argc, char **argv) {
 	float *cfdat = NULL;
 	double inc[2], wesn[4], xmax = 0.0, ymax = 0.0;
 	float *filter = NULL, *buffer = NULL, *indat = NULL;
-	float filtin, filtdat, rnorm, rnormax, anormax;
+	float *filtdat = NULL, *rnorm = NULL;
+	float filtin, rnormax, anormax;
+	struct CONV_PLAN *plan = NULL;
 	FILE *f_filter = NULL, *f_input = NULL;
 	struct PRM p;
 	void *API = NULL;            /* GMT control structure */
@@ -301,6 +303,13 @@ int main(int argc, char **argv) {
 	norm = 0.0f;
 	if (fabs(rnormax) > 0.05 * anormax)
 		norm = 1.0f;
+
+	/* work out once whether the filter is separable or big enough for the fft */
+	plan = conv2d_plan(filter, yarr, xarr);
+	nout = (int)floor(xmax / inc[GMT_X]);
+	if ((filtdat = (float *)malloc(sizeof(float) * (ibuff / idec + 2) * nout)) == NULL ||
+	    (rnorm = (float *)malloc(sizeof(float) * (ibuff / idec + 2) * nout)) == NULL)
+		die("memory allocation", "");
 	ic0 = 0;
 	iend = ylen = ibuff;
 
@@ -342,30 +351,37 @@ int main(int argc, char **argv) {
 				read_SLC_float(cfdat, xdim, f_input, yarr, buffer, DFACT, iread);
 
 		} /* end of ic loop */
-		left_node = GMT_Get_Index(API, Out->header, row, 0);
-		jout = 0;
+		/* rows that can be done before the buffer has to move again */
+		for (nrow = 1; ic + nrow * idec < iout * idec; nrow++) {
+			ic1 = ic + nrow * idec;
+			if ((ic1 + yarr2) >= iend && (ic1 + yarr2) < (ydim - 1))
+				break;
+		}
 		ic1 = ic - ic0;
 
 		/* now do the 2d convolution */
-		for (jc = 0; jc < floor(xmax / inc[GMT_X]) * jdec; jc = jc + jdec) {
-			conv2d(buffer, &ylen, &xdim, filter, &yarr, &xarr, &filtdat, &ic1, &jc, &rnorm);
-			/* use a zero or null value if there is not enough data in the filter */
-			Out->data[left_node + jout] = 0.0f;
-			if (norm > 0) {
-				if (fabs(rnorm) > (0.01 * rnormax))
-					Out->data[left_node + jout] = filtdat / rnorm;
-			}
-			else {
-				if (fabs(rnorm) < 0.0001 * anormax)
-					Out->data[left_node + jout] = filtdat;
+		conv2d_rows(plan, buffer, ylen, xdim, ic1, idec, nrow, jdec, nout, filtdat, rnorm);
+		for (k = 0; k < nrow; k++) {
+			left_node = GMT_Get_Index(API, Out->header, row, 0);
+			for (jout = 0; jout < nout; jout++) {
+				i = k * nout + jout;
+				/* use a zero or null value if there is not enough data in the filter */
+				Out->data[left_node + jout] = 0.0f;
+				if (norm > 0) {
+					if (fabs(rnorm[i]) > (0.01 * rnormax))
+						Out->data[left_node + jout] = filtdat[i] / rnorm[i];
+				}
+				else {
+					if (fabs(rnorm[i]) < 0.0001 * anormax)
+						Out->data[left_node + jout] = filtdat[i];
+				}
 			}
-
-			jout++;
-
-		} /* end of jc loop */
-		row++;
+			row++;
+		}
+		ic = ic + (nrow - 1) * idec;
 	} /* end of data loop */
 	fclose(f_input);
+	conv2d_plan_destroy(plan);
 
 	if (GMT_Write_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_ALL, NULL, output_name, Out)) {
 		die("Failed to write output grid", "");
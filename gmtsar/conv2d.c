@@ -16,6 +16,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "gmtsar.h"
 #include "lib_functions.h"
 #define min(x, y) (((x) < (y)) ? (x) : (y))
 #define max(x, y) (((x) > (y)) ? (x) : (y))
@@ -65,3 +66,355 @@ void conv2d(float *rdat, int *ni, int *nj, float *filt, int *nif, int *njf, floa
 		}
 	}
 }
+
+/************************************************************************
+ * conv2d_plan looks at a filter once so that conv2d_rows can apply it   *
+ * faster than the direct sum of conv2d:                                 *
+ *   - as a few separable 1-D passes when an svd shows it is (close to)  *
+ *     low rank, which is the case for the gaussian filters               *
+ *   - by overlap-save fft on square tiles when it is large               *
+ * conv2d_rows picks the cheapest of the three for the decimation asked  *
+ * for and returns the same fdat and rnorm as conv2d, to float accuracy  *
+ ************************************************************************/
+/************************************************************************
+ * Modification history:                                                 *
+ *                                                                       *
+ * Date                                                                  *
+ * 10/17/26     Added conv2d_plan and conv2d_rows                        *
+ ************************************************************************/
+
+#define CONV_SVD_TOL 1.0e-6 /* rms misfit of the separable filter relative to the rms of the filter */
+#define CONV_FFT_MIN 64     /* filters with fewer coefficients are never done by fft */
+#define CONV_FFT_MAX 1024   /* largest fft tile */
+
+/*--------------------------------------------------------------*/
+/* one-sided Jacobi svd of the m by n array a (row major)        */
+/* on return a holds U*S, w holds V (n by n) and s the singular  */
+/* values, so that the input a = sum_k a[.][k] w[.][k]           */
+/*--------------------------------------------------------------*/
+static void conv_svd(int m, int n, double *a, double *w, double *s) {
+	int i, j, k, sweep, rotated;
+	double alpha, beta, gamma, zeta, t, c, sn, x, y;
+
+	for (j = 0; j < n; j++)
+		for (k = 0; k < n; k++)
+			w[j * n + k] = (j == k) ? 1.0 : 0.0;
+
+	for (sweep = 0; sweep < 60; sweep++) {
+		rotated = 0;
+		for (j = 0; j < n - 1; j++) {
+			for (k = j + 1; k < n; k++) {
+				alpha = beta = gamma = 0.0;
+				for (i = 0; i < m; i++) {
+					alpha += a[i * n + j] * a[i * n + j];
+					beta += a[i * n + k] * a[i * n + k];
+					gamma += a[i * n + j] * a[i * n + k];
+				}
+				if (fabs(gamma) <= 1.0e-15 * sqrt(alpha * beta))
+					continue;
+				rotated = 1;
+				zeta = (beta - alpha) / (2.0 * gamma);
+				t = ((zeta >= 0.0) ? 1.0 : -1.0) / (fabs(zeta) + sqrt(1.0 + zeta * zeta));
+				c = 1.0 / sqrt(1.0 + t * t);
+				sn = c * t;
+				for (i = 0; i < m; i++) {
+					x = a[i * n + j];
+					y = a[i * n + k];
+					a[i * n + j] = c * x - sn * y;
+					a[i * n + k] = sn * x + c * y;
+				}
+				for (i = 0; i < n; i++) {
+					x = w[i * n + j];
+					y = w[i * n + k];
+					w[i * n + j] = c * x - sn * y;
+					w[i * n + k] = sn * x + c * y;
+				}
+			}
+		}
+		if (!rotated)
+			break;
+	}
+
+	for (j = 0; j < n; j++) {
+		for (i = 0, s[j] = 0.0; i < m; i++)
+			s[j] += a[i * n + j] * a[i * n + j];
+		s[j] = sqrt(s[j]);
+	}
+}
+
+/*--------------------------------------------------------------*/
+struct CONV_PLAN *conv2d_plan(float *filt, int nif, int njf) {
+	int i, j, k, kmax, n, mx;
+	double *a, *w, *s, total, rest;
+	struct CONV_PLAN *p;
+
+	if ((nif & 1) == 0 || (njf & 1) == 0) {
+		fprintf(stderr, " nif njf %d %d should be odd \n", nif, njf);
+		exit(-1);
+	}
+	if ((p = (struct CONV_PLAN *)calloc(1, sizeof(struct CONV_PLAN))) == NULL)
+		die("conv2d_plan: ", "out of memory");
+	p->nif = nif;
+	p->njf = njf;
+	n = nif * njf;
+	p->filt = (float *)malloc(n * sizeof(float));
+	p->fsat = (double *)calloc((nif + 1) * (njf + 1), sizeof(double));
+	a = (double *)malloc(n * sizeof(double));
+	w = (double *)malloc(njf * njf * sizeof(double));
+	s = (double *)malloc(njf * sizeof(double));
+	if (p->filt == NULL || p->fsat == NULL || a == NULL || w == NULL || s == NULL)
+		die("conv2d_plan: ", "out of memory");
+
+	/* summed area table gives the filter sum over any clipped window */
+	for (i = 0; i < nif; i++) {
+		for (j = 0; j < njf; j++) {
+			p->filt[i * njf + j] = filt[i * njf + j];
+			a[i * njf + j] = filt[i * njf + j];
+			p->fsat[(i + 1) * (njf + 1) + j + 1] =
+			    filt[i * njf + j] + p->fsat[i * (njf + 1) + j + 1] + p->fsat[(i + 1) * (njf + 1) + j] - p->fsat[i * (njf + 1) + j];
+		}
+	}
+
+	/* keep the fewest singular vectors that reproduce the filter */
+	conv_svd(nif, njf, a, w, s);
+	for (j = 0, total = 0.0; j < njf; j++)
+		total += s[j] * s[j];
+	if (total > 0.0) {
+		p->u = (float *)malloc(njf * nif * sizeof(float));
+		p->v = (float *)malloc(njf * njf * sizeof(float));
+		if (p->u == NULL || p->v == NULL)
+			die("conv2d_plan: ", "out of memory");
+		rest = total;
+		while (rest > CONV_SVD_TOL * CONV_SVD_TOL * total && p->rank < njf) {
+			for (j = 0, kmax = -1; j < njf; j++)
+				if (s[j] >= 0.0 && (kmax < 0 || s[j] > s[kmax]))
+					kmax = j;
+			for (i = 0; i < nif; i++)
+				p->u[p->rank * nif + i] = (float)a[i * njf + kmax];
+			for (k = 0; k < njf; k++)
+				p->v[p->rank * njf + k] = (float)w[k * njf + kmax];
+			rest -= s[kmax] * s[kmax];
+			s[kmax] = -1.0;
+			p->rank++;
+		}
+	}
+	free(a);
+	free(w);
+	free(s);
+
+	/* spectrum of the flipped filter for the fft path, zero padded to the tile */
+	mx = MAX(nif, njf);
+	if (n >= CONV_FFT_MIN) {
+		for (p->nfft = 64; p->nfft < 4 * mx && p->nfft < CONV_FFT_MAX; p->nfft *= 2)
+			;
+		if (p->nfft <= 2 * mx) {
+			p->nfft = 0;
+		}
+		else {
+			if ((p->fhat = (struct FCOMPLEX *)calloc(p->nfft * p->nfft, sizeof(struct FCOMPLEX))) == NULL)
+				die("conv2d_plan: ", "out of memory");
+			for (i = 0; i < nif; i++)
+				for (j = 0; j < njf; j++)
+					p->fhat[((p->nfft - i) % p->nfft) * p->nfft + (p->nfft - j) % p->nfft].r = filt[i * njf + j];
+			fft_plan_2d(NULL, fft_plan_get(p->nfft, GMT_FFT_FWD), fft_plan_get(p->nfft, GMT_FFT_FWD), p->fhat, p->nfft, p->nfft);
+		}
+	}
+
+	return (p);
+}
+
+/*--------------------------------------------------------------*/
+void conv2d_plan_destroy(struct CONV_PLAN *p) {
+	if (p == NULL)
+		return;
+	free(p->filt);
+	free(p->fsat);
+	if (p->u)
+		free(p->u);
+	if (p->v)
+		free(p->v);
+	if (p->fhat)
+		free(p->fhat);
+	free(p);
+}
+
+/*--------------------------------------------------------------*/
+/* sum of the filter over the part of the window inside the data */
+static float conv_rnorm(struct CONV_PLAN *p, int ni, int nj, int ic, int jc) {
+	int a0, a1, b0, b1, n1 = p->njf + 1;
+
+	a0 = max(0, ic - p->nif / 2) - ic + p->nif / 2;
+	a1 = min(ni, ic + p->nif / 2) - ic + p->nif / 2 + 1;
+	b0 = max(0, jc - p->njf / 2) - jc + p->njf / 2;
+	b1 = min(nj, jc + p->njf / 2) - jc + p->njf / 2 + 1;
+	if (a1 <= a0 || b1 <= b0)
+		return (0.0f);
+	return ((float)(p->fsat[a1 * n1 + b1] - p->fsat[a0 * n1 + b1] - p->fsat[a1 * n1 + b0] + p->fsat[a0 * n1 + b0]));
+}
+
+/*--------------------------------------------------------------*/
+/* separable passes: down the columns with u_k, then along the row with v_k */
+static void conv2d_rows_sep(struct CONV_PLAN *p, float *rdat, int ni, int nj, int ic, int idec, int nrow, int jdec, int nout,
+                            float *fdat, float *rnorm) {
+	int i, j, k, m, t, icr, jc, i0, i1, j0, j1, jmax;
+	int nif2 = p->nif / 2, njf2 = p->njf / 2;
+	float w, sum, *ut, *vt, *row, *col;
+
+	if ((col = (float *)malloc((nj + 1) * sizeof(float))) == NULL)
+		die("conv2d_rows: ", "out of memory");
+
+	jmax = min(nj, (nout - 1) * jdec + njf2);
+	for (k = 0; k < nrow; k++) {
+		icr = ic + k * idec;
+		i0 = max(0, icr - nif2);
+		i1 = min(ni, icr + nif2);
+		for (m = 0; m < nout; m++) {
+			fdat[k * nout + m] = 0.0f;
+			rnorm[k * nout + m] = conv_rnorm(p, ni, nj, icr, m * jdec);
+		}
+		for (t = 0; t < p->rank; t++) {
+			ut = &p->u[t * p->nif];
+			vt = &p->v[t * p->njf];
+
+			/* rows are addressed as in conv2d, so column nj is the start of the next row */
+			for (j = 0; j <= jmax; j++)
+				col[j] = 0.0f;
+			for (i = i0; i <= i1; i++) {
+				w = ut[i - icr + nif2];
+				row = &rdat[(size_t)nj * i];
+				for (j = 0; j <= jmax; j++)
+					col[j] += w * row[j];
+			}
+
+			for (m = 0; m < nout; m++) {
+				jc = m * jdec;
+				j0 = max(0, jc - njf2);
+				j1 = min(nj, jc + njf2);
+				for (j = j0, sum = 0.0f; j <= j1; j++)
+					sum += vt[j - jc + njf2] * col[j];
+				fdat[k * nout + m] += sum;
+			}
+		}
+	}
+	free(col);
+}
+
+/*--------------------------------------------------------------*/
+/* overlap-save fft for the outputs whose window is inside the    */
+/* data, conv2d for the ones near the edges                      */
+/*--------------------------------------------------------------*/
+static void conv2d_rows_fft(struct CONV_PLAN *p, float *rdat, int ni, int nj, int ic, int idec, int nrow, int jdec, int nout,
+                            float *fdat, float *rnorm) {
+	int i, j, k, m, r, c, T, sr, sc, icr, jc, ii, jj;
+	int nif2 = p->nif / 2, njf2 = p->njf / 2;
+	int k0, k1, m0, m1, ka, kb, ma, mb, orow, ocol;
+	float fsum;
+	struct FCOMPLEX *tile, z;
+	struct FFT_PLAN *fwd, *inv;
+
+	T = p->nfft;
+	sr = T - p->nif + 1;
+	sc = T - p->njf + 1;
+	fsum = conv_rnorm(p, p->nif, p->njf, nif2, njf2);
+
+	/* rows k0..k1 and columns m0..m1 have the whole window inside the data */
+	for (k0 = 0; k0 < nrow && ic + k0 * idec - nif2 < 0; k0++)
+		;
+	for (k1 = nrow - 1; k1 >= k0 && ic + k1 * idec + nif2 > ni - 1; k1--)
+		;
+	for (m0 = 0; m0 < nout && m0 * jdec - njf2 < 0; m0++)
+		;
+	for (m1 = nout - 1; m1 >= m0 && m1 * jdec + njf2 > nj - 1; m1--)
+		;
+
+	for (k = 0; k < nrow; k++) {
+		for (m = 0; m < nout; m++) {
+			if (k >= k0 && k <= k1 && m >= m0 && m <= m1)
+				continue;
+			icr = ic + k * idec;
+			jc = m * jdec;
+			conv2d(rdat, &ni, &nj, p->filt, &p->nif, &p->njf, &fdat[k * nout + m], &icr, &jc, &rnorm[k * nout + m]);
+		}
+	}
+	if (k1 < k0 || m1 < m0)
+		return;
+
+	if ((tile = (struct FCOMPLEX *)malloc(T * T * sizeof(struct FCOMPLEX))) == NULL)
+		die("conv2d_rows: ", "out of memory");
+	fwd = fft_plan_get(T, GMT_FFT_FWD);
+	inv = fft_plan_get(T, GMT_FFT_INV);
+
+	/* each tile gives sr by sc full resolution outputs starting at orow, ocol */
+	for (ka = k0; ka <= k1; ka = kb + 1) {
+		orow = ic + ka * idec;
+		for (kb = ka; kb < k1 && ic + (kb + 1) * idec < orow + sr; kb++)
+			;
+		for (ma = m0; ma <= m1; ma = mb + 1) {
+			ocol = ma * jdec;
+			for (mb = ma; mb < m1 && (mb + 1) * jdec < ocol + sc; mb++)
+				;
+
+			for (r = 0; r < T; r++) {
+				ii = orow - nif2 + r;
+				for (c = 0; c < T; c++) {
+					jj = ocol - njf2 + c;
+					tile[r * T + c].r = (ii < ni && jj < nj) ? rdat[(size_t)nj * ii + jj] : 0.0f;
+					tile[r * T + c].i = 0.0f;
+				}
+			}
+			fft_plan_2d(NULL, fwd, fwd, tile, T, T);
+			for (i = 0; i < T * T; i++) {
+				z = tile[i];
+				tile[i].r = z.r * p->fhat[i].r - z.i * p->fhat[i].i;
+				tile[i].i = z.r * p->fhat[i].i + z.i * p->fhat[i].r;
+			}
+			fft_plan_2d(NULL, inv, inv, tile, T, T);
+
+			for (k = ka; k <= kb; k++) {
+				r = ic + k * idec - orow;
+				for (m = ma; m <= mb; m++) {
+					j = m * jdec - ocol;
+					fdat[k * nout + m] = tile[r * T + j].r;
+					rnorm[k * nout + m] = fsum;
+				}
+			}
+		}
+	}
+	free(tile);
+}
+
+/*--------------------------------------------------------------*/
+/* filter nrow output rows centred on rows ic, ic+idec, ... of   */
+/* rdat (ni by nj) at columns 0, jdec, ... (nout of them)        */
+/* fdat and rnorm are nrow by nout, as conv2d would give them    */
+/*--------------------------------------------------------------*/
+void conv2d_rows(struct CONV_PLAN *p, float *rdat, int ni, int nj, int ic, int idec, int nrow, int jdec, int nout, float *fdat,
+                 float *rnorm) {
+	int k, m, icr, jc;
+	double cost_direct, cost_sep, cost_fft, n2;
+
+	/* rough cost per output in multiply-adds */
+	cost_direct = (double)p->nif * p->njf;
+	cost_sep = (p->rank > 0) ? (double)p->rank * (p->nif * jdec + p->njf) : cost_direct + 1.0;
+	cost_fft = cost_direct + 1.0;
+	if (p->nfft > 0 && nrow * idec >= (p->nfft - p->nif + 1) / 2) {
+		n2 = (double)p->nfft * p->nfft;
+		cost_fft = (5.0 * n2 * log2(n2) + 2.0 * n2) * idec * jdec / ((double)(p->nfft - p->nif + 1) * (p->nfft - p->njf + 1));
+	}
+
+	if (cost_sep <= cost_direct && cost_sep <= cost_fft) {
+		conv2d_rows_sep(p, rdat, ni, nj, ic, idec, nrow, jdec, nout, fdat, rnorm);
+	}
+	else if (cost_fft < cost_direct) {
+		conv2d_rows_fft(p, rdat, ni, nj, ic, idec, nrow, jdec, nout, fdat, rnorm);
+	}
+	else {
+		for (k = 0; k < nrow; k++) {
+			icr = ic + k * idec;
+			for (m = 0; m < nout; m++) {
+				jc = m * jdec;
+				conv2d(rdat, &ni, &nj, p->filt, &p->nif, &p->njf, &fdat[k * nout + m], &icr, &jc, &rnorm[k * nout + m]);
+			}
+		}
+	}
+}
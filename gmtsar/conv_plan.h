@@ -0,0 +1,16 @@
+/*	$Id$	*/
+/* conv2d plans - the filter analysed once to pick the fastest way to apply it */
+#ifndef CONV_PLAN_H
+#define CONV_PLAN_H
+#include "sfd_complex.h"
+
+struct CONV_PLAN {
+	int nif, njf;          /* filter rows and columns, both odd */
+	float *filt;           /* the filter, nif by njf */
+	double *fsat;          /* summed area table of the filter, (nif+1) by (njf+1) */
+	int rank;              /* terms in the separable approximation, 0 if none is close enough */
+	float *u, *v;          /* rank columns of nif and rank rows of njf, filt ~ sum u_k v_k */
+	int nfft;              /* tile size of the fft path, 0 if the filter is too small for it */
+	struct FCOMPLEX *fhat; /* fft of the flipped filter on an nfft by nfft tile */
+};
+#endif /* CONV_PLAN_H */
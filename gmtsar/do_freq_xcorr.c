@@ -8,32 +8,31 @@
 #include <math.h>
 
 /*-------------------------------------------------------------------------------*/
-void fft_multiply(void *API, int N, int M, struct FCOMPLEX *c1, struct FCOMPLEX *c2, struct FCOMPLEX *c3) {
+void fft_multiply(void *API, struct xcorr *xc, int N, int M, struct FCOMPLEX *c1, struct FCOMPLEX *c2, struct FCOMPLEX *c3) {
 	int i, j, isign;
+	struct FCOMPLEX a, b;
 
 	/* do forward fft 					*/
-	GMT_FFT_2D(API, (float *)c1, N, M, GMT_FFT_FWD, GMT_FFT_COMPLEX);
-	GMT_FFT_2D(API, (float *)c2, N, M, GMT_FFT_FWD, GMT_FFT_COMPLEX);
+	/* in batch mode the master spectrum is computed once	*/
+	if (!xc->master_fft)
+		fft_plan_2d(API, xc->fx, xc->fy, c1, N, M);
+	fft_plan_2d(API, xc->fx, xc->fy, c2, N, M);
 
 	/* multiply a with conj(b)				*/
-	/* the isign should shift the results appropriately	*/
-	/* normalize by absolute values				*/
+	/* the sign (-1)^(i+j) shifts the zero lag to the	*/
+	/* center; it starts at +-1 on each row and alternates	*/
 	for (i = 0; i < M; i++) {
-		for (j = 0; j < N; j++) {
-			isign = (int)lrint(pow(-1.0, (double)(i + j)));
-			c3[i * N + j] = RCmul(isign, Cmul((c1[i * N + j]), (Conjg(c2[i * N + j]))));
-			/*
-			                        if (norm_flag) {
-			                                c3[i*N + j] = RCmul(1.0/Cabs(c3[i*N +
-			   j]),c3[i*N + j]); if isnan(c3[i*N + j].r) c3[i*N + j].r = 0.0; if
-			   isnan(c3[i*N + j].i) c3[i*N + j].i = 0.0;
-			                                }
-			*/
+		isign = (i & 1) ? -1 : 1;
+		for (j = 0; j < N; j++, isign = -isign) {
+			a = c1[i * N + j];
+			b = c2[i * N + j];
+			c3[i * N + j].r = isign * (a.r * b.r + a.i * b.i);
+			c3[i * N + j].i = isign * (a.i * b.r - a.r * b.i);
 		}
 	}
 
 	/* inverse fft  for cross-correlation (c matrix) 	*/
-	GMT_FFT_2D(API, (float *)c3, N, M, GMT_FFT_INV, GMT_FFT_COMPLEX);
+	fft_plan_2d(API, xc->ix, xc->iy, c3, N, M);
 }
 /*-------------------------------------------------------------------------------*/
 void do_freq_corr(void *API, struct xcorr *xc, int iloc) {
@@ -54,7 +53,7 @@ void do_freq_corr(void *API, struct xcorr *xc, int iloc) {
 		print_complex(xc->c2, xc->npy, xc->npx, 1);
 
 	/* multiply c1 and c2 uisng fft */
-	fft_multiply(API, xc->npx, xc->npy, xc->c1, xc->c2, xc->c3);
+	fft_multiply(API, xc, xc->npx, xc->npy, xc->c1, xc->c2, xc->c3);
 
 	/* transfer results into correlation matrix		*/
 	for (i = 0; i < xc->nyc; i++) {
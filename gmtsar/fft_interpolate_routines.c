@@ -30,7 +30,11 @@
 /*											*/
 /*	all vectors and matrices must be pre-allocated
  */
-/*	all use the SIO fcomplex and call GMT_FFT_1D or GMT_FFT_2D
+/*	all use the SIO fcomplex and the fft plans in fft_plan.c
+ */
+/*	the plain versions take plans from the process wide cache,
+ */
+/*	the _plan versions take plans from the caller
  */
 /* 	fcomplex - struct {float r; float i} where r is real and i imag
  */
@@ -54,38 +58,53 @@ void fft_arrange_interpolate(struct FCOMPLEX *in, int N, struct FCOMPLEX *out, i
 }
 /*------------------------------------------------------------------------*/
 void fft_interpolate_1d(void *API, struct FCOMPLEX *in, int N, struct FCOMPLEX *out, int ifactor) {
+
+	/* plans are built on first use of each length and then reused */
+	fft_interpolate_1d_plan(API, fft_plan_get(N, GMT_FFT_FWD), fft_plan_get(ifactor * N, GMT_FFT_INV), in, N, out, ifactor);
+}
+/*--------------------------------------------------------------------------------------*/
+void fft_interpolate_2d(void *API, struct FCOMPLEX *in, int N1, int M1, struct FCOMPLEX *out, int N, int M, int ifactor) {
+#if 0
+	/* sanity checks */
+	if (N != (N1 * ifactor)) error_flag = 1;
+	if (M != (M1 * ifactor)) error_flag = 1;
+#endif
+	if (debug)
+		print_complex(in, N1, M1, 0);
+
+	fft_interpolate_2d_plan(API, fft_plan_get(M1, GMT_FFT_FWD), fft_plan_get(M, GMT_FFT_INV), fft_plan_get(N1, GMT_FFT_FWD),
+	                        fft_plan_get(N, GMT_FFT_INV), in, N1, M1, out, N, M, ifactor);
+
+	if (debug)
+		print_complex(out, N, M, 0);
+}
+/*--------------------------------------------------------------------------------------*/
+/* same as fft_interpolate_1d using plans of length N (fwd) and ifactor*N (inv)	*/
+void fft_interpolate_1d_plan(void *API, struct FFT_PLAN *fwd, struct FFT_PLAN *inv, struct FCOMPLEX *in, int N, struct FCOMPLEX *out,
+                             int ifactor) {
 	int i, M;
 
 	M = ifactor * N;
 
-	/* forward fft */
-	// dir = -1;
-	// cfft1d_(&N, in, &dir);
-	GMT_FFT_1D(API, (float *)in, N, GMT_FFT_FWD, GMT_FFT_COMPLEX);
+	fft_plan_1d(API, fwd, in, 1);
 
-	/* re-arrange values in fft */
 	fft_arrange_interpolate(in, N, out, M, ifactor);
 
-	/* backward fft */
-	// dir = 1;
-	// cfft1d_(&M, out, &dir);
-	GMT_FFT_1D(API, (float *)out, M, GMT_FFT_INV, GMT_FFT_COMPLEX);
+	fft_plan_1d(API, inv, out, 1);
 
-	/* scale amplitude */
 	for (i = 0; i < M; i++) {
 		out[i].r = ((float)ifactor) * out[i].r;
 		out[i].i = ((float)ifactor) * out[i].i;
 	}
 }
 /*--------------------------------------------------------------------------------------*/
-void fft_interpolate_2d(void *API, struct FCOMPLEX *in, int N1, int M1, struct FCOMPLEX *out, int N, int M, int ifactor) {
+/* same as fft_interpolate_2d; row plans have length M1 and M, column plans N1 and N	*/
+void fft_interpolate_2d_plan(void *API, struct FFT_PLAN *fwd_row, struct FFT_PLAN *inv_row, struct FFT_PLAN *fwd_col,
+                             struct FFT_PLAN *inv_col, struct FCOMPLEX *in, int N1, int M1, struct FCOMPLEX *out, int N, int M,
+                             int ifactor) {
 	int i, j;
 	struct FCOMPLEX *tmp1, *tmp2, *tmp3;
-#if 0
-	/* sanity checks */
-	if (N != (N1 * ifactor)) error_flag = 1;
-	if (M != (M1 * ifactor)) error_flag = 1;
-#endif
+
 	tmp1 = (struct FCOMPLEX *)malloc(N1 * M * sizeof(struct FCOMPLEX));
 	tmp2 = (struct FCOMPLEX *)malloc(N1 * sizeof(struct FCOMPLEX));
 	tmp3 = (struct FCOMPLEX *)malloc(N * sizeof(struct FCOMPLEX));
@@ -93,27 +112,17 @@ void fft_interpolate_2d(void *API, struct FCOMPLEX *in, int N1, int M1, struct F
 	for (i = 0; i < N1 * M; i++)
 		tmp1[i].i = tmp1[i].r = 0.0f;
 
-	if (debug)
-		print_complex(in, N1, M1, 0);
-
 	for (i = 0; i < N1; i++)
-		fft_interpolate_1d(API, &in[i * M1], M1, &tmp1[i * M], ifactor);
-
-	if (debug)
-		print_complex(tmp1, N1, M, 0);
+		fft_interpolate_1d_plan(API, fwd_row, inv_row, &in[i * M1], M1, &tmp1[i * M], ifactor);
 
-	/* now do columns - need to transpose */
 	for (i = 0; i < M; i++) {
 		for (j = 0; j < N1; j++)
 			tmp2[j] = tmp1[j * M + i];
-		fft_interpolate_1d(API, tmp2, N1, tmp3, ifactor);
+		fft_interpolate_1d_plan(API, fwd_col, inv_col, tmp2, N1, tmp3, ifactor);
 		for (j = 0; j < N; j++)
 			out[j * M + i] = tmp3[j];
 	}
 
-	if (debug)
-		print_complex(out, N, M, 0);
-
 	free((char *)tmp1);
 	free((char *)tmp2);
 	free((char *)tmp3);
@@ -0,0 +1,169 @@
+/*	$Id$	*/
+/*--------------------------------------------------------------------------------------*/
+/* fft plans that can be built once and executed many times				*/
+/*											*/
+/* fft_plan_create(n, direction)	precompute twiddles and bit reversal for	*/
+/*					a complex transform of length n			*/
+/* fft_plan_get(n, direction)		same but cached for the life of the process,	*/
+/*					so each (n, direction) is only planned once	*/
+/* fft_plan_1d(API, p, data, stride)	in-place transform of n samples spaced by	*/
+/*					stride, inverse is scaled by 1/n		*/
+/* fft_plan_2d(API, px, py, data, nx, ny)	2D transform as rows then columns	*/
+/*											*/
+/*	same sign and scaling conventions as GMT_FFT_1D and GMT_FFT_2D		*/
+/*	a plan is read-only once created so threads may execute it concurrently	*/
+/*	lengths that are not a power of two are passed on to GMT_FFT_1D,		*/
+/*	one call at a time since the GMT fft (fftw planner) is not thread safe	*/
+/*--------------------------------------------------------------------------------------*/
+#include "gmtsar.h"
+#include "fft_plan.h"
+
+/* cache of plans handed out by fft_plan_get, never freed */
+#define MAX_CACHED_PLANS 64
+static struct FFT_PLAN *cached_plans[MAX_CACHED_PLANS];
+static int n_cached_plans = 0;
+
+/*------------------------------------------------------------------------*/
+struct FFT_PLAN *fft_plan_create(int n, int direction) {
+	int i, j, nbits;
+	double arg, sign;
+	struct FFT_PLAN *p;
+
+	if ((p = (struct FFT_PLAN *)calloc(1, sizeof(struct FFT_PLAN))) == NULL)
+		die("fft_plan_create: ", "out of memory");
+
+	p->n = n;
+	p->direction = direction;
+	p->radix2 = (n > 1 && (n & (n - 1)) == 0);
+	if (!p->radix2)
+		return (p);
+
+	for (nbits = 0; (1 << nbits) < n; nbits++)
+		;
+
+	p->bitrev = (int *)malloc(n * sizeof(int));
+	p->w = (struct FCOMPLEX *)malloc((n / 2) * sizeof(struct FCOMPLEX));
+	if (p->bitrev == NULL || p->w == NULL)
+		die("fft_plan_create: ", "out of memory");
+
+	for (i = 0; i < n; i++) {
+		for (j = 0, p->bitrev[i] = 0; j < nbits; j++)
+			if (i & (1 << j))
+				p->bitrev[i] |= 1 << (nbits - 1 - j);
+	}
+
+	/* forward uses exp(-i), inverse exp(+i) like GMT */
+	sign = (direction == GMT_FFT_FWD) ? -1.0 : 1.0;
+	for (i = 0; i < n / 2; i++) {
+		arg = sign * 2.0 * M_PI * (double)i / (double)n;
+		p->w[i].r = (float)cos(arg);
+		p->w[i].i = (float)sin(arg);
+	}
+
+	return (p);
+}
+/*------------------------------------------------------------------------*/
+struct FFT_PLAN *fft_plan_get(int n, int direction) {
+	int k;
+	struct FFT_PLAN *p = NULL;
+
+#pragma omp critical(gmtsar_fft_plan)
+	{
+		for (k = 0; k < n_cached_plans && p == NULL; k++)
+			if (cached_plans[k]->n == n && cached_plans[k]->direction == direction)
+				p = cached_plans[k];
+		if (p == NULL) {
+			p = fft_plan_create(n, direction);
+			if (n_cached_plans < MAX_CACHED_PLANS) {
+				p->cached = 1;
+				cached_plans[n_cached_plans++] = p;
+			}
+		}
+	}
+
+	return (p);
+}
+/*------------------------------------------------------------------------*/
+/* cached plans are shared and stay alive until exit */
+/* a plan from fft_plan_get only needs destroying when the cache was full */
+void fft_plan_destroy(struct FFT_PLAN *p) {
+	if (p == NULL || p->cached)
+		return;
+	if (p->bitrev)
+		free(p->bitrev);
+	if (p->w)
+		free(p->w);
+	free(p);
+}
+/*------------------------------------------------------------------------*/
+void fft_plan_1d(void *API, struct FFT_PLAN *p, struct FCOMPLEX *d, int stride) {
+	int i, j, k, n, len, half, step;
+	float scale;
+	struct FCOMPLEX a, b, t, w, *tmp;
+
+	n = p->n;
+
+	if (!p->radix2) {
+		if (stride == 1) {
+#pragma omp critical(gmtsar_gmt_fft)
+			GMT_FFT_1D(API, (float *)d, n, p->direction, GMT_FFT_COMPLEX);
+			return;
+		}
+		tmp = (struct FCOMPLEX *)malloc(n * sizeof(struct FCOMPLEX));
+		for (i = 0; i < n; i++)
+			tmp[i] = d[i * stride];
+#pragma omp critical(gmtsar_gmt_fft)
+		GMT_FFT_1D(API, (float *)tmp, n, p->direction, GMT_FFT_COMPLEX);
+		for (i = 0; i < n; i++)
+			d[i * stride] = tmp[i];
+		free(tmp);
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		if ((j = p->bitrev[i]) > i) {
+			t = d[i * stride];
+			d[i * stride] = d[j * stride];
+			d[j * stride] = t;
+		}
+	}
+
+	/* radix-2 butterflies */
+	for (len = 2; len <= n; len <<= 1) {
+		half = len / 2;
+		step = n / len;
+		for (i = 0; i < n; i += len) {
+			for (k = 0; k < half; k++) {
+				w = p->w[k * step];
+				a = d[(i + k) * stride];
+				b = d[(i + k + half) * stride];
+				t.r = b.r * w.r - b.i * w.i;
+				t.i = b.r * w.i + b.i * w.r;
+				d[(i + k) * stride].r = a.r + t.r;
+				d[(i + k) * stride].i = a.i + t.i;
+				d[(i + k + half) * stride].r = a.r - t.r;
+				d[(i + k + half) * stride].i = a.i - t.i;
+			}
+		}
+	}
+
+	if (p->direction == GMT_FFT_INV) {
+		scale = 1.0f / (float)n;
+		for (i = 0; i < n; i++) {
+			d[i * stride].r *= scale;
+			d[i * stride].i *= scale;
+		}
+	}
+}
+/*------------------------------------------------------------------------*/
+/* data is ny rows of nx complex values; px has length nx, py length ny   */
+void fft_plan_2d(void *API, struct FFT_PLAN *px, struct FFT_PLAN *py, struct FCOMPLEX *d, int nx, int ny) {
+	int i, j;
+
+	for (i = 0; i < ny; i++)
+		fft_plan_1d(API, px, &d[i * nx], 1);
+
+	for (j = 0; j < nx; j++)
+		fft_plan_1d(API, py, &d[j], nx);
+}
+/*------------------------------------------------------------------------*/
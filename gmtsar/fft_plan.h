@@ -0,0 +1,15 @@
+/*	$Id$	*/
+/* reusable fft plans - twiddles and bit reversal computed once per size */
+#ifndef FFT_PLAN_H
+#define FFT_PLAN_H
+#include "sfd_complex.h"
+
+struct FFT_PLAN {
+	int n;               /* transform length */
+	int direction;       /* GMT_FFT_FWD or GMT_FFT_INV */
+	int radix2;          /* 1 if n is a power of two, else fall back to GMT */
+	int cached;          /* 1 if owned by the fft_plan_get cache */
+	int *bitrev;         /* bit reversal permutation (n) */
+	struct FCOMPLEX *w;  /* twiddle factors exp(-+2 pi i k/n) (n/2) */
+};
+#endif /* FFT_PLAN_H */
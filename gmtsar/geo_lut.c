@@ -0,0 +1,117 @@
+/*	$Id$	*/
+/*--------------------------------------------------------------------------------------*/
+/* geocoding lookup table i/o - see geo_lut.h for the layout				*/
+/*											*/
+/* geo_lut_read(file, g)		read a whole table				*/
+/* geo_lut_write(file, g)		write a whole table				*/
+/* geo_lut_ra(g, lon, lat, r, a)	range and azimuth at lon, lat by bilinear	*/
+/*					interpolation, returns 0 outside the table or	*/
+/*					next to a NaN node				*/
+/* geo_lut_free(g)			free the nodes					*/
+/*											*/
+/*	the table is written in native byte order					*/
+/*--------------------------------------------------------------------------------------*/
+#include "gmtsar.h"
+#include "geo_lut.h"
+
+/*------------------------------------------------------------------------*/
+void geo_lut_read(char *file, struct GEO_LUT *g) {
+	FILE *fp = NULL;
+	char magic[8];
+	size_t n;
+	int ok = 1;
+
+	memset(g, 0, sizeof(struct GEO_LUT));
+	if ((fp = fopen(file, "rb")) == NULL)
+		die("Can't open ", file);
+	if (fread(magic, 1, 8, fp) != 8 || strncmp(magic, GEO_LUT_MAGIC, 8))
+		die("not a geocoding lookup table: ", file);
+
+	ok &= fread(&g->version, sizeof(int32_t), 1, fp) == 1;
+	ok &= fread(&g->precise, sizeof(int32_t), 1, fp) == 1;
+	ok &= fread(&g->n_columns, sizeof(int64_t), 1, fp) == 1;
+	ok &= fread(&g->n_rows, sizeof(int64_t), 1, fp) == 1;
+	ok &= fread(g->wesn, sizeof(double), 4, fp) == 4;
+	ok &= fread(g->inc, sizeof(double), 2, fp) == 2;
+	ok &= fread(&g->n_rng, sizeof(int64_t), 1, fp) == 1;
+	ok &= fread(&g->n_azi, sizeof(int64_t), 1, fp) == 1;
+	if (!ok)
+		die("truncated header in ", file);
+	if (g->version != GEO_LUT_VERSION)
+		die("unsupported lookup table version in ", file);
+	if (g->n_columns < 2 || g->n_rows < 2)
+		die("bad lookup table dimensions in ", file);
+
+	n = (size_t)(2 * g->n_columns * g->n_rows);
+	if ((g->ra = (float *)malloc(n * sizeof(float))) == NULL)
+		die("memory allocation!", file);
+	if (fread(g->ra, sizeof(float), n, fp) != n)
+		die("truncated lookup table ", file);
+	fclose(fp);
+}
+/*------------------------------------------------------------------------*/
+void geo_lut_write(char *file, struct GEO_LUT *g) {
+	FILE *fp = NULL;
+	size_t n;
+	int ok = 1;
+
+	if ((fp = fopen(file, "wb")) == NULL)
+		die("Can't open ", file);
+	g->version = GEO_LUT_VERSION;
+	ok &= fwrite(GEO_LUT_MAGIC, 1, 8, fp) == 8;
+	ok &= fwrite(&g->version, sizeof(int32_t), 1, fp) == 1;
+	ok &= fwrite(&g->precise, sizeof(int32_t), 1, fp) == 1;
+	ok &= fwrite(&g->n_columns, sizeof(int64_t), 1, fp) == 1;
+	ok &= fwrite(&g->n_rows, sizeof(int64_t), 1, fp) == 1;
+	ok &= fwrite(g->wesn, sizeof(double), 4, fp) == 4;
+	ok &= fwrite(g->inc, sizeof(double), 2, fp) == 2;
+	ok &= fwrite(&g->n_rng, sizeof(int64_t), 1, fp) == 1;
+	ok &= fwrite(&g->n_azi, sizeof(int64_t), 1, fp) == 1;
+	n = (size_t)(2 * g->n_columns * g->n_rows);
+	ok &= fwrite(g->ra, sizeof(float), n, fp) == n;
+	if (fclose(fp) || !ok)
+		die("error writing ", file);
+}
+/*------------------------------------------------------------------------*/
+int geo_lut_ra(struct GEO_LUT *g, double lon, double lat, double *r, double *a) {
+	int64_t i, j, k;
+	double u, v, w00, w01, w10, w11;
+	float *p00, *p01, *p10, *p11;
+
+	u = (lon - g->wesn[GMT_XLO]) / g->inc[GMT_X];
+	v = (g->wesn[GMT_YHI] - lat) / g->inc[GMT_Y];
+	if (u < 0. || v < 0. || u > g->n_columns - 1 || v > g->n_rows - 1)
+		return (0);
+	j = (int64_t)u;
+	i = (int64_t)v;
+	if (j == g->n_columns - 1)
+		j--;
+	if (i == g->n_rows - 1)
+		i--;
+	u -= j;
+	v -= i;
+
+	k = i * g->n_columns + j;
+	p00 = &g->ra[2 * k];
+	p01 = &g->ra[2 * (k + 1)];
+	p10 = &g->ra[2 * (k + g->n_columns)];
+	p11 = &g->ra[2 * (k + g->n_columns + 1)];
+	if (isnan(p00[0]) || isnan(p01[0]) || isnan(p10[0]) || isnan(p11[0]))
+		return (0);
+
+	w00 = (1. - u) * (1. - v);
+	w01 = u * (1. - v);
+	w10 = (1. - u) * v;
+	w11 = u * v;
+	*r = w00 * p00[0] + w01 * p01[0] + w10 * p10[0] + w11 * p11[0];
+	*a = w00 * p00[1] + w01 * p01[1] + w10 * p10[1] + w11 * p11[1];
+
+	return (1);
+}
+/*------------------------------------------------------------------------*/
+void geo_lut_free(struct GEO_LUT *g) {
+	if (g->ra)
+		free(g->ra);
+	g->ra = NULL;
+}
+/*------------------------------------------------------------------------*/
@@ -0,0 +1,26 @@
+/*	$Id$	*/
+/* geocoding lookup table - range and azimuth of the master on a lon/lat grid */
+#ifndef GEO_LUT_H
+#define GEO_LUT_H
+#include <stdint.h>
+
+#define GEO_LUT_MAGIC "GMTSARGL" /* first 8 bytes of every table */
+#define GEO_LUT_VERSION 1
+
+/* the file is this header then the nodes top row first; each node holds	*/
+/* range and azimuth as two floats, NaN where the DEM had no elevation	*/
+/* between nodes range and azimuth are bilinear in lon and lat, with no	*/
+/* height term, which is good to a fraction of a pixel for resampling	*/
+/* products but far from the accuracy that the phase of an SLC needs	*/
+struct GEO_LUT {
+	int32_t version;   /* GEO_LUT_VERSION */
+	int32_t precise;   /* precise flag of the zero Doppler search */
+	int64_t n_columns; /* nodes per row */
+	int64_t n_rows;    /* rows of nodes */
+	double wesn[4];    /* region of the nodes (gridline registered) */
+	double inc[2];     /* node spacing in degrees */
+	int64_t n_rng;     /* range bins of the master image */
+	int64_t n_azi;     /* lines of the master image */
+	float *ra;         /* range, azimuth of every node (2 * n_columns * n_rows) */
+};
+#endif /* GEO_LUT_H */
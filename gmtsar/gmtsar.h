@@ -51,6 +51,11 @@
 		paka("error: malloc()  ");                                                                                               \
 	}
 
+#define KERNEL_STEPS 1024 /* tabulated interpolation kernels have a row every 1/1024 pixel */
+#define KERNEL_SINC 0
+#define KERNEL_CUBIC 1
+#define KERNEL_INVDIST 2
+
 #define NULL_DATA 15
 #define NULL_INT -99999
 #define NULL_DOUBLE -99999.9999
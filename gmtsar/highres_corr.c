@@ -40,7 +40,7 @@ void do_highres_corr(void *API, struct xcorr *xc, int iloc) {
 	if (debug)
 		print_complex(xc->md, nx, ny, 1);
 
-	fft_interpolate_2d(API, xc->md, ny, nx, xc->cd_exp, ny2, nx2, ifc);
+	fft_interpolate_2d_plan(API, xc->fhx, xc->ihx, xc->fhy, xc->ihy, xc->md, ny, nx, xc->cd_exp, ny2, nx2, ifc);
 
 	if (ifc <= 4)
 		print_complex(xc->cd_exp, nx2, ny2, 1);
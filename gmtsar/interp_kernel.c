@@ -0,0 +1,90 @@
+/*	$Id$	*/
+/*--------------------------------------------------------------------------------------*/
+/* interpolation kernels								*/
+/*											*/
+/* sinc_kernel(x)			sin(pi x) / (pi x)				*/
+/* cubic_kernel(x, a)			cubic convolution kernel, a in [-3, 0]		*/
+/* make_kernel_table(kernel, n, copies)	n tap weights every 1/KERNEL_STEPS pixel	*/
+/*											*/
+/*	row f of a table holds the weights of the n taps around a sub-pixel offset	*/
+/*	of f/KERNEL_STEPS, tap i at distance |f/KERNEL_STEPS + n/2 - 1 - i|, each	*/
+/*	weight repeated copies times (2 to line up with interleaved real and	*/
+/*	imaginary samples) and the row normalized to unit sum so the separable	*/
+/*	product matches the 2-D weight normalization					*/
+/*--------------------------------------------------------------------------------------*/
+#include "gmtsar.h"
+
+/*------------------------------------------------------------------------*/
+/* Creator: David Sandwell (Scripps Institution of Oceanography), 03/28/13 */
+double sinc_kernel(double x) {
+	double arg, f;
+
+	arg = fabs(PI * x);
+	if (arg > 0.) {
+		f = sin(arg) / arg;
+	}
+	else {
+		f = 1.;
+	}
+	return (f);
+}
+/*------------------------------------------------------------------------*/
+/* bi-cubic spline kernel using the formula given at			   */
+/* http://undergraduate.csse.uwa.edu.au/units/CITS4241/Handouts/Lecture04.html */
+/* note arg must be positive and a must be between -3 and 0		   */
+/* Creator: David Sandwell (Scripps Institution of Oceanography), 03/22/13 */
+double cubic_kernel(double arg, double a) {
+	double arg2, arg3, f;
+
+	arg2 = arg * arg;
+	arg3 = arg2 * arg;
+	if (arg <= 1.) {
+		f = (a + 2) * arg3 - (a + 3) * arg2 + 1.;
+	}
+	else if (arg <= 2.) {
+		f = a * arg3 - 5 * a * arg2 + 8 * a * arg - 4 * a;
+	}
+	else {
+		f = 0.;
+	}
+	return (f);
+}
+/*------------------------------------------------------------------------*/
+/* KERNEL_CUBIC uses the free parameter a = -0.3 of resamp;		   */
+/* KERNEL_INVDIST gives the inverse distance weights used for the TOPS	   */
+/* ramp phase, all on the sample when the offset falls on one		   */
+float *make_kernel_table(int kernel, int n, int copies) {
+	int f, i, c, off;
+	double x, arg, wsum, *w;
+	float *wtab;
+
+	off = n / 2 - 1;
+	w = (double *)malloc(n * sizeof(double));
+	wtab = (float *)malloc((size_t)(KERNEL_STEPS + 1) * n * copies * sizeof(float));
+	if (w == NULL || wtab == NULL)
+		die("make_kernel_table: ", "out of memory");
+
+	for (f = 0; f <= KERNEL_STEPS; f++) {
+		x = (double)f / KERNEL_STEPS;
+		wsum = 0.0;
+		for (i = 0; i < n; i++) {
+			arg = fabs(x + off - i);
+			if (kernel == KERNEL_CUBIC)
+				w[i] = cubic_kernel(arg, -0.3);
+			else if (kernel == KERNEL_INVDIST)
+				w[i] = (arg > 0.) ? 1. / arg : 1.e30;
+			else
+				w[i] = sinc_kernel(arg);
+			wsum += w[i];
+		}
+		if (wsum <= 0.0)
+			fprintf(stderr, " error wsum is zero \n");
+		for (i = 0; i < n; i++)
+			for (c = 0; c < copies; c++)
+				wtab[(f * n + i) * copies + c] = (float)(w[i] / wsum);
+	}
+
+	free(w);
+	return (wtab);
+}
+/*------------------------------------------------------------------------*/
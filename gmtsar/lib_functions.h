@@ -7,11 +7,19 @@
 #include "sfd_complex.h"
 #include "../declspec.h"
 #include "xcorr.h"
+#include "fft_plan.h"
+#include "conv_plan.h"
+#include "stack_cube.h"
+#include "geo_lut.h"
 #include "PRM.h"
+#include "sat_orbit.h"
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+struct GMT_GRID;
+struct GMT_GRID_HEADER;
+
 /* function prototypes 				*/
 EXTERN_MSC void null_sio_struct(struct PRM *);
 EXTERN_MSC void get_sio_struct(FILE *, struct PRM *);
@@ -40,12 +48,55 @@ EXTERN_MSC int find_fft_length(int n);
 EXTERN_MSC void aastretch(fcomplex **fdata, int ipatch, int nrows, int num_valid_az, int num_rng_bins, float coef);
 EXTERN_MSC void acpatch(void *API, fcomplex **data, int nrows, double delr, double fd, double fdd, double fddd);
 EXTERN_MSC void conv2d(float *rdat, int *ni, int *nj, float *filt, int *nif, int *njf, float *fdat, int *ic, int *jc, float *rnorm);
+EXTERN_MSC struct CONV_PLAN *conv2d_plan(float *filt, int nif, int njf);
+EXTERN_MSC void conv2d_plan_destroy(struct CONV_PLAN *p);
+EXTERN_MSC void conv2d_rows(struct CONV_PLAN *p, float *rdat, int ni, int nj, int ic, int idec, int nrow, int jdec, int nout, float *fdat,
+                            float *rnorm);
 EXTERN_MSC void do_freq_corr(void *API, struct xcorr *xc, int iloc);
 EXTERN_MSC void do_time_corr(struct xcorr *xc, int iloc);
 EXTERN_MSC double calc_time_corr(struct xcorr *xc, int ioff, int joff);
 EXTERN_MSC int fft_bins(int num);
 EXTERN_MSC void fft_interpolate_1d(void *API, struct FCOMPLEX *in, int N, struct FCOMPLEX *out, int ifactor);
 EXTERN_MSC void fft_interpolate_2d(void *API, struct FCOMPLEX *in, int N1, int M1, struct FCOMPLEX *out, int N, int M, int ifactor);
+EXTERN_MSC void fft_interpolate_1d_plan(void *API, struct FFT_PLAN *fwd, struct FFT_PLAN *inv, struct FCOMPLEX *in, int N,
+                                        struct FCOMPLEX *out, int ifactor);
+EXTERN_MSC void fft_interpolate_2d_plan(void *API, struct FFT_PLAN *fwd_row, struct FFT_PLAN *inv_row, struct FFT_PLAN *fwd_col,
+                                        struct FFT_PLAN *inv_col, struct FCOMPLEX *in, int N1, int M1, struct FCOMPLEX *out, int N,
+                                        int M, int ifactor);
+EXTERN_MSC struct FFT_PLAN *fft_plan_create(int n, int direction);
+EXTERN_MSC struct FFT_PLAN *fft_plan_get(int n, int direction);
+EXTERN_MSC void fft_plan_destroy(struct FFT_PLAN *p);
+EXTERN_MSC void fft_plan_1d(void *API, struct FFT_PLAN *p, struct FCOMPLEX *data, int stride);
+EXTERN_MSC void fft_plan_2d(void *API, struct FFT_PLAN *px, struct FFT_PLAN *py, struct FCOMPLEX *data, int nx, int ny);
+EXTERN_MSC int stack_cube_read_header(FILE *fp, struct STACK_CUBE *c);
+EXTERN_MSC void stack_cube_write_header(FILE *fp, struct STACK_CUBE *c);
+EXTERN_MSC void stack_cube_read_rows(FILE *fp, struct STACK_CUBE *c, int64_t r0, int64_t nrows, float *buf);
+EXTERN_MSC void stack_cube_check_scenes(struct STACK_CUBE *c, int64_t S, int64_t *L, double *time);
+EXTERN_MSC void stack_cube_free(struct STACK_CUBE *c);
+EXTERN_MSC void stack_cube_read_ts(FILE *fp, struct STACK_CUBE *c, int64_t r0, int64_t nrows, int64_t si, int64_t sj, int64_t sk,
+                                   float *buf, int64_t *flag, float *var, float *phi);
+EXTERN_MSC int read_cube_data_ts(void *API, FILE *fp, struct STACK_CUBE *c, int64_t xdim, int64_t ydim, int64_t si, int64_t sj,
+                                 int64_t sk, int64_t *flag, float *var, float *phi, struct GMT_GRID **Out);
+EXTERN_MSC float var_from_corr(float c);
+EXTERN_MSC int read_grid_rows(void *API, char *name, struct GMT_GRID_HEADER *h, int64_t r0, int64_t nrows, float *buf);
+EXTERN_MSC double sinc_kernel(double x);
+EXTERN_MSC double cubic_kernel(double arg, double a);
+EXTERN_MSC float *make_kernel_table(int kernel, int n, int copies);
+EXTERN_MSC void geo_lut_read(char *file, struct GEO_LUT *g);
+EXTERN_MSC void geo_lut_write(char *file, struct GEO_LUT *g);
+EXTERN_MSC int geo_lut_ra(struct GEO_LUT *g, double lon, double lat, double *r, double *a);
+EXTERN_MSC void geo_lut_free(struct GEO_LUT *g);
+EXTERN_MSC int zero_doppler_newton(double **orb_pos, int nsamp, double ts, double *xp, double *tm, double *rng);
+EXTERN_MSC int orbit_table_state(double **orb_pos, int nsamp, double ts, double t, double *s, double *v, double *a);
+EXTERN_MSC struct SAT_ORBIT *sat_orbit_create(struct PRM *prm);
+EXTERN_MSC struct SAT_ORBIT *sat_orbit_create_sampled(struct PRM *prm, double ts, int npad);
+EXTERN_MSC void sat_orbit_destroy(struct SAT_ORBIT *so);
+EXTERN_MSC void sat_orbit_position(struct SAT_ORBIT *so, double t, double *pos);
+EXTERN_MSC int sat_orbit_state(struct SAT_ORBIT *so, double t, double *pos, double *vel);
+EXTERN_MSC int sat_orbit_zero_doppler(struct SAT_ORBIT *so, double *xp, int precise, int *seeded, double *tseed, double *tm,
+                                      double *rng);
+EXTERN_MSC void sat_orbit_point(struct SAT_ORBIT *so, int precise, double *llt, int *seeded, double *tseed, double *rat);
+EXTERN_MSC void sat_orbit_llt2rat(struct SAT_ORBIT *so, int precise, int64_t n, double *llt, double *rat);
 EXTERN_MSC void print_prm_params(struct PRM p1, struct PRM p2);
 EXTERN_MSC void fix_prm_params(struct PRM *p, char *s);
 EXTERN_MSC void get_locations(struct xcorr *xc);
@@ -68,6 +119,9 @@ EXTERN_MSC void read_data(struct xcorr xc);
 EXTERN_MSC void read_complex_short2float(FILE *f, float *d, int iy, int jx, int npx, int npy, int nx);
 EXTERN_MSC void read_optional_args(void *API, int argc, char **argv, struct PRM *tp, int *topoflag, struct PRM *mp, int *modelflag);
 EXTERN_MSC void read_xcorr_data(struct xcorr *xc, int iloc);
+EXTERN_MSC void read_xcorr_master(struct xcorr *xc, int iloc);
+EXTERN_MSC void read_xcorr_aligned(struct xcorr *xc, int iloc);
+EXTERN_MSC void handle_batch_prm(void *, char **argv, struct xcorr *xc);
 EXTERN_MSC void rmpatch(fcomplex **data, int nrows, double delr, double fd, double fdd, double fddd);
 EXTERN_MSC void rng_cmp(void *API, int ranfft, fcomplex *data, fcomplex *ref);
 EXTERN_MSC void rng_ref(void *API, int ranfft, float delr, fcomplex *ref1);
@@ -81,6 +135,7 @@ EXTERN_MSC void read_params(struct xcorr *, FILE *);
 EXTERN_MSC void make_mask(struct xcorr *);
 EXTERN_MSC void do_highres(struct xcorr *, int);
 EXTERN_MSC void allocate_arrays(struct xcorr *);
+EXTERN_MSC void free_arrays(struct xcorr *);
 EXTERN_MSC char *trimwhitespace(char *str);
 
 #endif /* LIB_FUNCTIONS_H */
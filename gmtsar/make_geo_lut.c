@@ -0,0 +1,175 @@
+/***************************************************************************
+ * Creator:  GMTSAR contributors                                           *
+ * Date   :  10/17/2026                                                    *
+ ***************************************************************************/
+
+/***************************************************************************
+ * Modification history:                                                   *
+ *                                                                         *
+ * DATE                                                                    *
+ *                                                                         *
+ ***************************************************************************/
+
+/* compute the range and azimuth of the master on every dec-th node of a	*/
+/* DEM once and keep them as a geocoding lookup table (see geo_lut.h);	*/
+/* proj_ra2ll_lut then only gathers through it, so			*/
+/* every grid of a stack sharing the master geometry is projected without	*/
+/* running gmt surface or the zero Doppler search again			*/
+
+#include "gmtsar.h"
+
+char *USAGE = "\nUsage: make_geo_lut master.PRM dem.grd geo.lut [-dec n] [-nthreads n]\n\n"
+              "    master.PRM      --  parameter file of the master image, points to its LED orbit file\n"
+              "    dem.grd         --  DEM in longitude/latitude, the same one given to dem2topo_ra.csh\n"
+              "    geo.lut         --  output lookup table\n"
+              "    -dec n          --  use every n-th node of the DEM (default 2), range and azimuth\n"
+              "                        are interpolated bilinearly in between\n"
+              "    -nthreads n     --  number of threads computing rows of nodes (default 1)\n\n"
+              "    the table is trimmed to the nodes that fall on the master image\n"
+              "    example:\n"
+              "    make_geo_lut master.PRM dem.grd geo.lut -nthreads 8\n"
+              "    proj_ra2ll_lut geo.lut phasefilt.grd phasefilt_ll.grd\n\n";
+
+EXTERN_MSC void set_prm_defaults(struct PRM *);
+
+int main(int argc, char **argv) {
+
+	FILE *fprm = NULL;
+	int n, dec = 2, nthreads = 1;
+	int64_t i, j, nx, ny, mx, my, i0, i1, j0, j1;
+	double x0, y0, dx, dy;
+	float *ra = NULL;
+	struct PRM prm;
+	struct SAT_ORBIT *so = NULL;
+	struct GEO_LUT g;
+	struct GMT_GRID *DEM = NULL;
+	void *API = NULL;
+
+	if (argc < 4)
+		die("\n", USAGE);
+	for (n = 4; n < argc; n++) {
+		if (!strcmp(argv[n], "-dec") && n + 1 < argc) {
+			dec = atoi(argv[++n]);
+			if (dec < 1)
+				die("-dec must be positive", "");
+		}
+		else if (!strcmp(argv[n], "-nthreads") && n + 1 < argc) {
+			nthreads = atoi(argv[++n]);
+			if (nthreads < 1)
+				nthreads = 1;
+		}
+		else
+			die("unknown option ", argv[n]);
+	}
+
+	if ((API = GMT_Create_Session(argv[0], 0U, 0U, NULL)) == NULL)
+		return EXIT_FAILURE;
+
+	/* read the master PRM and its orbit */
+	if ((fprm = fopen(argv[1], "r")) == NULL)
+		die("Can't open ", argv[1]);
+	null_sio_struct(&prm);
+	set_prm_defaults(&prm);
+	get_sio_struct(fprm, &prm);
+	fclose(fprm);
+	so = sat_orbit_create(&prm);
+
+	if ((DEM = GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_ALL, NULL, argv[2], NULL)) == NULL)
+		die("cannot open DEM ", argv[2]);
+
+	/* DEM node coordinates, top row first */
+	nx = DEM->header->n_columns;
+	ny = DEM->header->n_rows;
+	dx = DEM->header->inc[GMT_X];
+	dy = DEM->header->inc[GMT_Y];
+	x0 = DEM->header->wesn[GMT_XLO] + 0.5 * DEM->header->registration * dx;
+	y0 = DEM->header->wesn[GMT_YHI] - 0.5 * DEM->header->registration * dy;
+
+	/* table nodes are every dec-th DEM node */
+	mx = (nx - 1) / dec + 1;
+	my = (ny - 1) / dec + 1;
+	if (mx < 2 || my < 2)
+		die("-dec leaves less than 2 by 2 nodes of ", argv[2]);
+	if ((ra = (float *)malloc((size_t)(2 * mx * my) * sizeof(float))) == NULL)
+		die("memory allocation!", "");
+	fprintf(stderr, "computing %lld by %lld nodes ...\n", (long long)mx, (long long)my);
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+	for (i = 0; i < my; i++) {
+		int64_t jj, k;
+		int seeded = 0;
+		double tseed = 0., llt[3], rat[5];
+
+		/* each row starts cold, so the table does not depend on the number of threads */
+		for (jj = 0; jj < mx; jj++) {
+			k = (i * dec) * nx + jj * dec;
+			if (isnan(DEM->data[k])) {
+				ra[2 * (i * mx + jj)] = ra[2 * (i * mx + jj) + 1] = NAN;
+				continue;
+			}
+			llt[0] = x0 + jj * dec * dx;
+			llt[1] = y0 - i * dec * dy;
+			llt[2] = DEM->data[k];
+			sat_orbit_point(so, 1, llt, &seeded, &tseed, rat);
+			ra[2 * (i * mx + jj)] = (float)rat[0];
+			ra[2 * (i * mx + jj) + 1] = (float)rat[1];
+		}
+	}
+
+	/* trim to the nodes on the image plus one node all around */
+	i0 = my;
+	i1 = -1;
+	j0 = mx;
+	j1 = -1;
+	for (i = 0; i < my; i++) {
+		for (j = 0; j < mx; j++) {
+			float *p = &ra[2 * (i * mx + j)];
+			if (isnan(p[0]) || p[0] < 0. || p[0] > prm.num_rng_bins || p[1] < 0. ||
+			    p[1] > prm.num_patches * prm.num_valid_az)
+				continue;
+			i0 = MIN(i0, i);
+			i1 = MAX(i1, i);
+			j0 = MIN(j0, j);
+			j1 = MAX(j1, j);
+		}
+	}
+	if (i1 < 0)
+		die("the DEM does not cover the master image ", argv[1]);
+	i0 = MAX(i0 - 1, 0);
+	j0 = MAX(j0 - 1, 0);
+	i1 = MIN(i1 + 1, my - 1);
+	j1 = MIN(j1 + 1, mx - 1);
+	if (i1 == i0 || j1 == j0)
+		die("the DEM covers less than one cell of the table, lower -dec", "");
+
+	memset(&g, 0, sizeof(struct GEO_LUT));
+	g.precise = 1;
+	g.n_columns = j1 - j0 + 1;
+	g.n_rows = i1 - i0 + 1;
+	g.inc[GMT_X] = dec * dx;
+	g.inc[GMT_Y] = dec * dy;
+	g.wesn[GMT_XLO] = x0 + j0 * g.inc[GMT_X];
+	g.wesn[GMT_XHI] = x0 + j1 * g.inc[GMT_X];
+	g.wesn[GMT_YHI] = y0 - i0 * g.inc[GMT_Y];
+	g.wesn[GMT_YLO] = y0 - i1 * g.inc[GMT_Y];
+	g.n_rng = prm.num_rng_bins;
+	g.n_azi = prm.num_patches * prm.num_valid_az;
+	if ((g.ra = (float *)malloc((size_t)(2 * g.n_columns * g.n_rows) * sizeof(float))) == NULL)
+		die("memory allocation!", "");
+	for (i = 0; i < g.n_rows; i++)
+		memcpy(&g.ra[2 * i * g.n_columns], &ra[2 * ((i + i0) * mx + j0)], (size_t)(2 * g.n_columns) * sizeof(float));
+	fprintf(stderr, "lookup table is %lld by %lld nodes over %.6f/%.6f/%.6f/%.6f \n", (long long)g.n_columns,
+	        (long long)g.n_rows, g.wesn[GMT_XLO], g.wesn[GMT_XHI], g.wesn[GMT_YLO], g.wesn[GMT_YHI]);
+
+	geo_lut_write(argv[3], &g);
+
+	geo_lut_free(&g);
+	free(ra);
+	sat_orbit_destroy(so);
+	if (GMT_Destroy_Data(API, &DEM))
+		die("error freeing data", argv[2]);
+	if (GMT_Destroy_Session(API))
+		return EXIT_FAILURE;
+
+	return (EXIT_SUCCESS);
+}
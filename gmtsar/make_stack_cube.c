@@ -0,0 +1,193 @@
+/***************************************************************************
+ * Creator:  GMTSAR contributors                                           *
+ * Date   :  10/17/2026                                                    *
+ ***************************************************************************/
+
+/***************************************************************************
+ * Modification history:                                                   *
+ *                                                                         *
+ * DATE                                                                    *
+ *                                                                         *
+ ***************************************************************************/
+
+/* convert the unwrapped phase and correlation grids listed in intf.tab	*/
+/* into one stack cube (see stack_cube.h) that sbas and sbas_parallel	*/
+/* read in place of intf.tab; every pixel keeps its whole time series	*/
+/* together so a band of rows comes off the disk in a single read	*/
+
+#define _GNU_SOURCE /* for strdup */
+#include "gmtsar.h"
+#include <stdint.h>
+
+char *USAGE = "\nUsage: make_stack_cube intf.tab scene.tab stack.cube [-memory mb]\n\n"
+              "    intf.tab        --  list of unwrapped (filtered) interferograms:\n"
+              "    format:   unwrap.grd  corr.grd  ref_id  rep_id  B_perp \n"
+              "    scene.tab       --  list of the SAR scenes in chronological order\n"
+              "    format:   scene_id   number_of_days \n"
+              "    stack.cube      --  output cube, give it to sbas in place of intf.tab\n"
+              "    -memory mb      --  memory used to reorder a band of rows (default 512)\n\n"
+              "    all grids must have the same region and size\n"
+              "    example:\n"
+              "    make_stack_cube intf.tab scene.tab stack.cube\n"
+              "    sbas stack.cube scene.tab 88 28 700 1000\n\n";
+
+int main(int argc, char **argv) {
+
+	FILE *infile = NULL, *datefile = NULL, *cube = NULL;
+	char **gfile = NULL, **cfile = NULL, tmp1[200], tmp2[200], tmp3[200], name1[200], name2[200];
+	int64_t i, j, k, N, xdim, ydim, nb, nr, r0, n_alloc = 64;
+	double memory = 512.0;
+	float *buf = NULL, *band = NULL;
+	struct STACK_CUBE c;
+	struct GMT_GRID *CC = NULL, *GG = NULL, *Ref = NULL;
+	struct GMT_GRID_HEADER *h = NULL;
+	void *API = NULL;
+
+	if (argc != 4 && argc != 6)
+		die("\n", USAGE);
+	if (argc == 6) {
+		if (strcmp(argv[4], "-memory"))
+			die("unknown option ", argv[4]);
+		memory = atof(argv[5]);
+		if (memory <= 0.0)
+			die("-memory must be positive", "");
+	}
+
+	if ((API = GMT_Create_Session(argv[0], 0U, 0U, NULL)) == NULL)
+		return EXIT_FAILURE;
+
+	/* read in intf.tab */
+	if ((infile = fopen(argv[1], "r")) == NULL)
+		die("Can't open file", argv[1]);
+	memset(&c, 0, sizeof(struct STACK_CUBE));
+	gfile = (char **)malloc(n_alloc * sizeof(char *));
+	cfile = (char **)malloc(n_alloc * sizeof(char *));
+	c.ref = (int64_t *)malloc(n_alloc * sizeof(int64_t));
+	c.rep = (int64_t *)malloc(n_alloc * sizeof(int64_t));
+	c.bperp = (float *)malloc(n_alloc * sizeof(float));
+	N = 0;
+	while (fscanf(infile, "%s %s %s %s %s", name1, name2, tmp1, tmp2, tmp3) == 5) {
+		if (N == n_alloc) {
+			n_alloc *= 2;
+			gfile = (char **)realloc(gfile, n_alloc * sizeof(char *));
+			cfile = (char **)realloc(cfile, n_alloc * sizeof(char *));
+			c.ref = (int64_t *)realloc(c.ref, n_alloc * sizeof(int64_t));
+			c.rep = (int64_t *)realloc(c.rep, n_alloc * sizeof(int64_t));
+			c.bperp = (float *)realloc(c.bperp, n_alloc * sizeof(float));
+		}
+		if (gfile == NULL || cfile == NULL || c.ref == NULL || c.rep == NULL || c.bperp == NULL)
+			die("memory allocation!", "intf.tab");
+		gfile[N] = strdup(name1);
+		cfile[N] = strdup(name2);
+		c.ref[N] = atoi(tmp1);
+		c.rep[N] = atoi(tmp2);
+		c.bperp[N] = atof(tmp3);
+		N++;
+	}
+	fclose(infile);
+	if (N == 0)
+		die("no interferograms in ", argv[1]);
+	fprintf(stderr, "number of interferograms is %lld \n", (long long)N);
+
+	/* read in scene.tab, the dates go into the cube as they are */
+	if ((datefile = fopen(argv[2], "r")) == NULL)
+		die("Can't open file", argv[2]);
+	n_alloc = 64;
+	c.scene = (int64_t *)malloc(n_alloc * sizeof(int64_t));
+	c.days = (double *)malloc(n_alloc * sizeof(double));
+	while (fscanf(datefile, "%s %s", tmp1, tmp2) == 2) {
+		if (c.n_scene == n_alloc) {
+			n_alloc *= 2;
+			c.scene = (int64_t *)realloc(c.scene, n_alloc * sizeof(int64_t));
+			c.days = (double *)realloc(c.days, n_alloc * sizeof(double));
+		}
+		if (c.scene == NULL || c.days == NULL)
+			die("memory allocation!", "scene.tab");
+		c.scene[c.n_scene] = atoi(tmp1);
+		c.days[c.n_scene] = atof(tmp2);
+		c.n_scene++;
+	}
+	fclose(datefile);
+	if (c.n_scene == 0)
+		die("no scenes in ", argv[2]);
+	fprintf(stderr, "number of SAR scenes is %lld \n", (long long)c.n_scene);
+
+	/* check the grid sizes, the cube takes its region from the first correlation grid */
+	for (i = 0; i < N; i++) {
+		if ((CC = GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, cfile[i], NULL)) ==
+		    NULL)
+			die("Can't open ", cfile[i]);
+		if ((GG = GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, gfile[i], NULL)) ==
+		    NULL)
+			die("Can't open ", gfile[i]);
+		if (Ref != NULL && (CC->header->n_columns != Ref->header->n_columns || CC->header->n_rows != Ref->header->n_rows))
+			die("dimension don't match!", cfile[i]);
+		if (GG->header->n_columns != CC->header->n_columns || GG->header->n_rows != CC->header->n_rows)
+			die("dimension don't match!", gfile[i]);
+		if (GMT_Destroy_Data(API, &GG))
+			die("error freeing data", gfile[i]);
+		if (Ref == NULL)
+			Ref = CC;
+		else if (GMT_Destroy_Data(API, &CC))
+			die("error freeing data", cfile[i]);
+	}
+	h = Ref->header;
+	xdim = h->n_columns;
+	ydim = h->n_rows;
+
+	c.registration = h->registration;
+	c.n_intf = N;
+	c.n_columns = xdim;
+	c.n_rows = ydim;
+	for (i = 0; i < 4; i++)
+		c.wesn[i] = h->wesn[i];
+	c.inc[GMT_X] = h->inc[GMT_X];
+	c.inc[GMT_Y] = h->inc[GMT_Y];
+
+	/* a band of the cube plus one band of a grid must fit in memory */
+	nb = (int64_t)(memory * 1024.0 * 1024.0) / (xdim * (2 * N + 1) * (int64_t)sizeof(float));
+	if (nb < 1)
+		die("-memory is less than one row needs", "");
+	if (nb > ydim)
+		nb = ydim;
+	if ((band = (float *)malloc((size_t)(nb * xdim * 2 * N) * sizeof(float))) == NULL ||
+	    (buf = (float *)malloc((size_t)(nb * xdim) * sizeof(float))) == NULL)
+		die("memory allocation!", "band");
+
+	if ((cube = fopen(argv[3], "wb")) == NULL)
+		die("Can't open file", argv[3]);
+	stack_cube_write_header(cube, &c);
+
+	for (r0 = 0; r0 < ydim; r0 += nb) {
+		nr = (r0 + nb <= ydim) ? nb : ydim - r0;
+		fprintf(stderr, "rows %lld to %lld ...\n", (long long)r0, (long long)(r0 + nr - 1));
+		for (i = 0; i < N; i++) {
+			read_grid_rows(API, gfile[i], h, r0, nr, buf);
+			for (k = 0; k < nr * xdim; k++)
+				band[k * 2 * N + i] = buf[k];
+			read_grid_rows(API, cfile[i], h, r0, nr, buf);
+			for (k = 0; k < nr * xdim; k++)
+				band[k * 2 * N + N + i] = buf[k];
+		}
+		if (fwrite(band, sizeof(float), (size_t)(nr * xdim * 2 * N), cube) != (size_t)(nr * xdim * 2 * N))
+			die("error writing ", argv[3]);
+	}
+	if (fclose(cube))
+		die("error writing ", argv[3]);
+
+	for (j = 0; j < N; j++) {
+		free(gfile[j]);
+		free(cfile[j]);
+	}
+	free(gfile);
+	free(cfile);
+	free(band);
+	free(buf);
+	stack_cube_free(&c);
+	if (GMT_Destroy_Data(API, &Ref))
+		die("error freeing data", "");
+	if (GMT_Destroy_Session(API))
+		return EXIT_FAILURE;
+
+	return (EXIT_SUCCESS);
+}
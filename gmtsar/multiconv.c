@@ -0,0 +1,352 @@
+/*	$Id$	*/
+/***************************************************************************/
+/* multiconv runs a chain of conv filter/decimation steps on several      */
+/* co-registered images in one pass.  Each input is read once, the rows   */
+/* are streamed through every step in memory, and only the output of the  */
+/* last step is written, so the intermediate *_tmp.grd=bf files of        */
+/* chained conv calls are no longer needed.                               */
+/*                                                                         */
+/* Each step gives the same result as running conv with that idec, jdec   */
+/* and filter on the output of the previous step.                         */
+/***************************************************************************/
+
+/***************************************************************************
+ * Modification history:                                                   *
+ *                                                                         *
+ * DATE                                                                    *
+ * 10/17/26     Written, based on conv.c                                   *
+ ***************************************************************************/
+
+#include "gmtsar.h"
+#include "lib_functions.h"
+
+char *USAGE = "multiconv [GMTSAR] - chained 2-D image convolution of several images\n\n"
+              "Usage: multiconv -f idec jdec filter_file [-f idec jdec filter_file ...] input output [input output ...]\n"
+              "   -f idec jdec filter_file - one filter step, steps are applied in the order given \n"
+              "          idec           - row decimation factor \n"
+              "          jdec           - column decimation factor \n"
+              "          filter_file    - eg. filters/gauss17x5 \n"
+              "   input          - name of file to be filtered (GMT binary grid or PRM of an SLC) \n"
+              "   output         - name of filtered output grid \n\n"
+              "   example:\n"
+              "   multiconv -f 4 2 filters/gauss5x5 -f 2 2 gauss_alos_200m real.grd=bf realfilt.grd imag.grd=bf imagfilt.grd \n"
+              "   (same as conv 4 2 filters/gauss5x5 real.grd=bf real_tmp.grd=bf followed by \n"
+              "    conv 2 2 gauss_alos_200m real_tmp.grd=bf realfilt.grd, and the same for imag) \n";
+
+#define MAX_STEPS 8
+
+/* one filter step, shared by all images */
+struct conv_step {
+	int idec, jdec;        /* row and column decimation */
+	int xarr, yarr;        /* filter size, both odd */
+	int norm;              /* 1 if the filter is normalized by its sum */
+	float rnormax, anormax; /* sum and absolute sum of the filter */
+	float *filter;
+	struct CONV_PLAN *plan; /* how conv2d_rows applies the filter */
+};
+
+/* state of one step for one image */
+struct conv_level {
+	int xdim, ydim;        /* size of the step input */
+	int jout, iout;        /* size of the step output */
+	double xmax, ymax;     /* extent of the step input */
+	double inc[2];         /* output increments as computed by conv */
+	float *strip;          /* input rows first to first+nrows-1, followed by a row of zeros */
+	float *fdat, *rnorm;   /* one row of conv2d_rows output */
+	int first, nrows;
+};
+
+/* one image and its chain of steps */
+struct conv_image {
+	char input[128], output[128];
+	int format_flag;       /* 1 float, 2 i*2 complex, 3 r*4 complex */
+	FILE *f_input;
+	int next_in;           /* next row to be read from f_input */
+	void *line;            /* one row as stored in f_input */
+	struct conv_level level[MAX_STEPS];
+	struct GMT_GRID *Out;
+};
+
+/*-------------------------------------------------------------*/
+void read_conv_filter(char *name, struct conv_step *s) {
+	int i, narr;
+	float filtin;
+	FILE *f_filter;
+
+	if ((f_filter = fopen(name, "r")) == NULL)
+		die("Can't open filter", name);
+
+	/* read size of filter and make sure dimensions are odd */
+	if (fscanf(f_filter, "%d%d", &s->xarr, &s->yarr) != 2 || s->xarr < 1 || s->yarr < 1 || (s->xarr & 1) == 0 ||
+	    (s->yarr & 1) == 0)
+		die("filter incomplete", name);
+
+	narr = s->xarr * s->yarr;
+	if ((s->filter = (float *)malloc(sizeof(float) * narr)) == NULL)
+		die("memory allocation", "");
+
+	/* read the filter and calculate normalization constants*/
+	s->anormax = s->rnormax = 0.0f;
+	for (i = 0; i < narr; i++) {
+		if (fscanf(f_filter, "%f", &filtin) == EOF)
+			die("filter incomplete", name);
+		s->filter[i] = filtin;
+		s->anormax = s->anormax + (float)fabs(s->filter[i]);
+		s->rnormax = s->rnormax + s->filter[i];
+	}
+	s->norm = (fabs(s->rnormax) > 0.05 * s->anormax) ? 1 : 0;
+	s->plan = conv2d_plan(s->filter, s->yarr, s->xarr);
+	fclose(f_filter);
+}
+
+/*-------------------------------------------------------------*/
+/* open the input, size every step and allocate the output grid */
+void open_conv_image(void *API, struct conv_image *c, struct conv_step *step, int nstep) {
+	int k, n;
+	char *s = NULL;
+	double wesn[4];
+	struct PRM p;
+	struct conv_level *L;
+	struct GMT_GRID *In = NULL;
+
+	L = &c->level[0];
+	n = (int)strlen(c->input);
+	if (n > 3 && (strncmp(&c->input[n - 3], "PRM", 3) == 0 || strncmp(&c->input[n - 3], "prm", 3) == 0)) {
+		FILE *f_input_prm;
+
+		if ((f_input_prm = fopen(c->input, "r")) == NULL)
+			die("Can't open input header", c->input);
+		null_sio_struct(&p);
+		get_sio_struct(f_input_prm, &p);
+		fclose(f_input_prm);
+		c->format_flag = (strncmp(p.dtype, "c", 1) == 0) ? 3 : 2;
+		if ((c->f_input = fopen(p.SLC_file, "rb")) == NULL)
+			die("Can't open input data ", p.SLC_file);
+		L->xdim = p.num_rng_bins;
+		L->ydim = p.num_valid_az * p.num_patches;
+		L->xmax = L->xdim;
+		L->ymax = L->ydim;
+	}
+	else {
+		if ((In = GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, c->input, NULL)) ==
+		    NULL)
+			die("Can't open ", c->input);
+		if ((s = strstr(c->input, "=bf")))
+			s[0] = '\0'; /* Chop off any trailing =bf flag */
+		if ((c->f_input = fopen(c->input, "rb")) == NULL)
+			die("Can't open ", c->input);
+		fseek(c->f_input, 892L, SEEK_SET); /* Skip past the header */
+		c->format_flag = 1;
+		L->xdim = In->header->n_columns;
+		L->ydim = In->header->n_rows;
+		L->xmax = In->header->wesn[GMT_XHI];
+		L->ymax = In->header->wesn[GMT_YHI];
+	}
+	c->next_in = 0;
+	if ((c->line = malloc((c->format_flag == 3 ? 8 : 4) * (size_t)L->xdim)) == NULL)
+		die("memory allocation", "");
+
+	/* size of each step output, done the same way as conv */
+	for (k = 0; k < nstep; k++) {
+		L = &c->level[k];
+		L->iout = (L->ydim + step[k].idec - 1) / step[k].idec;
+		L->jout = (L->xdim + step[k].jdec - 1) / step[k].jdec;
+		L->inc[GMT_X] = round(L->xmax / (double)L->jout);
+		L->inc[GMT_Y] = round(L->ymax / (double)L->iout);
+		L->jout = floor(L->xmax / L->inc[GMT_X]);
+		L->iout = floor(L->ymax / L->inc[GMT_Y]);
+
+		/* window rows plus one row below it, as conv2d may read one past the window, and
+		   a zero row; conv2d can also touch the first value after that */
+		if ((L->strip = (float *)calloc((size_t)(step[k].yarr + 3) * L->xdim, sizeof(float))) == NULL ||
+		    (L->fdat = (float *)malloc(L->jout * sizeof(float))) == NULL || (L->rnorm = (float *)malloc(L->jout * sizeof(float))) == NULL)
+			die("memory allocation", "");
+		L->first = L->nrows = 0;
+
+		if (k + 1 < nstep) {
+			c->level[k + 1].xdim = L->jout;
+			c->level[k + 1].ydim = L->iout;
+			c->level[k + 1].xmax = L->inc[GMT_X] * L->jout;
+			c->level[k + 1].ymax = L->inc[GMT_Y] * L->iout;
+		}
+	}
+
+	L = &c->level[nstep - 1];
+	wesn[GMT_XLO] = 0.0;
+	wesn[GMT_XHI] = L->inc[GMT_X] * L->jout;
+	wesn[GMT_YLO] = 0.0;
+	wesn[GMT_YHI] = L->inc[GMT_Y] * L->iout;
+	if ((c->Out = GMT_Create_Data(API, GMT_IS_GRID, GMT_IS_SURFACE, GMT_GRID_ALL, NULL, wesn, L->inc, GMT_GRID_PIXEL_REG, 0,
+	                              NULL)) == NULL)
+		die("could not allocate output grid", c->output);
+	if (GMT_Set_Comment(API, GMT_IS_GRID, GMT_COMMENT_IS_TITLE, "multiconv", c->Out))
+		die("could not set title", "");
+}
+
+/*-------------------------------------------------------------*/
+/* read the next row of the input as float, amplitude squared for SLCs like conv */
+void read_conv_row(struct conv_image *c, float *row) {
+	int j, xdim = c->level[0].xdim;
+	short *ci2 = (short *)c->line;
+	float *cf2 = (float *)c->line;
+	double df2 = DFACT * DFACT;
+
+	c->next_in++;
+	if (c->format_flag == 1) {
+		fread(row, sizeof(float), xdim, c->f_input);
+	}
+	else if (c->format_flag == 2) {
+		fread(ci2, 2 * sizeof(short), xdim, c->f_input);
+		for (j = 0; j < xdim; j++)
+			row[j] = (float)(df2 * ci2[2 * j] * ci2[2 * j] + df2 * ci2[2 * j + 1] * ci2[2 * j + 1]);
+	}
+	else {
+		fread(cf2, 2 * sizeof(float), xdim, c->f_input);
+		for (j = 0; j < xdim; j++)
+			row[j] = (float)(df2 * cf2[2 * j] * cf2[2 * j] + df2 * cf2[2 * j + 1] * cf2[2 * j + 1]);
+	}
+}
+
+/*-------------------------------------------------------------*/
+/* compute output row r of step k into out; rows must be asked for in increasing order */
+void conv_step_row(struct conv_image *c, struct conv_step *step, int k, int r, float *out) {
+	int i, jout, ic, ic1, lo, hi, drop, yarr2;
+	struct conv_step *s = &step[k];
+	struct conv_level *L = &c->level[k];
+
+	yarr2 = s->yarr / 2;
+	ic = r * s->idec;
+	lo = MAX(0, ic - yarr2);
+	hi = MIN(L->ydim - 1, ic + yarr2 + 1);
+
+	/* drop the rows above the window */
+	drop = MIN(lo - L->first, L->nrows);
+	if (drop > 0) {
+		memmove(L->strip, &L->strip[(size_t)drop * L->xdim], (size_t)(L->nrows - drop) * L->xdim * sizeof(float));
+		L->first += drop;
+		L->nrows -= drop;
+	}
+
+	/* rows between the last window and this one are not used */
+	if (L->nrows == 0 && L->first < lo) {
+		if (k == 0)
+			while (c->next_in < lo)
+				read_conv_row(c, L->strip);
+		L->first = lo;
+	}
+
+	/* bring in the rows below */
+	while (L->first + L->nrows <= hi) {
+		if (k == 0)
+			read_conv_row(c, &L->strip[(size_t)L->nrows * L->xdim]);
+		else
+			conv_step_row(c, step, k - 1, L->first + L->nrows, &L->strip[(size_t)L->nrows * L->xdim]);
+		L->nrows++;
+	}
+	for (i = 0; i < L->xdim; i++)
+		L->strip[(size_t)L->nrows * L->xdim + i] = 0.0f;
+
+	/* now do the 2d convolution */
+	ic1 = ic - L->first;
+	conv2d_rows(s->plan, L->strip, L->nrows, L->xdim, ic1, s->idec, 1, s->jdec, L->jout, L->fdat, L->rnorm);
+	for (jout = 0; jout < L->jout; jout++) {
+		/* use a zero or null value if there is not enough data in the filter */
+		out[jout] = 0.0f;
+		if (s->norm > 0) {
+			if (fabs(L->rnorm[jout]) > (0.01 * s->rnormax))
+				out[jout] = L->fdat[jout] / L->rnorm[jout];
+		}
+		else {
+			if (fabs(L->rnorm[jout]) < 0.0001 * s->anormax)
+				out[jout] = L->fdat[jout];
+		}
+	}
+}
+
+/*-------------------------------------------------------------*/
+void filter_conv_image(void *API, struct conv_image *c, struct conv_step *step, int nstep) {
+	int k, row;
+	uint64_t left_node;
+	struct conv_level *L = &c->level[nstep - 1];
+
+	for (row = 0; row < L->iout; row++) {
+		left_node = GMT_Get_Index(API, c->Out->header, row, 0);
+		conv_step_row(c, step, nstep - 1, row, &c->Out->data[left_node]);
+	}
+
+	fclose(c->f_input);
+	free(c->line);
+	for (k = 0; k < nstep; k++) {
+		free(c->level[k].strip);
+		free(c->level[k].fdat);
+		free(c->level[k].rnorm);
+	}
+}
+
+/*-------------------------------------------------------------*/
+int main(int argc, char **argv) {
+	int i, k, nstep, nimage;
+	struct conv_step step[MAX_STEPS];
+	struct conv_image *image = NULL;
+	void *API = NULL; /* GMT control structure */
+
+	if (argc < 7)
+		die("\n", USAGE);
+
+	/* Begin: Initializing new GMT session */
+	if ((API = GMT_Create_Session(argv[0], 0U, 0U, NULL)) == NULL)
+		return EXIT_FAILURE;
+
+	verbose = 0;
+
+	/* filter steps */
+	for (i = 1, nstep = 0; i < argc && strcmp(argv[i], "-f") == 0; i += 4, nstep++) {
+		if (i + 3 >= argc)
+			die("-f needs idec jdec filter_file", "");
+		if (nstep == MAX_STEPS)
+			die("too many filter steps", "");
+		step[nstep].idec = atoi(argv[i + 1]);
+		step[nstep].jdec = atoi(argv[i + 2]);
+		if (step[nstep].idec <= 0 || step[nstep].jdec <= 0)
+			die("idec and jdec should be positive integers.", "");
+		read_conv_filter(argv[i + 3], &step[nstep]);
+	}
+	if (nstep == 0)
+		die("\n", USAGE);
+
+	/* input and output pairs */
+	if ((argc - i) < 2 || (argc - i) % 2)
+		die("inputs and outputs should come in pairs", "");
+	nimage = (argc - i) / 2;
+	if ((image = (struct conv_image *)calloc(nimage, sizeof(struct conv_image))) == NULL)
+		die("memory allocation", "");
+	for (k = 0; k < nimage; k++, i += 2) {
+		if (strlen(argv[i]) >= sizeof(image[k].input))
+			die("input file name too long: ", argv[i]);
+		if (strlen(argv[i + 1]) >= sizeof(image[k].output))
+			die("output file name too long: ", argv[i + 1]);
+		strcpy(image[k].input, argv[i]);
+		strcpy(image[k].output, argv[i + 1]);
+		open_conv_image(API, &image[k], step, nstep);
+	}
+
+	/* the images are independent so each can go to its own thread */
+#pragma omp parallel for schedule(dynamic, 1)
+	for (k = 0; k < nimage; k++)
+		filter_conv_image(API, &image[k], step, nstep);
+
+	for (k = 0; k < nimage; k++)
+		if (GMT_Write_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_ALL, NULL, image[k].output, image[k].Out))
+			die("Failed to write output grid", image[k].output);
+
+	for (k = 0; k < nstep; k++) {
+		free(step[k].filter);
+		conv2d_plan_destroy(step[k].plan);
+	}
+	free(image);
+
+	if (GMT_Destroy_Session(API))
+		return EXIT_FAILURE; /* Remove the GMT machinery */
+
+	return (EXIT_SUCCESS);
+}
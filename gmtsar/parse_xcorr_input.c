@@ -28,6 +28,7 @@ void print_params(struct xcorr *xc) {
 	fprintf(stdout, " npy %d \n", xc->npy);
 	fprintf(stdout, " npx %d \n", xc->npx);
 	fprintf(stdout, " npy %d \n", xc->npy);
+	fprintf(stdout, " nthreads %d \n", xc->nthreads);
 	fprintf(stderr, "data file 1 %s \n", xc->data1_name);
 	fprintf(stderr, "data file 2 %s \n", xc->data2_name);
 }
@@ -35,6 +36,11 @@ void print_params(struct xcorr *xc) {
 void set_defaults(struct xcorr *xc) {
 	xc->format = 0; /* data format */
 	xc->ri = 2;     /* range interpolation factor */
+	xc->nthreads = 1; /* rows of locations done in parallel */
+	xc->batch = 0;    /* one aligned image unless -batch */
+	xc->npairs = 0;
+	xc->pair = NULL;
+	xc->master_fft = 0;
 
 	/* default values for time correlation */
 	if ((xc->corr_flag == 0) || (xc->corr_flag == 1)) {
@@ -170,6 +176,19 @@ void parse_command_line(int na, char **a, struct xcorr *xc, int *nfiles, int *in
 			fprintf(stderr, " setting ysearch to %d\n", xc->ysearch);
 			fprintf(stderr, " setting ny_corr to %d\n", xc->ny_corr);
 		}
+		else if (!strcmp(a[n], "-nthreads")) {
+			n++;
+			if (n == na)
+				die(" no option after -nthreads!\n", "");
+			xc->nthreads = atoi(a[n]);
+			if (xc->nthreads < 1)
+				die(" -nthreads needs to be at least 1\n", "");
+			fprintf(stderr, " setting number of threads to %d\n", xc->nthreads);
+		}
+		else if (!strcmp(a[n], "-batch")) {
+			xc->batch = 1;
+			fprintf(stderr, " correlating master against list of aligned images in %s\n", a[2]);
+		}
 		else if (!strcmp(a[n], "-v")) {
 			verbose = 1;
 			fprintf(stderr, " verbose output \n");
@@ -299,3 +318,104 @@ void handle_prm(void *API, char **argv, struct xcorr *xc, int nfiles) {
 	free(r);
 }
 /*---------------------------------------------------------------------------*/
+/* copy a file name into a fixed size field of the batch structures	*/
+/*---------------------------------------------------------------------------*/
+static void copy_name(char *to, size_t size, char *from) {
+	if (strlen(from) >= size)
+		die("file name too long: ", from);
+	strcpy(to, from);
+}
+/*---------------------------------------------------------------------------*/
+/* batch mode: argv[1] is the master PRM, argv[2] lists one aligned PRM	*/
+/* per line, optionally followed by the name of its output file		*/
+/*---------------------------------------------------------------------------*/
+void handle_batch_prm(void *API, char **argv, struct xcorr *xc) {
+	int nalloc, nitems;
+	char line[1024], name[1024], out[1024], stem[1024], dat[1100], *c;
+	FILE *prmfile, *listfile;
+	struct PRM m, r;
+	struct xcorr_pair *p;
+
+	if (strcmp(&argv[1][strlen(argv[1]) - 4], ".PRM") != 0)
+		die("batch mode needs a master PRM file, not ", argv[1]);
+
+	if ((prmfile = fopen(argv[1], "r")) == NULL)
+		die("Can't open prmfile ", argv[1]);
+	null_sio_struct(&m);
+	get_sio_struct(prmfile, &m);
+	fclose(prmfile);
+
+	copy_name(xc->data1_name, sizeof(xc->data1_name), m.SLC_file);
+	if ((xc->data1 = fopen(xc->data1_name, "r")) == NULL)
+		die("Cannot open SLC_file", xc->data1_name);
+	xc->m_nx = m.num_rng_bins;
+	xc->m_ny = m.num_patches * m.num_valid_az;
+
+	if ((listfile = fopen(argv[2], "r")) == NULL)
+		die("Can't open list of aligned PRM files ", argv[2]);
+
+	nalloc = 16;
+	xc->pair = (struct xcorr_pair *)malloc(nalloc * sizeof(struct xcorr_pair));
+	xc->npairs = 0;
+	xc->s_nx = xc->s_ny = 0;
+
+	while (fgets(line, sizeof(line), listfile) != NULL) {
+		if ((nitems = sscanf(line, "%s %s", name, out)) < 1 || name[0] == '#')
+			continue;
+
+		if ((prmfile = fopen(name, "r")) == NULL)
+			die("Can't open prmfile ", name);
+		null_sio_struct(&r);
+		get_sio_struct(prmfile, &r);
+		fclose(prmfile);
+
+		if (xc->npairs == nalloc) {
+			nalloc *= 2;
+			xc->pair = (struct xcorr_pair *)realloc(xc->pair, nalloc * sizeof(struct xcorr_pair));
+		}
+		p = &xc->pair[xc->npairs++];
+
+		copy_name(p->prm_name, sizeof(p->prm_name), name);
+		copy_name(p->data2_name, sizeof(p->data2_name), r.SLC_file);
+		p->s_nx = r.num_rng_bins;
+		p->s_ny = r.num_patches * r.num_valid_az;
+		p->x_offset = r.rshift;
+		p->y_offset = r.ashift;
+		p->astretcha = (m.prf > 0) ? (r.prf - m.prf) / m.prf : 0.0;
+		p->loc = NULL;
+
+		if (xc->offset_flag == 1)
+			p->x_offset = p->y_offset = 0;
+
+		/* default output is freq_xcorr_<aligned stem>.dat */
+		if (nitems == 2) {
+			copy_name(p->filename, sizeof(p->filename), out);
+		}
+		else {
+			strcpy(stem, (c = strrchr(name, '/')) ? c + 1 : name);
+			if ((c = strstr(stem, ".PRM")) != NULL)
+				*c = '\0';
+			sprintf(dat, "%s_%s.dat", (xc->corr_flag == 2) ? "freq_xcorr" : "time_xcorr", stem);
+			copy_name(p->filename, sizeof(p->filename), dat);
+		}
+
+		/* workspace is sized for the widest aligned image */
+		xc->s_nx = MAX(xc->s_nx, p->s_nx);
+		xc->s_ny = MAX(xc->s_ny, p->s_ny);
+
+		fprintf(stderr, " %s: %d %d %d %d %f -> %s\n", p->prm_name, p->s_nx, p->s_ny, p->x_offset, p->y_offset, p->astretcha,
+		        p->filename);
+	}
+	fclose(listfile);
+
+	if (xc->npairs == 0)
+		die("no aligned PRM files in ", argv[2]);
+
+	/* these are set per pair while correlating */
+	xc->data2 = NULL;
+	xc->x_offset = xc->y_offset = 0;
+	xc->astretcha = 0.0;
+
+	fprintf(stderr, " %d %d master against %d aligned images\n", xc->m_nx, xc->m_ny, xc->npairs);
+}
+/*---------------------------------------------------------------------------*/
@@ -50,39 +50,94 @@
  * 10/23/10     changed calc_phase to calc_drho and completely rewrote     *
  *              the topographic phase correction to use all the nonlinear  *
  *              terms.
+ * 10/17/26     Added -batch to form the interferograms of one reference   *
+ *              with many repeat images in a single pass over the          *
+ *              reference SLC, the look angles of each row are computed    *
+ *              once for all of them                                       *
  ***************************************************************************/
 #include "gmtsar.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define MAX_BATCH_OPEN 128 /* repeat images streamed per pass over the reference */
 
 char *USAGE = "phasediff [GMTSAR] - Compute phase difference of two images\n\n"
               "\nUsage: "
               "phasediff ref.PRM rep.PRM [-topo topo_ra.grd] [-model "
-              "modelphase.grd]\n (topo_ra and model in GMT grd format)\n";
+              "modelphase.grd]\n (topo_ra and model in GMT grd format)\n"
+              "\n       phasediff ref.PRM rep.list -batch [-topo topo_ra.grd] [-nthreads n]\n"
+              "\n -batch       rep.list holds one repeat PRM file per line, optionally followed by\n"
+              "              an existing directory that gets its real.grd and imag.grd;\n"
+              "              otherwise they are written as real_<rep>.grd and imag_<rep>.grd\n"
+              "              the repeat PRM files must hold their baselines to the reference\n"
+              "              as intf.csh appends them, -model is not available\n"
+              " -nthreads n  number of repeat images formed at the same time in -batch mode\n";
+
+/* baseline along the frame as a polynomial in time */
+struct BASELINE {
+	double Bh0, dBh, ddBh; /* horizontal */
+	double Bv0, dBv, ddBv; /* vertical */
+	double Bx0, dBx, ddBx; /* along track offset */
+};
+
+/* one repeat image of a batch run */
+struct BATCH_PAIR {
+	struct PRM p;
+	struct BASELINE bl;
+	double dt, cnst;
+	int shift; /* shift the range for a long baseline */
+	FILE *SLCfile;
+	char real_file[1100], imag_file[1100];
+	struct GMT_GRID *RE, *IM;
+	float *re, *im; /* the current row of the interferogram */
+};
+
+/* scratch rows of one thread */
+struct BATCH_WORK {
+	short *d2;
+	fcomplex *iptr2, *intfp;
+	double *drho, *drho0, *shft, *real, *imag, *ss, *as;
+};
 
 /*--------------------------------------------------------------*/
-void calc_drho(int xdim, double *range, double *topo, double avet, double re, double height, double B, double alpha, double Bx,
-               double *drho) {
+/* sine and cosine of the look angle of every range bin,	*/
+/* these depend only on the reference orbit and the topography	*/
+void calc_look(int xdim, double *range, double *topo, double avet, double re, double height, long double *sint,
+               long double *cost) {
 	int k;
 	/* EX: changing to long double for better precision */
-	long double rho, sint, cost, cosa, sina, b;
-	// long double term1,term2,c,c2,ret,ret2;
-	long double term1, c, c2, ret, ret2;
+	long double rho, c, c2, ret, ret2;
 
-	sina = sin(alpha);
-	cosa = cos(alpha);
 	c = re + height;
 	c2 = c * c;
-	b = B;
 	for (k = 0; k < xdim; k++) {
 
 		/* compute the look angle using equation (C26) in Appendix C */
 		rho = range[k];
 		ret = re + avet + topo[k];
 		ret2 = ret * ret;
-		cost = ((rho * rho + c2 - ret2) / (2. * rho * c));
+		cost[k] = ((rho * rho + c2 - ret2) / (2. * rho * c));
 		// thet = acos(cost);
-		if (cost >= 1.)
+		if (cost[k] >= 1.)
 			die("calc_drho", "cost >= 0");
-		sint = sqrtl(1. - cost * cost);
+		sint[k] = sqrtl(1. - cost[k] * cost[k]);
+	}
+}
+
+/*--------------------------------------------------------------*/
+/* range change of every range bin for one baseline		*/
+void calc_drho(int xdim, double *range, long double *sint, long double *cost, double B, double alpha, double Bx, double *drho) {
+	int k;
+	long double rho, cosa, sina, b;
+	// long double term1,term2,c,c2,ret,ret2;
+	long double term1;
+
+	sina = sin(alpha);
+	cosa = cos(alpha);
+	b = B;
+	for (k = 0; k < xdim; k++) {
+		rho = range[k];
 
 		/* compute the range change using equation (c23) in Appendic C */
 		// term1 = -B*(sint*cosa-cost*sina);
@@ -96,12 +151,88 @@ void calc_drho(int xdim, double *range, double *topo, double avet, double re, do
 		// drho[k] = -rho + sqrtl(term1);
 
 		/* Compute the offset effect from non-parallel orbit */
-		term1 = rho * rho + b * b - 2 * rho * b * (sint * cosa - cost * sina) - Bx * Bx;
+		term1 = rho * rho + b * b - 2 * rho * b * (sint[k] * cosa - cost[k] * sina) - Bx * Bx;
 		// term1 = rho*rho + b*b - 2*rho*b*(sint*cosa-cost*sina);
 		drho[k] = -rho + sqrtl(term1);
 	}
 }
 
+/*--------------------------------------------------------------*/
+/* baseline polynomials from the repeat PRM			*/
+/* first case is quadratic baseline model, second case is	*/
+/* default linear model						*/
+void baseline_model(struct PRM *p2, double tspan, struct BASELINE *bl) {
+	double Bhc, Bvc, Bxc, Bhf, Bvf, Bxf;
+
+	bl->Bh0 = p2->baseline_start * cos(p2->alpha_start * PI / 180.0);
+	bl->Bv0 = p2->baseline_start * sin(p2->alpha_start * PI / 180.0);
+	Bhf = p2->baseline_end * cos(p2->alpha_end * PI / 180.0);
+	Bvf = p2->baseline_end * sin(p2->alpha_end * PI / 180.0);
+	bl->Bx0 = p2->B_offset_start;
+	Bxf = p2->B_offset_end;
+
+	if (p2->baseline_center != NULL_DOUBLE || p2->alpha_center != NULL_DOUBLE || p2->B_offset_center != NULL_DOUBLE) {
+
+		Bhc = p2->baseline_center * cos(p2->alpha_center * PI / 180.0);
+		Bvc = p2->baseline_center * sin(p2->alpha_center * PI / 180.0);
+		Bxc = p2->B_offset_center;
+
+		bl->dBh = (-3. * bl->Bh0 + 4 * Bhc - Bhf) / tspan;
+		bl->dBv = (-3. * bl->Bv0 + 4 * Bvc - Bvf) / tspan;
+		bl->ddBh = (2. * bl->Bh0 - 4 * Bhc + 2 * Bhf) / (tspan * tspan);
+		bl->ddBv = (2. * bl->Bv0 - 4 * Bvc + 2 * Bvf) / (tspan * tspan);
+
+		bl->dBx = (-3. * bl->Bx0 + 4 * Bxc - Bxf) / tspan;
+		bl->ddBx = (2. * bl->Bx0 - 4 * Bxc + 2 * Bxf) / (tspan * tspan);
+	}
+	else {
+		bl->dBh = (Bhf - bl->Bh0) / tspan;
+		bl->dBv = (Bvf - bl->Bv0) / tspan;
+		bl->dBx = (Bxf - bl->Bx0) / tspan;
+		bl->ddBh = bl->ddBv = bl->ddBx = 0.0;
+	}
+}
+
+/*--------------------------------------------------------------*/
+/* baseline length, angle and along track offset at time	*/
+void baseline_at(struct BASELINE *bl, double time, double *B, double *alpha, double *Bx) {
+	double Bh, Bv, time2;
+
+	time2 = time * time;
+	Bh = bl->Bh0 + bl->dBh * time + bl->ddBh * time2;
+	Bv = bl->Bv0 + bl->dBv * time + bl->ddBv * time2;
+	*Bx = bl->Bx0 + bl->dBx * time + bl->ddBx * time2;
+	*B = sqrt(Bh * Bh + Bv * Bv);
+	*alpha = atan2(Bv, Bh);
+}
+
+/*--------------------------------------------------------------*/
+/* shift the range of the repeat image by shft bins with a	*/
+/* spline to improve image matching for very long baselines	*/
+void shift_range(int xdim, double *xs, double *shft, fcomplex *intfp, double *real, double *imag, double *ss, double *as) {
+	int k, istart;
+	double ys, test;
+
+	for (k = 0; k < xdim; k++) {
+		real[k] = intfp[k].r;
+		imag[k] = intfp[k].i;
+	}
+	/* shift the real part */
+	spline_(&istart, &xdim, xs, real, ss, as);
+	for (k = 0; k < xdim; k++) {
+		ys = xs[k] + shft[k];
+		evals_(&istart, &ys, &xdim, xs, real, ss, &test);
+		intfp[k].r = (float)test;
+	}
+	/* shift imaginary part  */
+	spline_(&istart, &xdim, xs, imag, ss, as);
+	for (k = 0; k < xdim; k++) {
+		ys = xs[k] + shft[k];
+		evals_(&istart, &ys, &xdim, xs, real, ss, &test);
+		intfp[k].i = (float)test;
+	}
+}
+
 /*--------------------------------------------------------------*/
 void calc_average_topo(double *avet, int xdimt, int ydimt, float *topo) {
 	double sumt;
@@ -194,9 +325,346 @@ void read_optional_args(void *API, int argc, char **argv, struct PRM *tp, int *t
 	}
 }
 
+/*--------------------------------------------------------------*/
+/* read topo_ra, remove its average and return its decimation	*/
+struct GMT_GRID *read_topo(void *API, char *file, int xdim, int ydim, double *avet, double *xdect, double *ydect) {
+	double rdumt;
+	struct GMT_GRID *T = NULL;
+
+	if ((T = GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, file, NULL)) == NULL)
+		die("cannot open topofile", file);
+	if (xdim % T->header->n_columns != 0 || ydim % T->header->n_rows != 0)
+		die("The dimension SLC must be multiplication factor of the topo_ra", file);
+	if (GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_DATA_ONLY, NULL, file, T) == NULL)
+		die("cannot read topofile", file);
+	rdumt = floor(T->header->z_max + 1.0);
+
+	if (verbose)
+		fprintf(stderr, "\n%s %s %d %d\n", T->header->title, file, T->header->n_columns, T->header->n_rows);
+	if (verbose)
+		fprintf(stderr, "\n%f %f %f %f %f\n", T->header->wesn[GMT_XLO], T->header->wesn[GMT_YLO], T->header->inc[GMT_X],
+		        T->header->inc[GMT_Y], rdumt);
+
+	/* T->header->inc[GMT_X] or T->header->inc[GMT_Y] may be negative */
+	*xdect = fabs(T->header->inc[GMT_X]);
+	*ydect = fabs(T->header->inc[GMT_Y]);
+
+	/* calculate the average and remove the average from the topography */
+
+	calc_average_topo(avet, T->header->n_columns, T->header->n_rows, T->data);
+	if (verbose)
+		fprintf(stderr, " read topo file: average %f \n", *avet);
+
+	return (T);
+}
+
+/*--------------------------------------------------------------*/
+/* read the list of repeat PRM files of a batch run		*/
+struct BATCH_PAIR *read_batch_list(char *list, struct PRM *p1, int xdim, int ydim, int *npairs, int *ydim_start) {
+	int n, nalloc, nitems, start;
+	char line[1024], name[1024], out[1024], stem[1024], *c;
+	double tspan;
+	FILE *listfile = NULL;
+	struct BATCH_PAIR *pairs = NULL, *q;
+
+	if ((listfile = fopen(list, "r")) == NULL)
+		die("Can't open list of repeat PRM files ", list);
+
+	nalloc = 16;
+	pairs = (struct BATCH_PAIR *)malloc(nalloc * sizeof(struct BATCH_PAIR));
+	n = 0;
+	while (fgets(line, sizeof(line), listfile) != NULL) {
+		if ((nitems = sscanf(line, "%s %s", name, out)) < 1 || name[0] == '#')
+			continue;
+		if (n == nalloc) {
+			nalloc *= 2;
+			pairs = (struct BATCH_PAIR *)realloc(pairs, nalloc * sizeof(struct BATCH_PAIR));
+		}
+		q = &pairs[n];
+		memset(q, 0, sizeof(struct BATCH_PAIR));
+
+		get_prm(&q->p, name);
+		if (q->p.baseline_start < -9000) {
+			print_prm_params(*p1, q->p);
+			die("baseline < -9000 not set ?", name);
+		}
+		fix_prm_params(&q->p, name);
+		if (q->p.num_rng_bins != xdim)
+			die("The dimensions of range do not match", name);
+		if (q->p.num_patches * q->p.num_valid_az != ydim)
+			die("The dimensions of azimuth do not match", name);
+
+		/* revise params in accordance with first_line, the same for all pairs */
+		start = ((p1->first_line > 0) && (q->p.first_line > 0)) ? p1->first_line - 1 : 0;
+		if (n == 0)
+			*ydim_start = start;
+		else if (start != *ydim_start)
+			die("first_line must be set in all or none of the repeat PRM files ", name);
+
+		/*   compute the time span and the time spacing */
+		tspan = 86400. * fabs(q->p.SC_clock_stop - q->p.SC_clock_start);
+		q->dt = tspan / (ydim - 1);
+		if (tspan < 0.01 || q->p.prf < 0.01)
+			die("check sc_clock_start, _end, or prf", name);
+		baseline_model(&q->p, tspan, &q->bl);
+		q->cnst = -4.0 * PI / q->p.lambda;
+		q->shift = (q->p.baseline_start > 1000.0);
+
+		/* outputs go to the given directory or next to the list */
+		if (nitems == 2) {
+			sprintf(q->real_file, "%s/real.grd=bf", out);
+			sprintf(q->imag_file, "%s/imag.grd=bf", out);
+		}
+		else {
+			strcpy(stem, (c = strrchr(name, '/')) ? c + 1 : name);
+			if ((c = strstr(stem, ".PRM")) != NULL)
+				*c = '\0';
+			sprintf(q->real_file, "real_%s.grd=bf", stem);
+			sprintf(q->imag_file, "imag_%s.grd=bf", stem);
+		}
+		n++;
+	}
+	fclose(listfile);
+	if (n == 0)
+		die("no repeat PRM files in ", list);
+
+	*npairs = n;
+	return (pairs);
+}
+
+/*--------------------------------------------------------------*/
+/* start a pixel registered xdim by ydim grid that is written	*/
+/* one row at a time						*/
+struct GMT_GRID *open_grid_rows(void *API, int xdim, int ydim, char *fname, char *type) {
+	double inc[2], wesn[4];
+	struct GMT_GRID *G = NULL;
+
+	inc[GMT_X] = inc[GMT_Y] = 1.0; /* Pixels */
+	wesn[GMT_XLO] = 0.0;
+	wesn[GMT_XHI] = inc[GMT_X] * xdim;
+	wesn[GMT_YLO] = 0.0;
+	wesn[GMT_YHI] = inc[GMT_Y] * ydim;
+	if ((G = GMT_Create_Data(API, GMT_IS_GRID, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, wesn, inc, GMT_GRID_PIXEL_REG, 0,
+	                         NULL)) == NULL)
+		die("could not allocate grid header", "");
+	strcpy(G->header->remark, type);
+	if (GMT_Write_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY | GMT_GRID_ROW_BY_ROW, NULL, fname, G))
+		die("cannot create ", fname);
+
+	return (G);
+}
+
+/*--------------------------------------------------------------*/
+/* interferogram of one repeat image on row j of the reference	*/
+void batch_row(struct BATCH_PAIR *q, struct BATCH_WORK *w, int j, int xdim, int topoflag, double *range, double *range2,
+               double *xs, long double *sint, long double *cost, long double *sint0, long double *cost0, fcomplex *iptr1) {
+	int k;
+	double B, alpha, Bx, drange;
+
+	read_SLC_short2float(q->SLCfile, q->p.SLC_file, w->d2, w->iptr2, xdim, 1, DFACT);
+
+	if (topoflag > 0) {
+		baseline_at(&q->bl, j * q->dt, &B, &alpha, &Bx);
+		calc_drho(xdim, range2, sint, cost, B, alpha, Bx, w->drho);
+		for (k = 0; k < xdim; k++)
+			w->intfp[k] = Cmul(iptr1[k], Cexp(q->cnst * w->drho[k]));
+
+		if (q->shift) {
+			drange = SOL / (2.0 * q->p.fs);
+			calc_drho(xdim, range, sint0, cost0, B, alpha, Bx, w->drho0);
+			for (k = 0; k < xdim; k++)
+				w->shft[k] = (w->drho0[k] - w->drho[k]) / drange;
+			shift_range(xdim, xs, w->shft, w->intfp, w->real, w->imag, w->ss, w->as);
+		}
+	}
+	else {
+		for (k = 0; k < xdim; k++)
+			w->intfp[k] = iptr1[k];
+	}
+
+	for (k = 0; k < xdim; k++) {
+		w->intfp[k] = Cmul(w->intfp[k], Conjg(w->iptr2[k]));
+		q->re[k] = w->intfp[k].r;
+		q->im[k] = w->intfp[k].i;
+	}
+}
+
+/*--------------------------------------------------------------*/
+/* form the interferograms of the reference with every repeat	*/
+/* image of the list: each row of the reference SLC is read and	*/
+/* its look angles computed once, then every pair only needs	*/
+/* its own baseline, and the rows of all the outputs are	*/
+/* written as they are done					*/
+void phasediff_batch(void *API, struct PRM *p1, char *list, int topoflag, struct PRM *tp, int nthreads) {
+	int i, j, k, t, c0, nc, npairs, xdim, ydim, ydim_start = 0, need0;
+	double drange, tspan, dt, time, time2, ht0, htc, htf, dht, ddht, height, avet = 0.0, xdect = 1.0, ydect = 1.0;
+	double *range = NULL, *range2 = NULL, *topo2 = NULL, *xs = NULL;
+	long double *sint = NULL, *cost = NULL, *sint0 = NULL, *cost0 = NULL;
+	short *d1 = NULL;
+	fcomplex *iptr1 = NULL;
+	FILE *SLCfile1 = NULL;
+	struct BATCH_PAIR *pairs = NULL;
+	struct BATCH_WORK *work = NULL;
+	struct GMT_GRID *T = NULL;
+
+	xdim = p1->num_rng_bins;
+	ydim = p1->num_patches * p1->num_valid_az;
+	pairs = read_batch_list(list, p1, xdim, ydim, &npairs, &ydim_start);
+	fprintf(stderr, " xdim %d, ydim %d, %d repeat images \n", xdim, ydim, npairs);
+
+	if (topoflag)
+		T = read_topo(API, tp->input_file, xdim, ydim, &avet, &xdect, &ydect);
+
+#ifndef _OPENMP
+	nthreads = 1;
+#endif
+	nthreads = MAX(1, MIN(nthreads, MIN(npairs, MAX_BATCH_OPEN)));
+
+	/* the height of the reference along the frame */
+	tspan = 86400. * fabs(p1->SC_clock_stop - p1->SC_clock_start);
+	dt = tspan / (ydim - 1);
+	if (tspan < 0.01 || p1->prf < 0.01)
+		die("check sc_clock_start, _end, or prf", "");
+	htc = p1->ht;
+	ht0 = p1->ht_start;
+	htf = p1->ht_end;
+	dht = (-3. * ht0 + 4 * htc - htf) / tspan;
+	ddht = (2. * ht0 - 4 * htc + 2 * htf) / (tspan * tspan);
+
+	/* look angles without topography are needed for the long baseline range shift */
+	need0 = 0;
+	for (i = 0; i < npairs; i++)
+		need0 |= topoflag && pairs[i].shift;
+
+	/* allocate memory */
+	drange = SOL / (2.0 * p1->fs);
+	range = (double *)malloc(xdim * sizeof(double));
+	range2 = (double *)malloc(xdim * sizeof(double));
+	topo2 = (double *)malloc(xdim * sizeof(double));
+	xs = (double *)malloc(xdim * sizeof(double));
+	sint = (long double *)malloc(xdim * sizeof(long double));
+	cost = (long double *)malloc(xdim * sizeof(long double));
+	sint0 = (long double *)malloc(xdim * sizeof(long double));
+	cost0 = (long double *)malloc(xdim * sizeof(long double));
+	d1 = (short *)malloc(2 * xdim * sizeof(short));
+	iptr1 = (fcomplex *)malloc(xdim * sizeof(fcomplex));
+	for (k = 0; k < xdim; k++) {
+		range[k] = p1->near_range + k * (1 + p1->stretch_r) * drange;
+		topo2[k] = 0.;
+		xs[k] = k;
+	}
+
+	work = (struct BATCH_WORK *)malloc(nthreads * sizeof(struct BATCH_WORK));
+	for (t = 0; t < nthreads; t++) {
+		work[t].d2 = (short *)malloc(2 * xdim * sizeof(short));
+		work[t].iptr2 = (fcomplex *)malloc(xdim * sizeof(fcomplex));
+		work[t].intfp = (fcomplex *)malloc(xdim * sizeof(fcomplex));
+		work[t].drho = (double *)malloc(xdim * sizeof(double));
+		work[t].drho0 = (double *)malloc(xdim * sizeof(double));
+		work[t].shft = (double *)malloc(xdim * sizeof(double));
+		work[t].real = (double *)malloc(xdim * sizeof(double));
+		work[t].imag = (double *)malloc(xdim * sizeof(double));
+		work[t].ss = (double *)malloc(xdim * sizeof(double));
+		work[t].as = (double *)malloc(xdim * sizeof(double));
+	}
+
+	/* at most MAX_BATCH_OPEN repeat images per pass so the open files stay few */
+	for (c0 = 0; c0 < npairs; c0 += MAX_BATCH_OPEN) {
+		nc = MIN(MAX_BATCH_OPEN, npairs - c0);
+		if ((SLCfile1 = fopen(p1->SLC_file, "r")) == NULL)
+			die("Can't open SLCfile", p1->SLC_file);
+		for (i = c0; i < c0 + nc; i++) {
+			if ((pairs[i].SLCfile = fopen(pairs[i].p.SLC_file, "r")) == NULL)
+				die("Can't open SLCfile", pairs[i].p.SLC_file);
+			pairs[i].RE = open_grid_rows(API, xdim, ydim, pairs[i].real_file, "real");
+			pairs[i].IM = open_grid_rows(API, xdim, ydim, pairs[i].imag_file, "imag");
+			pairs[i].re = (float *)malloc(xdim * sizeof(float));
+			pairs[i].im = (float *)malloc(xdim * sizeof(float));
+		}
+
+		for (j = ydim_start; j < (ydim + ydim_start); j++) {
+			for (k = 0; k < xdim; k++)
+				range2[k] = range[k] + j * p1->a_stretch_r * drange;
+
+			/* read data from complex i2 SLC 	*/
+			read_SLC_short2float(SLCfile1, p1->SLC_file, d1, iptr1, xdim, 1, DFACT);
+
+			/* look angles of the row with and without topography */
+			if (topoflag > 0) {
+				time = j * dt;
+				time2 = time * time;
+				height = ht0 + dht * time + ddht * time2;
+				for (k = 0; k < xdim; k++)
+					topo2[k] = T->data[(int)(k / xdect) + T->header->n_columns * (int)(j / ydect)];
+				calc_look(xdim, range2, topo2, avet, p1->RE, height, sint, cost);
+				if (need0) {
+					for (k = 0; k < xdim; k++)
+						topo2[k] = 0.;
+					calc_look(xdim, range, topo2, avet, p1->RE, height, sint0, cost0);
+				}
+			}
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads) private(t)
+#endif
+			for (i = c0; i < c0 + nc; i++) {
+#ifdef _OPENMP
+				t = omp_get_thread_num();
+#else
+				t = 0;
+#endif
+				batch_row(&pairs[i], &work[t], j, xdim, topoflag, range, range2, xs, sint, cost, sint0, cost0, iptr1);
+			}
+
+			for (i = c0; i < c0 + nc; i++) {
+				GMT_Put_Row(API, j - ydim_start, pairs[i].RE, pairs[i].re);
+				GMT_Put_Row(API, j - ydim_start, pairs[i].IM, pairs[i].im);
+			}
+		}
+
+		fclose(SLCfile1);
+		for (i = c0; i < c0 + nc; i++) {
+			fclose(pairs[i].SLCfile);
+			if (GMT_Destroy_Data(API, &pairs[i].RE) || GMT_Destroy_Data(API, &pairs[i].IM))
+				die("error freeing data", pairs[i].real_file);
+			free(pairs[i].re);
+			free(pairs[i].im);
+			if (verbose)
+				fprintf(stderr, " wrote %s %s \n", pairs[i].real_file, pairs[i].imag_file);
+		}
+	}
+
+	for (t = 0; t < nthreads; t++) {
+		free(work[t].d2);
+		free(work[t].iptr2);
+		free(work[t].intfp);
+		free(work[t].drho);
+		free(work[t].drho0);
+		free(work[t].shft);
+		free(work[t].real);
+		free(work[t].imag);
+		free(work[t].ss);
+		free(work[t].as);
+	}
+	free(work);
+	free(pairs);
+	free(range);
+	free(range2);
+	free(topo2);
+	free(xs);
+	free(sint);
+	free(cost);
+	free(sint0);
+	free(cost0);
+	free(d1);
+	free(iptr1);
+	if (topoflag && GMT_Destroy_Data(API, &T))
+		die("error freeing data", tp->input_file);
+}
+
 int main(int argc, char **argv) {
-	int j, k, istart;
-	int topoflag, modelflag;
+	int i, j, k;
+	int topoflag, modelflag, batch, nthreads;
 	int xdim = 0, ydim = 0; /* size of SLC file */
 	int ydim_start;         /* start of SLC filesize */
 	int xt, yt;             /* size of topo file, increment */
@@ -205,16 +673,14 @@ int main(int argc, char **argv) {
 	short *d1 = NULL, *d2 = NULL; /* pointers to input data files */
 	double *xs = NULL, *shft = NULL, *ss = NULL, *as = NULL, *topo2 = NULL;
 	double *real = NULL, *imag = NULL, *range = NULL, *drho = NULL, *drho0 = NULL;
-	double drange, dt, tspan, time, time2;
+	long double *sint = NULL, *cost = NULL;
+	double drange, drange1, dt, dt1, tspan, tspan1, time, time2;
 	double ht0, htc, htf, dht, ddht, height;
 	double alpha, cnst, pha, avet;
-	double B, Bh, Bv, dBh, dBv, ddBh, ddBv;
-
-	double Bx, dBx, ddBx, Bx0, Bxc, Bxf;
-
-	double Bh0, Bhc, Bhf, Bv0, Bvc, Bvf;
-	double ys, test, inc[2], wesn[4];
-	double xdect, ydect, xdecm, ydecm, rdumt;
+	double B, Bx;
+	struct BASELINE bl;
+	double inc[2], wesn[4];
+	double xdect, ydect, xdecm, ydecm;
 	FILE *SLCfile1 = NULL, *SLCfile2 = NULL;
 	fcomplex *intfp = NULL, *iptr1 = NULL, *iptr2 = NULL, pshif;
 	struct PRM p1, p2, tp, mp;
@@ -229,7 +695,8 @@ int main(int argc, char **argv) {
 		return EXIT_FAILURE;
 
 	verbose = 0;
-	topoflag = modelflag = 0;
+	topoflag = modelflag = batch = 0;
+	nthreads = 1;
 	xdect = ydect = 1.0;
 	xdecm = ydecm = 1.0;
 	avet = 0.0;
@@ -238,6 +705,27 @@ int main(int argc, char **argv) {
 	if (argc < 3)
 		die(USAGE, "");
 
+	for (i = 3; i < argc; i++) {
+		if (strcmp(argv[i], "-batch") == 0)
+			batch = 1;
+		else if (strcmp(argv[i], "-nthreads") == 0 && i + 1 < argc)
+			nthreads = atoi(argv[++i]);
+	}
+
+	/* batch mode: argv[2] is a list of repeat PRM files */
+	if (batch) {
+		get_prm(&p1, argv[1]);
+		if (argc > 3)
+			read_optional_args(API, argc, argv, &tp, &topoflag, &mp, &modelflag);
+		if (modelflag)
+			die("-model cannot be used with -batch", "");
+		fix_prm_params(&p1, argv[1]);
+		phasediff_batch(API, &p1, argv[2], topoflag, &tp, nthreads);
+		if (GMT_Destroy_Session(API))
+			return EXIT_FAILURE; /* Remove the GMT machinery */
+		return (EXIT_SUCCESS);
+	}
+
 	/* read prm file into two pointers */
 	get_prm(&p1, argv[1]);
 	get_prm(&p2, argv[2]);
@@ -311,6 +799,8 @@ int main(int argc, char **argv) {
 	drho0 = (double *)malloc(xdim * sizeof(double));
 	range = (double *)malloc(xdim * sizeof(double));
 	range2 = (double *)malloc(xdim * sizeof(double));
+	sint = (long double *)malloc(xdim * sizeof(long double));
+	cost = (long double *)malloc(xdim * sizeof(long double));
 
 	intfp = (fcomplex *)malloc(xdim * sizeof(fcomplex));
 	iptr1 = (fcomplex *)malloc(xdim * sizeof(fcomplex));
@@ -328,32 +818,8 @@ int main(int argc, char **argv) {
 	as = (double *)malloc(xdim * sizeof(double));
 
 	/* open and read topo file and allocate memory */
-	if (topoflag) {
-		if ((T = GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, tp.input_file, NULL)) ==
-		    NULL)
-			return EXIT_FAILURE;
-		if (xdim % T->header->n_columns != 0 || ydim % T->header->n_rows != 0)
-			die("The dimension SLC must be multiplication factor of the topo_ra", tp.input_file);
-		if (GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_DATA_ONLY, NULL, tp.input_file, T) == NULL)
-			return EXIT_FAILURE;
-		rdumt = floor(T->header->z_max + 1.0);
-
-		if (verbose)
-			fprintf(stderr, "\n%s %s %d %d\n", T->header->title, tp.input_file, T->header->n_columns, T->header->n_rows);
-		if (verbose)
-			fprintf(stderr, "\n%f %f %f %f %f\n", T->header->wesn[GMT_XLO], T->header->wesn[GMT_YLO], T->header->inc[GMT_X],
-			        T->header->inc[GMT_Y], rdumt);
-
-		/* T->header->inc[GMT_X] or T->header->inc[GMT_Y] may be negative */
-		xdect = fabs(T->header->inc[GMT_X]);
-		ydect = fabs(T->header->inc[GMT_Y]);
-
-		/* calculate the average and remove the average from the topography */
-
-		calc_average_topo(&avet, T->header->n_columns, T->header->n_rows, T->data);
-		if (verbose)
-			fprintf(stderr, " read topo file: average %f \n", avet);
-	}
+	if (topoflag)
+		T = read_topo(API, tp.input_file, xdim, ydim, &avet, &xdect, &ydect);
 
 	/* open and read the model file and allocate the memory */
 
@@ -369,22 +835,29 @@ int main(int argc, char **argv) {
 		ydecm = fabs(M->header->inc[GMT_Y]);
 	}
 
-	/*   compute the time span and the time spacing */
+	/*   compute the time span and the time spacing of the repeat for its	*/
+	/*   baseline and of the reference for its height, as in batch mode	*/
 
 	tspan = 86400. * fabs(p2.SC_clock_stop - p2.SC_clock_start);
 	dt = tspan / (ydim - 1);
 	if (tspan < 0.01 || p2.prf < 0.01)
 		die("check sc_clock_start, _end, or prf", "");
+	tspan1 = 86400. * fabs(p1.SC_clock_stop - p1.SC_clock_start);
+	dt1 = tspan1 / (ydim - 1);
+	if (tspan1 < 0.01 || p1.prf < 0.01)
+		die("check sc_clock_start, _end, or prf", "");
 
-	/* setup the default parameters */
+	/* setup the default parameters; the range of the reference pixels	*/
+	/* follows its own sampling rate and the shift the repeat's		*/
 
 	drange = SOL / (2.0 * p2.fs);
+	drange1 = SOL / (2.0 * p1.fs);
 	alpha = p2.alpha_start * PI / 180.0;
 	cnst = -4.0 * PI / p2.lambda;
 
 	for (k = 0; k < xdim; k++) {
 		// range[k]=p1.near_range+k*drange;
-		range[k] = p1.near_range + k * (1 + p1.stretch_r) * drange;
+		range[k] = p1.near_range + k * (1 + p1.stretch_r) * drange1;
 		topo2[k] = 0.;
 		xs[k] = k;
 	}
@@ -414,40 +887,11 @@ int main(int argc, char **argv) {
 	}
 	*/
 
-	Bh0 = p2.baseline_start * cos(p2.alpha_start * PI / 180.0);
-	Bv0 = p2.baseline_start * sin(p2.alpha_start * PI / 180.0);
-	Bhf = p2.baseline_end * cos(p2.alpha_end * PI / 180.0);
-	Bvf = p2.baseline_end * sin(p2.alpha_end * PI / 180.0);
-	Bx0 = p2.B_offset_start;
-	Bxf = p2.B_offset_end;
-
-	/* first case is quadratic baseline model, second case is default linear model
-	 */
-
-	if (p2.baseline_center != NULL_DOUBLE || p2.alpha_center != NULL_DOUBLE || p2.B_offset_center != NULL_DOUBLE) {
-
-		Bhc = p2.baseline_center * cos(p2.alpha_center * PI / 180.0);
-		Bvc = p2.baseline_center * sin(p2.alpha_center * PI / 180.0);
-		Bxc = p2.B_offset_center;
-
-		dBh = (-3. * Bh0 + 4 * Bhc - Bhf) / tspan;
-		dBv = (-3. * Bv0 + 4 * Bvc - Bvf) / tspan;
-		ddBh = (2. * Bh0 - 4 * Bhc + 2 * Bhf) / (tspan * tspan);
-		ddBv = (2. * Bv0 - 4 * Bvc + 2 * Bvf) / (tspan * tspan);
-
-		dBx = (-3. * Bx0 + 4 * Bxc - Bxf) / tspan;
-		ddBx = (2. * Bx0 - 4 * Bxc + 2 * Bxf) / (tspan * tspan);
-	}
-	else {
-		dBh = (Bhf - Bh0) / tspan;
-		dBv = (Bvf - Bv0) / tspan;
-		dBx = (Bxf - Bx0) / tspan;
-		ddBh = ddBv = ddBx = 0.0;
-	}
+	baseline_model(&p2, tspan, &bl);
 
 	/* calculate height increment */
-	dht = (-3. * ht0 + 4 * htc - htf) / tspan;
-	ddht = (2. * ht0 - 4 * htc + 2 * htf) / (tspan * tspan);
+	dht = (-3. * ht0 + 4 * htc - htf) / tspan1;
+	ddht = (2. * ht0 - 4 * htc + 2 * htf) / (tspan1 * tspan1);
 
 	/* revise params in accordance with first_line 	*/
 	if ((p1.first_line > 0) && (p2.first_line > 0))
@@ -458,7 +902,7 @@ int main(int argc, char **argv) {
 
 		for (k = 0; k < xdim; k++) {
 			// range[k]=p1.near_range+k*drange;
-			range2[k] = range[k] + j * p1.a_stretch_r * drange;
+			range2[k] = range[k] + j * p1.a_stretch_r * drange1;
 		}
 
 		/* read data from complex i2 SLC 	*/
@@ -470,15 +914,9 @@ if (topoflag > 0) {
 		ym = j / ydecm; /* for modelphase */
 
 		/* calculate the change in baseline and height along the frame if topoflag is on */
-		time = j * dt;
+		baseline_at(&bl, j * dt, &B, &alpha, &Bx);
+		time = j * dt1;
 		time2 = time * time;
-		Bh = Bh0 + dBh * time + ddBh * time2;
-		Bv = Bv0 + dBv * time + ddBv * time2;
-
-		Bx = Bx0 + dBx * time + ddBx * time2;
-
-		B = sqrt(Bh * Bh + Bv * Bv);
-		alpha = atan2(Bv, Bh);
 		height = ht0 + dht * time + ddht * time2;
 
 		for (k = 0; k < xdim; k++) {
@@ -490,7 +928,8 @@ if (topoflag > 0) {
 		}
 
 		/* calculate the combined earth curvature and topography correction if topoflag is on */
-		calc_drho(xdim, range2, topo2, avet, p1.RE, height, B, alpha, Bx, drho);
+		calc_look(xdim, range2, topo2, avet, p1.RE, height, sint, cost);
+		calc_drho(xdim, range2, sint, cost, B, alpha, Bx, drho);
 
 		// if (j == 50) printf("drho = %.12f\n",drho[50]);
 
@@ -525,27 +964,12 @@ else {
 
 			/* compute the range change with no topography so the range shift can be
 			 * determined for the spline */
-			calc_drho(xdim, range, shft, avet, p1.RE, height, B, alpha, Bx, drho0);
+			calc_look(xdim, range, shft, avet, p1.RE, height, sint, cost);
+			calc_drho(xdim, range, sint, cost, B, alpha, Bx, drho0);
 
-			for (k = 0; k < xdim; k++) {
+			for (k = 0; k < xdim; k++)
 				shft[k] = (drho0[k] - drho[k]) / drange;
-				real[k] = intfp[k].r;
-				imag[k] = intfp[k].i;
-			}
-			/* shift the real part */
-			spline_(&istart, &xdim, xs, real, ss, as);
-			for (k = 0; k < xdim; k++) {
-				ys = xs[k] + shft[k];
-				evals_(&istart, &ys, &xdim, xs, real, ss, &test);
-				intfp[k].r = (float)test;
-			}
-			/* shift imaginary part  */
-			spline_(&istart, &xdim, xs, imag, ss, as);
-			for (k = 0; k < xdim; k++) {
-				ys = xs[k] + shft[k];
-				evals_(&istart, &ys, &xdim, xs, real, ss, &test);
-				intfp[k].i = (float)test;
-			}
+			shift_range(xdim, xs, shft, intfp, real, imag, ss, as);
 		}
 
 		/* make interferogram */
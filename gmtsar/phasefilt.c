@@ -25,6 +25,10 @@
  *     	default psize changed to 32
  *      '-complex_out' option added to write out filtered real and imag
  *
+ *	rows of patches filtered in parallel ('-nthreads') with cached
+ *	fft plans
+ *	'-stream' option reads, filters and writes in bands of rows
+ *
  *-------------------------------------------------------------------------------------
  */
 int verbose;
@@ -89,7 +93,7 @@ int phasefilt_read_data(void *API, char *imname, struct GMT_GRID *IM, char *rena
 
 	if (GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_DATA_ONLY, NULL, imname, IM) == NULL)
 		die("error reading file", imname);
-	if (GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_DATA_ONLY, NULL, imname, RE) == NULL)
+	if (GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_DATA_ONLY, NULL, rename, RE) == NULL)
 		die("error reading file", rename);
 
 	for (i = 0; i < n; i++) {
@@ -126,17 +130,100 @@ int make_wgt(float *wgt, int nxp, int nyp) {
 }
 
 /* the classic Goldstein filter */
+/* the power and scaling loops are kept free of calls so they vectorize;	*/
+/* the common exponents use sqrtf instead of powf			*/
 int apply_pspec(int m, int n, float alpha, struct FCOMPLEX *in, struct FCOMPLEX *out) {
-	int i;
-	float wgt;
+	int i, mn;
+	float *pw;
 
 	if (alpha < 0.0f)
 		die("alpha < 0; something is rotten in Denmark", "");
+
+	/* the weights are built in the real part of out */
+	mn = m * n;
+	pw = (float *)out;
+	for (i = 0; i < mn; i++)
+		pw[2 * i] = in[i].r * in[i].r + in[i].i * in[i].i;
+
 	/* pow(x,a/2) == pow(sqrt(x),a) */
-	for (i = 0; i < m * n; i++) {
-		wgt = powf((in[i].r * in[i].r + in[i].i * in[i].i), alpha / 2.0f);
-		out[i].r = wgt * in[i].r;
-		out[i].i = wgt * in[i].i;
+	if (alpha == 0.0f) {
+		for (i = 0; i < mn; i++)
+			pw[2 * i] = 1.0f;
+	}
+	else if (alpha == 0.5f) {
+		for (i = 0; i < mn; i++)
+			pw[2 * i] = sqrtf(sqrtf(pw[2 * i]));
+	}
+	else if (alpha == 1.0f) {
+		for (i = 0; i < mn; i++)
+			pw[2 * i] = sqrtf(pw[2 * i]);
+	}
+	else {
+		for (i = 0; i < mn; i++)
+			pw[2 * i] = powf(pw[2 * i], alpha / 2.0f);
+	}
+
+	for (i = 0; i < mn; i++) {
+		out[i].i = pw[2 * i] * in[i].i;
+		out[i].r = pw[2 * i] * in[i].r;
+	}
+
+	return (EXIT_SUCCESS);
+}
+
+/* filter the nxp by nyp patch with upper left corner at row ii, column jj */
+/* patch0 and patch1 are scratch, the filtered patch is left in patch1	   */
+int filter_patch(void *API, struct FFT_PLAN *fx, struct FFT_PLAN *fy, struct FFT_PLAN *ix, struct FFT_PLAN *iy, struct FCOMPLEX *data,
+                 float *corr, float *wgt, unsigned int xdim, unsigned int ii, unsigned int jj, int nxp, int nyp, float alpha,
+                 struct FCOMPLEX *patch0, struct FCOMPLEX *patch1) {
+	int i, j, k2;
+	int64_t k1;
+	float pcorr, swgt;
+
+	pcorr = 0.0f;
+	swgt = 0.0f;
+	for (i = 0; i < nyp; i++) {
+		k1 = (int64_t)(ii + i) * xdim + jj;
+		memcpy(&patch0[i * nxp], &data[k1], nxp * sizeof(struct FCOMPLEX));
+		if (corr != NULL) {
+			for (j = 0; j < nxp; j++) {
+				k2 = i * nxp + j;
+				pcorr += wgt[k2] * corr[k1 + j];
+				swgt += wgt[k2];
+			}
+		}
+	}
+
+	/* set alpha to 1.0 - coherence 	*/
+	/* Baran et al., 2003			*/
+	if (corr != NULL)
+		alpha = 1.0f - pcorr / swgt;
+
+	fft_plan_2d(API, fx, fy, patch0, nxp, nyp);
+
+	apply_pspec(nxp, nyp, alpha, patch0, patch1);
+
+	fft_plan_2d(API, ix, iy, patch1, nxp, nyp);
+
+	return (EXIT_SUCCESS);
+}
+
+/* add a row of npx filtered patches, weighted, into fdata at row ii */
+/* patches are added left to right, in the same order as one at a time */
+int add_patch_row(struct FCOMPLEX *fdata, float *wgt, struct FCOMPLEX *prow, unsigned int xdim, unsigned int ii, int npx, int nxp,
+                  int nyp) {
+	int i, j, jp;
+	int64_t k1, k2;
+
+	for (jp = 0; jp < npx; jp++) {
+		for (i = 0; i < nyp; i++) {
+			k1 = (int64_t)(ii + i) * xdim + jp * (nxp / 2);
+			k2 = (int64_t)jp * nxp * nyp + i * nxp;
+			for (j = 0; j < nxp; j++) {
+				fdata[k1 + j].r = fdata[k1 + j].r + wgt[i * nxp + j] * prow[k2 + j].r;
+				fdata[k1 + j].i = fdata[k1 + j].i + wgt[i * nxp + j] * prow[k2 + j].i;
+			}
+		}
 	}
 
 	return (EXIT_SUCCESS);
@@ -179,8 +266,213 @@ int calc_corr(void *API, char *amp1, char *amp2, unsigned int xdim, unsigned int
 	return (EXIT_SUCCESS);
 }
 
+/* start a grid shaped like h that is written one row at a time */
+struct GMT_GRID *open_grid_rows(void *API, struct GMT_GRID_HEADER *h, char *fname, char *prog, char *type) {
+	struct GMT_GRID *G = NULL;
+
+	if (verbose)
+		fprintf(stderr, " writing %s \n", fname);
+
+	if ((G = GMT_Create_Data(API, GMT_IS_GRID, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, h->wesn, h->inc, h->registration, 0,
+	                         NULL)) == NULL)
+		die("could not allocate grid header", "");
+	strcpy(G->header->command, prog);
+	strcpy(G->header->remark, type);
+	if (GMT_Write_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY | GMT_GRID_ROW_BY_ROW, NULL, fname, G))
+		die("cannot create ", fname);
+
+	return (G);
+}
+
+/* read rows r0 to r0+nrows-1 of the interferogram (and amplitudes) into row k of the window */
+int read_window_rows(void *API, char *sre, char *sim, char *amp1, char *amp2, struct GMT_GRID_HEADER *h, unsigned int r0,
+                     unsigned int nrows, unsigned int k, float *re, float *im, float *a1, float *a2, struct FCOMPLEX *data,
+                     float *corr) {
+	int64_t i, n, k0;
+	float a;
+
+	n = (int64_t)nrows * h->n_columns;
+	k0 = (int64_t)k * h->n_columns;
+	read_grid_rows(API, sre, h, r0, nrows, re);
+	read_grid_rows(API, sim, h, r0, nrows, im);
+	for (i = 0; i < n; i++) {
+		data[k0 + i].r = re[i];
+		data[k0 + i].i = im[i];
+	}
+	if (corr == NULL)
+		return (EXIT_SUCCESS);
+
+	/* same as calc_corr */
+	read_grid_rows(API, amp1, h, r0, nrows, a1);
+	read_grid_rows(API, amp2, h, r0, nrows, a2);
+	for (i = 0; i < n; i++) {
+		a = a1[i] * a2[i];
+		corr[k0 + i] = (a > 0.0f) ? sqrtf(re[i] * re[i] + im[i] * im[i]) / sqrtf(a) : 0.0f;
+		if (corr[k0 + i] < 0.0f)
+			corr[k0 + i] = 0.0f;
+		if (corr[k0 + i] > 1.0f)
+			corr[k0 + i] = 1.0f;
+	}
+
+	return (EXIT_SUCCESS);
+}
+
+/* filter the interferogram holding only nyp rows of it at a time		*/
+/* the window of nyp rows moves down half a patch per row of patches;	*/
+/* once a row of patches is added, the top half of the window is final	*/
+/* and is written out, so the output is the same as filtering in memory	*/
+int phasefilt_stream(void *API, struct GMT_GRID_HEADER *h, char *sre, char *sim, char *amp1, char *amp2, int corrflag, int dflag,
+                     int comflag, float alpha, int nxp, int nyp, float *wgt, int nthreads) {
+	unsigned int xdim, ydim, xdim2, ydim2, top, nout, nread, step;
+	int i, j, k, jp, npx, npy, nk;
+	int64_t nw;
+	float *re, *im, *a1 = NULL, *a2 = NULL, *corr = NULL, *orow;
+	struct FCOMPLEX *data, *fdata, *prow, *patch0, *d, *f;
+	struct FFT_PLAN *fx, *fy, *ix, *iy;
+	struct GMT_GRID *Phase = NULL, *Corr = NULL, *Real = NULL, *Imag = NULL, *Diff = NULL, *A1 = NULL, *A2 = NULL;
+
+	xdim = h->n_columns;
+	ydim = h->n_rows;
+	step = nyp / 2;
+	nw = (int64_t)nyp * xdim;
+	npy = ((int)ydim > nyp) ? (ydim - nyp - 1) / step + 1 : 0;
+	npx = ((int)xdim > nxp) ? (xdim - nxp - 1) / (nxp / 2) + 1 : 0;
+	nk = (ydim + step - 1) / step;
+
+	re = malloc(nw * sizeof(float));
+	im = malloc(nw * sizeof(float));
+	orow = malloc(xdim * sizeof(float));
+	data = malloc(nw * sizeof(struct FCOMPLEX));
+	fdata = calloc(nw, sizeof(struct FCOMPLEX));
+	prow = malloc((size_t)(npx > 0 ? npx : 1) * nxp * nyp * sizeof(struct FCOMPLEX));
+	if (re == NULL || im == NULL || orow == NULL || data == NULL || fdata == NULL || prow == NULL)
+		die("error allocating memory", "");
+	if (corrflag) {
+		/* the amp rows are read with the header of real and imag, so check them as calc_corr does */
+		read_file_hdr(API, amp1, &A1, amp2, &A2, &xdim2, &ydim2);
+		if ((xdim != xdim2) || (ydim != ydim2))
+			die("amp files are different size than real and imag files", "");
+		if (GMT_Destroy_Data(API, &A1) || GMT_Destroy_Data(API, &A2))
+			die("error freeing data", "");
+		a1 = malloc(nw * sizeof(float));
+		a2 = malloc(nw * sizeof(float));
+		corr = malloc(nw * sizeof(float));
+		if (a1 == NULL || a2 == NULL || corr == NULL)
+			die("error allocating memory", "");
+	}
+
+	fx = fft_plan_get(nxp, GMT_FFT_FWD);
+	fy = fft_plan_get(nyp, GMT_FFT_FWD);
+	ix = fft_plan_get(nxp, GMT_FFT_INV);
+	iy = fft_plan_get(nyp, GMT_FFT_INV);
+
+	Phase = open_grid_rows(API, h, "filtphase.grd", "phasefilt", "phase");
+	if (corrflag)
+		Corr = open_grid_rows(API, h, "filtcorr.grd", "phasefilt", "corr");
+	if (comflag) {
+		Real = open_grid_rows(API, h, "filtphase_real.grd", "phasefilt", "real");
+		Imag = open_grid_rows(API, h, "filtphase_imag.grd", "phasefilt", "imag");
+	}
+	if (dflag)
+		Diff = open_grid_rows(API, h, "filtdiff.grd", "phasefilt", "diff");
+
+#pragma omp parallel num_threads(nthreads) private(k, jp, patch0)
+	{
+		if ((patch0 = malloc(nxp * nyp * sizeof(struct FCOMPLEX))) == NULL)
+			die("error allocating memory", "");
+
+		for (k = 0; k < nk; k++) {
+#pragma omp single
+			{
+				/* move the window down to start at row top */
+				top = k * step;
+				if (k == 0) {
+					nread = (ydim < (unsigned int)nyp) ? ydim : nyp;
+					read_window_rows(API, sre, sim, amp1, amp2, h, 0, nread, 0, re, im, a1, a2, data, corr);
+				}
+				else {
+					memmove(data, &data[step * xdim], (nw - step * xdim) * sizeof(struct FCOMPLEX));
+					memmove(fdata, &fdata[step * xdim], (nw - step * xdim) * sizeof(struct FCOMPLEX));
+					memset(&fdata[nw - step * xdim], 0, step * xdim * sizeof(struct FCOMPLEX));
+					if (corrflag)
+						memmove(corr, &corr[step * xdim], (nw - step * xdim) * sizeof(float));
+					if (top + nyp - step < ydim) {
+						nread = (top + nyp <= ydim) ? step : ydim - (top + nyp - step);
+						read_window_rows(API, sre, sim, amp1, amp2, h, top + nyp - step, nread, nyp - step, re, im, a1, a2,
+						                 data, corr);
+					}
+				}
+			}
+
+			/* filter row k of patches, which covers the whole window */
+			if (k < npy) {
+#pragma omp for schedule(dynamic, 4)
+				for (jp = 0; jp < npx; jp++)
+					filter_patch(API, fx, fy, ix, iy, data, corr, wgt, xdim, 0, jp * (nxp / 2), nxp, nyp, alpha, patch0,
+					             &prow[jp * nxp * nyp]);
+			}
+
+#pragma omp single
+			{
+				if (k < npy)
+					add_patch_row(fdata, wgt, prow, xdim, 0, npx, nxp, nyp);
+
+				/* the top half of the window is done */
+				nout = (top + step <= ydim) ? step : ydim - top;
+				for (i = 0; i < (int)nout; i++) {
+					d = &data[i * xdim];
+					f = &fdata[i * xdim];
+					for (j = 0; j < (int)xdim; j++)
+						orow[j] = atan2f(f[j].i, f[j].r);
+					GMT_Put_Row(API, top + i, Phase, orow);
+					if (dflag) {
+						for (j = 0; j < (int)xdim; j++)
+							orow[j] = atan2f(d[j].i, d[j].r) - atan2f(f[j].i, f[j].r);
+						GMT_Put_Row(API, top + i, Diff, orow);
+					}
+					if (corrflag)
+						GMT_Put_Row(API, top + i, Corr, &corr[i * xdim]);
+					if (comflag) {
+						for (j = 0; j < (int)xdim; j++)
+							orow[j] = f[j].r;
+						GMT_Put_Row(API, top + i, Real, orow);
+						for (j = 0; j < (int)xdim; j++)
+							orow[j] = f[j].i;
+						GMT_Put_Row(API, top + i, Imag, orow);
+					}
+				}
+			}
+		}
+
+		free((void *)patch0);
+	}
+
+	if (GMT_Destroy_Data(API, &Phase))
+		die("error freeing data", "filtphase.grd");
+	if (corrflag && GMT_Destroy_Data(API, &Corr))
+		die("error freeing data", "filtcorr.grd");
+	if (comflag && (GMT_Destroy_Data(API, &Real) || GMT_Destroy_Data(API, &Imag)))
+		die("error freeing data", "filtphase_real.grd");
+	if (dflag && GMT_Destroy_Data(API, &Diff))
+		die("error freeing data", "filtdiff.grd");
+
+	free((void *)re);
+	free((void *)im);
+	free((void *)orow);
+	free((void *)data);
+	free((void *)fdata);
+	free((void *)prow);
+	if (corrflag) {
+		free((void *)a1);
+		free((void *)a2);
+		free((void *)corr);
+	}
+
+	return (EXIT_SUCCESS);
+}
+
 int phasefilt_parse_command_line(char **a, int na, char *USAGE, char *sre, char *sim, float *alp, int *ps, char *amp1, char *amp2,
-                                 int *dflag, int *comflag) {
+                                 int *dflag, int *comflag, int *nthreads, int *sflag) {
 	int n;
 	int flag[4];
 
@@ -244,6 +536,16 @@ int phasefilt_parse_command_line(char **a, int na, char *USAGE, char *sre, char
 			if (verbose)
 				fprintf(stderr, "patch size %d \n", *ps);
 		}
+		else if (!strcmp(a[n], "-nthreads")) {
+			n++;
+			if (n == na)
+				die(" no option after -nthreads!\n", "");
+			*nthreads = atoi(a[n]);
+			if (*nthreads < 1)
+				die(" -nthreads needs to be at least 1\n", "");
+			if (verbose)
+				fprintf(stderr, "threads %d \n", *nthreads);
+		}
 		else if (!strcmp(a[n], "-diff")) {
 			*dflag = 1;
 			if (verbose)
@@ -252,6 +554,11 @@ int phasefilt_parse_command_line(char **a, int na, char *USAGE, char *sre, char
 		else if (!strcmp(a[n], "-complex_out")) {
 			*comflag = 1;
 		}
+		else if (!strcmp(a[n], "-stream")) {
+			*sflag = 1;
+			if (verbose)
+				fprintf(stderr, "filtering in bands of rows \n");
+		}
 		else if (!strcmp(a[n], "-debug")) {
 			verbose = 1;
 			debug = 1;
@@ -296,7 +603,7 @@ int phasefilt_parse_command_line(char **a, int na, char *USAGE, char *sre, char
 
 char *USAGE = "phasefilt [GMTSAR] - Apply adaptive non-linear phase filter\n\n"
               "\n USAGE:\nphasefilt -imag imag.grd -real real.grd [-alpha alpha][-psize "
-              "size][-amp1 amp1.grd -amp2 amp2.grd][-diff][-v]\n"
+              "size][-amp1 amp1.grd -amp2 amp2.grd][-diff][-nthreads n][-stream][-v]\n"
               " applies Goldstein adaptive filter to phase [output: filtphase.grd]\n"
               " or applies modified Goldstein adaptive filter to phase [output: "
               "filtphase.grd, corrfilt.grd]\n"
@@ -316,6 +623,10 @@ char *USAGE = "phasefilt [GMTSAR] - Apply adaptive non-linear phase filter\n\n"
               "(and applies) modified filter.\n"
               "-diff 		Calculate difference between input phase and output "
               "phase.\n"
+              "-nthreads	number of threads filtering rows of patches in parallel.\n"
+              "		default: 1\n"
+              "-stream	Read, filter and write in bands of rows, holding about psize rows\n"
+              "		in memory rather than the whole grid (for very large grids).\n"
               "-complex_out	Write out filtered real and imaginary "
               "(filtphase_real.grd and filtphase_imag.grd)\n"
               "-v 		Verbose.\n"
@@ -325,13 +636,14 @@ char *USAGE = "phasefilt [GMTSAR] - Apply adaptive non-linear phase filter\n\n"
               "phasefilt -imag imag.grd -real real.grd -alpha 0.5\n";
 
 int main(int argc, char **argv) {
-	unsigned int i, j, ii, jj, k1, k2;
+	unsigned int i, ii;
 	unsigned int xdim, ydim;
 	unsigned int nxp, nyp;
-	int psize, corrflag, dflag, comflag;
-	float alpha, pcorr, swgt;
+	int psize, corrflag, dflag, comflag, nthreads, sflag, ip, jp, npx, npy;
+	float alpha;
 	float *outphase = NULL, *wgt = NULL, *amp = NULL, *corr = NULL, *diff = NULL, *ftmp = NULL;
-	struct FCOMPLEX *data = NULL, *fdata = NULL, *patch0 = NULL, *patch1 = NULL;
+	struct FCOMPLEX *data = NULL, *fdata = NULL, *patch0 = NULL, *prow = NULL;
+	struct FFT_PLAN *fx, *fy, *ix, *iy;
 	char sre[256], sim[256];
 	char amp1[256], amp2[256];
 
@@ -350,7 +662,9 @@ int main(int argc, char **argv) {
 	psize = 32;   /* size of patch  # changed from 64 */
 	alpha = 0.5f; /* exponent */
 	dflag = 0;    /* write out difference */
-	phasefilt_parse_command_line(argv, argc, USAGE, sre, sim, &alpha, &psize, amp1, amp2, &dflag, &comflag);
+	nthreads = 1; /* rows of patches filtered in parallel */
+	sflag = 0;    /* filter in bands of rows */
+	phasefilt_parse_command_line(argv, argc, USAGE, sre, sim, &alpha, &psize, amp1, amp2, &dflag, &comflag, &nthreads, &sflag);
 
 	/* patch size 		*/
 	/* currently square 	*/
@@ -363,18 +677,30 @@ int main(int argc, char **argv) {
 	                         IM->header->registration, 0, NULL)) == NULL)
 		die("could not allocate grid header", "");
 
+	if ((wgt = malloc(nxp * nyp * sizeof(float))) == NULL)
+		die("error allocating memory", "");
+
+	/* create weights for each patch 				*/
+	/* each patch overlaps each other by half and summed 		*/
+	/* ideally, total wgt for each pixl = 1				*/
+	/* except at edges...						*/
+	make_wgt(wgt, nxp, nyp);
+
+	if (sflag) {
+		corrflag = (alpha < 0.0);
+		phasefilt_stream(API, IM->header, sre, sim, amp1, amp2, corrflag, dflag, comflag, alpha, nxp, nyp, wgt, nthreads);
+		if (GMT_Destroy_Session(API))
+			return EXIT_FAILURE;
+		free((void *)wgt);
+		return (EXIT_SUCCESS);
+	}
+
 	if ((data = malloc(T->header->nm * sizeof(struct FCOMPLEX))) == NULL)
 		die("error allocating memory", "");
 	if ((fdata = malloc(T->header->nm * sizeof(struct FCOMPLEX))) == NULL)
 		die("error allocating memory", "");
-	if ((patch0 = malloc(nxp * nyp * sizeof(struct FCOMPLEX))) == NULL)
-		die("error allocating memory", "");
-	if ((patch1 = malloc(nxp * nyp * sizeof(struct FCOMPLEX))) == NULL)
-		die("error allocating memory", "");
 	if ((amp = malloc(T->header->nm * sizeof(float))) == NULL)
 		die("error allocating memory", "");
-	if ((wgt = malloc(nxp * nyp * sizeof(float))) == NULL)
-		die("error allocating memory", "");
 	if ((outphase = malloc(xdim * (ydim + nyp) * sizeof(float))) == NULL)
 		die("error allocating memory", "");
 
@@ -410,50 +736,36 @@ int main(int argc, char **argv) {
 			fprintf(stderr, "phasefilt: constant alpha (%6.2f)\n", alpha);
 	}
 
-	/* create weights for each patch 				*/
-	/* each patch overlaps each other by half and summed 		*/
-	/* ideally, total wgt for each pixl = 1				*/
-	/* except at edges...						*/
-	make_wgt(wgt, nxp, nyp);
-
-	for (ii = 0; ii < (ydim - nyp); ii += nyp / 2) {
-		for (jj = 0; jj < (xdim - nxp); jj += nxp / 2) {
-
-			pcorr = 0.0f;
-			swgt = 0.0f;
-			for (i = 0; i < nyp; i++) {
-				for (j = 0; j < nxp; j++) {
-					k1 = (ii + i) * xdim + jj + j;
-					k2 = i * nxp + j;
-					patch0[k2].r = data[k1].r;
-					patch0[k2].i = data[k1].i;
-					if (corrflag) {
-						pcorr += wgt[k2] * corr[k1];
-						swgt += wgt[k2];
-					}
-				}
-			}
-
-			/* set alpha to 1.0 - coherence 	*/
-			/* Baran et al., 2003			*/
-			if (corrflag)
-				alpha = 1.0f - pcorr / swgt;
-
-			GMT_FFT_2D(API, (float *)patch0, nxp, nyp, GMT_FFT_FWD, GMT_FFT_COMPLEX);
-
-			apply_pspec(nxp, nyp, alpha, patch0, patch1);
+	/* patches step by half a patch; a row of patches only overlaps its	*/
+	/* neighbours, so rows are filtered in parallel into private buffers	*/
+	/* and added to fdata in row order, giving the same sums as serially	*/
+	npy = ((int)ydim > (int)nyp) ? (ydim - nyp - 1) / (nyp / 2) + 1 : 0;
+	npx = ((int)xdim > (int)nxp) ? (xdim - nxp - 1) / (nxp / 2) + 1 : 0;
+	fx = fft_plan_get(nxp, GMT_FFT_FWD);
+	fy = fft_plan_get(nyp, GMT_FFT_FWD);
+	ix = fft_plan_get(nxp, GMT_FFT_INV);
+	iy = fft_plan_get(nyp, GMT_FFT_INV);
+
+#pragma omp parallel num_threads(nthreads) private(ii, ip, jp, prow, patch0)
+	{
+		if ((patch0 = malloc(nxp * nyp * sizeof(struct FCOMPLEX))) == NULL)
+			die("error allocating memory", "");
+		if ((prow = malloc((size_t)(npx > 0 ? npx : 1) * nxp * nyp * sizeof(struct FCOMPLEX))) == NULL)
+			die("error allocating memory", "");
 
-			GMT_FFT_2D(API, (float *)patch1, nxp, nyp, GMT_FFT_INV, GMT_FFT_COMPLEX);
+#pragma omp for ordered schedule(dynamic, 1)
+		for (ip = 0; ip < npy; ip++) {
+			ii = ip * (nyp / 2);
+			for (jp = 0; jp < npx; jp++)
+				filter_patch(API, fx, fy, ix, iy, data, corr, wgt, xdim, ii, jp * (nxp / 2), nxp, nyp, alpha, patch0,
+				             &prow[jp * nxp * nyp]);
 
-			for (i = 0; i < nyp; i++) {
-				for (j = 0; j < nxp; j++) {
-					k1 = (ii + i) * xdim + jj + j;
-					k2 = i * nxp + j;
-					fdata[k1].r = fdata[k1].r + wgt[k2] * patch1[k2].r;
-					fdata[k1].i = fdata[k1].i + wgt[k2] * patch1[k2].i;
-				}
-			}
+#pragma omp ordered
+			add_patch_row(fdata, wgt, prow, xdim, ii, npx, nxp, nyp);
 		}
+
+		free((void *)patch0);
+		free((void *)prow);
 	}
 
 	for (i = 0; i < T->header->nm; i++)
@@ -484,8 +796,6 @@ int main(int argc, char **argv) {
 	if (GMT_Destroy_Session(API))
 		return EXIT_FAILURE; /* Remove the GMT machinery */
 
-	free((void *)patch0);
-	free((void *)patch1);
 	free((void *)data);
 	free((void *)fdata);
 	free((void *)amp);
@@ -0,0 +1,243 @@
+/***************************************************************************
+ * Creator:  GMTSAR contributors                                           *
+ * Date   :  10/17/2026                                                    *
+ ***************************************************************************/
+
+/***************************************************************************
+ * Modification history:                                                   *
+ *                                                                         *
+ * DATE                                                                    *
+ *                                                                         *
+ ***************************************************************************/
+
+/* project a grid from range/azimuth into lon/lat through a lookup table	*/
+/* from make_geo_lut: every output cell looks up the range and azimuth of	*/
+/* its corners and takes the median of the input pixels in that footprint,	*/
+/* as gmt blockmedian does on the surface path of proj_ra2ll.csh, so no	*/
+/* surface is fitted and each grid of a stack costs one pass over the output	*/
+
+#include "gmtsar.h"
+#include <float.h>
+
+char *USAGE = "\nUsage: proj_ra2ll_lut geo.lut phase_ra.grd phase_ll.grd [-m pixel_m] [-nearest] [-bilinear] [-nthreads n]\n\n"
+              "    geo.lut         --  lookup table from make_geo_lut\n"
+              "    phase_ra.grd    --  a grid of phase or anything in range/azimuth coordinates\n"
+              "    phase_ll.grd    --  output grid in lon/lat coordinates (pixel registered)\n"
+              "    -m pixel_m      --  output pixel size in meters (default 60), rounded to\n"
+              "                        half arc seconds as m2s.csh does\n"
+              "    -nearest        --  take the nearest pixel instead of the median of the\n"
+              "                        pixels under the output pixel\n"
+              "    -bilinear       --  where no input pixel falls under an output pixel,\n"
+              "                        interpolate bilinearly instead of taking the nearest\n"
+              "                        pixel; only for smooth fields, not wrapped phase\n"
+              "    -nthreads n     --  number of threads (default 1)\n\n"
+              "    example:\n"
+              "    proj_ra2ll_lut geo.lut unwrap.grd unwrap_ll.grd -m 60 -bilinear\n\n";
+
+/* median of the n values in z, which get reordered; the mean of the middle two for even n */
+static float median_float(float *z, int64_t n) {
+	int64_t i, j, k, lo = 0, hi = n - 1, m = n / 2;
+	float t, pivot, zmax;
+
+	/* quickselect the upper middle value into z[m] */
+	while (lo < hi) {
+		pivot = z[(lo + hi) / 2];
+		i = lo;
+		j = hi;
+		while (i <= j) {
+			while (z[i] < pivot)
+				i++;
+			while (z[j] > pivot)
+				j--;
+			if (i <= j) {
+				t = z[i];
+				z[i++] = z[j];
+				z[j--] = t;
+			}
+		}
+		if (m <= j)
+			hi = j;
+		else if (m >= i)
+			lo = i;
+		else
+			break;
+	}
+	if (n & 1)
+		return (z[m]);
+
+	/* the lower middle value is the largest of the values below m */
+	zmax = z[0];
+	for (k = 1; k < m; k++)
+		zmax = MAX(zmax, z[k]);
+	return (0.5f * (zmax + z[m]));
+}
+
+int main(int argc, char **argv) {
+
+	int n, bilinear = 0, nearest = 0, nthreads = 1;
+	int64_t i, j, nx, ny;
+	double pix_m = 60., mlat, xf, yf, dxi, dyi, inc[2], inc2[2], wesn[4], r, a, lon, lat;
+	struct GEO_LUT g;
+	struct GMT_GRID *IN = NULL, *OUT = NULL;
+	void *API = NULL;
+
+	if (argc < 4)
+		die("\n", USAGE);
+	for (n = 4; n < argc; n++) {
+		if (!strcmp(argv[n], "-m") && n + 1 < argc) {
+			pix_m = atof(argv[++n]);
+			if (pix_m <= 0.)
+				die("-m must be positive", "");
+		}
+		else if (!strcmp(argv[n], "-nearest"))
+			nearest = 1;
+		else if (!strcmp(argv[n], "-bilinear"))
+			bilinear = 1;
+		else if (!strcmp(argv[n], "-nthreads") && n + 1 < argc) {
+			nthreads = atoi(argv[++n]);
+			if (nthreads < 1)
+				nthreads = 1;
+		}
+		else
+			die("unknown option ", argv[n]);
+	}
+
+	if ((API = GMT_Create_Session(argv[0], 0U, 0U, NULL)) == NULL)
+		return EXIT_FAILURE;
+
+	geo_lut_read(argv[1], &g);
+	if ((IN = GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_ALL, NULL, argv[2], NULL)) == NULL)
+		die("Can't read ", argv[2]);
+
+	/* range and azimuth of the first node, as gmt grd2xyz reports them */
+	nx = IN->header->n_columns;
+	ny = IN->header->n_rows;
+	dxi = IN->header->inc[GMT_X];
+	dyi = IN->header->inc[GMT_Y];
+	xf = IN->header->wesn[GMT_XLO] + 0.5 * IN->header->registration * dxi;
+	yf = IN->header->wesn[GMT_YHI] - 0.5 * IN->header->registration * dyi;
+
+	/* lon/lat extent of the table nodes that fall on the input grid */
+	wesn[GMT_XLO] = wesn[GMT_YLO] = DBL_MAX;
+	wesn[GMT_XHI] = wesn[GMT_YHI] = -DBL_MAX;
+	for (i = 0; i < g.n_rows; i++) {
+		for (j = 0; j < g.n_columns; j++) {
+			r = g.ra[2 * (i * g.n_columns + j)];
+			a = g.ra[2 * (i * g.n_columns + j) + 1];
+			if (isnan(r) || r < IN->header->wesn[GMT_XLO] || r > IN->header->wesn[GMT_XHI] ||
+			    a < IN->header->wesn[GMT_YLO] || a > IN->header->wesn[GMT_YHI])
+				continue;
+			lon = g.wesn[GMT_XLO] + j * g.inc[GMT_X];
+			lat = g.wesn[GMT_YHI] - i * g.inc[GMT_Y];
+			wesn[GMT_XLO] = MIN(wesn[GMT_XLO], lon);
+			wesn[GMT_XHI] = MAX(wesn[GMT_XHI], lon);
+			wesn[GMT_YLO] = MIN(wesn[GMT_YLO], lat);
+			wesn[GMT_YHI] = MAX(wesn[GMT_YHI], lat);
+		}
+	}
+	if (wesn[GMT_XLO] > wesn[GMT_XHI])
+		die("the lookup table does not cover ", argv[2]);
+
+	/* pixel size in half arc seconds and region in multiples of ten pixels, as m2s.csh and gmtinfo -I */
+	mlat = 0.5 * (wesn[GMT_YLO] + wesn[GMT_YHI]);
+	inc[GMT_Y] = MAX(rint(pix_m / 111195.079734 * 3600. * 2.), 1.) / 2. / 3600.;
+	inc[GMT_X] = MAX(rint(pix_m / 111195.079734 / cos(mlat * PI / 180.) * 3600. * 2.), 1.) / 2. / 3600.;
+	inc2[GMT_X] = 10. * inc[GMT_X];
+	inc2[GMT_Y] = 10. * inc[GMT_Y];
+	wesn[GMT_XLO] = floor(wesn[GMT_XLO] / inc2[GMT_X]) * inc2[GMT_X];
+	wesn[GMT_XHI] = ceil(wesn[GMT_XHI] / inc2[GMT_X]) * inc2[GMT_X];
+	wesn[GMT_YLO] = floor(wesn[GMT_YLO] / inc2[GMT_Y]) * inc2[GMT_Y];
+	wesn[GMT_YHI] = ceil(wesn[GMT_YHI] / inc2[GMT_Y]) * inc2[GMT_Y];
+
+	if ((OUT = GMT_Create_Data(API, GMT_IS_GRID, GMT_IS_SURFACE, GMT_GRID_ALL, NULL, wesn, inc, GMT_GRID_PIXEL_REG, 0, NULL)) ==
+	    NULL)
+		die("error creating output grid", argv[3]);
+	strcpy(OUT->header->x_units, "longitude [degrees_east]");
+	strcpy(OUT->header->y_units, "latitude [degrees_north]");
+	fprintf(stderr, "projecting %s onto %d by %d pixels of %.1f by %.1f arc seconds \n", argv[2], OUT->header->n_columns,
+	        OUT->header->n_rows, inc[GMT_X] * 3600., inc[GMT_Y] * 3600.);
+
+#pragma omp parallel for schedule(dynamic, 16) private(j) num_threads(nthreads)
+	for (i = 0; i < OUT->header->n_rows; i++) {
+		int64_t k, ii, jj, c, nz, i0, i1, j0, j1, n_alloc = 0;
+		double rr, aa, u, v, lon, lat, umin, umax, vmin, vmax;
+		float z, *p, *zs = NULL;
+
+		for (j = 0; j < OUT->header->n_columns; j++) {
+			k = i * OUT->header->n_columns + j;
+			OUT->data[k] = NAN;
+			lon = wesn[GMT_XLO] + (j + 0.5) * inc[GMT_X];
+			lat = wesn[GMT_YHI] - (i + 0.5) * inc[GMT_Y];
+			if (!geo_lut_ra(&g, lon, lat, &rr, &aa))
+				continue;
+			u = (rr - xf) / dxi;
+			v = (yf - aa) / dyi;
+			if (u < -0.5 || v < -0.5 || u > nx - 0.5 || v > ny - 0.5)
+				continue;
+
+			/* median of the pixels whose centers fall in the range/azimuth box around the four corners */
+			if (!nearest) {
+				umin = vmin = DBL_MAX;
+				umax = vmax = -DBL_MAX;
+				for (c = 0; c < 4; c++) {
+					if (!geo_lut_ra(&g, lon + ((c & 1) - 0.5) * inc[GMT_X], lat + ((c >> 1) - 0.5) * inc[GMT_Y], &rr, &aa))
+						break;
+					umin = MIN(umin, (rr - xf) / dxi);
+					umax = MAX(umax, (rr - xf) / dxi);
+					vmin = MIN(vmin, (yf - aa) / dyi);
+					vmax = MAX(vmax, (yf - aa) / dyi);
+				}
+				if (c == 4) {
+					j0 = MAX((int64_t)ceil(umin), 0);
+					j1 = MIN((int64_t)floor(umax), nx - 1);
+					i0 = MAX((int64_t)ceil(vmin), 0);
+					i1 = MIN((int64_t)floor(vmax), ny - 1);
+					if (j0 <= j1 && i0 <= i1) {
+						if ((j1 - j0 + 1) * (i1 - i0 + 1) > n_alloc) {
+							n_alloc = (j1 - j0 + 1) * (i1 - i0 + 1);
+							if ((zs = (float *)realloc(zs, (size_t)n_alloc * sizeof(float))) == NULL)
+								die("memory allocation!", "");
+						}
+						for (nz = 0, ii = i0; ii <= i1; ii++)
+							for (jj = j0; jj <= j1; jj++)
+								if (!isnan(IN->data[ii * nx + jj]))
+									zs[nz++] = IN->data[ii * nx + jj];
+						if (nz > 0)
+							OUT->data[k] = median_float(zs, nz);
+						continue;
+					}
+				}
+			}
+
+			/* nearest pixel, where no pixel falls under the output pixel */
+			jj = MIN((int64_t)rint(u), nx - 1);
+			ii = MIN((int64_t)rint(v), ny - 1);
+			z = IN->data[ii * nx + jj];
+
+			/* bilinear where the four pixels around are all there */
+			if (bilinear && u >= 0. && v >= 0. && u < nx - 1 && v < ny - 1) {
+				jj = (int64_t)u;
+				ii = (int64_t)v;
+				u -= jj;
+				v -= ii;
+				p = &IN->data[ii * nx + jj];
+				if (!isnan(p[0]) && !isnan(p[1]) && !isnan(p[nx]) && !isnan(p[nx + 1]))
+					z = (float)((1. - v) * ((1. - u) * p[0] + u * p[1]) + v * ((1. - u) * p[nx] + u * p[nx + 1]));
+			}
+			OUT->data[k] = z;
+		}
+		if (zs)
+			free(zs);
+	}
+
+	if (GMT_Write_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_ALL, NULL, argv[3], OUT))
+		die("Failed to write output grid ", argv[3]);
+
+	geo_lut_free(&g);
+	if (GMT_Destroy_Data(API, &OUT) || GMT_Destroy_Data(API, &IN))
+		die("error freeing data", "");
+	if (GMT_Destroy_Session(API))
+		return EXIT_FAILURE;
+
+	return (EXIT_SUCCESS);
+}
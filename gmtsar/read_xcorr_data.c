@@ -6,39 +6,55 @@
 #include <stdlib.h>
 #include <string.h>
 
+/*-------------------------------------------------------*/
+/* read npy lines starting at line iy into d		*/
+/* lines outside the file are set to zero		*/
 /*-------------------------------------------------------*/
 void read_complex_short2(FILE *f, struct FCOMPLEX *d, int iy, int npy, int nx, short *tmp) {
 	int64_t num_to_seek;
-	int i, j;
+	int i, j, i0;
 
-	num_to_seek = 2 * iy * nx * sizeof(short);
+	/* skip lines before the start of the file */
+	for (i0 = 0; i0 < npy && iy + i0 < 0; i0++)
+		memset(&d[i0 * nx], 0, nx * sizeof(struct FCOMPLEX));
+	if (i0 == npy)
+		return;
+
+	num_to_seek = (int64_t)2 * (iy + i0) * nx * sizeof(short);
 	fseek(f, num_to_seek, SEEK_SET); /* from beginning */
 
 	/* need to read two parts of complex numbers */
-	for (i = 0; i < npy; i++) {
-		fread(&tmp[0], 2 * sizeof(short), nx, f); /* read whole line */
+	for (i = i0; i < npy; i++) {
+		if (fread(&tmp[0], 2 * sizeof(short), nx, f) != (size_t)nx) { /* read whole line */
+			memset(&d[i * nx], 0, (npy - i) * nx * sizeof(struct FCOMPLEX));
+			break;
+		}
 
 		/* read into complex float */
 		for (j = 0; j < nx; j++) {
 			d[i * nx + j].r = (float)tmp[2 * j];
 			d[i * nx + j].i = (float)tmp[2 * j + 1];
-			// d[i*nx+j].r =
-			// sqrt(((float)tmp[2*j])*((float)tmp[2*j])+((float)tmp[2*j+1])*((float)tmp[2*j+1]));
-			// d[i*nx+j].i = 0.0;
 		}
 	}
 }
 /*-------------------------------------------------------*/
 void read_real_float2(FILE *f, struct FCOMPLEX *d, int iy, int npy, int nx, float *tmp) {
 	int64_t num_to_seek;
-	int i, j;
+	int i, j, i0;
 
-	num_to_seek = iy * nx * sizeof(float);
+	for (i0 = 0; i0 < npy && iy + i0 < 0; i0++)
+		memset(&d[i0 * nx], 0, nx * sizeof(struct FCOMPLEX));
+	if (i0 == npy)
+		return;
+
+	num_to_seek = (int64_t)(iy + i0) * nx * sizeof(float);
 	fseek(f, num_to_seek, SEEK_SET); /* from beginning */
 
-	/* need to read two parts of complex numbers */
-	for (i = 0; i < npy; i++) {
-		fread(&tmp[0], sizeof(float), nx, f); /* read whole line */
+	for (i = i0; i < npy; i++) {
+		if (fread(&tmp[0], sizeof(float), nx, f) != (size_t)nx) { /* read whole line */
+			memset(&d[i * nx], 0, (npy - i) * nx * sizeof(struct FCOMPLEX));
+			break;
+		}
 
 		/* read into complex float */
 		for (j = 0; j < nx; j++) {
@@ -50,66 +66,96 @@ void read_real_float2(FILE *f, struct FCOMPLEX *d, int iy, int npy, int nx, floa
 
 /*-------------------------------------------------------*/
 void read_real_float_grid(struct GMT_GRID *f, struct FCOMPLEX *d, int iy, int npy, int nx, int ny) {
-	// int64_t    num;
 	int i, j;
 
-	// num_to_seek = iy*nx;
-	// fseek(f, num_to_seek, SEEK_SET);        /* from beginning */
-
-	/* need to read two parts of complex numbers */
 	for (i = 0; i < npy; i++) {
-
-		// fread(&tmp[0],sizeof(float), nx, f);  /* read whole line */
-
+		if (iy + i < 0 || iy + i >= ny) {
+			memset(&d[i * nx], 0, nx * sizeof(struct FCOMPLEX));
+			continue;
+		}
 		/* read into complex float */
 		for (j = 0; j < nx; j++) {
-			// num = i+npy+j*ny;
-			d[i * nx + j].r = f->data[(i + iy) * nx + j];
+			d[i * nx + j].r = f->data[(int64_t)(i + iy) * nx + j];
 			d[i * nx + j].i = 0.0;
 		}
 	}
 }
 
 /*-------------------------------------------------------*/
-void read_xcorr_data(struct xcorr *xc, int iloc) {
-	int iy, ishft;
-	short *tmp_m, *tmp_s;
-	float *tmp2_m, *tmp2_s;
+/* d holds npy lines starting at *first; move it to hold	*/
+/* lines starting at iy and return how many of those are	*/
+/* already in place (they are shifted to the top of d)	*/
+/*-------------------------------------------------------*/
+int slide_strip(struct FCOMPLEX *d, int *first, int iy, int npy, int nx) {
+	int shift, keep;
+
+	keep = 0;
+	if (*first != NO_STRIP && iy >= *first && iy < *first + npy) {
+		shift = iy - *first;
+		keep = npy - shift;
+		if (shift > 0)
+			memmove(d, &d[(int64_t)shift * nx], (int64_t)keep * nx * sizeof(struct FCOMPLEX));
+	}
+	*first = iy;
+
+	return (keep);
+}
 
-	tmp_m = (short *)malloc(2 * xc->m_nx * sizeof(short));  /* whole line */
-	tmp2_m = (float *)malloc(2 * xc->m_nx * sizeof(float)); /* whole line */
-	tmp_s = (short *)malloc(2 * xc->s_nx * sizeof(short));  /* whole line */
-	tmp2_s = (float *)malloc(2 * xc->s_nx * sizeof(float)); /* whole line */
+/*-------------------------------------------------------*/
+/* load the npy line strips of master and aligned needed	*/
+/* by the row of locations containing iloc			*/
+/* consecutive rows usually overlap, so only lines that	*/
+/* are new since the previous call are read and converted	*/
+/*-------------------------------------------------------*/
+void read_xcorr_master(struct xcorr *xc, int iloc) {
+	int iy, keep;
+	struct FCOMPLEX *d;
 
 	/* set locations and read data for master       */
 	/* read whole line at correct y offset          */
 	iy = xc->loc[iloc].y - xc->npy / 2;
 
-	if (debug)
-		fprintf(stderr, " reading data from master at y = %d and %d items\n", iy, xc->m_nx);
+	keep = slide_strip(xc->d1, &xc->iy1, iy, xc->npy, xc->m_nx);
+	d = &xc->d1[(int64_t)keep * xc->m_nx];
 
-	if (xc->format == 0)
-		read_complex_short2(xc->data1, xc->d1, iy, xc->npy, xc->m_nx, tmp_m);
-	if (xc->format == 1)
-		read_real_float2(xc->data1, xc->d1, iy, xc->npy, xc->m_nx, tmp2_m);
-	if (xc->format == 2)
-		read_real_float_grid(xc->D1, xc->d1, iy, xc->npy, xc->m_nx, xc->m_ny);
+	if (debug)
+		fprintf(stderr, " reading data from master at y = %d (%d lines kept) and %d items\n", iy, keep, xc->m_nx);
+
+	if (keep < xc->npy) {
+		if (xc->format == 0)
+			read_complex_short2(xc->data1, d, iy + keep, xc->npy - keep, xc->m_nx, (short *)xc->line1);
+		if (xc->format == 1)
+			read_real_float2(xc->data1, d, iy + keep, xc->npy - keep, xc->m_nx, (float *)xc->line1);
+		if (xc->format == 2)
+			read_real_float_grid(xc->D1, d, iy + keep, xc->npy - keep, xc->m_nx, xc->m_ny);
+	}
+}
+/*-------------------------------------------------------*/
+void read_xcorr_aligned(struct xcorr *xc, int iloc) {
+	int iy, ishft, keep;
+	struct FCOMPLEX *d;
 
 	/* set locations and read data for aligned */
 	ishft = (int)xc->loc[iloc].y * xc->astretcha;
 	iy = xc->loc[iloc].y + xc->y_offset + ishft - xc->npy / 2;
 
+	keep = slide_strip(xc->d2, &xc->iy2, iy, xc->npy, xc->s_nx);
+	d = &xc->d2[(int64_t)keep * xc->s_nx];
+
 	if (debug)
-		fprintf(stderr, " reading data from aligned at y = %d and %d items\n", iy, xc->s_nx);
-	if (xc->format == 0)
-		read_complex_short2(xc->data2, xc->d2, iy, xc->npy, xc->s_nx, tmp_s);
-	if (xc->format == 1)
-		read_real_float2(xc->data2, xc->d2, iy, xc->npy, xc->s_nx, tmp2_s);
-	if (xc->format == 2)
-		read_real_float_grid(xc->D2, xc->d2, iy, xc->npy, xc->s_nx, xc->s_ny);
-
-	free((char *)tmp_m);
-	free((char *)tmp2_m);
-	free((char *)tmp_s);
-	free((char *)tmp2_s);
+		fprintf(stderr, " reading data from aligned at y = %d (%d lines kept) and %d items\n", iy, keep, xc->s_nx);
+
+	if (keep < xc->npy) {
+		if (xc->format == 0)
+			read_complex_short2(xc->data2, d, iy + keep, xc->npy - keep, xc->s_nx, (short *)xc->line2);
+		if (xc->format == 1)
+			read_real_float2(xc->data2, d, iy + keep, xc->npy - keep, xc->s_nx, (float *)xc->line2);
+		if (xc->format == 2)
+			read_real_float_grid(xc->D2, d, iy + keep, xc->npy - keep, xc->s_nx, xc->s_ny);
+	}
+}
+/*-------------------------------------------------------*/
+void read_xcorr_data(struct xcorr *xc, int iloc) {
+	read_xcorr_master(xc, iloc);
+	read_xcorr_aligned(xc, iloc);
 }
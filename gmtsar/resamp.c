@@ -1,4 +1,5 @@
 /*	$Id$	*/
+#define _GNU_SOURCE /* for madvise */
 /***************************************************************************
  * resamp resamples a aligned image to match the geometry of a master image. *
  **************************************************************************/
@@ -20,6 +21,10 @@
  * 04/28/16 EXU Modified 4 resampling subroutine to shift pointer before   *
  *              interpolation, so that resamp won't fail on files larger   *
  *              than 4GB.                                                  *
+ * 10/17/26     Affine mapping evaluated a row at a time; bicubic and     *
+ *              bisinc use 1/1024 pixel kernel tables applied separably.   *
+ * 10/17/26     Optional nthreads; blocks of rows are resampled in        *
+ *              parallel and written in order.                            *
  ***************************************************************************/
 
 #include "gmtsar.h"
@@ -31,36 +36,41 @@
 #include "mman.c"
 #else
 #include <sys/mman.h>
+#include <unistd.h>
 #endif
 #include <sys/types.h>
 
+#define MAX_TAPS (NS > 4 ? NS : 4)    /* widest kernel */
+#define BLOCK_ROWS 64                 /* output rows resampled by a thread at a time */
+
 char *USAGE = "\nUsage: "
-              "resamp master.PRM aligned.PRM new_aligned.PRM new_aligned.SLC intrp \n"
+              "resamp master.PRM aligned.PRM new_aligned.PRM new_aligned.SLC intrp [nthreads]\n"
               "   master.PRM       - PRM for master imagea \n"
               "   aligned.PRM        - PRM for aligned image \n"
               "   new_aligned.PRM    - PRM for aligned aligned image \n"
               "   new_aligned.SLC    - SLC for aligned aligned image \n"
 
               "   intrp            - interpolation method: 1-nearest; "
-              "2-bilinear; 3-biquadratic; 4-bisinc \n \n";
+              "2-bilinear; 3-biquadratic; 4-bisinc \n"
+              "   nthreads         - number of threads resampling blocks of rows (default 1) \n \n";
 
 void print_prm_params(struct PRM, struct PRM);
 void fix_prm_params(struct PRM *, char *);
-void ram2ras(struct PRM, double *, double *);
+void ram2ras_row(struct PRM, int, int, double *, double *);
 void nearest(double *, short *, int, int, short *);
 void bilinear(double *, short *, int, int, short *);
-void bicubic(double *, short *, int, int, short *);
-void bicubic_one(double *, double *, double, double, double *);
-void bisinc(double *, short *, int, int, short *);
-void sinc_one(double *, double *, double, double, double *);
+void kernel_row(double *, double *, short *, int, int, float *, int, int, short *);
+void resamp_row(struct PRM, int, int, short *, int, int, float *, int, int, double *, short *);
+void advise_rows(struct PRM, short *, int, int, int, int, int);
 
 int main(int argc, char **argv) {
-	int ii, jj;
+	int ib, nblocks, nthreads;
 	int debug, intrp;
 	int xdimm, ydimm;                 /* size of master SLC file */
 	int xdims, ydims;                 /* size of aligned SLC file */
-	short *sinn = NULL, *sout = NULL; /* pointer to input (whole array) and output (row) files.*/
-	double ram[2], ras[2];            /* range and azimuth locations for master and aligned images */
+	short *sinn = NULL;               /* pointer to input (whole array) */
+	float *wtab = NULL;               /* tabulated interpolation kernel */
+	int nk = 0;                       /* number of kernel taps */
 	FILE *SLC_file2 = NULL, *prmout = NULL;
 	int fdin;
 	double sv_pr[6];
@@ -79,6 +89,9 @@ int main(int argc, char **argv) {
 	get_prm(&pm, argv[1]);
 	get_prm(&ps, argv[2]);
 	intrp = atoi(argv[5]);
+	nthreads = (argc > 6) ? atoi(argv[6]) : 1;
+	if (nthreads < 1)
+		nthreads = 1;
 
 	if (debug)
 		print_prm_params(pm, ps);
@@ -105,11 +118,10 @@ int main(int argc, char **argv) {
 		ps.a_stretch_a = 0.;
 	}
 
-	/* allocate memory for one row of the aligned image */
-	//if ((sout = (short *)malloc(2 * xdimm * sizeof(short))) == NULL) {
-	if ((sout = (short *)calloc(2 * xdimm, sizeof(short))) == NULL) {
-		fprintf(stderr, "Sorry, couldn't allocate memory for output indata.\n");
-		exit(-1);
+	/* cubic and sinc weights are looked up rather than computed per pixel */
+	if (intrp == 3 || intrp == 4) {
+		nk = (intrp == 3) ? 4 : NS;
+		wtab = make_kernel_table((intrp == 3) ? KERNEL_CUBIC : KERNEL_SINC, nk, 2);
 	}
 
 	/* open the input file, determine its length and mmap the input file */
@@ -126,34 +138,37 @@ int main(int argc, char **argv) {
 	if ((sinn = mmap(0, st_size, PROT_READ, MAP_SHARED, fdin, 0)) == MAP_FAILED)
 		die("mmap error for input", " ");
 
-	/* open the aligned slc file for writing and write one row at a time */
+	/* open the aligned slc file for writing */
 	if ((SLC_file2 = fopen(argv[4], "wb")) == NULL)
 		die("Can't open SLCfile for output", argv[4]);
-	for (ii = 0; ii < ydimm; ii++) {
-		for (jj = 0; jj < xdimm; jj++) {
-
-			/* convert master ra to aligned ra */
-			ram[0] = jj;
-			ram[1] = ii;
-			ram2ras(ps, ram, ras);
-
-			/*  do nearest, bilinear, bicubic, or sinc interpolation */
-
-			if (intrp == 1) {
-				nearest(ras, sinn, ydims, xdims, &sout[2 * jj]);
-			}
-			else if (intrp == 2) {
-				bilinear(ras, sinn, ydims, xdims, &sout[2 * jj]);
-			}
-			else if (intrp == 3) {
-				bicubic(ras, sinn, ydims, xdims, &sout[2 * jj]);
-			}
-			else if (intrp == 4) {
-				bisinc(ras, sinn, ydims, xdims, &sout[2 * jj]);
-			}
-			// if(ras[0]>xdimm||ras[0]<0) count++;
+
+	/* threads take blocks of BLOCK_ROWS output rows; each block is written
+	   as soon as all blocks before it are out, so the file stays in order
+	   and at most one block per thread is held in memory */
+	nblocks = (ydimm + BLOCK_ROWS - 1) / BLOCK_ROWS;
+#pragma omp parallel num_threads(nthreads)
+	{
+		int ii, i0, nrows;
+		short *sout;  /* one block of rows of the resampled image */
+		double *ras;  /* aligned range and azimuth of each pixel in a master row */
+
+		if ((sout = (short *)calloc(2 * (size_t)xdimm * BLOCK_ROWS, sizeof(short))) == NULL ||
+		    (ras = (double *)malloc(2 * xdimm * sizeof(double))) == NULL)
+			die("Sorry, couldn't allocate memory for output indata.", "");
+
+#pragma omp for ordered schedule(dynamic, 1)
+		for (ib = 0; ib < nblocks; ib++) {
+			i0 = ib * BLOCK_ROWS;
+			nrows = (i0 + BLOCK_ROWS > ydimm) ? ydimm - i0 : BLOCK_ROWS;
+			advise_rows(ps, sinn, ydims, xdims, xdimm, i0, nrows);
+			for (ii = i0; ii < i0 + nrows; ii++)
+				resamp_row(ps, intrp, ii, sinn, ydims, xdims, wtab, nk, xdimm, ras, &sout[2 * (size_t)xdimm * (ii - i0)]);
+#pragma omp ordered
+			fwrite(sout, 2 * sizeof(short), (size_t)xdimm * nrows, SLC_file2);
 		}
-		fwrite(sout, 2 * sizeof(short), xdimm, SLC_file2);
+
+		free(sout);
+		free(ras);
 	}
 	// fprintf(stderr,"%llu points out of bounds
 	// (%d,%.6f,%.6f,%.6f)\n",count,ps.rshift,ps.sub_int_r,ps.stretch_r,ps.a_stretch_r);
@@ -186,88 +201,12 @@ int main(int argc, char **argv) {
 		die("mmap error unmapping file", " ");
 	close(fdin);
 	fclose(SLC_file2);
+	if (wtab)
+		free(wtab);
 
 	return (EXIT_SUCCESS);
 }
 
-/************************************************************************
- * bi-cubic interpolation algorithm modified from GMT                    *
- ************************************************************************/
-/************************************************************************
- * Creator: David Sandwell       (Scripps Institution of Oceanography)   *
- * Date   : 03/22/13                                                     *
- ************************************************************************/
-#include <math.h>
-#include <stdio.h>
-
-double cubic_kernel(double, double);
-
-void bicubic_one(double *rdata, double *idata, double x, double y, double *cz) {
-	int i, j, ij;
-	double wx[4], wy[4];
-	double arg, w, wsum, rsum, isum;
-	double a = -0.3;
-
-	/* These weights are based on the cubic convolution kernel, see for example
-	   http://undergraduate.csse.uwa.edu.au/units/CITS4241/Handouts/Lecture04.html
-	   These weights include a free parameter (a).
-	*/
-
-	for (i = 0; i < 4; i++) {
-		arg = fabs(x + 1 - i);
-		wx[i] = cubic_kernel(arg, a);
-		arg = fabs(y + 1 - i);
-		wy[i] = cubic_kernel(arg, a);
-	}
-
-	rsum = isum = wsum = 0.0;
-	ij = 0;
-	for (j = 0; j < 4; j++) {
-		for (i = 0; i < 4; i++) {
-			w = wx[i] * wy[j];
-			rsum += rdata[ij + i] * w;
-			isum += idata[ij + i] * w;
-			wsum += w;
-		}
-		ij += 4;
-	}
-	if (wsum <= 0.0)
-		fprintf(stderr, " error wsum is zero \n");
-	cz[0] = rsum / wsum;
-	cz[1] = isum / wsum;
-}
-/************************************************************************
-  kernel computes a bi-cubic spline kernel using the formula given at
-  the following web page
-  http://undergraduate.csse.uwa.edu.au/units/CITS4241/Handouts/Lecture04.html
-************************************************************************/
-/************************************************************************
- * Creator: David Sandwell       (Scripps Institution of Oceanography)   *
- * Date   : 03/22/13                                                     *
- ************************************************************************/
-#include <stdio.h>
-
-double cubic_kernel(double arg, double a)
-
-/* note arg must be positive and a must be between -3 and 0. */
-{
-
-	double arg2, arg3, f;
-
-	arg2 = arg * arg;
-	arg3 = arg2 * arg;
-	if (arg <= 1.) {
-		f = (a + 2) * arg3 - (a + 3) * arg2 + 1.;
-	}
-	else if (arg <= 2.) {
-		f = a * arg3 - 5 * a * arg2 + 8 * a * arg - 4 * a;
-	}
-	else {
-		f = 0.;
-	}
-	return (f);
-}
-
 /************************************************************************
  * nearest, bilinear, and bicubic interpolations                         *
  ************************************************************************/
@@ -374,118 +313,115 @@ void bilinear(double *ras, short *s_in, int ydims, int xdims, short *sout) {
 	/*if(nclip > 0) fprintf(stderr," %d integers were clipped \n",nclip);*/
 }
 
-void bicubic(double *ras, short *s_in, int ydims, int xdims, short *sout) {
-	double dr, da;
-	double rdata[16], idata[16], cz[2];
-	int i, j, k, kk;
-	int i0, j0;
-	int nclip;
+/************************************************************************
+ * bicubic and bisinc interpolation of a whole output row               *
+ * the kernel is applied separably, range first then azimuth, with the  *
+ * real and imaginary parts of the nk taps of an input line interleaved *
+ * so the inner loop runs over 2*nk contiguous values                   *
+ ************************************************************************/
+void kernel_row(double *rng, double *azi, short *s_in, int ydims, int xdims, float *wtab, int nk, int xdimm, short *sout) {
+	int jj, k, ky, i0, j0, off;
+	int nw = 2 * nk;
+	float acc[2 * MAX_TAPS], wy, real, imag;
+	float *wx, *wy_row;
 	short *tmp_sin;
 
-	/* compute the residual offsets */
-	nclip = 0;
-	j0 = (int)floor(ras[0]);
-	i0 = (int)floor(ras[1]);
-	dr = ras[0] - (double)j0;
-	da = ras[1] - (double)i0;
-	if (dr < 0. || dr > 1. || da < 0. || da > 1)
-		fprintf(stderr, " dr or da out of bounds %f %f \n", dr, da);
-
-	/* make sure all 4 corners are within the bounds of the aligned array */
+	off = nk / 2 - 1;
+	for (jj = 0; jj < xdimm; jj++) {
+		j0 = (int)floor(rng[jj]);
+		i0 = (int)floor(azi[jj]);
 
-	if ((i0 - 1) < 0 || (i0 + 2) >= ydims || (j0 - 1) < 0 || (j0 + 2) >= xdims) {
-		sout[0] = 0;
-		sout[1] = 0;
-	}
-	else {
-
-		/* safe to do the interpolation */
-
-		/* shift the pointer by i0-1 lines  */
-		tmp_sin = s_in;
-		tmp_sin++;
-		tmp_sin = s_in + (size_t)(2 * xdims) * (size_t)(i0 - 1) * (tmp_sin - s_in);
-
-		for (i = 0; i < 4; i++) {
-			for (j = 0; j < 4; j++) {
-				k = i * 4 + j;
-				// kk = 2*xdims*(i0-1+i)  + 2*(j0-1+j);
-				kk = 2 * xdims * i + 2 * (j0 - 1 + j);
-				// rdata[k] = s_in[kk];
-				// idata[k] = s_in[kk+1];
-				rdata[k] = tmp_sin[kk];
-				idata[k] = tmp_sin[kk + 1];
-			}
+		/* make sure all nk by nk points are within the bounds of the aligned array */
+		if ((i0 - off) < 0 || (i0 - off + nk) > ydims || (j0 - off) < 0 || (j0 - off + nk) > xdims) {
+			sout[2 * jj] = 0;
+			sout[2 * jj + 1] = 0;
+			continue;
 		}
 
-		/* interpolate the real and imaginary data */
-
-		bicubic_one(rdata, idata, dr, da, cz);
+		/* shift the pointer to the first tap, size_t so files over 4GB work */
+		tmp_sin = s_in + (size_t)(2 * xdims) * (size_t)(i0 - off) + (size_t)(2 * (j0 - off));
+
+		wx = &wtab[(int)((rng[jj] - j0) * KERNEL_STEPS + 0.5) * nw];
+		wy_row = &wtab[(int)((azi[jj] - i0) * KERNEL_STEPS + 0.5) * nw];
+		for (k = 0; k < nw; k++)
+			acc[k] = 0.f;
+		for (ky = 0; ky < nk; ky++) {
+			wy = wy_row[2 * ky];
+			for (k = 0; k < nw; k++)
+				acc[k] += wy * wx[k] * (float)tmp_sin[k];
+			tmp_sin += 2 * xdims;
+		}
 
-		if ((int)fabs(cz[0]) > I2MAX)
-			nclip = nclip + 1;
-		sout[0] = (short)clipi2(cz[0] + 0.5);
-		if ((int)fabs(cz[1]) > I2MAX)
-			nclip = nclip + 1;
-		sout[1] = (short)clipi2(cz[1] + 0.5);
+		real = imag = 0.f;
+		for (k = 0; k < nw; k += 2) {
+			real += acc[k];
+			imag += acc[k + 1];
+		}
+		sout[2 * jj] = (short)clipi2(real + 0.5f);
+		sout[2 * jj + 1] = (short)clipi2(imag + 0.5f);
 	}
-	/*if(nclip > 0) fprintf(stderr," %d integers were clipped \n",nclip);*/
 }
 
-void bisinc(double *ras, short *s_in, int ydims, int xdims, short *sout) {
-	double dr, da, ns2 = NS / 2 - 1;
-	double rdata[NS * NS], idata[NS * NS], cz[2];
-	int i, j, k, kk;
-	int i0, j0;
-	int nclip;
-	short *tmp_sin;
-
-	/* compute the residual offsets */
-	nclip = 0;
-	j0 = (int)floor(ras[0]);
-	i0 = (int)floor(ras[1]);
-	dr = ras[0] - (double)j0;
-	da = ras[1] - (double)i0;
-	if (dr < 0. || dr > 1. || da < 0. || da > 1)
-		fprintf(stderr, " dr or da out of bounds %f %f \n", dr, da);
-
-	/* make sure all 4 corners are within the bounds of the aligned array */
-
-	if ((i0 - ns2) < 0 || (i0 + ns2 + 1) >= ydims || (j0 - ns2) < 0 || (j0 + ns2 + 1) >= xdims) {
-		sout[0] = 0;
-		sout[1] = 0;
+/************************************************************************
+ * hint the kernel to read ahead the band of aligned lines that output   *
+ * rows i0 to i0+nrows-1 will touch; the mapping is affine so the band   *
+ * is set by the four corners, padded by the kernel width                *
+ ************************************************************************/
+void advise_rows(struct PRM ps, short *s_in, int ydims, int xdims, int xdimm, int i0, int nrows) {
+#ifdef MADV_WILLNEED
+	int k, first, last;
+	double a, amin = 0., amax = 0.;
+	size_t line, start, end, pg;
+
+	for (k = 0; k < 4; k++) {
+		a = (i0 + (k / 2) * (nrows - 1)) * (1.0 + ps.a_stretch_a) + (ps.ashift + ps.sub_int_a) + (k % 2) * (xdimm - 1) * ps.stretch_a;
+		if (k == 0 || a < amin)
+			amin = a;
+		if (k == 0 || a > amax)
+			amax = a;
 	}
-	else {
+	first = (int)floor(amin) - MAX_TAPS;
+	last = (int)ceil(amax) + MAX_TAPS + 1;
+	if (first < 0)
+		first = 0;
+	if (last > ydims)
+		last = ydims;
+	if (first >= last)
+		return;
+
+	line = (size_t)4 * (size_t)xdims;
+	pg = (size_t)sysconf(_SC_PAGESIZE);
+	start = (size_t)first * line;
+	start -= start % pg;
+	end = (size_t)last * line;
+	madvise((char *)s_in + start, end - start, MADV_WILLNEED);
+#endif
+}
 
-		/* safe to do the interpolation */
-
-		/* shift the pointer by i0-ns2 lines  */
-		tmp_sin = s_in;
-		tmp_sin++;
-		tmp_sin = s_in + (size_t)(2 * xdims) * (size_t)(i0 - ns2) * (tmp_sin - s_in);
-
-		for (i = 0; i < NS; i++) {
-			for (j = 0; j < NS; j++) {
-				k = i * NS + j;
-				// kk = 2*xdims*(i0-ns2+i)  + 2*(j0-ns2+j);
-				kk = 2 * xdims * i + 2 * (j0 + j - ns2);
-				rdata[k] = tmp_sin[kk];
-				idata[k] = tmp_sin[kk + 1];
-			}
-		}
+/************************************************************************
+ * resample one row ii of the master geometry into sout                  *
+ * ras is scratch for 2*xdimm coordinates                                *
+ ************************************************************************/
+void resamp_row(struct PRM ps, int intrp, int ii, short *s_in, int ydims, int xdims, float *wtab, int nk, int xdimm, double *ras,
+                short *sout) {
+	int jj;
+	double *rng = ras, *azi = &ras[xdimm], rs[2];
 
-		/* interpolate the real and imaginary data */
+	ram2ras_row(ps, ii, xdimm, rng, azi);
 
-		sinc_one(rdata, idata, dr, da, cz);
+	if (intrp == 3 || intrp == 4) {
+		kernel_row(rng, azi, s_in, ydims, xdims, wtab, nk, xdimm, sout);
+		return;
+	}
 
-		if ((int)fabs(cz[0]) > I2MAX)
-			nclip = nclip + 1;
-		sout[0] = (short)clipi2(cz[0] + 0.5);
-		if ((int)fabs(cz[1]) > I2MAX)
-			nclip = nclip + 1;
-		sout[1] = (short)clipi2(cz[1] + 0.5);
+	for (jj = 0; jj < xdimm; jj++) {
+		rs[0] = rng[jj];
+		rs[1] = azi[jj];
+		if (intrp == 1)
+			nearest(rs, s_in, ydims, xdims, &sout[2 * jj]);
+		else if (intrp == 2)
+			bilinear(rs, s_in, ydims, xdims, &sout[2 * jj]);
 	}
-	/*if(nclip > 0) fprintf(stderr," %d integers were clipped \n",nclip);*/
 }
 #include "gmtsar.h"
 #include "lib_functions.h"
@@ -520,8 +456,8 @@ void fix_prm_params(struct PRM *p, char *s) {
 	p->SC_clock_stop = p->SC_clock_start + (p->num_valid_az * p->num_patches) / (p->prf * 86400.0);
 }
 /************************************************************************
- * ram2ras maps range and azimuth from a master image location into the  *
- * corresponding range and azimuth location of the aligned image.          *
+ * ram2ras_row maps range and azimuth of every pixel in master row ii    *
+ * into the corresponding range and azimuth location of the aligned image.*
  ************************************************************************/
 /************************************************************************
  * Creator: David Sandwell       (Scripps Institution of Oceanography)   *
@@ -536,74 +472,21 @@ void fix_prm_params(struct PRM *p, char *s) {
 #include <stdio.h>
 #include <stdlib.h>
 
-void ram2ras(struct PRM ps, double *ram, double *ras) {
-	/* this is the range coordinate */
-	ras[0] = ram[0] + ((ps.rshift + ps.sub_int_r) + ram[0] * ps.stretch_r + ram[1] * ps.a_stretch_r);
-
-	/* this is the azimuth coordinate */
-	ras[1] = ram[1] + ((ps.ashift + ps.sub_int_a) + ram[0] * ps.stretch_a + ram[1] * ps.a_stretch_a);
-}
-
-/************************************************************************
-  computes sinc function kernel for interpolation
-************************************************************************/
-/************************************************************************
- * Creator: David Sandwell       (Scripps Institution of Oceanography)   *
- * Date   : 03/28/13                                                     *
- ************************************************************************/
-#include <math.h>
-#define PI 3.1415926535897932
-
-double sinc_kernel(double x) {
-	double arg, f;
-
-	arg = fabs(PI * x);
-	if (arg > 0.) {
-		f = sin(arg) / arg;
-	}
-	else {
-		f = 1.;
-	}
-	return (f);
-}
-/************************************************************************
- * sinc function interpolation                                           *
- ************************************************************************/
-/************************************************************************
- * Creator: David Sandwell       (Scripps Institution of Oceanography)   *
- * Date   : 03/28/13                                                     *
- ************************************************************************/
-#include "gmtsar.h"
-#include <math.h>
-#include <stdio.h>
-
-double sinc_kernel(double);
+void ram2ras_row(struct PRM ps, int ii, int xdimm, double *rng, double *azi) {
+	int jj;
+	double r0, a0, dr, da;
 
-void sinc_one(double *rdata, double *idata, double x, double y, double *cz) {
-	int i, j, ij, ns2 = NS / 2 - 1;
-	double wx[NS], wy[NS];
-	double arg, w, wsum, rsum, isum;
+	/* the mapping is affine so along a row both coordinates are linear in jj */
+	r0 = (ps.rshift + ps.sub_int_r) + ii * ps.a_stretch_r;
+	a0 = ii + ((ps.ashift + ps.sub_int_a) + ii * ps.a_stretch_a);
+	dr = 1.0 + ps.stretch_r;
+	da = ps.stretch_a;
 
-	for (i = 0; i < NS; i++) {
-		arg = fabs(x + ns2 - i);
-		wx[i] = sinc_kernel(arg);
-		arg = fabs(y + ns2 - i);
-		wy[i] = sinc_kernel(arg);
-	}
+	for (jj = 0; jj < xdimm; jj++) {
+		/* this is the range coordinate */
+		rng[jj] = r0 + jj * dr;
 
-	rsum = isum = wsum = 0.0;
-	ij = 0;
-	for (j = 0; j < NS; j++) {
-		for (i = 0; i < NS; i++) {
-			w = wx[i] * wy[j];
-			rsum += rdata[ij + i] * w;
-			isum += idata[ij + i] * w;
-			wsum += w;
-		}
-		ij += NS;
+		/* this is the azimuth coordinate */
+		azi[jj] = a0 + jj * da;
 	}
-	if (wsum <= 0.0)
-		fprintf(stderr, " error wsum is zero \n");
-	cz[0] = rsum / wsum;
-	cz[1] = isum / wsum;
 }
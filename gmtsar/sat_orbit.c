@@ -0,0 +1,320 @@
+/*	$Id$	*/
+/*--------------------------------------------------------------------------------------*/
+/* orbit object - see sat_orbit.h							*/
+/*											*/
+/* sat_orbit_create(prm)		read the LED file of prm and sample the orbit	*/
+/*					every ts seconds over the scene plus padding	*/
+/* sat_orbit_create_sampled(prm, ts, npad)	the same with a given sampling	*/
+/* sat_orbit_destroy(so)		free it						*/
+/* sat_orbit_position(so, t, pos)	Hermite position at any time of the LED file	*/
+/* sat_orbit_state(so, t, pos, vel)	position and velocity from the sampled orbit,	*/
+/*					returns 0 outside of it				*/
+/* sat_orbit_zero_doppler(so, xp, precise, seeded, tseed, tm, rng)			*/
+/*					time and range of closest approach to xp	*/
+/* sat_orbit_point(so, precise, llt, seeded, tseed, rat)				*/
+/*					range, azimuth of one lon, lat, elevation	*/
+/* sat_orbit_llt2rat(so, precise, n, llt, rat)	the same for an array of points	*/
+/*											*/
+/*	the object is only read after sat_orbit_create so threads can share it;	*/
+/*	seeded and tseed carry the zero Doppler time from one point to the next	*/
+/*	and belong to the caller (one pair per thread)					*/
+/*--------------------------------------------------------------------------------------*/
+#include "gmtsar.h"
+#include "orbit.h"
+
+#define R 0.61803399
+#define C 0.382
+#define SHFT2(a, b, c)                                                                                                           \
+	(a) = (b);                                                                                                                   \
+	(b) = (c);
+#define SHFT3(a, b, c, d)                                                                                                        \
+	(a) = (b);                                                                                                                   \
+	(b) = (c);                                                                                                                   \
+	(c) = (d);
+#define TOL 2
+
+void read_orb(FILE *, struct SAT_ORB *);
+void hermite_c(double *, double *, double *, int, int, double, double *, int *);
+void polyfit(double *, double *, double *, int *, int *);
+
+/*------------------------------------------------------------------------*/
+static double orbit_dist(double *xp, int n, double **orb_pos) {
+	double dx, dy, dz;
+
+	dx = xp[0] - orb_pos[1][n];
+	dy = xp[1] - orb_pos[2][n];
+	dz = xp[2] - orb_pos[3][n];
+
+	return (sqrt(dx * dx + dy * dy + dz * dz));
+}
+/*------------------------------------------------------------------------*/
+/* golden section search for the orbit sample closest to xp between ax and bx */
+static int orbit_goldop(double **orb_pos, int ax, int bx, int cx, double *xp, double *rng, double *tm) {
+	double f1, f2;
+	int x0, x1, x2, x3, xmin;
+
+	x0 = ax;
+	x3 = bx;
+	if (abs(bx - cx) > abs(cx - ax)) {
+		x1 = cx;
+		x2 = cx + (int)fabs((C * (bx - cx)));
+	}
+	else {
+		x2 = cx;
+		x1 = cx - (int)fabs((C * (cx - ax))); /* make x0 to x1 the smaller segment */
+	}
+
+	f1 = orbit_dist(xp, x1, orb_pos);
+	f2 = orbit_dist(xp, x2, orb_pos);
+
+	while ((x3 - x0) > TOL && (x2 != x1)) {
+		if (f2 < f1) {
+			SHFT3(x0, x1, x2, (int)(R * x3 + C * x1));
+			SHFT2(f1, f2, orbit_dist(xp, x2, orb_pos));
+		}
+		else {
+			SHFT3(x3, x2, x1, (int)(R * x0 + C * x2));
+			SHFT2(f2, f1, orbit_dist(xp, x1, orb_pos));
+		}
+	}
+
+	xmin = (f1 < f2) ? x1 : x2;
+	if (xmin > bx || xmin < ax)
+		xmin = abs(xmin - bx) > abs(xmin - ax) ? ax : bx;
+	*tm = orb_pos[0][xmin];
+	*rng = orbit_dist(xp, xmin, orb_pos);
+
+	return (xmin);
+}
+/*------------------------------------------------------------------------*/
+struct SAT_ORBIT *sat_orbit_create(struct PRM *prm) {
+	double ts;
+	int npad;
+
+	/* sample the orbit only every 2th point or about 8 m along track */
+	/* if this is S1A which has a low PRF sample 2 times more often */
+	ts = 2. / prm->prf;
+	npad = 8000;
+	if (prm->prf < 600.) {
+		ts = 2. / (2. * prm->prf);
+		npad = 20000;
+	}
+
+	return (sat_orbit_create_sampled(prm, ts, npad));
+}
+/*------------------------------------------------------------------------*/
+struct SAT_ORBIT *sat_orbit_create_sampled(struct PRM *prm, double ts, int npad) {
+	struct SAT_ORBIT *so = NULL;
+	FILE *ldrfile = NULL;
+	int i, k, ir, nval = 6;
+	double t2, pt0, time, xs;
+
+	if ((so = (struct SAT_ORBIT *)calloc(1, sizeof(struct SAT_ORBIT))) == NULL)
+		die("sat_orbit_create: ", "out of memory");
+	so->prm = *prm;
+
+	/*  get the orbit data */
+	if ((ldrfile = fopen(prm->led_file, "r")) == NULL)
+		die("can't open ", prm->led_file);
+	so->orb = (struct SAT_ORB *)malloc(sizeof(struct SAT_ORB));
+	read_orb(ldrfile, so->orb);
+	fclose(ldrfile);
+
+	so->dr = 0.5 * SOL / prm->fs;
+
+	/* compute the flattening */
+	so->fll = (prm->ra - prm->rc) / prm->ra;
+
+	/* compute the start time, stop time and increment */
+	so->t1 = 86400. * prm->clock_start + (prm->nrows - prm->num_valid_az) / (2. * prm->prf);
+	t2 = so->t1 + prm->num_patches * prm->num_valid_az / prm->prf;
+
+	so->ts = ts;
+	so->npad = npad;
+	so->nrec = (int)((t2 - so->t1) / so->ts);
+	so->nsamp = so->nrec + 2 * so->npad;
+
+	/* state vectors in the arrays hermite_c wants, kept for sat_orbit_position */
+	so->pt = (double *)malloc(so->orb->nd * sizeof(double));
+	for (k = 0; k < 3; k++) {
+		so->px[k] = (double *)malloc(so->orb->nd * sizeof(double));
+		so->pv[k] = (double *)malloc(so->orb->nd * sizeof(double));
+	}
+	pt0 = 86400. * so->orb->id + so->orb->sec;
+	for (i = 0; i < so->orb->nd; i++) {
+		so->pt[i] = pt0 + i * so->orb->dsec;
+		so->px[0][i] = so->orb->points[i].px;
+		so->px[1][i] = so->orb->points[i].py;
+		so->px[2][i] = so->orb->points[i].pz;
+		so->pv[0][i] = so->orb->points[i].vx;
+		so->pv[1][i] = so->orb->points[i].vy;
+		so->pv[2][i] = so->orb->points[i].vz;
+	}
+
+	/* orbit position at every sample */
+	so->orb_pos = (double **)malloc(4 * sizeof(double *));
+	for (k = 0; k < 4; k++)
+		if ((so->orb_pos[k] = (double *)malloc(so->nsamp * sizeof(double))) == NULL)
+			die("sat_orbit_create: ", "out of memory");
+	for (i = 0; i < so->nsamp; i++) {
+		time = so->t1 - so->npad * so->ts + i * so->ts;
+		so->orb_pos[0][i] = time;
+		for (k = 0; k < 3; k++) {
+			hermite_c(so->pt, so->px[k], so->pv[k], so->orb->nd, nval, time, &xs, &ir);
+			so->orb_pos[k + 1][i] = xs;
+		}
+	}
+
+	return (so);
+}
+/*------------------------------------------------------------------------*/
+void sat_orbit_destroy(struct SAT_ORBIT *so) {
+	int k;
+
+	if (so == NULL)
+		return;
+	for (k = 0; k < 4; k++)
+		free(so->orb_pos[k]);
+	free(so->orb_pos);
+	for (k = 0; k < 3; k++) {
+		free(so->px[k]);
+		free(so->pv[k]);
+	}
+	free(so->pt);
+	free(so->orb->points);
+	free(so->orb);
+	free(so);
+}
+/*------------------------------------------------------------------------*/
+/* same as interpolate_SAT_orbit_slow without rebuilding the arrays */
+void sat_orbit_position(struct SAT_ORBIT *so, double t, double *pos) {
+	int k, ir;
+
+	for (k = 0; k < 3; k++)
+		hermite_c(so->pt, so->px[k], so->pv[k], so->orb->nd, 6, t, &pos[k], &ir);
+}
+/*------------------------------------------------------------------------*/
+int sat_orbit_state(struct SAT_ORBIT *so, double t, double *pos, double *vel) {
+	double acc[3];
+
+	return (orbit_table_state(so->orb_pos, so->nsamp, so->ts, t, pos, vel, acc));
+}
+/*------------------------------------------------------------------------*/
+/* returns the orbit sample closest to xp; tm and rng are that sample's, or the
+ * refined minimum when precise is 1 */
+int sat_orbit_zero_doppler(struct SAT_ORBIT *so, double *xp, int precise, int *seeded, double *tseed, double *tm,
+                           double *rng) {
+	double t11, dt, dtt, tz = 0., rz, xs[3];
+	double time[20], rngs[20], d[3]; /* arrays used for polynomial refinement of min range */
+	int k, xmin = -1, ntt = 10, nc = 3;
+
+	/* start from the zero Doppler time of the previous point and only search
+	 * the whole orbit when that fails */
+	if (*seeded) {
+		tz = *tseed;
+		xmin = zero_doppler_newton(so->orb_pos, so->nsamp, so->ts, xp, &tz, &rz);
+	}
+	if (xmin < 0) {
+		xmin = orbit_goldop(so->orb_pos, 0, so->nsamp - 1, (int)((so->nsamp - 1) * C), xp, rng, tm);
+		tz = *tm;
+		if ((k = zero_doppler_newton(so->orb_pos, so->nsamp, so->ts, xp, &tz, &rz)) < 0) {
+			*seeded = 0;
+			if (precise == 1) {
+				/* off the orbit array, refine this minimum range and azimuth with a polynomial fit */
+				dt = 1. / ntt; /* make the polynomial 1 second long */
+				for (k = 0; k < ntt; k++) {
+					time[k] = dt * (k - ntt / 2 + .5);
+					t11 = *tm + time[k];
+					sat_orbit_position(so, t11, xs);
+					rngs[k] = sqrt((xp[0] - xs[0]) * (xp[0] - xs[0]) + (xp[1] - xs[1]) * (xp[1] - xs[1]) +
+					               (xp[2] - xs[2]) * (xp[2] - xs[2])) -
+					          *rng;
+				}
+
+				/* fit a second order polynomial to the range versus time function and
+				 * update the tm and rng */
+				polyfit(time, rngs, d, &ntt, &nc);
+				dtt = -d[1] / (2. * d[2]);
+				*tm = *tm + dtt;
+				sat_orbit_position(so, *tm, xs);
+				*rng = sqrt((xp[0] - xs[0]) * (xp[0] - xs[0]) + (xp[1] - xs[1]) * (xp[1] - xs[1]) +
+				            (xp[2] - xs[2]) * (xp[2] - xs[2]));
+			}
+			return (xmin);
+		}
+		xmin = k;
+	}
+	*seeded = 1;
+	*tseed = tz;
+
+	/* the Newton root of the range rate is the refined minimum */
+	if (precise == 1) {
+		*tm = tz;
+		*rng = rz;
+	}
+	else {
+		*tm = so->orb_pos[0][xmin];
+		*rng = orbit_dist(xp, xmin, so->orb_pos);
+	}
+
+	return (xmin);
+}
+/*------------------------------------------------------------------------*/
+/* llt is lon, lat, elevation; rat gets range, azimuth, elevation above the
+ * PRM radius, lon, lat */
+void sat_orbit_point(struct SAT_ORBIT *so, int precise, double *llt, int *seeded, double *tseed, double *rat) {
+	struct PRM *prm = &so->prm;
+	double tm, rng0, rdd, daa, drr, dopc;
+	double xp[3], xt[2], rp[3];
+
+	rp[0] = llt[1];
+	rp[1] = llt[0];
+	rp[2] = llt[2];
+	plh2xyz(rp, xp, prm->ra, so->fll);
+	if (rp[1] > 180.)
+		rp[1] = rp[1] - 360.;
+
+	/* compute the topography due to the difference between the local radius and
+	 * center radius */
+	rp[2] = sqrt(xp[0] * xp[0] + xp[1] * xp[1] + xp[2] * xp[2]) - prm->RE;
+
+	(void)sat_orbit_zero_doppler(so, xp, precise, seeded, tseed, &tm, &rng0);
+
+	/* compute the range and azimuth in pixel space */
+	xt[0] = (rng0 - prm->near_range) / so->dr - (prm->rshift + prm->sub_int_r) + prm->chirp_ext;
+	xt[1] = prm->prf * (tm - so->t1) - (prm->ashift + prm->sub_int_a);
+
+	/* For Envisat correct for biases based on Pinon reflector analysis */
+	if (prm->SC_identity == 4) {
+		xt[0] = xt[0] + 8.4;
+		xt[1] = xt[1] + 4;
+	}
+
+	/* compute the azimuth and range correction if the Doppler is not zero */
+	if (prm->fd1 != 0.) {
+		dopc = prm->fd1 + prm->fdd1 * (prm->near_range + so->dr * prm->num_rng_bins / 2.);
+		rdd = (prm->vel * prm->vel) / rng0;
+		daa = -0.5 * (prm->lambda * dopc) / rdd;
+		drr = 0.5 * rdd * daa * daa / so->dr;
+		daa = prm->prf * daa;
+		xt[0] = xt[0] + drr;
+		xt[1] = xt[1] + daa;
+	}
+
+	rat[0] = xt[0];
+	rat[1] = xt[1];
+	rat[2] = rp[2];
+	rat[3] = rp[1];
+	rat[4] = rp[0];
+}
+/*------------------------------------------------------------------------*/
+/* n points, 3 values each in llt and 5 in rat */
+void sat_orbit_llt2rat(struct SAT_ORBIT *so, int precise, int64_t n, double *llt, double *rat) {
+	int64_t i;
+	int seeded = 0;
+	double tseed = 0.;
+
+	for (i = 0; i < n; i++)
+		sat_orbit_point(so, precise, &llt[3 * i], &seeded, &tseed, &rat[5 * i]);
+}
+/*------------------------------------------------------------------------*/
@@ -0,0 +1,19 @@
+/*	$Id$	*/
+/* orbit of one PRM, read and sampled once and then shared by every point projected with it */
+#ifndef SAT_ORBIT_H
+#define SAT_ORBIT_H
+#include "PRM.h"
+
+struct SAT_ORB;
+
+/* built by sat_orbit_create, read only afterwards so threads may share it */
+struct SAT_ORBIT {
+	struct PRM prm;             /* copy of the PRM the orbit belongs to */
+	struct SAT_ORB *orb;        /* state vectors from the LED file */
+	double *pt, *px[3], *pv[3]; /* state vector times, positions and velocities for hermite_c */
+	double **orb_pos;           /* t, x, y, z every ts seconds starting at t1 - npad * ts */
+	int nrec, npad, nsamp;      /* samples over the scene, padding on each side, total */
+	double t1, ts;              /* scene start time and orbit sampling interval */
+	double dr, fll;             /* range pixel size and flattening */
+};
+#endif /* SAT_ORBIT_H */
@@ -81,6 +81,7 @@ char *USAGE = "USAGE: sbas intf.tab scene.tab N S xdim ydim [-atm ni] [-smooth s
               " input: \n"
               "  intf.tab             --  list of unwrapped (filtered) interferograms:\n"
               "   format:   unwrap.grd  corr.grd  ref_id  rep_id  B_perp \n"
+              "   or a stack cube of the same list made by make_stack_cube \n"
               "  scene.tab            --  list of the SAR scenes in chronological order\n"
               "   format:   scene_id   number_of_days \n"
               "   note:     the number_of_days is relative to a reference date \n"
@@ -171,7 +172,7 @@ int main(int argc, char **argv) {
 	sf = 0;
 
 	/* reading in some parameters and open corresponding files */
-	if ((infile = fopen(argv[1], "r")) == NULL)
+	if ((infile = fopen(argv[1], "rb")) == NULL)
 		die("Can't open file", argv[1]);
 	if ((datefile = fopen(argv[2], "r")) == NULL)
 		die("Can't open file", argv[2]);
@@ -38,6 +38,9 @@
  *  08/19/2014 do not require the velocity curve go through origin * 08/19/2014          *
  *  remove seasonal term                                                                 *
  *  08/19/2014 fix temporal smoothing                                                    *
+ *  10/17/2026 add -group, solving pixels that use the same interferograms together      *
+ *  10/17/2026 add -tile, solving bands of rows within a memory budget                   *
+ *  10/17/2026 add -update, keeping per-pixel QR factors to add new data later           *
  ****************************************************************************************/
 
 /* Reference:
@@ -72,18 +75,20 @@ J. Geophys. Res., 108, 2416, doi:10.1029/2002JB002267, B9.
 #define Malloc(type, n) (type *)calloc((n) , sizeof(type))
 
 #define max(a, b) (((a) > (b)) ? (a) : (b))
+#define GROUP_CHUNK 1024 /* most pixels solved in one DGELSY call with -group */
 #ifdef DEBUG
-#define checkpoint() fprintf(stderr, "Checkpoint64_t at line %lld in file %s\n", __LINE__, __FILE__)
+#define checkpoint() fprintf(stderr, "Checkpoint64_t at line %lld in file %s\n", (long long)__LINE__, __FILE__)
 #else
 #define checkpoint()
 #endif
 
 
 char *USAGE = "USAGE: sbas_parallel intf.tab scene.tab N S xdim ydim [-atm ni] [-smooth sf] "
-              "[-wavelength wl] [-incidence inc] [-range -rng] [-rms] [-dem]\n\n"
+              "[-wavelength wl] [-incidence inc] [-range -rng] [-rms] [-dem] [-mmap] [-group cmin] [-tile mb] [-update state]\n\n"
               " input: \n"
               "  intf.tab             --  list of unwrapped (filtered) interferograms:\n"
               "   format:   unwrap.grd  corr.grd  ref_id  rep_id  B_perp \n"
+              "   or a stack cube of the same list made by make_stack_cube \n"
               "  scene.tab            --  list of the SAR scenes in chronological order\n"
               "   format:   scene_id   number_of_days \n"
               "   note:     the number_of_days is relative to a reference date \n"
@@ -102,7 +107,17 @@ char *USAGE = "USAGE: sbas_parallel intf.tab scene.tab N S xdim ydim [-atm ni] [
               "  -rms                 --  output velocity uncertainty grids (mm/yr): "
               "rms.grd\n"
               "  -dem                 --  output DEM error (m): dem.grd \n"
-              "  -mmap                --  use mmap to allocate disk space for less use of memory \n\n"
+              "  -mmap                --  use mmap to allocate disk space for less use of memory \n"
+              "  -group cmin          --  use an interferogram at a pixel only where its phase is not NaN and its \n"
+              "                           correlation is at least cmin, without correlation weighting. Pixels that \n"
+              "                           use the same interferograms share one factorization (much faster) \n"
+              "  -tile mb             --  read, solve and write bands of rows, holding about mb megabytes of \n"
+              "                           interferograms and results in memory (not with -atm or -mmap) \n"
+              "  -update state        --  keep the factorization of every pixel in the file state. A later run \n"
+              "                           with more scenes at the end of scene.tab and more interferograms in \n"
+              "                           intf.tab reads only the new interferograms and updates all outputs. \n"
+              "                           Not with -atm or -mmap; -smooth may change between runs (bands of 512 MB \n"
+              "                           unless -tile is given) \n\n"
               " output: \n"
               "  disp_##.grd          --  cumulative displacement time series (mm) "
               "grids\n"
@@ -137,7 +152,8 @@ void dgelsy_(const int64_t *m, const int64_t *n, const int64_t *nrhs, double *G,
              const int64_t *info);
 
 int parse_command_ts(int64_t agc, char **agv, float *sf, double *wl, double *theta, double *rng, int64_t *flag_rms,
-                     int64_t *flag_dem, int64_t *atm, int64_t *flag_mmap) {
+                     int64_t *flag_dem, int64_t *atm, int64_t *flag_mmap, int64_t *flag_group, float *gcorr, double *tile_mb,
+                     char **statefile) {
 
 	int64_t i;
 
@@ -178,6 +194,32 @@ int parse_command_ts(int64_t agc, char **agv, float *sf, double *wl, double *the
             *flag_mmap = 1;
             fprintf(stderr, "mmap disk space for less use of memory\n");
         }  
+		else if (!strcmp(agv[i], "-group")) {
+			i++;
+			if (i == agc)
+				die("no option after -group \n", "");
+			*gcorr = atof(agv[i]);
+			if (*gcorr <= 0.0 || *gcorr > 1.0)
+				die("-group needs a correlation between 0 and 1 \n", "");
+			*flag_group = 1;
+			fprintf(stderr, "solve pixels grouped by interferograms with correlation >= %.3f\n", *gcorr);
+		}
+		else if (!strcmp(agv[i], "-tile")) {
+			i++;
+			if (i == agc)
+				die("no option after -tile \n", "");
+			*tile_mb = atof(agv[i]);
+			if (*tile_mb <= 0.0)
+				die("-tile needs a memory size in MB \n", "");
+			fprintf(stderr, "solve in bands of rows using about %g MB\n", *tile_mb);
+		}
+		else if (!strcmp(agv[i], "-update")) {
+			i++;
+			if (i == agc)
+				die("no option after -update \n", "");
+			*statefile = agv[i];
+			fprintf(stderr, "update the time series kept in %s\n", *statefile);
+		}
 		else if (!strcmp(agv[i], "-atm")) {
 			i++;
 			if (i == agc)
@@ -290,14 +332,12 @@ int init_array_ts(double *G, double *Gs, float *res, float *dem, float *disp, in
 	return (1);
 }
 
-int read_table_data_ts(void *API, FILE *infile, FILE *datefile, char **gfile, char **cfile, int64_t *H, float *bperp,
-                       int64_t *flag, float *var, float *phi, int64_t S, int64_t N, int64_t xdim, int64_t ydim,
-                       struct GMT_GRID **Out, int64_t *L, double *time) {
+/* returns 1 if intf.tab is a stack cube, whose header is then left in cube */
+int read_tables_ts(FILE *infile, FILE *datefile, char **gfile, char **cfile, int64_t *H, float *bperp, int64_t S, int64_t N,
+                   int64_t *L, double *time, struct STACK_CUBE *cube) {
 
 	char tmp1[200], tmp2[200], tmp3[200];
-	int64_t i, j, k, xin, yin, indx;
-	float *corin, *grdin;
-	struct GMT_GRID *CC = NULL, *GG = NULL;
+	int64_t i;
 
 	fprintf(stderr, "read table file ...\n");
 	/* read in scene.tab */
@@ -311,10 +351,24 @@ int read_table_data_ts(void *API, FILE *infile, FILE *datefile, char **gfile, ch
 	}
 	if (i != S)
 		die("S and number of the SAR scenes don't match!", "");
-	fprintf(stderr, "number of SAR scenes is %lld \n", S);
+	fprintf(stderr, "number of SAR scenes is %lld \n", (long long)S);
 	for (i = S - 1; i >= 0; i--)
 		time[i] = time[i] - time[0];
 
+	/* intf.tab may be a stack cube */
+	if (stack_cube_read_header(infile, cube)) {
+		stack_cube_check_scenes(cube, S, L, time);
+		if (cube->n_intf != N)
+			die("N and number of interferograms in the stack cube don't match!", "");
+		for (i = 0; i < N; i++) {
+			H[i * 2 + 0] = cube->ref[i];
+			H[i * 2 + 1] = cube->rep[i];
+			bperp[i] = cube->bperp[i];
+		}
+		fprintf(stderr, "number of interferograms is %lld \n", (long long)N);
+		return (1);
+	}
+
 	/* read in intf.tab */
 	i = 0;
 	while (fscanf(infile, "%s %s %s %s %s", gfile[i], cfile[i], &tmp1[0], &tmp2[0], &tmp3[0]) == 5) {
@@ -327,7 +381,24 @@ int read_table_data_ts(void *API, FILE *infile, FILE *datefile, char **gfile, ch
 	}
 	if (i != N)
 		die("N and number of interferograms don't match!", "");
-	fprintf(stderr, "number of interferograms is %lld \n", N);
+	fprintf(stderr, "number of interferograms is %lld \n", (long long)N);
+	return (0);
+}
+
+int read_table_data_ts(void *API, FILE *infile, FILE *datefile, char **gfile, char **cfile, int64_t *H, float *bperp,
+                       int64_t *flag, float *var, float *phi, int64_t S, int64_t N, int64_t xdim, int64_t ydim,
+                       struct GMT_GRID **Out, int64_t *L, double *time) {
+
+	int64_t i, j, k, xin, yin, indx;
+	float *corin, *grdin;
+	struct GMT_GRID *CC = NULL, *GG = NULL;
+	struct STACK_CUBE cube;
+
+	if (read_tables_ts(infile, datefile, gfile, cfile, H, bperp, S, N, L, time, &cube)) {
+		read_cube_data_ts(API, infile, &cube, xdim, ydim, xdim * ydim, ydim, 1, flag, var, phi, Out);
+		stack_cube_free(&cube);
+		return (1);
+	}
 
 	/* read in N 2-dimensional grd file into 3D array */
 	fprintf(stderr, "read phase and correlation grids ...\n");
@@ -357,19 +428,9 @@ int read_table_data_ts(void *API, FILE *infile, FILE *datefile, char **gfile, ch
                 indx = i * xdim * ydim + ydim * j + k;
 				phi[indx] = grdin[j + k * xdim];
 				if (isnan(grdin[j + k * xdim]) != 0) {
-					flag[j + xdim] = 1;
-				}
-				if (corin[j + k * xdim] >= 1e-2 && corin[j + k * xdim] <= 0.99) {
-					/* Rosen et al., 2000 IEEE */
-					var[indx] =
-					    sqrt((1.0 - corin[j + k * xdim] * corin[j + k * xdim]) / (corin[j + k * xdim] * corin[j + k * xdim]));
-				}
-				else if (corin[j + k * xdim] < 1e-2) {
-					var[indx] = 99.99;
-				}
-				else {
-					var[indx] = 0.1;
+					flag[j + k * xdim] = 1;
 				}
+				var[indx] = var_from_corr(corin[j + k * xdim]);
 			}
 		}
 		if (*Out == NULL && (*Out = GMT_Duplicate_Data(API, GMT_IS_GRID, GMT_DUPLICATE_DATA, CC)) == NULL)
@@ -406,6 +467,109 @@ int init_G_ts(double *G, double *Gs, int64_t N, int64_t S, int64_t m, int64_t n,
 	return (1);
 }
 
+/* add up the solution ddd of pixel (j,k) into the displacement time series	*/
+/* and fit a line through it for the velocity and its rms			*/
+void store_pixel_ts(double *ddd, int64_t j, int64_t k, int64_t xdim, int64_t ydim, int64_t S, int64_t n, int64_t count, double *time,
+                    double wl, double *atm_rms, int64_t flag_dem, int64_t flag_rms, float *disp, float *vel, float *res, float *dem) {
+
+	int64_t i, p;
+	double sumxx, sumxy, sumx, sumy, sumyy, aa;
+
+	for (i = 0; i < S; i++) {
+		for (p = 0; p < i; p++) {
+			disp[i * xdim * ydim + j * ydim + k] = disp[i * xdim * ydim + j * ydim + k] + ddd[p];
+		}
+		// disp[i*xdim*ydim+j*ydim+k]=-79.58*wl*disp[i*xdim*ydim+j*ydim+k];
+		// //1000/4/pi
+	}
+
+	if (flag_dem == 1)
+		dem[j + xdim * k] = ddd[n - 1];
+	/*
+	                                if (flag_rms == 1) {
+	                                        new=0;
+	                                        old=0;
+	                                // check the WRMS reduction
+	                                        for (i=0;i<N;i++) {
+	                                                pred=0;
+	                                                for (p=0;p<n;p++) {
+	                                                        pred=pred+d[p]*Gs[i+p*N]/var[i*xdim*ydim+ydim*j+k];
+	                                                }
+	                                                new=new+(ds[i]-pred)*(ds[i]-pred);
+	                                                old=old+ds[i]*ds[i];
+	                                        }
+	                                        res[j+xdim*k]=(sqrt(old)-sqrt(new))/sqrt(old);
+
+	                                        for (i=0;i<N;i++) {
+
+
+	                                        }
+	                                }
+	*/
+	// fitting a straight line by least squares
+	sumxy = 0;
+	sumxx = 0;
+	sumx = 0;
+	sumy = 0;
+	sumyy = 0;
+	if (count > 2) {
+		for (i = 2; i < S - 2; i++) {
+			if (atm_rms[i] != 0.0) {
+				sumxy = sumxy + time[i] * disp[i * xdim * ydim + j * ydim + k];
+				sumxx = sumxx + time[i] * time[i];
+				sumy = sumy + disp[i * xdim * ydim + j * ydim + k];
+				sumx = sumx + time[i];
+			}
+		}
+		vel[j + xdim * k] = -79.58 * wl * (count * sumxy - sumx * sumy) / (count * sumxx - sumx * sumx) * 365.0;
+		if (flag_rms == 1) {
+			aa = sumy / count - (count * sumxy - sumx * sumy) / (count * sumxx - sumx * sumx) * sumx / count;
+			for (i = 2; i < S - 2; i++) {
+				if (atm_rms[i] != 0.0) {
+					sumyy = sumyy + pow((disp[i * xdim * ydim + j * ydim + k] -
+					                     time[i] * vel[j + xdim * k] / (-79.58 * wl * 365) - aa),
+					                    2);
+				}
+			}
+			res[j + xdim * k] =
+			    sqrt(count * sumyy / ((count - 2) * (count * sumxx - sumx * sumx))) * (79.58 * wl * 365);
+		}
+	}
+	else {
+		for (i = 0; i < S; i++) {
+			sumxy = sumxy + time[i] * disp[i * xdim * ydim + j * ydim + k];
+			sumxx = sumxx + time[i] * time[i];
+			sumy = sumy + disp[i * xdim * ydim + j * ydim + k];
+			sumx = sumx + time[i];
+		}
+		vel[j + xdim * k] = -79.58 * wl * (S * sumxy - sumx * sumy) / (S * sumxx - sumx * sumx) * 365.0;
+		if (flag_rms == 1) {
+			aa = sumy / S - (S * sumxy - sumx * sumy) / (S * sumxx - sumx * sumx) * sumx / S;
+			for (i = 2; i < S - 2; i++) {
+				sumyy = sumyy + pow((disp[i * xdim * ydim + j * ydim + k] -
+				                     time[i] * vel[j + xdim * k] / (-79.58 * wl * 365) - aa),
+				                    2);
+			}
+			res[j + xdim * k] = sqrt(S * sumyy / ((S - 2) * (S * sumxx - sumx * sumx))) * (79.58 * wl * 365);
+		}
+	}
+}
+
+/* pixel (j,k) has no solution */
+void store_nan_ts(int64_t j, int64_t k, int64_t xdim, int64_t ydim, int64_t S, int64_t flag_dem, int64_t flag_rms, float *disp,
+                  float *vel, float *res, float *dem) {
+
+	int64_t i;
+
+	for (i = 0; i < S; i++)
+		disp[i * xdim * ydim + j * ydim + k] = NAN;
+	vel[j + xdim * k] = NAN;
+	if (flag_rms == 1)
+		res[j + xdim * k] = NAN;
+	if (flag_dem == 1)
+		dem[j + xdim * k] = NAN;
+}
+
 int64_t lsqlin_sov_ts(int64_t xdim, int64_t ydim, float *disp, float *vel, int64_t *flag, double *d, double *ds, double *time,
                       double *G, double *Gs, double *A, float *var, float *phi, int64_t N, int64_t S, int64_t m, int64_t n,
                       double *work, int64_t lwork, int64_t flag_dem, float *dem, int64_t flag_rms, float *res, int64_t *jpvt,
@@ -419,7 +583,6 @@ int64_t lsqlin_sov_ts(int64_t xdim, int64_t ydim, float *disp, float *vel, int64
     int64_t i, j, k, p, info = 0;
     int64_t rank = 0, nrhs = 1;
     double rcond = 1e-3;
-    double sumxx, sumxy, sumx, sumy, sumyy, aa;
     double *ddd,*GGG;
 
     lda = max(1, m);
@@ -429,7 +592,7 @@ int64_t lsqlin_sov_ts(int64_t xdim, int64_t ydim, float *disp, float *vel, int64
         if (atm_rms[zz] != 0.0 && zz != 0 && zz != 1 && zz != S - 1 && zz != S - 2)
             count++;
 
-    fprintf(stderr, "run least-squares problem over %lld by %lld pixel (%lld) ...\n", xdim, ydim, count);
+    fprintf(stderr, "run least-squares problem over %lld by %lld pixel (%lld) ...\n", (long long)xdim, (long long)ydim, (long long)count);
 
     //Get max number of threads on this system
     int64_t numthreads_max;
@@ -441,7 +604,7 @@ int64_t lsqlin_sov_ts(int64_t xdim, int64_t ydim, float *disp, float *vel, int64
             workwork[i] = (double*)malloc(sizeof(double)*lwork);
 
         // the segment below needs some cleaning, deleting non-useful variables, etc.
-    #pragma omp parallel private(from,to,tid,numt,i,j,k,p,rank,nrhs,rcond,sumxx,sumxy,sumx,sumy,sumyy,aa,ddd,GGG)
+    #pragma omp parallel private(from,to,tid,numt,i,j,k,p,rank,nrhs,rcond,ddd,GGG)
     {
     ddd = (double *) calloc(ldb,sizeof(double));
     GGG = (double *) calloc(m*n,sizeof(double));
@@ -453,7 +616,7 @@ int64_t lsqlin_sov_ts(int64_t xdim, int64_t ydim, float *disp, float *vel, int64
     to = (ydim/numt)*(tid+1)-1;
     if (tid == numt-1)
         to = ydim-1;
-    fprintf(stderr,"Initialing thread %d of %d, running rows from %d to %d\n", tid+1, numt, from, to);
+    fprintf(stderr,"Initialing thread %lld of %lld, running rows from %lld to %lld\n", (long long)(tid+1), (long long)numt, (long long)from, (long long)to);
 
     //This pragma necessary to keep data for all threads private within for clause
     #pragma omp parallel for collapse(2)
@@ -485,10 +648,10 @@ int64_t lsqlin_sov_ts(int64_t xdim, int64_t ydim, float *disp, float *vel, int64
 					fprintf(stderr, "warning! input has an illegal value\n");
 				if (j == 0 && k == 0) {
 					if (rank == n) {
-						fprintf(stderr, "matrix is full rank: %lld\n\n", rank);
+						fprintf(stderr, "matrix is full rank: %lld\n\n", (long long)rank);
 					}
 					else if (rank < n) {
-						fprintf(stderr, "matrix is rank-deficient: %lld\n\n", rank);
+						fprintf(stderr, "matrix is rank-deficient: %lld\n\n", (long long)rank);
 						if (rank == 0) {
 							fprintf(stderr, "WARNING: rank is zero. Check scene.tab and intf.tab for "
 							       "possible duplicates.\n\n");
@@ -502,93 +665,10 @@ int64_t lsqlin_sov_ts(int64_t xdim, int64_t ydim, float *disp, float *vel, int64
 					}
 				}
 
-				for (i = 0; i < S; i++) {
-					for (p = 0; p < i; p++) {
-						disp[i * xdim * ydim + j * ydim + k] = disp[i * xdim * ydim + j * ydim + k] + ddd[p];
-					}
-					// disp[i*xdim*ydim+j*ydim+k]=-79.58*wl*disp[i*xdim*ydim+j*ydim+k];
-					// //1000/4/pi
-				}
-
-				if (flag_dem == 1)
-					dem[j + xdim * k] = ddd[n - 1];
-				/*
-				                                if (flag_rms == 1) {
-				                                        new=0;
-				                                        old=0;
-				                                // check the WRMS reduction
-				                                        for (i=0;i<N;i++) {
-				                                                pred=0;
-				                                                for (p=0;p<n;p++) {
-				                                                        pred=pred+d[p]*Gs[i+p*N]/var[i*xdim*ydim+ydim*j+k];
-				                                                }
-				                                                new=new+(ds[i]-pred)*(ds[i]-pred);
-				                                                old=old+ds[i]*ds[i];
-				                                        }
-				                                        res[j+xdim*k]=(sqrt(old)-sqrt(new))/sqrt(old);
-
-				                                        for (i=0;i<N;i++) {
-
-
-				                                        }
-				                                }
-				*/
-				// fitting a straight line by least squares
-				sumxy = 0;
-				sumxx = 0;
-				sumx = 0;
-				sumy = 0;
-				sumyy = 0;
-				if (count > 2) {
-					for (i = 2; i < S - 2; i++) {
-						if (atm_rms[i] != 0.0) {
-							sumxy = sumxy + time[i] * disp[i * xdim * ydim + j * ydim + k];
-							sumxx = sumxx + time[i] * time[i];
-							sumy = sumy + disp[i * xdim * ydim + j * ydim + k];
-							sumx = sumx + time[i];
-						}
-					}
-					vel[j + xdim * k] = -79.58 * wl * (count * sumxy - sumx * sumy) / (count * sumxx - sumx * sumx) * 365.0;
-					if (flag_rms == 1) {
-						aa = sumy / count - (count * sumxy - sumx * sumy) / (count * sumxx - sumx * sumx) * sumx / count;
-						for (i = 2; i < S - 2; i++) {
-							if (atm_rms[i] != 0.0) {
-								sumyy = sumyy + pow((disp[i * xdim * ydim + j * ydim + k] -
-								                     time[i] * vel[j + xdim * k] / (-79.58 * wl * 365) - aa),
-								                    2);
-							}
-						}
-						res[j + xdim * k] =
-						    sqrt(count * sumyy / ((count - 2) * (count * sumxx - sumx * sumx))) * (79.58 * wl * 365);
-					}
-				}
-				else {
-					for (i = 0; i < S; i++) {
-						sumxy = sumxy + time[i] * disp[i * xdim * ydim + j * ydim + k];
-						sumxx = sumxx + time[i] * time[i];
-						sumy = sumy + disp[i * xdim * ydim + j * ydim + k];
-						sumx = sumx + time[i];
-					}
-					vel[j + xdim * k] = -79.58 * wl * (S * sumxy - sumx * sumy) / (S * sumxx - sumx * sumx) * 365.0;
-					if (flag_rms == 1) {
-						aa = sumy / S - (S * sumxy - sumx * sumy) / (S * sumxx - sumx * sumx) * sumx / S;
-						for (i = 2; i < S - 2; i++) {
-							sumyy = sumyy + pow((disp[i * xdim * ydim + j * ydim + k] -
-							                     time[i] * vel[j + xdim * k] / (-79.58 * wl * 365) - aa),
-							                    2);
-						}
-						res[j + xdim * k] = sqrt(S * sumyy / ((S - 2) * (S * sumxx - sumx * sumx))) * (79.58 * wl * 365);
-					}
-				}
+				store_pixel_ts(ddd, j, k, xdim, ydim, S, n, count, time, wl, atm_rms, flag_dem, flag_rms, disp, vel, res, dem);
 			}
 			else {
-				for (i = 0; i < S; i++)
-					disp[i * xdim * ydim + j * ydim + k] = NAN;
-				vel[j + xdim * k] = NAN;
-				if (flag_rms == 1)
-					res[j + xdim * k] = NAN;
-				if (flag_dem == 1)
-					dem[j + xdim * k] = NAN;
+				store_nan_ts(j, k, xdim, ydim, S, flag_dem, flag_rms, disp, vel, res, dem);
 			}
 		}
 	}
@@ -602,6 +682,169 @@ int64_t lsqlin_sov_ts(int64_t xdim, int64_t ydim, float *disp, float *vel, int64
 	return (1);
 }
 
+/* pixels are sorted by a hash of the interferograms they use */
+struct pixel_key {
+	uint64_t hash;
+	int64_t p; /* pixel index j*ydim+k, as in phi */
+};
+
+int compare_pixel_key(const void *a, const void *b) {
+	const struct pixel_key *ka = a, *kb = b;
+
+	if (ka->hash != kb->hash)
+		return (ka->hash < kb->hash) ? -1 : 1;
+	return (ka->p < kb->p) ? -1 : (ka->p > kb->p);
+}
+
+/* interferogram i is used at pixel p where its phase is defined and it is coherent enough */
+#define USE_INTF(i, p) (!isnan(phi[(i) * np + (p)]) && var[(i) * np + (p)] <= vmax)
+
+/* largest variance of an interferogram used with -group, see var_from_corr */
+float group_vmax(float gcorr) {
+
+	float vmax;
+
+	vmax = (float)(sqrt((1.0 - gcorr * gcorr) / (gcorr * gcorr)) * (1.0 + 1e-6));
+	if (gcorr > 0.99)
+		vmax = 0.1f;
+	if (vmax > 99.0f)
+		vmax = 99.0f; /* correlation below 0.01 is never used */
+	return (vmax);
+}
+
+/* solve the pixels in groups that use the same interferograms, unweighted.	*/
+/* all pixels of a group share one design matrix, so it is factored once	*/
+/* and the group is solved as one DGELSY call with many right hand sides	*/
+int64_t lsqlin_group_ts(int64_t xdim, int64_t ydim, float *disp, float *vel, double *time, double *A, float *var,
+                        float *phi, int64_t N, int64_t S, int64_t m, int64_t n, int64_t flag_dem, float *dem, int64_t flag_rms,
+                        float *res, double wl, double *atm_rms, float gcorr) {
+
+	int64_t np, a, b, c, e, q, i, p, w, nwork, nalloc, ngroup, first, cnt, nuse, zz, count;
+	int64_t lda, ldb, lw, rank, info, *work_list, *jpv;
+	double rcond = 1e-3, *GGG, *B, *wk;
+	float vmax;
+	uint64_t h;
+	struct pixel_key *key, tkey;
+
+	np = xdim * ydim;
+	lda = max(1, m);
+	ldb = max(1, max(m, n));
+	lw = max(1, m * n + max(m * n, GROUP_CHUNK) * 16);
+	count = 0;
+	for (zz = 0; zz < S; zz++)
+		if (atm_rms[zz] != 0.0 && zz != 0 && zz != 1 && zz != S - 1 && zz != S - 2)
+			count++;
+
+	vmax = group_vmax(gcorr);
+
+	if ((key = Malloc(struct pixel_key, np)) == NULL)
+		die("memory allocation!", "key");
+	nalloc = np / GROUP_CHUNK + 1;
+	if ((work_list = Malloc(int64_t, 2 * nalloc)) == NULL)
+		die("memory allocation!", "work_list");
+
+#pragma omp parallel for private(i, h)
+	for (p = 0; p < np; p++) {
+		h = 1469598103934665603ULL;
+		for (i = 0; i < N; i++)
+			if (USE_INTF(i, p))
+				h = (h ^ (uint64_t)i) * 1099511628211ULL;
+		key[p].hash = h;
+		key[p].p = p;
+	}
+	qsort(key, np, sizeof(struct pixel_key), compare_pixel_key);
+
+	/* split each run of equal hashes into groups with identical sets of */
+	/* interferograms, and the groups into pieces of at most GROUP_CHUNK */
+	nwork = ngroup = 0;
+	for (a = 0; a < np; a = b) {
+		for (b = a + 1; b < np && key[b].hash == key[a].hash; b++)
+			;
+		for (c = a; c < b; c = e) {
+			for (e = c + 1, q = c + 1; q < b; q++) {
+				for (i = 0; i < N; i++)
+					if (USE_INTF(i, key[c].p) != USE_INTF(i, key[q].p))
+						break;
+				if (i == N) {
+					tkey = key[e];
+					key[e++] = key[q];
+					key[q] = tkey;
+				}
+			}
+			ngroup++;
+			for (first = c; first < e; first += GROUP_CHUNK) {
+				if (nwork == nalloc) {
+					nalloc *= 2;
+					if ((work_list = realloc(work_list, 2 * nalloc * sizeof(int64_t))) == NULL)
+						die("memory allocation!", "work_list");
+				}
+				work_list[2 * nwork] = first;
+				work_list[2 * nwork + 1] = (e - first < GROUP_CHUNK) ? e - first : GROUP_CHUNK;
+				nwork++;
+			}
+		}
+	}
+	fprintf(stderr, "run least-squares problem over %lld by %lld pixel in %lld groups (%lld) ...\n", (long long)xdim, (long long)ydim, (long long)ngroup, (long long)count);
+
+#pragma omp parallel private(w, first, cnt, nuse, i, q, c, p, rank, info, GGG, B, wk, jpv)
+	{
+		GGG = Malloc(double, m * n);
+		B = Malloc(double, ldb * GROUP_CHUNK);
+		wk = Malloc(double, lw);
+		jpv = Malloc(int64_t, n);
+		if (GGG == NULL || B == NULL || wk == NULL || jpv == NULL)
+			die("memory allocation!", "GGG");
+
+#pragma omp for schedule(dynamic, 1)
+		for (w = 0; w < nwork; w++) {
+			first = work_list[2 * w];
+			cnt = work_list[2 * w + 1];
+
+			/* design matrix with the unused interferograms zeroed */
+			p = key[first].p;
+			for (i = 0, nuse = 0; i < N; i++)
+				if (USE_INTF(i, p))
+					nuse++;
+			for (i = 0; i < m; i++)
+				for (q = 0; q < n; q++)
+					GGG[i + m * q] = (i >= N || USE_INTF(i, p)) ? A[i + m * q] : 0.0;
+
+			for (c = 0; c < cnt; c++) {
+				p = key[first + c].p;
+				for (i = 0; i < ldb; i++)
+					B[i + ldb * c] = (i < N && USE_INTF(i, p)) ? (double)phi[i * np + p] : 0.0;
+			}
+
+			if (nuse > 0) {
+				for (q = 0; q < n; q++)
+					jpv[q] = 0;
+				dgelsy_(&m, &n, &cnt, GGG, &lda, B, &ldb, jpv, &rcond, &rank, wk, &lw, &info);
+				if (info != 0)
+					fprintf(stderr, "warning! input has an illegal value\n");
+			}
+
+			for (c = 0; c < cnt; c++) {
+				p = key[first + c].p;
+				if (nuse == 0)
+					store_nan_ts(p / ydim, p % ydim, xdim, ydim, S, flag_dem, flag_rms, disp, vel, res, dem);
+				else
+					store_pixel_ts(&B[ldb * c], p / ydim, p % ydim, xdim, ydim, S, n, count, time, wl, atm_rms, flag_dem,
+					               flag_rms, disp, vel, res, dem);
+			}
+		}
+
+		free(GGG);
+		free(B);
+		free(wk);
+		free(jpv);
+	}
+
+	free(key);
+	free(work_list);
+
+	return (1);
+}
+
 int write_output_ts(void *API, struct GMT_GRID *Out, int64_t agc, char **agv, int64_t xdim, int64_t ydim, int64_t S,
                     int64_t flag_rms, int64_t flag_dem, float *disp, float *vel, float *res, float *dem, float *screen, double wl,
                     int64_t n_atm, int64_t *L) {
@@ -635,10 +878,10 @@ int write_output_ts(void *API, struct GMT_GRID *Out, int64_t agc, char **agv, in
 				grdin[j + k * xdim] = -79.58 * wl * disp[i * xdim * ydim + j * ydim + k];
 			}
 		}
-		sprintf(tmp1, "%07lld", L[i]);
+		sprintf(tmp1, "%07lld", (long long)L[i]);
 		strcat(outfile, tmp1);
 		strcat(outfile, ".grd");
-		sprintf(tmp1, "Displacement Time Series %03lld", i + 1);
+		sprintf(tmp1, "Displacement Time Series %03lld", (long long)(i + 1));
 		strcpy(Out->header->title, "");
 		strcpy(Out->header->remark, "");
 		if (GMT_Set_Comment(API, GMT_IS_GRID, GMT_COMMENT_IS_REMARK, "Displacement Time Series (mm)", Out))
@@ -686,10 +929,10 @@ int write_output_ts(void *API, struct GMT_GRID *Out, int64_t agc, char **agv, in
 					grdin[j + k * xdim] = screen[i * xdim * ydim + j * ydim + k];
 				}
 			}
-			sprintf(tmp1, "%07lld", L[i]);
+			sprintf(tmp1, "%07lld", (long long)L[i]);
 			strcat(outfile, tmp1);
 			strcat(outfile, ".grd");
-			sprintf(tmp1, "Atmospheric Phase Screen %03lld", i + 1);
+			sprintf(tmp1, "Atmospheric Phase Screen %03lld", (long long)(i + 1));
 			strcpy(Out->header->title, "");
 			strcpy(Out->header->remark, "");
 			if (GMT_Set_Comment(API, GMT_IS_GRID, GMT_COMMENT_IS_REMARK, "Atmospheric Phase Screen", Out))
@@ -987,6 +1230,651 @@ int rank_double(double *nums, int64_t *seq, int64_t n) {
 	return (1);
 }
 
+/* read rows r0 to r0+nrows-1 of all interferograms into phi and var,	*/
+/* laid out as read_table_data_ts does for a grid of nrows rows		*/
+int read_band_ts(void *API, char **gfile, char **cfile, struct GMT_GRID_HEADER *h, int64_t N, int64_t xdim, int64_t r0,
+                 int64_t nrows, float *buf, int64_t *flag, float *var, float *phi) {
+
+	int64_t i, j, k, indx;
+
+	for (i = 0; i < xdim * nrows; i++)
+		flag[i] = 0;
+	for (i = 0; i < N; i++) {
+		read_grid_rows(API, gfile[i], h, r0, nrows, buf);
+		for (k = 0; k < nrows; k++) {
+			for (j = 0; j < xdim; j++) {
+				indx = i * xdim * nrows + nrows * j + k;
+				phi[indx] = buf[j + k * xdim];
+				if (isnan(buf[j + k * xdim]) != 0)
+					flag[j + k * xdim] = 1;
+			}
+		}
+		read_grid_rows(API, cfile[i], h, r0, nrows, buf);
+		for (k = 0; k < nrows; k++)
+			for (j = 0; j < xdim; j++)
+				var[i * xdim * nrows + nrows * j + k] = var_from_corr(buf[j + k * xdim]);
+	}
+
+	return (1);
+}
+
+/* start an output grid shaped like h that is written one row at a time */
+struct GMT_GRID *open_rows_ts(void *API, struct GMT_GRID_HEADER *h, char *command, char *remark, char *title, char *outfile) {
+
+	struct GMT_GRID *Out = NULL;
+
+	if ((Out = GMT_Create_Data(API, GMT_IS_GRID, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, h->wesn, h->inc, h->registration, 0,
+	                           NULL)) == NULL)
+		die("error creating output grid", outfile);
+	if (GMT_Set_Comment(API, GMT_IS_GRID, GMT_COMMENT_IS_COMMAND, command, Out))
+		die("could not set title", "");
+	if (GMT_Set_Comment(API, GMT_IS_GRID, GMT_COMMENT_IS_REMARK, remark, Out))
+		die("could not set title", "");
+	if (GMT_Set_Comment(API, GMT_IS_GRID, GMT_COMMENT_IS_TITLE, title, Out))
+		die("could not set title", "");
+	if (GMT_Write_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY | GMT_GRID_ROW_BY_ROW, NULL, outfile,
+	                   Out))
+		die("Failed to write output grid", outfile);
+
+	return (Out);
+}
+
+/* out-of-core sbas: solve bands of rows that fit in tile_mb megabytes,	*/
+/* reading only those rows of each grid and writing the rows of each	*/
+/* output as soon as the band is solved (no atmospheric correction)	*/
+int sbas_tiled_ts(void *API, int64_t agc, char **agv, FILE *infile, FILE *datefile, int64_t N, int64_t S, int64_t xdim, int64_t ydim,
+                  float sf, double wl, double scale, int64_t flag_rms, int64_t flag_dem, int64_t flag_group, float gcorr,
+                  double tile_mb) {
+
+	char **gfile = NULL, **cfile = NULL, command[GMT_BUFSIZ], tmp1[200], outfile[200];
+	int64_t i, j, k, m, n, nb, nr, r0, lwork, ldb, nrhs = 1, per_row, is_cube;
+	int64_t *flag = NULL, *jpvt = NULL, *H = NULL, *L = NULL, *hit = NULL;
+	float *phi = NULL, *var = NULL, *disp = NULL, *res = NULL, *dem = NULL, *vel = NULL, *bperp = NULL, *buf = NULL, *row = NULL;
+	double *G = NULL, *A = NULL, *Gs = NULL, *d = NULL, *ds = NULL, *work = NULL, *time = NULL, *atm_rms = NULL;
+	struct GMT_GRID *CC = NULL, *GG = NULL, *Ref = NULL, **Disp = NULL, *Vel = NULL, *Rms = NULL, *Dem = NULL;
+	struct GMT_GRID_HEADER *h = NULL;
+	struct STACK_CUBE cube;
+
+	m = N + S - 2;
+	n = S;
+	lwork = max(1, m * n + max(m * n, nrhs) * 16);
+	ldb = max(1, max(m, n));
+
+	/* phi, var, disp, flag, res, dem, vel and the read buffer for one row */
+	per_row = xdim * (4 * (4 * N + S) + 8 + 16);
+	nb = (int64_t)(tile_mb * 1024.0 * 1024.0) / per_row;
+	if (nb < 1)
+		die("-tile memory is less than one row needs", "");
+	if (nb > ydim)
+		nb = ydim;
+	fprintf(stderr, "solving in bands of %lld rows\n", (long long)nb);
+
+	allocate_memory_ts(&jpvt, &work, &d, &ds, &bperp, &gfile, &cfile, &L, &time, &H, &G, &A, &Gs, &flag, &dem, &res, &vel, &phi,
+	                   &var, &disp, n, m, lwork, ldb, N, S, xdim, nb, &hit, 0);
+	/* buf holds a band of one grid, or a band of a stack cube */
+	if ((buf = Malloc(float, xdim * nb * 2 * N)) == NULL || (row = Malloc(float, xdim)) == NULL)
+		die("memory allocation!", "buf");
+	if ((atm_rms = Malloc(double, S)) == NULL || (Disp = Malloc(struct GMT_GRID *, S)) == NULL)
+		die("memory allocation!", "Disp");
+
+	is_cube = read_tables_ts(infile, datefile, gfile, cfile, H, bperp, S, N, L, time, &cube);
+
+	/* check the grid sizes, outputs are shaped like the first correlation grid or the cube */
+	if (is_cube) {
+		if (cube.n_columns != xdim || cube.n_rows != ydim)
+			die("dimension don't match!", "stack cube");
+		if ((Ref = GMT_Create_Data(API, GMT_IS_GRID, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, cube.wesn, cube.inc,
+		                           cube.registration, 0, NULL)) == NULL)
+			die("error creating output grid", "");
+	}
+	for (i = 0; i < N && !is_cube; i++) {
+		if ((CC = GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, cfile[i], NULL)) ==
+		    NULL)
+			die("Can't open ", cfile[i]);
+		if ((GG = GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, gfile[i], NULL)) ==
+		    NULL)
+			die("Can't open ", gfile[i]);
+		if (CC->header->n_columns != xdim || CC->header->n_rows != ydim)
+			die("dimension don't match!", cfile[i]);
+		if (GG->header->n_columns != xdim || GG->header->n_rows != ydim)
+			die("dimension don't match!", gfile[i]);
+		if (GMT_Destroy_Data(API, &GG))
+			die("error freeing data", gfile[i]);
+		if (Ref == NULL)
+			Ref = CC;
+		else if (GMT_Destroy_Data(API, &CC))
+			die("error freeing data", cfile[i]);
+	}
+	h = Ref->header;
+
+	printf("%.6f %.6f %.6f %.6f\n", sf, scale, time[0], bperp[0]);
+
+	init_array_ts(G, Gs, res, dem, disp, n, m, xdim, nb, N, S, 0);
+	init_G_ts(G, Gs, N, S, m, n, L, H, time, sf, bperp, scale);
+	for (i = 0; i < m * n; i++)
+		A[i] = G[i];
+	for (i = 0; i < S; i++)
+		atm_rms[i] = 0.0;
+
+	strcpy(command, "");
+	for (i = 0; i < agc; i++) {
+		strcat(command, agv[i]);
+		strcat(command, " ");
+	}
+	for (i = 0; i < S; i++) {
+		sprintf(outfile, "disp_%07lld.grd", (long long)L[i]);
+		sprintf(tmp1, "Displacement Time Series %03lld", (long long)(i + 1));
+		Disp[i] = open_rows_ts(API, h, command, "Displacement Time Series (mm)", tmp1, outfile);
+	}
+	if (flag_rms == 1)
+		Rms = open_rows_ts(API, h, command, "WRMS reduction from SBAS (mm)", "Weighed Root Mean Square of Fitting", "rms.grd");
+	if (flag_dem == 1)
+		Dem = open_rows_ts(API, h, command, "DEM error estimated from SBAS (m)", "Digital Elevation Model Error", "dem.grd");
+	Vel = open_rows_ts(API, h, command, "Mean LOS velocity from SBAS (mm/yr)", "Mean Line-Of-Sight velocity from SBAS",
+	                   "vel.grd");
+
+	for (r0 = 0; r0 < ydim; r0 += nb) {
+		nr = (r0 + nb <= ydim) ? nb : ydim - r0;
+		fprintf(stderr, "rows %lld to %lld ...\n", (long long)r0, (long long)(r0 + nr - 1));
+
+		if (is_cube) {
+			for (i = 0; i < xdim * nr; i++)
+				flag[i] = 0;
+			stack_cube_read_ts(infile, &cube, r0, nr, xdim * nr, nr, 1, buf, flag, var, phi);
+		} else
+			read_band_ts(API, gfile, cfile, h, N, xdim, r0, nr, buf, flag, var, phi);
+		for (i = 0; i < xdim * nr * S; i++)
+			disp[i] = 0.0;
+		for (i = 0; i < xdim * nr; i++)
+			res[i] = dem[i] = 0.0;
+
+		if (flag_group == 1)
+			lsqlin_group_ts(xdim, nr, disp, vel, time, A, var, phi, N, S, m, n, flag_dem, dem, flag_rms, res, wl, atm_rms,
+			                gcorr);
+		else
+			lsqlin_sov_ts(xdim, nr, disp, vel, flag, d, ds, time, G, Gs, A, var, phi, N, S, m, n, work, lwork, flag_dem, dem,
+			              flag_rms, res, jpvt, wl, atm_rms);
+
+		for (k = 0; k < nr; k++) {
+			for (i = 0; i < S; i++) {
+				for (j = 0; j < xdim; j++)
+					row[j] = -79.58 * wl * disp[i * xdim * nr + j * nr + k];
+				GMT_Put_Row(API, r0 + k, Disp[i], row);
+			}
+			if (flag_rms == 1)
+				GMT_Put_Row(API, r0 + k, Rms, &res[k * xdim]);
+			if (flag_dem == 1)
+				GMT_Put_Row(API, r0 + k, Dem, &dem[k * xdim]);
+			GMT_Put_Row(API, r0 + k, Vel, &vel[k * xdim]);
+		}
+	}
+
+	for (i = 0; i < S; i++)
+		if (GMT_Destroy_Data(API, &Disp[i]))
+			die("error freeing data", "disp");
+	if (flag_rms == 1 && GMT_Destroy_Data(API, &Rms))
+		die("error freeing data", "rms.grd");
+	if (flag_dem == 1 && GMT_Destroy_Data(API, &Dem))
+		die("error freeing data", "dem.grd");
+	if (GMT_Destroy_Data(API, &Vel))
+		die("error freeing data", "vel.grd");
+
+	free_memory_ts(N, phi, var, gfile, cfile, disp, G, A, Gs, H, d, ds, L, res, vel, time, flag, bperp, dem, work, jpvt, hit, 0);
+	free(buf);
+	free(row);
+	free(atm_rms);
+	free(Disp);
+	if (is_cube)
+		stack_cube_free(&cube);
+	if (GMT_Destroy_Data(API, &Ref))
+		die("error freeing data", "");
+
+	return (1);
+}
+
+/* first 8 bytes of an -update state file */
+#define STATE_MAGIC "GMTSARSB"
+
+/* an -update state file is this header, then the scene ids and days,	*/
+/* then the pairs, then for every pixel of every row (top to bottom)	*/
+/* the number of interferograms used (-1 once a phase was NaN), Q'd	*/
+/* (S) and the packed upper triangle of R (S*(S+1)/2), where QR is the	*/
+/* factorization of its weighted interferogram rows, all as doubles	*/
+struct sbas_state {
+	int64_t xdim, ydim;     /* grid size */
+	int64_t S, N;           /* scenes and interferograms accumulated so far */
+	int64_t group;          /* 1 if accumulated unweighted as with -group */
+	int64_t registration;   /* of the output grids */
+	double scale;           /* scale of the B_perp (DEM error) column */
+	double gcorr;           /* -group correlation threshold */
+	double wesn[4], inc[2]; /* region of the output grids */
+	int64_t *L, *H;         /* scene ids (S) and pairs (2N) */
+	double *time;           /* days since the first scene (S) */
+};
+
+/* element (a,b), a <= b, of a packed upper triangle */
+#define PACKED(a, b) ((a) + (b) * ((b) + 1) / 2)
+
+/* doubles stored per pixel for S unknowns */
+#define STATE_REC(S) (1 + (S) + (S) * ((S) + 1) / 2)
+
+int read_state_ts(FILE *fp, struct sbas_state *st) {
+
+	char magic[8];
+	int ok = 1;
+
+	memset(st, 0, sizeof(struct sbas_state));
+	if (fread(magic, 1, 8, fp) != 8 || strncmp(magic, STATE_MAGIC, 8))
+		die("not an sbas -update state file", "");
+	ok &= fread(&st->xdim, sizeof(int64_t), 1, fp) == 1;
+	ok &= fread(&st->ydim, sizeof(int64_t), 1, fp) == 1;
+	ok &= fread(&st->S, sizeof(int64_t), 1, fp) == 1;
+	ok &= fread(&st->N, sizeof(int64_t), 1, fp) == 1;
+	ok &= fread(&st->group, sizeof(int64_t), 1, fp) == 1;
+	ok &= fread(&st->registration, sizeof(int64_t), 1, fp) == 1;
+	ok &= fread(&st->scale, sizeof(double), 1, fp) == 1;
+	ok &= fread(&st->gcorr, sizeof(double), 1, fp) == 1;
+	ok &= fread(st->wesn, sizeof(double), 4, fp) == 4;
+	ok &= fread(st->inc, sizeof(double), 2, fp) == 2;
+	if (!ok || st->S < 2 || st->N < 1)
+		die("truncated sbas -update state file", "");
+	if ((st->L = Malloc(int64_t, st->S)) == NULL || (st->time = Malloc(double, st->S)) == NULL ||
+	    (st->H = Malloc(int64_t, 2 * st->N)) == NULL)
+		die("memory allocation!", "state");
+	ok &= fread(st->L, sizeof(int64_t), st->S, fp) == (size_t)st->S;
+	ok &= fread(st->time, sizeof(double), st->S, fp) == (size_t)st->S;
+	ok &= fread(st->H, sizeof(int64_t), 2 * st->N, fp) == (size_t)(2 * st->N);
+	if (!ok)
+		die("truncated sbas -update state file", "");
+
+	return (1);
+}
+
+int write_state_ts(FILE *fp, struct sbas_state *st) {
+
+	int ok = 1;
+
+	ok &= fwrite(STATE_MAGIC, 1, 8, fp) == 8;
+	ok &= fwrite(&st->xdim, sizeof(int64_t), 1, fp) == 1;
+	ok &= fwrite(&st->ydim, sizeof(int64_t), 1, fp) == 1;
+	ok &= fwrite(&st->S, sizeof(int64_t), 1, fp) == 1;
+	ok &= fwrite(&st->N, sizeof(int64_t), 1, fp) == 1;
+	ok &= fwrite(&st->group, sizeof(int64_t), 1, fp) == 1;
+	ok &= fwrite(&st->registration, sizeof(int64_t), 1, fp) == 1;
+	ok &= fwrite(&st->scale, sizeof(double), 1, fp) == 1;
+	ok &= fwrite(&st->gcorr, sizeof(double), 1, fp) == 1;
+	ok &= fwrite(st->wesn, sizeof(double), 4, fp) == 4;
+	ok &= fwrite(st->inc, sizeof(double), 2, fp) == 2;
+	ok &= fwrite(st->L, sizeof(int64_t), st->S, fp) == (size_t)st->S;
+	ok &= fwrite(st->time, sizeof(double), st->S, fp) == (size_t)st->S;
+	ok &= fwrite(st->H, sizeof(int64_t), 2 * st->N, fp) == (size_t)(2 * st->N);
+	if (!ok)
+		die("error writing sbas -update state file", "");
+
+	return (1);
+}
+
+/* carry the factorization of one pixel from So to Sn unknowns.	*/
+/* the new scenes come after the old ones, so the old intervals keep	*/
+/* their place and only the B_perp column moves to the end		*/
+void expand_state_ts(double *so, int64_t So, double *sn, int64_t Sn) {
+
+	int64_t a, b, a2, b2;
+
+	for (a = 0; a < STATE_REC(Sn); a++)
+		sn[a] = 0.0;
+	if (So == 0)
+		return;
+	sn[0] = so[0];
+	for (a = 0; a < So; a++) {
+		a2 = (a == So - 1) ? Sn - 1 : a;
+		sn[1 + a2] = so[1 + a];
+		for (b = a; b < So; b++) {
+			b2 = (b == So - 1) ? Sn - 1 : b;
+			sn[1 + Sn + PACKED(a2, b2)] = so[1 + So + PACKED(a, b)];
+		}
+	}
+}
+
+/* add the row x (n) with right hand side y to the factorization of	*/
+/* one pixel by Givens rotations, x is overwritten			*/
+void givens_row_ts(double *sp, int64_t n, double *x, double y) {
+
+	int64_t a, b;
+	double *z = &sp[1], *R = &sp[1 + n], rho, c, s, t;
+
+	for (a = 0; a < n; a++) {
+		if (x[a] == 0.0)
+			continue;
+		rho = hypot(R[PACKED(a, a)], x[a]);
+		c = R[PACKED(a, a)] / rho;
+		s = x[a] / rho;
+		for (b = a; b < n; b++) {
+			t = R[PACKED(a, b)];
+			R[PACKED(a, b)] = c * t + s * x[b];
+			x[b] = c * x[b] - s * t;
+		}
+		t = z[a];
+		z[a] = c * t + s * y;
+		y = c * y - s * t;
+	}
+}
+
+/* incremental sbas: the QR factorization of the weighted rows of every	*/
+/* pixel is kept in statefile, so a later run reads only the		*/
+/* interferograms of intf.tab that are not in it yet, appends the new	*/
+/* scenes of scene.tab and solves R with the smoothing rows below it,	*/
+/* n+S-2 rows instead of N+S-2. everything is done in bands of rows	*/
+/* that fit in tile_mb megabytes (no atmospheric correction). the	*/
+/* smoothing rows are added at solve time so -smooth may change between	*/
+/* runs									*/
+int sbas_update_ts(void *API, int64_t agc, char **agv, FILE *infile, FILE *datefile, int64_t N, int64_t S, int64_t xdim,
+                   int64_t ydim, float sf, double wl, double scale, int64_t flag_rms, int64_t flag_dem, int64_t flag_group,
+                   float gcorr, double tile_mb, char *statefile) {
+
+	char **gfile = NULL, **cfile = NULL, **ngfile = NULL, **ncfile = NULL, command[GMT_BUFSIZ], tmp1[200], outfile[200],
+	     newstate[256];
+	int64_t i, j, k, q, a, b, c, m, n, m2, nb, nr, r0, lwork, ldb, nrhs = 1, per_row, So = 0, N_new, rec_o, rec_n, np, p, lw,
+	    rank, info, *inew = NULL;
+	int64_t *flag = NULL, *jpvt = NULL, *H = NULL, *L = NULL, *hit = NULL, *jpv = NULL;
+	float *phi = NULL, *var = NULL, *disp = NULL, *res = NULL, *dem = NULL, *vel = NULL, *bperp = NULL, *buf = NULL, *row = NULL,
+	      vmax = 0.0f, ph, v;
+	double *G = NULL, *A = NULL, *Gs = NULL, *d = NULL, *ds = NULL, *work = NULL, *time = NULL, *atm_rms = NULL;
+	double *s_old = NULL, *s_new = NULL, *MM = NULL, *rhs = NULL, *wk = NULL, *x = NULL, *sp, w, rcond = 1e-3;
+	FILE *fold = NULL, *fnew = NULL;
+	struct GMT_GRID *CC = NULL, *GG = NULL, *Ref = NULL, **Disp = NULL, *Vel = NULL, *Rms = NULL, *Dem = NULL;
+	struct GMT_GRID_HEADER *h = NULL;
+	struct STACK_CUBE cube;
+	struct sbas_state st, old;
+
+	m = N + S - 2;
+	n = S;
+	lwork = max(1, m * n + max(m * n, nrhs) * 16);
+	ldb = max(1, max(m, n));
+
+	memset(&old, 0, sizeof(struct sbas_state));
+	if ((fold = fopen(statefile, "rb")) != NULL) {
+		read_state_ts(fold, &old);
+		So = old.S;
+		if (old.xdim != xdim || old.ydim != ydim)
+			die("dimension don't match!", statefile);
+		if (So > S)
+			die("scene.tab has fewer scenes than ", statefile);
+		if (old.group != flag_group || (flag_group == 1 && fabs(old.gcorr - gcorr) > 1e-6))
+			die("-group must be the same as in the run that made ", statefile);
+		if (fabs(old.scale - scale) > 1e-9 * fabs(scale))
+			die("-wavelength, -incidence and -range must be the same as in the run that made ", statefile);
+	}
+	rec_o = STATE_REC(So);
+	rec_n = STATE_REC(S);
+
+	/* phi, var, disp, flag, res, dem, vel, the read buffer and the old and new state */
+	per_row = xdim * (4 * (2 * N + S) + 8 + 16 + 8 * (rec_o + rec_n));
+	nb = (int64_t)(tile_mb * 1024.0 * 1024.0) / per_row;
+	if (nb < 1)
+		die("-tile memory is less than one row needs", "");
+	if (nb > ydim)
+		nb = ydim;
+	fprintf(stderr, "updating in bands of %lld rows\n", (long long)nb);
+
+	allocate_memory_ts(&jpvt, &work, &d, &ds, &bperp, &gfile, &cfile, &L, &time, &H, &G, &A, &Gs, &flag, &dem, &res, &vel, &phi,
+	                   &var, &disp, n, m, lwork, ldb, N, S, xdim, nb, &hit, 0);
+	if ((buf = Malloc(float, xdim * nb)) == NULL || (row = Malloc(float, xdim)) == NULL)
+		die("memory allocation!", "buf");
+	if ((atm_rms = Malloc(double, S)) == NULL || (Disp = Malloc(struct GMT_GRID *, S)) == NULL)
+		die("memory allocation!", "Disp");
+	if ((s_old = Malloc(double, xdim * nb * rec_o)) == NULL || (s_new = Malloc(double, xdim * nb * rec_n)) == NULL)
+		die("memory allocation!", "state");
+	if ((inew = Malloc(int64_t, N)) == NULL || (ngfile = Malloc(char *, N)) == NULL || (ncfile = Malloc(char *, N)) == NULL)
+		die("memory allocation!", "inew");
+
+	if (read_tables_ts(infile, datefile, gfile, cfile, H, bperp, S, N, L, time, &cube))
+		die("-update needs intf.tab as a list of grids", "");
+
+	/* the old scenes must be the first scenes of scene.tab */
+	for (i = 0; i < So; i++)
+		if (old.L[i] != L[i] || fabs(old.time[i] - time[i]) > 1e-6)
+			die("scene.tab does not start with the scenes of ", statefile);
+
+	/* interferograms of intf.tab that are not in the state yet */
+	for (i = 0, N_new = 0; i < N; i++) {
+		for (q = 0; q < old.N; q++)
+			if (old.H[2 * q] == H[2 * i] && old.H[2 * q + 1] == H[2 * i + 1])
+				break;
+		if (q == old.N) {
+			inew[N_new] = i;
+			ngfile[N_new] = gfile[i];
+			ncfile[N_new] = cfile[i];
+			N_new++;
+		}
+	}
+	fprintf(stderr, "adding %lld scenes and %lld interferograms to %s\n", (long long)(S - So), (long long)N_new, statefile);
+
+	/* check the sizes of the new grids, outputs are shaped like the state or the first new correlation grid */
+	if (So > 0 && (Ref = GMT_Create_Data(API, GMT_IS_GRID, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, old.wesn, old.inc,
+	                                     (unsigned int)old.registration, 0, NULL)) == NULL)
+		die("error creating output grid", "");
+	for (q = 0; q < N_new; q++) {
+		if ((CC = GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, ncfile[q], NULL)) ==
+		    NULL)
+			die("Can't open ", ncfile[q]);
+		if ((GG = GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_HEADER_ONLY, NULL, ngfile[q], NULL)) ==
+		    NULL)
+			die("Can't open ", ngfile[q]);
+		if (CC->header->n_columns != xdim || CC->header->n_rows != ydim)
+			die("dimension don't match!", ncfile[q]);
+		if (GG->header->n_columns != xdim || GG->header->n_rows != ydim)
+			die("dimension don't match!", ngfile[q]);
+		if (GMT_Destroy_Data(API, &GG))
+			die("error freeing data", ngfile[q]);
+		if (Ref == NULL)
+			Ref = CC;
+		else if (GMT_Destroy_Data(API, &CC))
+			die("error freeing data", ncfile[q]);
+	}
+	if (Ref == NULL)
+		die("no interferograms to start ", statefile);
+	h = Ref->header;
+
+	printf("%.6f %.6f %.6f %.6f\n", sf, scale, time[0], bperp[0]);
+
+	init_array_ts(G, Gs, res, dem, disp, n, m, xdim, nb, N, S, 0);
+	init_G_ts(G, Gs, N, S, m, n, L, H, time, sf, bperp, scale);
+	for (i = 0; i < m * n; i++)
+		A[i] = G[i];
+	for (i = 0; i < S; i++)
+		atm_rms[i] = 0.0;
+	if (flag_group == 1)
+		vmax = group_vmax(gcorr);
+
+	/* the new state */
+	st.xdim = xdim;
+	st.ydim = ydim;
+	st.S = S;
+	st.N = old.N + N_new;
+	st.group = flag_group;
+	st.registration = h->registration;
+	st.scale = scale;
+	st.gcorr = gcorr;
+	for (i = 0; i < 4; i++)
+		st.wesn[i] = h->wesn[i];
+	st.inc[GMT_X] = h->inc[GMT_X];
+	st.inc[GMT_Y] = h->inc[GMT_Y];
+	st.L = L;
+	st.time = time;
+	if ((st.H = Malloc(int64_t, 2 * st.N)) == NULL)
+		die("memory allocation!", "state");
+	for (q = 0; q < old.N; q++) {
+		st.H[2 * q] = old.H[2 * q];
+		st.H[2 * q + 1] = old.H[2 * q + 1];
+	}
+	for (q = 0; q < N_new; q++) {
+		st.H[2 * (old.N + q)] = H[2 * inew[q]];
+		st.H[2 * (old.N + q) + 1] = H[2 * inew[q] + 1];
+	}
+	sprintf(newstate, "%s.new", statefile);
+	if ((fnew = fopen(newstate, "wb")) == NULL)
+		die("Can't open file", newstate);
+	write_state_ts(fnew, &st);
+
+	strcpy(command, "");
+	for (i = 0; i < agc; i++) {
+		strcat(command, agv[i]);
+		strcat(command, " ");
+	}
+	for (i = 0; i < S; i++) {
+		sprintf(outfile, "disp_%07lld.grd", (long long)L[i]);
+		sprintf(tmp1, "Displacement Time Series %03lld", (long long)(i + 1));
+		Disp[i] = open_rows_ts(API, h, command, "Displacement Time Series (mm)", tmp1, outfile);
+	}
+	if (flag_rms == 1)
+		Rms = open_rows_ts(API, h, command, "WRMS reduction from SBAS (mm)", "Weighed Root Mean Square of Fitting", "rms.grd");
+	if (flag_dem == 1)
+		Dem = open_rows_ts(API, h, command, "DEM error estimated from SBAS (m)", "Digital Elevation Model Error", "dem.grd");
+	Vel = open_rows_ts(API, h, command, "Mean LOS velocity from SBAS (mm/yr)", "Mean Line-Of-Sight velocity from SBAS",
+	                   "vel.grd");
+
+	/* R on top of the smoothing rows */
+	m2 = n + S - 2;
+	lw = max(1, m2 * n + max(m2 * n, nrhs) * 16);
+	for (r0 = 0; r0 < ydim; r0 += nb) {
+		nr = (r0 + nb <= ydim) ? nb : ydim - r0;
+		np = xdim * nr;
+		fprintf(stderr, "rows %lld to %lld ...\n", (long long)r0, (long long)(r0 + nr - 1));
+
+		if (So > 0 && fread(s_old, sizeof(double), np * rec_o, fold) != (size_t)(np * rec_o))
+			die("truncated sbas -update state file", statefile);
+		if (N_new > 0)
+			read_band_ts(API, ngfile, ncfile, h, N_new, xdim, r0, nr, buf, flag, var, phi);
+		for (i = 0; i < np * S; i++)
+			disp[i] = 0.0;
+		for (i = 0; i < np; i++)
+			res[i] = dem[i] = 0.0;
+
+#pragma omp parallel private(p, j, k, q, a, b, c, i, sp, ph, v, w, MM, rhs, wk, jpv, x, rank, info)
+		{
+			MM = Malloc(double, m2 * n);
+			rhs = Malloc(double, m2);
+			wk = Malloc(double, lw);
+			jpv = Malloc(int64_t, n);
+			x = Malloc(double, n);
+			if (MM == NULL || rhs == NULL || wk == NULL || jpv == NULL || x == NULL)
+				die("memory allocation!", "MM");
+
+#pragma omp for schedule(static)
+			for (p = 0; p < np; p++) {
+				k = p / xdim;
+				j = p % xdim;
+				sp = &s_new[p * rec_n];
+				expand_state_ts(&s_old[p * rec_o], So, sp, S);
+
+				/* add the rows of the new interferograms */
+				for (q = 0; q < N_new; q++) {
+					ph = phi[q * np + nr * j + k];
+					v = var[q * np + nr * j + k];
+					if (flag_group == 1) {
+						if (isnan(ph) || v > vmax)
+							continue;
+						w = 1.0;
+					}
+					else {
+						if (isnan(ph))
+							sp[0] = -1.0;
+						if (sp[0] < 0.0)
+							continue;
+						w = 1.0 / v;
+					}
+					for (a = 0; a < n; a++)
+						x[a] = w * A[inew[q] + m * a];
+					givens_row_ts(sp, n, x, w * ph);
+					sp[0] += 1.0;
+				}
+
+				if (sp[0] <= 0.0) {
+					store_nan_ts(j, k, xdim, nr, S, flag_dem, flag_rms, disp, vel, res, dem);
+					continue;
+				}
+				for (b = 0; b < n; b++) {
+					jpv[b] = 0;
+					for (a = 0; a < n; a++)
+						MM[a + m2 * b] = (a <= b) ? sp[1 + n + PACKED(a, b)] : 0.0;
+					for (a = n; a < m2; a++)
+						MM[a + m2 * b] = A[N + a - n + m * b];
+				}
+				for (a = 0; a < m2; a++)
+					rhs[a] = (a < n) ? sp[1 + a] : 0.0;
+				c = 1;
+				dgelsy_(&m2, &n, &c, MM, &m2, rhs, &m2, jpv, &rcond, &rank, wk, &lw, &info);
+				if (info != 0)
+					fprintf(stderr, "warning! input has an illegal value\n");
+				store_pixel_ts(rhs, j, k, xdim, nr, S, n, 0, time, wl, atm_rms, flag_dem, flag_rms, disp, vel, res, dem);
+			}
+
+			free(MM);
+			free(rhs);
+			free(wk);
+			free(jpv);
+			free(x);
+		}
+
+		if (fwrite(s_new, sizeof(double), np * rec_n, fnew) != (size_t)(np * rec_n))
+			die("error writing sbas -update state file", newstate);
+
+		for (k = 0; k < nr; k++) {
+			for (i = 0; i < S; i++) {
+				for (j = 0; j < xdim; j++)
+					row[j] = -79.58 * wl * disp[i * np + j * nr + k];
+				GMT_Put_Row(API, r0 + k, Disp[i], row);
+			}
+			if (flag_rms == 1)
+				GMT_Put_Row(API, r0 + k, Rms, &res[k * xdim]);
+			if (flag_dem == 1)
+				GMT_Put_Row(API, r0 + k, Dem, &dem[k * xdim]);
+			GMT_Put_Row(API, r0 + k, Vel, &vel[k * xdim]);
+		}
+	}
+
+	/* replace the old state only once the new one is complete */
+	if (fclose(fnew))
+		die("error writing sbas -update state file", newstate);
+	if (fold != NULL)
+		fclose(fold);
+	remove(statefile);
+	if (rename(newstate, statefile))
+		die("Can't rename to ", statefile);
+
+	for (i = 0; i < S; i++)
+		if (GMT_Destroy_Data(API, &Disp[i]))
+			die("error freeing data", "disp");
+	if (flag_rms == 1 && GMT_Destroy_Data(API, &Rms))
+		die("error freeing data", "rms.grd");
+	if (flag_dem == 1 && GMT_Destroy_Data(API, &Dem))
+		die("error freeing data", "dem.grd");
+	if (GMT_Destroy_Data(API, &Vel))
+		die("error freeing data", "vel.grd");
+
+	free_memory_ts(N, phi, var, gfile, cfile, disp, G, A, Gs, H, d, ds, L, res, vel, time, flag, bperp, dem, work, jpvt, hit, 0);
+	free(buf);
+	free(row);
+	free(atm_rms);
+	free(Disp);
+	free(s_old);
+	free(s_new);
+	free(inew);
+	free(ngfile);
+	free(ncfile);
+	free(st.H);
+	if (So > 0) {
+		free(old.L);
+		free(old.time);
+		free(old.H);
+	}
+	if (GMT_Destroy_Data(API, &Ref))
+		die("error freeing data", "");
+
+	return (1);
+}
+
 int main(int argc, char **argv) {
 
 	/* define variables */
@@ -996,7 +1884,10 @@ int main(int argc, char **argv) {
 	int64_t i, j, m, n, nrhs = 1, xdim, lwork, ydim, k1, k2;
 	int64_t N, S;
 	int64_t ldb, lda, *flag = NULL, *jpvt = NULL, *H = NULL, *L = NULL, *hit = NULL, *mark = NULL;
-	int64_t flag_rms = 0, flag_dem = 0, flag_mmap = 0;
+	int64_t flag_rms = 0, flag_dem = 0, flag_mmap = 0, flag_group = 0;
+	float gcorr = 0.0;
+	double tile_mb = 0.0;
+	char *statefile = NULL;
 	float *phi = NULL, *tmp_phi = NULL, sf, *disp = NULL, *res = NULL, *dem = NULL, *bperp = NULL, *vel = NULL, *screen = NULL,
 	      *tmp_screen = NULL;
 	float *var = NULL;
@@ -1050,7 +1941,7 @@ int main(int argc, char **argv) {
 	sf = 0;
 
 	/* reading in some parameters and open corresponding files */
-	if ((infile = fopen(argv[1], "r")) == NULL)
+	if ((infile = fopen(argv[1], "rb")) == NULL)
 		die("Can't open file", argv[1]);
 	if ((datefile = fopen(argv[2], "r")) == NULL)
 		die("Can't open file", argv[2]);
@@ -1062,7 +1953,8 @@ int main(int argc, char **argv) {
 	fprintf(stderr, "\n");
 
 	/* read in the parameters from command line */
-	parse_command_ts(argc, argv, &sf, &wl, &theta, &rng, &flag_rms, &flag_dem, &n_atm, &flag_mmap);
+	parse_command_ts(argc, argv, &sf, &wl, &theta, &rng, &flag_rms, &flag_dem, &n_atm, &flag_mmap, &flag_group, &gcorr, &tile_mb,
+	                 &statefile);
 
 	/* setting up some parameters */
 	scale = 4.0 * M_PI / wl / rng / sin(theta / 180.0 * M_PI);
@@ -1072,6 +1964,26 @@ int main(int argc, char **argv) {
 	lda = max(1, m);
 	ldb = max(1, max(m, n));
 
+	if (tile_mb > 0.0 || statefile != NULL) {
+		if (n_atm != 0 || flag_mmap == 1)
+			die("-tile and -update can not be combined with -atm or -mmap", "");
+		if (statefile != NULL)
+			sbas_update_ts(API, argc, argv, infile, datefile, N, S, xdim, ydim, sf, wl, scale, flag_rms, flag_dem, flag_group,
+			               gcorr, (tile_mb > 0.0) ? tile_mb : 512.0, statefile);
+		else
+			sbas_tiled_ts(API, argc, argv, infile, datefile, N, S, xdim, ydim, sf, wl, scale, flag_rms, flag_dem, flag_group,
+			              gcorr, tile_mb);
+		fclose(infile);
+		fclose(datefile);
+		free(sz_tmp_sbas_phi);
+		free(sz_tmp_sbas_var);
+		free(sz_tmp_sbas_disp);
+		free(sz_tmp_sbas_tmp_phi);
+		if (GMT_Destroy_Session(API))
+			return EXIT_FAILURE;
+		return (EXIT_SUCCESS);
+	}
+
 	/* memory allocation */ // also malloc for atm(nx,ny,S), hit(N,S), sum_vec(N)
 	                        // and atm_rms(S)
 	mm_size_N = 4 * (size_t)N * (size_t)xdim * (size_t)ydim;
@@ -1126,8 +2038,12 @@ int main(int argc, char **argv) {
 			A[i] = G[i];
 		for (i = 0; i < xdim * ydim * S; i++)
 			disp[i] = 0.0;
-		lsqlin_sov_ts(xdim, ydim, disp, vel, flag, d, ds, time, G, Gs, A, var, phi, N, S, m, n, work, lwork, flag_dem, dem,
-		              flag_rms, res, jpvt, wl, atm_rms);
+		if (flag_group == 1)
+			lsqlin_group_ts(xdim, ydim, disp, vel, time, A, var, phi, N, S, m, n, flag_dem, dem, flag_rms, res, wl,
+			                atm_rms, gcorr);
+		else
+			lsqlin_sov_ts(xdim, ydim, disp, vel, flag, d, ds, time, G, Gs, A, var, phi, N, S, m, n, work, lwork, flag_dem, dem,
+			              flag_rms, res, jpvt, wl, atm_rms);
 	}
 	else {
 		fprintf(stderr, "\n\nApplying atmospheric correction by common point stacking...\n\n");
@@ -1183,9 +2099,9 @@ int main(int argc, char **argv) {
 		}
 
 		for (i = 0; i < S; i++) {
-			fprintf(stderr, "%lld ", L[i]);
+			fprintf(stderr, "%lld ", (long long)L[i]);
 			for (j = 0; j < S; j++) {
-				fprintf(stderr, "%lld ", hit[i * S + j]);
+				fprintf(stderr, "%lld ", (long long)hit[i * S + j]);
 			}
 			fprintf(stderr, "\n");
 		}
@@ -1228,8 +2144,12 @@ int main(int argc, char **argv) {
 
 			fprintf(stderr, "Computing deformation time-series...\n");
 			// progam below is paralleled
-			lsqlin_sov_ts(xdim, ydim, disp, vel, flag, d, ds, time, G, Gs, A, var, tmp_phi, N, S, m, n, work, lwork, flag_dem,
-			              dem, flag_rms, res, jpvt, wl, atm_rms);
+			if (flag_group == 1)
+				lsqlin_group_ts(xdim, ydim, disp, vel, time, A, var, tmp_phi, N, S, m, n, flag_dem, dem, flag_rms, res, wl,
+				                atm_rms, gcorr);
+			else
+				lsqlin_sov_ts(xdim, ydim, disp, vel, flag, d, ds, time, G, Gs, A, var, tmp_phi, N, S, m, n, work, lwork, flag_dem,
+				              dem, flag_rms, res, jpvt, wl, atm_rms);
 			// remove the very smooth deformation signal from the data
 			if (kk > 1)
 				for (i = 0; i < xdim * ydim * N; i++)
@@ -1256,7 +2176,7 @@ int main(int argc, char **argv) {
 
 				rank_double(atm_rms, atm_rank, S);
 				for (i = 0; i < S; i++)
-					fprintf(stderr, "atm_noise(NO.%lld) = %lf\n ", atm_rank[i], atm_rms[atm_rank[i]]);
+					fprintf(stderr, "atm_noise(NO.%lld) = %lf\n ", (long long)atm_rank[i], atm_rms[atm_rank[i]]);
 				fprintf(stderr, "\n\n");
 			}
 
@@ -1272,7 +2192,7 @@ int main(int argc, char **argv) {
 			}
 			rank_double(atm_rms, atm_rank, S);
 			for (i = 0; i < S; i++)
-				fprintf(stderr, "atm_noise(NO.%lld) = %lf\n ", atm_rank[i], atm_rms[atm_rank[i]]);
+				fprintf(stderr, "atm_noise(NO.%lld) = %lf\n ", (long long)atm_rank[i], atm_rms[atm_rank[i]]);
 			fprintf(stderr, "\n\n");
 
 			// start agian with aps correction
@@ -1297,8 +2217,12 @@ int main(int argc, char **argv) {
 			A[i] = G[i];
 		for (i = 0; i < xdim * ydim * S; i++)
 			disp[i] = 0.0;
-		lsqlin_sov_ts(xdim, ydim, disp, vel, flag, d, ds, time, G, Gs, A, var, tmp_phi, N, S, m, n, work, lwork, flag_dem, dem,
-		              flag_rms, res, jpvt, wl, atm_rms);
+		if (flag_group == 1)
+			lsqlin_group_ts(xdim, ydim, disp, vel, time, A, var, tmp_phi, N, S, m, n, flag_dem, dem, flag_rms, res, wl,
+			                atm_rms, gcorr);
+		else
+			lsqlin_sov_ts(xdim, ydim, disp, vel, flag, d, ds, time, G, Gs, A, var, tmp_phi, N, S, m, n, work, lwork, flag_dem, dem,
+			              flag_rms, res, jpvt, wl, atm_rms);
 	}
 
 	// write output
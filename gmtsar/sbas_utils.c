@@ -256,6 +256,7 @@ int read_table_data_ts(void *API, FILE *infile, FILE *datefile, char **gfile, ch
 	int64_t i, j, k, xin, yin, indx;
 	float *corin, *grdin;
 	struct GMT_GRID *CC = NULL, *GG = NULL;
+	struct STACK_CUBE cube;
 
 	fprintf(stderr, "read table file ...\n");
 	/* read in scene.tab */
@@ -273,6 +274,22 @@ int read_table_data_ts(void *API, FILE *infile, FILE *datefile, char **gfile, ch
 	for (i = S - 1; i >= 0; i--)
 		time[i] = time[i] - time[0];
 
+	/* intf.tab may be a stack cube */
+	if (stack_cube_read_header(infile, &cube)) {
+		stack_cube_check_scenes(&cube, S, L, time);
+		if (cube.n_intf != N)
+			die("N and number of interferograms in the stack cube don't match!", "");
+		for (i = 0; i < N; i++) {
+			H[i * 2 + 0] = cube.ref[i];
+			H[i * 2 + 1] = cube.rep[i];
+			bperp[i] = cube.bperp[i];
+		}
+		fprintf(stderr, "number of interferograms is %lld \n", (long long)N);
+		read_cube_data_ts(API, infile, &cube, xdim, ydim, 1, N, xdim * N, flag, var, phi, Out);
+		stack_cube_free(&cube);
+		return (1);
+	}
+
 	/* read in intf.tab */
 	i = 0;
 	while (fscanf(infile, "%s %s %s %s %s", gfile[i], cfile[i], &tmp1[0], &tmp2[0], &tmp3[0]) == 5) {
@@ -319,17 +336,7 @@ int read_table_data_ts(void *API, FILE *infile, FILE *datefile, char **gfile, ch
 				if (isnan(grdin[j + k * xdim]) != 0) {
 					flag[j + k*xdim] = 1;
 				}
-				if (corin[j + k * xdim] >= 1e-2 && corin[j + k * xdim] <= 0.99) {
-					/* Rosen et al., 2000 IEEE */
-					var[indx] =
-					    sqrt((1.0 - corin[j + k * xdim] * corin[j + k * xdim]) / (corin[j + k * xdim] * corin[j + k * xdim]));
-				}
-				else if (corin[j + k * xdim] < 1e-2) {
-					var[indx] = 99.99;
-				}
-				else {
-					var[indx] = 0.1;
-				}
+				var[indx] = var_from_corr(corin[j + k * xdim]);
 			}
 		}
 		if (*Out == NULL && (*Out = GMT_Duplicate_Data(API, GMT_IS_GRID, GMT_DUPLICATE_DATA, CC)) == NULL)
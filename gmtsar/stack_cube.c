@@ -0,0 +1,206 @@
+/*	$Id$	*/
+/*--------------------------------------------------------------------------------------*/
+/* stack cube i/o - see stack_cube.h for the layout					*/
+/*											*/
+/* stack_cube_read_header(fp, c)	read the header and pair index, returns 0	*/
+/*					and rewinds fp if the file is not a cube	*/
+/* stack_cube_write_header(fp, c)	write the header and pair index			*/
+/* stack_cube_read_rows(fp, c, r0, nrows, buf)	read rows r0 to r0+nrows-1,		*/
+/*					2*n_intf*n_columns floats per row		*/
+/* stack_cube_check_scenes(c, S, L, time)	die unless the cube was made for	*/
+/*					the scenes of scene.tab				*/
+/* stack_cube_free(c)			free the pair and scene index			*/
+/* stack_cube_read_ts(fp, c, r0, nrows, si, sj, sk, buf, flag, var, phi)		*/
+/*					rows r0 to r0+nrows-1 as time series in one read	*/
+/* read_cube_data_ts(API, fp, c, xdim, ydim, si, sj, sk, flag, var, phi, Out)		*/
+/*					the whole cube as time series, one row at a time	*/
+/*											*/
+/*	the cube is written in native byte order					*/
+/*--------------------------------------------------------------------------------------*/
+#define _GNU_SOURCE /* for fseeko */
+#include "gmtsar.h"
+#include "stack_cube.h"
+
+#ifdef _WIN32
+#define cube_seek _fseeki64
+#else
+#define cube_seek fseeko
+#endif
+
+/*------------------------------------------------------------------------*/
+/* magic, fixed fields, the pair index and the scene index come before the rows */
+static int64_t cube_data_offset(struct STACK_CUBE *c) {
+	return (8 + 2 * sizeof(int32_t) + 4 * sizeof(int64_t) + 6 * sizeof(double) +
+	        c->n_intf * (2 * sizeof(int64_t) + sizeof(float)) + c->n_scene * (sizeof(int64_t) + sizeof(double)));
+}
+/*------------------------------------------------------------------------*/
+int stack_cube_read_header(FILE *fp, struct STACK_CUBE *c) {
+	char magic[8];
+	int64_t i;
+	int ok = 1;
+
+	memset(c, 0, sizeof(struct STACK_CUBE));
+	if (fread(magic, 1, 8, fp) != 8 || strncmp(magic, STACK_CUBE_MAGIC, 8)) {
+		rewind(fp);
+		return (0);
+	}
+
+	ok &= fread(&c->version, sizeof(int32_t), 1, fp) == 1;
+	ok &= fread(&c->registration, sizeof(int32_t), 1, fp) == 1;
+	ok &= fread(&c->n_intf, sizeof(int64_t), 1, fp) == 1;
+	ok &= fread(&c->n_scene, sizeof(int64_t), 1, fp) == 1;
+	ok &= fread(&c->n_columns, sizeof(int64_t), 1, fp) == 1;
+	ok &= fread(&c->n_rows, sizeof(int64_t), 1, fp) == 1;
+	ok &= fread(c->wesn, sizeof(double), 4, fp) == 4;
+	ok &= fread(c->inc, sizeof(double), 2, fp) == 2;
+	if (!ok)
+		die("stack_cube_read_header: ", "truncated header");
+	if (c->version != STACK_CUBE_VERSION)
+		die("stack_cube_read_header: ", "unsupported cube version");
+	if (c->n_intf < 1 || c->n_scene < 1 || c->n_columns < 1 || c->n_rows < 1)
+		die("stack_cube_read_header: ", "bad cube dimensions");
+
+	c->ref = (int64_t *)malloc(c->n_intf * sizeof(int64_t));
+	c->rep = (int64_t *)malloc(c->n_intf * sizeof(int64_t));
+	c->bperp = (float *)malloc(c->n_intf * sizeof(float));
+	if (c->ref == NULL || c->rep == NULL || c->bperp == NULL)
+		die("stack_cube_read_header: ", "out of memory");
+	for (i = 0; i < c->n_intf; i++) {
+		ok &= fread(&c->ref[i], sizeof(int64_t), 1, fp) == 1;
+		ok &= fread(&c->rep[i], sizeof(int64_t), 1, fp) == 1;
+		ok &= fread(&c->bperp[i], sizeof(float), 1, fp) == 1;
+	}
+	if (!ok)
+		die("stack_cube_read_header: ", "truncated pair index");
+
+	c->scene = (int64_t *)malloc(c->n_scene * sizeof(int64_t));
+	c->days = (double *)malloc(c->n_scene * sizeof(double));
+	if (c->scene == NULL || c->days == NULL)
+		die("stack_cube_read_header: ", "out of memory");
+	for (i = 0; i < c->n_scene; i++) {
+		ok &= fread(&c->scene[i], sizeof(int64_t), 1, fp) == 1;
+		ok &= fread(&c->days[i], sizeof(double), 1, fp) == 1;
+	}
+	if (!ok)
+		die("stack_cube_read_header: ", "truncated scene index");
+
+	c->data_offset = cube_data_offset(c);
+
+	return (1);
+}
+/*------------------------------------------------------------------------*/
+void stack_cube_write_header(FILE *fp, struct STACK_CUBE *c) {
+	int64_t i;
+	int ok = 1;
+
+	c->version = STACK_CUBE_VERSION;
+	ok &= fwrite(STACK_CUBE_MAGIC, 1, 8, fp) == 8;
+	ok &= fwrite(&c->version, sizeof(int32_t), 1, fp) == 1;
+	ok &= fwrite(&c->registration, sizeof(int32_t), 1, fp) == 1;
+	ok &= fwrite(&c->n_intf, sizeof(int64_t), 1, fp) == 1;
+	ok &= fwrite(&c->n_scene, sizeof(int64_t), 1, fp) == 1;
+	ok &= fwrite(&c->n_columns, sizeof(int64_t), 1, fp) == 1;
+	ok &= fwrite(&c->n_rows, sizeof(int64_t), 1, fp) == 1;
+	ok &= fwrite(c->wesn, sizeof(double), 4, fp) == 4;
+	ok &= fwrite(c->inc, sizeof(double), 2, fp) == 2;
+	for (i = 0; i < c->n_intf; i++) {
+		ok &= fwrite(&c->ref[i], sizeof(int64_t), 1, fp) == 1;
+		ok &= fwrite(&c->rep[i], sizeof(int64_t), 1, fp) == 1;
+		ok &= fwrite(&c->bperp[i], sizeof(float), 1, fp) == 1;
+	}
+	for (i = 0; i < c->n_scene; i++) {
+		ok &= fwrite(&c->scene[i], sizeof(int64_t), 1, fp) == 1;
+		ok &= fwrite(&c->days[i], sizeof(double), 1, fp) == 1;
+	}
+	if (!ok)
+		die("stack_cube_write_header: ", "write failed");
+
+	c->data_offset = cube_data_offset(c);
+}
+/*------------------------------------------------------------------------*/
+/* a band of rows is contiguous in the file so it is one seek and one read */
+void stack_cube_read_rows(FILE *fp, struct STACK_CUBE *c, int64_t r0, int64_t nrows, float *buf) {
+	int64_t row_len;
+
+	if (r0 < 0 || r0 + nrows > c->n_rows)
+		die("stack_cube_read_rows: ", "rows outside the cube");
+	row_len = 2 * c->n_intf * c->n_columns;
+	if (cube_seek(fp, c->data_offset + r0 * row_len * (int64_t)sizeof(float), SEEK_SET))
+		die("stack_cube_read_rows: ", "seek failed");
+	if (fread(buf, sizeof(float), (size_t)(nrows * row_len), fp) != (size_t)(nrows * row_len))
+		die("stack_cube_read_rows: ", "truncated cube");
+}
+/*------------------------------------------------------------------------*/
+/* L and time are scene.tab as read by sbas, time already relative to the first scene */
+void stack_cube_check_scenes(struct STACK_CUBE *c, int64_t S, int64_t *L, double *time) {
+	int64_t i;
+
+	if (c->n_scene != S)
+		die("S and number of the SAR scenes in the stack cube don't match!", "");
+	for (i = 0; i < S; i++)
+		if (c->scene[i] != L[i] || fabs((c->days[i] - c->days[0]) - time[i]) > 1e-6)
+			die("scene.tab does not match the scenes of the stack cube", "");
+}
+/*------------------------------------------------------------------------*/
+void stack_cube_free(struct STACK_CUBE *c) {
+	if (c->ref)
+		free(c->ref);
+	if (c->rep)
+		free(c->rep);
+	if (c->bperp)
+		free(c->bperp);
+	if (c->scene)
+		free(c->scene);
+	if (c->days)
+		free(c->days);
+	c->ref = c->rep = c->scene = NULL;
+	c->bperp = NULL;
+	c->days = NULL;
+}
+/*------------------------------------------------------------------------*/
+/* phase i of pixel j in row k of the band goes to phi[i * si + j * sj + k * sk]	*/
+/* and its variance to var, flag[j + k * n_columns] is set for NaN phases;		*/
+/* buf holds the band, 2 * n_intf * n_columns * nrows floats			*/
+void stack_cube_read_ts(FILE *fp, struct STACK_CUBE *c, int64_t r0, int64_t nrows, int64_t si, int64_t sj, int64_t sk,
+                        float *buf, int64_t *flag, float *var, float *phi) {
+	int64_t i, j, k, N = c->n_intf, xdim = c->n_columns, indx;
+	float *pix;
+
+	stack_cube_read_rows(fp, c, r0, nrows, buf);
+	for (k = 0; k < nrows; k++) {
+		for (j = 0; j < xdim; j++) {
+			pix = &buf[(k * xdim + j) * 2 * N];
+			for (i = 0; i < N; i++) {
+				indx = i * si + j * sj + k * sk;
+				phi[indx] = pix[i];
+				if (isnan(pix[i]) != 0)
+					flag[j + k * xdim] = 1;
+				var[indx] = var_from_corr(pix[N + i]);
+			}
+		}
+	}
+}
+/*------------------------------------------------------------------------*/
+/* same layout for the whole cube, read a row at a time so that only one	*/
+/* row is held besides phi and var; Out is made shaped like the cube	*/
+int read_cube_data_ts(void *API, FILE *fp, struct STACK_CUBE *c, int64_t xdim, int64_t ydim, int64_t si, int64_t sj, int64_t sk,
+                      int64_t *flag, float *var, float *phi, struct GMT_GRID **Out) {
+	int64_t k;
+	float *row;
+
+	if (c->n_columns != xdim || c->n_rows != ydim)
+		die("dimension don't match!", "stack cube");
+
+	fprintf(stderr, "read phase and correlation from the stack cube ...\n");
+	if ((row = (float *)malloc((size_t)(2 * c->n_intf * xdim) * sizeof(float))) == NULL)
+		die("memory allocation!", "row");
+	for (k = 0; k < ydim; k++)
+		stack_cube_read_ts(fp, c, k, 1, si, sj, sk, row, &flag[k * xdim], &var[k * sk], &phi[k * sk]);
+	free(row);
+
+	if (*Out == NULL && (*Out = GMT_Create_Data(API, GMT_IS_GRID, GMT_IS_SURFACE, GMT_GRID_ALL, NULL, c->wesn, c->inc,
+	                                            c->registration, 0, NULL)) == NULL)
+		die("error creating output grid", "");
+	return (1);
+}
+/*------------------------------------------------------------------------*/
@@ -0,0 +1,29 @@
+/*	$Id$	*/
+/* stack cube - a list of interferogram grids stored pixel interleaved in one file */
+#ifndef STACK_CUBE_H
+#define STACK_CUBE_H
+#include <stdint.h>
+
+#define STACK_CUBE_MAGIC "GMTSARSC" /* first 8 bytes of every cube */
+#define STACK_CUBE_VERSION 2
+
+/* the file is this header, then ref, rep and bperp of each interferogram,	*/
+/* then id and days of each scene as in scene.tab, then the rows top to	*/
+/* bottom; each pixel of a row holds the n_intf phases followed by the	*/
+/* n_intf correlations as floats					*/
+struct STACK_CUBE {
+	int32_t version;      /* STACK_CUBE_VERSION */
+	int32_t registration; /* GMT_GRID_NODE_REG or GMT_GRID_PIXEL_REG */
+	int64_t n_intf;       /* number of interferograms */
+	int64_t n_scene;      /* number of SAR scenes */
+	int64_t n_columns;    /* pixels per row */
+	int64_t n_rows;       /* rows in the cube */
+	double wesn[4];       /* region of the grids */
+	double inc[2];        /* grid spacing */
+	int64_t *ref, *rep;   /* scene ids of each pair (n_intf) */
+	float *bperp;         /* perpendicular baseline of each pair (n_intf) */
+	int64_t *scene;       /* scene ids (n_scene) */
+	double *days;         /* acquisition date of each scene in days, as in scene.tab (n_scene) */
+	int64_t data_offset;  /* byte offset of the first row */
+};
+#endif /* STACK_CUBE_H */
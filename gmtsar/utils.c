@@ -131,3 +131,36 @@ int geo2latlon(double *x, double *llt, struct PRM r) {
 	return (EXIT_SUCCESS);
 }
 /*-----------------------------------------------------------------------*/
+/* read rows r0 to r0+nrows-1 of grid name, whose full header is h, into buf */
+int read_grid_rows(void *API, char *name, struct GMT_GRID_HEADER *h, int64_t r0, int64_t nrows, float *buf) {
+	double wesn[4];
+	struct GMT_GRID *G = NULL;
+
+	/* region from the top of row r0 to the bottom of the last row */
+	wesn[GMT_XLO] = h->wesn[GMT_XLO];
+	wesn[GMT_XHI] = h->wesn[GMT_XHI];
+	wesn[GMT_YHI] = h->wesn[GMT_YHI] - r0 * h->inc[GMT_Y];
+	wesn[GMT_YLO] = h->wesn[GMT_YHI] - (r0 + nrows - 1 + h->registration) * h->inc[GMT_Y];
+
+	if ((G = GMT_Read_Data(API, GMT_IS_GRID, GMT_IS_FILE, GMT_IS_SURFACE, GMT_GRID_ALL, wesn, name, NULL)) == NULL)
+		die("Can't read ", name);
+	if (G->header->n_columns != h->n_columns || G->header->n_rows != nrows)
+		die("unexpected number of rows read from ", name);
+	memcpy(buf, G->data, (size_t)nrows * h->n_columns * sizeof(float));
+	if (GMT_Destroy_Data(API, &G))
+		die("error freeing data", name);
+
+	return (1);
+}
+/*-----------------------------------------------------------------------*/
+/* phase variance from correlation, Rosen et al., 2000 IEEE */
+float var_from_corr(float c) {
+
+	if (c >= 1e-2 && c <= 0.99)
+		return ((float)sqrt((1.0 - c * c) / (c * c)));
+	else if (c < 1e-2)
+		return (99.99);
+	else
+		return (0.1);
+}
+/*-----------------------------------------------------------------------*/
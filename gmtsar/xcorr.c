@@ -29,6 +29,9 @@
 
 /*-------------------------------------------------------*/
 #include "gmtsar.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 char *USAGE = "xcorr [GMTSAR] - Compute 2-D cross-correlation of two images\n\n"
               "\nUsage: xcorr master.PRM aligned.PRM [-time] [-real] [-freq] [-nx n] [-ny "
@@ -52,20 +55,26 @@ char *USAGE = "xcorr [GMTSAR] - Compute 2-D cross-correlation of two images\n\n"
               "(int power of 2 [32 64 128 256])\n"
               "-interp  factor    	interpolate correlation function by factor "
               "(int) [default, 16]\n"
+              "-nthreads n		correlate n rows of locations in parallel [default: 1]\n"
+              "-batch			aligned.PRM is a list of aligned PRM files, one per line,\n"
+              "			each optionally followed by its output file; master patches\n"
+              "			are read and transformed once for all of them\n"
               "-v			verbose\n"
               "output: \n freq_xcorr.dat (default) \n time_xcorr.dat (if -time option))\n"
+              " freq_xcorr_<aligned>.dat for each aligned image (if -batch option)\n"
               "\nuse fitoffset.csh to convert output to PRM format\n"
               "\nExample:\n"
               "xcorr IMG-HH-ALPSRP075880660-H1.0__A.PRM "
               "IMG-HH-ALPSRP129560660-H1.0__A.PRM -nx 20 -ny 50 \n"
-              "xcorr file1.grd file2.grd -nx 20 -ny 50 (takes grids with real numbers)\n";
+              "xcorr file1.grd file2.grd -nx 20 -ny 50 (takes grids with real numbers)\n"
+              "xcorr S1_20150526_F1.PRM aligned.list -batch -nx 20 -ny 50 -nthreads 8\n";
 
 /*-------------------------------------------------------------------------------*/
-int do_range_interpolate(void *API, struct FCOMPLEX *c, int nx, int ri, struct FCOMPLEX *work) {
+int do_range_interpolate(void *API, struct xcorr *xc, struct FCOMPLEX *c, int nx, int ri, struct FCOMPLEX *work) {
 	int i;
 
 	/* interpolate c and put into work */
-	fft_interpolate_1d(API, c, nx, work, ri);
+	fft_interpolate_1d_plan(API, xc->fx, xc->iri, c, nx, work, ri);
 
 	/* replace original with interpolated (only half) */
 	for (i = 0; i < nx; i++) {
@@ -76,129 +85,274 @@ int do_range_interpolate(void *API, struct FCOMPLEX *c, int nx, int ri, struct F
 	return (EXIT_SUCCESS);
 }
 /*-------------------------------------------------------------------------------*/
-/* complex arrays used in fft correlation */
-/* load complex arrays and mask out aligned */
-/* c1 is master */
-/* c2 is aligned */
-/* c3 used in fft complex correlation */
-/* c1, c2, and c3 are npy by npx */
-/* d1, d2 are npy by nx (length of line in SLC) */
+/* load one npy by npx patch starting at column x0 of the strip d (nx wide)	*/
+/* into c, range interpolate, convert to demeaned amplitude and optionally	*/
+/* mask it; ic gets the integer version used by the time correlation	*/
 /*-------------------------------------------------------------------------------*/
-void assign_values(void *API, struct xcorr *xc, int iloc) {
-	int i, j, k, sx, mx;
-	double mean1, mean2;
-
-	/* master and aligned x offsets */
-	mx = xc->loc[iloc].x - xc->npx / 2;
-	sx = xc->loc[iloc].x + xc->x_offset - xc->npx / 2;
+void assign_patch(void *API, struct xcorr *xc, struct FCOMPLEX *d, int nx, int x0, struct FCOMPLEX *c, int *ic, short *mask) {
+	int i, j, k;
+	double mean;
 
 	for (i = 0; i < xc->npy; i++) {
 		for (j = 0; j < xc->npx; j++) {
 			k = i * xc->npx + j;
-
-			xc->c3[k].i = xc->c3[k].r = 0.0f;
-
-			xc->c1[k].r = xc->d1[i * xc->m_nx + mx + j].r;
-			xc->c1[k].i = xc->d1[i * xc->m_nx + mx + j].i;
-
-			xc->c2[k].r = xc->d2[i * xc->s_nx + sx + j].r;
-			xc->c2[k].i = xc->d2[i * xc->s_nx + sx + j].i;
+			c[k].r = d[i * nx + x0 + j].r;
+			c[k].i = d[i * nx + x0 + j].i;
 		}
 	}
 
 	/* range interpolate */
 	if (xc->ri > 1) {
-		for (i = 0; i < xc->npy; i++) {
-			do_range_interpolate(API, &xc->c1[i * xc->npx], xc->npx, xc->ri, xc->ritmp);
-			do_range_interpolate(API, &xc->c2[i * xc->npx], xc->npx, xc->ri, xc->ritmp);
-		}
+		for (i = 0; i < xc->npy; i++)
+			do_range_interpolate(API, xc, &c[i * xc->npx], xc->npx, xc->ri, xc->ritmp);
 	}
 
 	/* convert to amplitude and demean */
-	mean1 = mean2 = 0.0;
+	mean = 0.0;
 	for (i = 0; i < xc->npy * xc->npx; i++) {
-		xc->c1[i].r = Cabs(xc->c1[i]);
-		xc->c1[i].i = 0.0f;
-
-		xc->c2[i].r = Cabs(xc->c2[i]);
-		xc->c2[i].i = 0.0f;
-
-		mean1 += xc->c1[i].r;
-		mean2 += xc->c2[i].r;
+		c[i].r = Cabs(c[i]);
+		c[i].i = 0.0f;
+		mean += c[i].r;
 	}
 
-	mean1 /= (double)(xc->npy * xc->npx);
-	mean2 /= (double)(xc->npy * xc->npx);
+	mean /= (double)(xc->npy * xc->npx);
 
-	for (i = 0; i < xc->npy * xc->npx; i++) {
-		xc->c1[i].r = xc->c1[i].r - (float)mean1;
-		xc->c2[i].r = xc->c2[i].r - (float)mean2;
-	}
+	for (i = 0; i < xc->npy * xc->npx; i++)
+		c[i].r = c[i].r - (float)mean;
 
 	/* apply mask */
 	for (i = 0; i < xc->npy * xc->npx; i++) {
-		xc->c1[i].i = xc->c2[i].i = 0.0f;
-		xc->c2[i].r = xc->c2[i].r * (float)xc->mask[i];
-
-		xc->i1[i] = (int)(xc->c1[i].r);
-		xc->i2[i] = (int)(xc->c2[i].r);
+		if (mask)
+			c[i].r = c[i].r * (float)mask[i];
+		ic[i] = (int)(c[i].r);
 	}
 
 	if (debug)
-		fprintf(stderr, " mean %lf\n", mean1);
-	if (debug)
-		fprintf(stderr, " mean %lf\n", mean2);
+		fprintf(stderr, " mean %lf\n", mean);
 }
 /*-------------------------------------------------------------------------------*/
-void do_correlation(void *API, struct xcorr *xc) {
-	int i, j, iloc, istep;
+/* complex arrays used in fft correlation */
+/* load complex arrays and mask out aligned */
+/* c1 is master */
+/* c2 is aligned */
+/* c3 used in fft complex correlation */
+/* c1, c2, and c3 are npy by npx */
+/* d1, d2 are npy by nx (length of line in SLC) */
+/*-------------------------------------------------------------------------------*/
+void assign_master(void *API, struct xcorr *xc, int iloc) {
+	assign_patch(API, xc, xc->d1, xc->m_nx, xc->loc[iloc].x - xc->npx / 2, xc->c1, xc->i1, NULL);
+}
+void assign_aligned(void *API, struct xcorr *xc, int iloc) {
+	assign_patch(API, xc, xc->d2, xc->s_nx, xc->loc[iloc].x + xc->x_offset - xc->npx / 2, xc->c2, xc->i2, xc->mask);
+}
+void assign_values(void *API, struct xcorr *xc, int iloc) {
+	assign_master(API, xc, iloc);
+	assign_aligned(API, xc, iloc);
+}
+/*-------------------------------------------------------------------------------*/
+/* correlate one row of locations using the workspace in xc */
+void correlate_row(void *API, struct xcorr *xc, int irow) {
+	int j, iloc;
 
-	/* opportunity for multiple processors */
-	istep = 1;
+	iloc = irow * xc->nxl;
 
-	/* allocate arrays   			*/
-	allocate_arrays(xc);
+	/* read in data for each row */
+	read_xcorr_data(xc, iloc);
 
-	/* make mask 				*/
-	make_mask(xc);
+	for (j = 0; j < xc->nxl; j++, iloc++) {
 
-	iloc = 0;
-	for (i = 0; i < xc->nyl; i += istep) {
+		if (debug)
+			fprintf(stderr, " initial: iloc %d (%d,%d)\n", iloc, xc->loc[iloc].x, xc->loc[iloc].y);
 
-		/* read in data for each row */
-		read_xcorr_data(xc, iloc);
+		/* copy values from d1,d2 (real) to c1,c2 (complex) */
+		assign_values(API, xc, iloc);
 
-		for (j = 0; j < xc->nxl; j++) {
+		if (debug)
+			print_complex(xc->c1, xc->npy, xc->npx, 1);
+		if (debug)
+			print_complex(xc->c2, xc->npy, xc->npx, 1);
 
-			if (debug)
-				fprintf(stderr, " initial: iloc %d (%d,%d)\n", iloc, xc->loc[iloc].x, xc->loc[iloc].y);
+		/* correlate patch with data over offsets in time domain */
+		if (xc->corr_flag < 2)
+			do_time_corr(xc, iloc);
 
-			/* copy values from d1,d2 (real) to c1,c2 (complex) */
-			assign_values(API, xc, iloc);
+		/* correlate patch with data over offsets in freq domain */
+		if (xc->corr_flag == 2)
+			do_freq_corr(API, xc, iloc);
 
-			if (debug)
-				print_complex(xc->c1, xc->npy, xc->npx, 1);
-			if (debug)
-				print_complex(xc->c2, xc->npy, xc->npx, 1);
+		/* oversample correlation surface  to obtain sub-pixel resolution */
+		if (xc->interp_flag == 1)
+			do_highres_corr(API, xc, iloc);
+	} /* end of x iloc loop */
+}
+/*-------------------------------------------------------------------------------*/
+/* batch mode: the master patches of the row are read, interpolated and fft'd	*/
+/* once and then correlated against the same row of every aligned image	*/
+/*-------------------------------------------------------------------------------*/
+void correlate_row_batch(void *API, struct xcorr *xc, int irow) {
+	int j, k, n, iloc0;
+	struct FCOMPLEX *c1, *d2;
+	int *i1;
+	struct locs *loc;
+	struct xcorr_pair *p;
+
+	n = xc->npx * xc->npy;
+	iloc0 = irow * xc->nxl;
+
+	/* keep the workspace pointers, c1 and i1 point into ms and mi below */
+	c1 = xc->c1;
+	d2 = xc->d2;
+	i1 = xc->i1;
+	loc = xc->loc;
+
+	read_xcorr_master(xc, iloc0);
+
+	for (j = 0; j < xc->nxl; j++) {
+		xc->c1 = &xc->ms[j * n];
+		xc->i1 = &xc->mi[j * n];
+		assign_master(API, xc, iloc0 + j);
+		if (xc->corr_flag == 2)
+			fft_plan_2d(API, xc->fx, xc->fy, xc->c1, xc->npx, xc->npy);
+	}
+	xc->master_fft = (xc->corr_flag == 2);
+
+	for (k = 0; k < xc->npairs; k++) {
+		p = &xc->pair[k];
+
+		/* each pair keeps its own file and strip, which slides down */
+		/* with the rows of this worker as in the single pair mode	*/
+		xc->data2 = xc->pair_data2[k];
+		xc->d2 = xc->pair_d2[k];
+		xc->iy2 = xc->pair_iy2[k];
+		xc->s_nx = p->s_nx;
+		xc->s_ny = p->s_ny;
+		xc->x_offset = p->x_offset;
+		xc->y_offset = p->y_offset;
+		xc->astretcha = p->astretcha;
+		xc->loc = p->loc;
+
+		read_xcorr_aligned(xc, iloc0);
+		xc->pair_iy2[k] = xc->iy2;
+
+		for (j = 0; j < xc->nxl; j++) {
+			xc->c1 = &xc->ms[j * n];
+			xc->i1 = &xc->mi[j * n];
+
+			assign_aligned(API, xc, iloc0 + j);
 
-			/* correlate patch with data over offsets in time domain */
 			if (xc->corr_flag < 2)
-				do_time_corr(xc, iloc);
+				do_time_corr(xc, iloc0 + j);
 
-			/* correlate patch with data over offsets in freq domain */
 			if (xc->corr_flag == 2)
-				do_freq_corr(API, xc, iloc);
+				do_freq_corr(API, xc, iloc0 + j);
 
-			/* oversample correlation surface  to obtain sub-pixel resolution */
 			if (xc->interp_flag == 1)
-				do_highres_corr(API, xc, iloc);
+				do_highres_corr(API, xc, iloc0 + j);
+		}
+	}
 
-			/* write out results */
-			print_results(xc, iloc);
+	xc->master_fft = 0;
+	xc->data2 = NULL;
+	xc->c1 = c1;
+	xc->d2 = d2;
+	xc->i1 = i1;
+	xc->loc = loc;
+}
+/*-------------------------------------------------------------------------------*/
+/* write the offsets of every pair of a batch run to their own files */
+void print_batch_results(struct xcorr *xc) {
+	int k, iloc;
+	struct xcorr out;
+	struct xcorr_pair *p;
+
+	for (k = 0; k < xc->npairs; k++) {
+		p = &xc->pair[k];
+		out = *xc;
+		out.x_offset = p->x_offset;
+		out.y_offset = p->y_offset;
+		out.astretcha = p->astretcha;
+		out.loc = p->loc;
+		if ((out.file = fopen(p->filename, "w")) == NULL)
+			die("Can't open output file", p->filename);
+		for (iloc = 0; iloc < xc->nlocs; iloc++)
+			print_results(&out, iloc);
+		fclose(out.file);
+	}
+}
+/*-------------------------------------------------------------------------------*/
+/* rows of locations are handed out to nthreads workers; each worker has its	*/
+/* own copy of xc with private patch arrays, fft plans and file handles	*/
+/* workers get consecutive rows so their SLC strips overlap from row to row	*/
+/* results go into xc->loc and are written in row order			*/
+/*-------------------------------------------------------------------------------*/
+void do_correlation(void *API, struct xcorr *xc) {
+	int i, j, k, t, nthreads;
+	struct xcorr *work;
+
+	nthreads = MAX(1, MIN(xc->nthreads, xc->nyl));
+#ifndef _OPENMP
+	nthreads = 1;
+#endif
+
+	/* allocate arrays and make mask for each worker */
+	work = (struct xcorr *)malloc(nthreads * sizeof(struct xcorr));
+	for (t = 0; t < nthreads; t++) {
+		work[t] = *xc;
+		allocate_arrays(&work[t]);
+		make_mask(&work[t]);
+
+		/* shared FILE positions cannot be used by several readers */
+		/* in batch mode every worker opens every aligned file once */
+		if (t > 0 && (xc->format == 0 || xc->format == 1)) {
+			if ((work[t].data1 = fopen(xc->data1_name, "r")) == NULL)
+				die("Cannot open SLC_file", xc->data1_name);
+			if (!xc->batch && (work[t].data2 = fopen(xc->data2_name, "r")) == NULL)
+				die("Cannot open SLC_file", xc->data2_name);
+		}
+		for (k = 0; xc->batch && k < xc->npairs; k++)
+			if ((work[t].pair_data2[k] = fopen(xc->pair[k].data2_name, "r")) == NULL)
+				die("Cannot open SLC_file", xc->pair[k].data2_name);
+	}
 
-			iloc++;
-		} /* end of x iloc loop */
-	}     /* end of y iloc loop */
+	if (verbose && nthreads > 1)
+		fprintf(stderr, " correlating %d rows of locations on %d threads\n", xc->nyl, nthreads);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(nthreads) private(t)
+#endif
+	for (i = 0; i < xc->nyl; i++) {
+#ifdef _OPENMP
+		t = omp_get_thread_num();
+#else
+		t = 0;
+#endif
+		if (xc->batch)
+			correlate_row_batch(API, &work[t], i);
+		else
+			correlate_row(API, &work[t], i);
+	} /* end of y iloc loop */
+
+	/* write out results */
+	if (xc->batch) {
+		print_batch_results(xc);
+	}
+	else {
+		for (i = 0; i < xc->nyl; i++)
+			for (j = 0; j < xc->nxl; j++)
+				print_results(xc, i * xc->nxl + j);
+	}
+
+	for (t = 0; t < nthreads; t++) {
+		if (t > 0 && (xc->format == 0 || xc->format == 1)) {
+			fclose(work[t].data1);
+			if (!xc->batch)
+				fclose(work[t].data2);
+		}
+		for (k = 0; xc->batch && k < xc->npairs; k++)
+			fclose(work[t].pair_data2[k]);
+		free_arrays(&work[t]);
+	}
+	free(work);
 }
 /*-------------------------------------------------------------------------------*/
 /* want to avoid circular correlation so mask out most of b */
@@ -222,7 +376,7 @@ void make_mask(struct xcorr *xc) {
 }
 /*-------------------------------------------------------------------------------*/
 void allocate_arrays(struct xcorr *xc) {
-	int nx, ny, nx_exp, ny_exp;
+	int k, nx, ny, nx_exp, ny_exp;
 
 	xc->d1 = (struct FCOMPLEX *)malloc(xc->m_nx * xc->npy * sizeof(struct FCOMPLEX));
 	xc->d2 = (struct FCOMPLEX *)malloc(xc->s_nx * xc->npy * sizeof(struct FCOMPLEX));
@@ -234,6 +388,27 @@ void allocate_arrays(struct xcorr *xc) {
 	xc->c2 = (struct FCOMPLEX *)malloc(xc->npx * xc->npy * sizeof(struct FCOMPLEX));
 	xc->c3 = (struct FCOMPLEX *)malloc(xc->npx * xc->npy * sizeof(struct FCOMPLEX));
 
+	/* d1, d2 hold no SLC lines yet; line1, line2 take one raw line */
+	xc->iy1 = xc->iy2 = NO_STRIP;
+	xc->line1 = malloc(2 * xc->m_nx * sizeof(float));
+	xc->line2 = malloc(2 * xc->s_nx * sizeof(float));
+
+	/* master patches of a whole row and a strip of every aligned */
+	/* image are kept in batch mode; the files are opened by the	*/
+	/* caller								*/
+	if (xc->batch) {
+		xc->ms = (struct FCOMPLEX *)malloc((int64_t)xc->nxl * xc->npx * xc->npy * sizeof(struct FCOMPLEX));
+		xc->mi = (int *)malloc((int64_t)xc->nxl * xc->npx * xc->npy * sizeof(int));
+		xc->pair_data2 = (FILE **)malloc(xc->npairs * sizeof(FILE *));
+		xc->pair_d2 = (struct FCOMPLEX **)malloc(xc->npairs * sizeof(struct FCOMPLEX *));
+		xc->pair_iy2 = (int *)malloc(xc->npairs * sizeof(int));
+		for (k = 0; k < xc->npairs; k++) {
+			xc->pair_data2[k] = NULL;
+			xc->pair_d2[k] = (struct FCOMPLEX *)malloc((int64_t)xc->pair[k].s_nx * xc->npy * sizeof(struct FCOMPLEX));
+			xc->pair_iy2[k] = NO_STRIP;
+		}
+	}
+
 	xc->ritmp = (struct FCOMPLEX *)malloc(xc->ri * xc->npx * sizeof(struct FCOMPLEX));
 	xc->mask = (short *)malloc(xc->npx * xc->npy * sizeof(short));
 
@@ -248,13 +423,67 @@ void allocate_arrays(struct xcorr *xc) {
 		xc->md = (struct FCOMPLEX *)malloc(nx * ny * sizeof(struct FCOMPLEX));
 		xc->cd_exp = (struct FCOMPLEX *)malloc(nx_exp * ny_exp * sizeof(struct FCOMPLEX));
 	}
+
+	/* fft plans for correlation, range interpolation and sub-pixel interpolation */
+	/* these come from the shared cache so all workers use the same plans */
+	xc->fx = fft_plan_get(xc->npx, GMT_FFT_FWD);
+	xc->ix = fft_plan_get(xc->npx, GMT_FFT_INV);
+	xc->fy = fft_plan_get(xc->npy, GMT_FFT_FWD);
+	xc->iy = fft_plan_get(xc->npy, GMT_FFT_INV);
+	xc->iri = fft_plan_get(xc->ri * xc->npx, GMT_FFT_INV);
+	xc->fhx = fft_plan_get(xc->n2x, GMT_FFT_FWD);
+	xc->ihx = fft_plan_get(xc->n2x * xc->interp_factor, GMT_FFT_INV);
+	xc->fhy = fft_plan_get(xc->n2y, GMT_FFT_FWD);
+	xc->ihy = fft_plan_get(xc->n2y * xc->interp_factor, GMT_FFT_INV);
+}
+/*-------------------------------------------------------------------------------*/
+void free_arrays(struct xcorr *xc) {
+	int k;
+
+	free(xc->d1);
+	free(xc->d2);
+	free(xc->line1);
+	free(xc->line2);
+	free(xc->i1);
+	free(xc->i2);
+	free(xc->c1);
+	free(xc->c2);
+	free(xc->c3);
+	free(xc->ritmp);
+	if (xc->batch) {
+		free(xc->ms);
+		free(xc->mi);
+		for (k = 0; k < xc->npairs; k++)
+			free(xc->pair_d2[k]);
+		free(xc->pair_d2);
+		free(xc->pair_data2);
+		free(xc->pair_iy2);
+	}
+	free(xc->mask);
+	free(xc->corr);
+
+	if (xc->interp_flag == 1) {
+		free(xc->md);
+		free(xc->cd_exp);
+	}
+
+	fft_plan_destroy(xc->fx);
+	fft_plan_destroy(xc->ix);
+	fft_plan_destroy(xc->fy);
+	fft_plan_destroy(xc->iy);
+	fft_plan_destroy(xc->iri);
+	fft_plan_destroy(xc->fhx);
+	fft_plan_destroy(xc->ihx);
+	fft_plan_destroy(xc->fhy);
+	fft_plan_destroy(xc->ihy);
 }
 
 /*-------------------------------------------------------*/
 int main(int argc, char **argv) {
-	int input_flag, nfiles;
+	int i, input_flag, nfiles;
 	struct xcorr *xc;
 	clock_t start, end;
+	time_t wall_start;
 	double cpu_time;
 	void *API = NULL; /* GMT API control structure */
 
@@ -279,7 +508,9 @@ int main(int argc, char **argv) {
 	parse_command_line(argc, argv, xc, &nfiles, &input_flag, USAGE);
 
 	/* read prm files */
-	if (input_flag == 0)
+	if (xc->batch)
+		handle_batch_prm(API, argv, xc);
+	else if (input_flag == 0)
 		handle_prm(API, argv, xc, nfiles);
 
 	if (debug)
@@ -293,15 +524,25 @@ int main(int argc, char **argv) {
 	if (xc->corr_flag == 2)
 		strcpy(xc->filename, "freq_xcorr.dat");
 
-	xc->file = fopen(xc->filename, "w");
-	if (xc->file == NULL)
-		die("Can't open output file", xc->filename);
+	/* batch mode writes one file per pair */
+	if (!xc->batch) {
+		xc->file = fopen(xc->filename, "w");
+		if (xc->file == NULL)
+			die("Can't open output file", xc->filename);
+	}
 
 	/* x locations, y locations */
 	get_locations(xc);
 
+	for (i = 0; i < xc->npairs; i++) {
+		xc->pair[i].loc = malloc(xc->nyl * (xc->nxl + 1) * sizeof(struct locs));
+		memcpy(xc->pair[i].loc, xc->loc, xc->nlocs * sizeof(struct locs));
+	}
+
 	/* calculate correlation at all points */
+	/* clock() adds up cpu time of all threads so use wall time as well */
 	start = clock();
+	wall_start = time(NULL);
 
 	do_correlation(API, xc);
 
@@ -313,11 +554,16 @@ int main(int argc, char **argv) {
 	end = clock();
 	cpu_time = ((double)(end - start)) / CLOCKS_PER_SEC;
 	fprintf(stdout, " elapsed time: %lf \n", cpu_time);
+	if (xc->nthreads > 1)
+		fprintf(stdout, " wall clock time: %.0lf \n", difftime(time(NULL), wall_start));
 
         if (xc->format == 0 || xc->format == 1) {
           fclose(xc->data1);
-          fclose(xc->data2);
+          if (!xc->batch)
+            fclose(xc->data2);
         }
+        if (!xc->batch)
+          fclose(xc->file);
 
 	if (GMT_Destroy_Session(API))
 		return EXIT_FAILURE; /* Remove the GMT machinery */
@@ -2,6 +2,7 @@
 #ifndef XCORR_H
 #define XCORR_H
 #include <stdio.h>
+#define NO_STRIP -2147483647 /* d1/d2 strip holds no lines */
 struct locs {
 	int x;       /* x pixel location */
 	int y;       /* y pixel location */
@@ -15,6 +16,18 @@ struct locs {
 	int m2;      /* mean value */
 };
 
+struct xcorr_pair {          /* one aligned image of a batch run */
+	char prm_name[128];      /* PRM file of aligned image */
+	char data2_name[128];    /* SLC file of aligned image */
+	char filename[128];      /* output file (offsets) */
+	int s_nx;                /* x size of aligned file */
+	int s_ny;                /* y size of aligned file */
+	int x_offset;            /* intial starting offset in x */
+	int y_offset;            /* intial starting offset in y */
+	double astretcha;        /* azimuth stretch parameter */
+	struct locs *loc;        /* results for this pair */
+};
+
 struct xcorr {
 	int format;              /* type of input data [0 short complex, 1 real float, 3 real grd]
 	                          */
@@ -43,6 +56,16 @@ struct xcorr {
 	int x_inc;               /* x distance between locations */
 	int y_inc;               /* y distance between locations */
 	int ri;                  /* range interpolation factor (must be power of two) */
+	int nthreads;            /* number of rows of locations correlated at once */
+	int batch;               /* 1 = correlate master against a list of aligned images */
+	int npairs;              /* number of aligned images in batch mode */
+	struct xcorr_pair *pair; /* aligned images in batch mode */
+	FILE **pair_data2;       /* batch mode: aligned file of each pair */
+	struct FCOMPLEX **pair_d2; /* batch mode: aligned strip (d2) of each pair */
+	int *pair_iy2;           /* batch mode: first line held in each pair strip */
+	int master_fft;          /* 1 if c1 already holds the master spectrum */
+	struct FCOMPLEX *ms;     /* master patches (spectra) of one row of locations */
+	int *mi;                 /* master patches (integer) of one row of locations */
 	short *mask;             /* mask file (short integer) */
 	int *i1;                 /* data matrix 1 (integer) */
 	int *i2;                 /* data matrix 2 (integer) */
@@ -50,6 +73,10 @@ struct xcorr {
 	int n2y;                 /* size of interpolation */
 	struct FCOMPLEX *d1;     /* data 1 (amplitude in real, imag = 0)*/
 	struct FCOMPLEX *d2;     /* data 2 (amplitude in real, imag = 0)*/
+	int iy1;                 /* first master line held in d1 */
+	int iy2;                 /* first aligned line held in d2 */
+	void *line1;             /* one raw line of master (short or float) */
+	void *line2;             /* one raw line of aligned (short or float) */
 	struct FCOMPLEX *c1;     /* subset data patch 1 (complex float) */
 	struct FCOMPLEX *c2;     /* subset data patch 2 (complex float) */
 	struct FCOMPLEX *c3;     /* c1 * c2 (complex float) */
@@ -62,6 +89,15 @@ struct xcorr {
 	struct FCOMPLEX *sd_exp; /* interpolation file */
 	struct FCOMPLEX *cd_exp; /* interpolation file */
 	double *interp_corr;     /* interpolation file */
+	struct FFT_PLAN *fx;     /* forward fft along patch rows (npx) */
+	struct FFT_PLAN *ix;     /* inverse fft along patch rows (npx) */
+	struct FFT_PLAN *fy;     /* forward fft along patch columns (npy) */
+	struct FFT_PLAN *iy;     /* inverse fft along patch columns (npy) */
+	struct FFT_PLAN *iri;    /* inverse fft for range interpolation (ri*npx) */
+	struct FFT_PLAN *fhx;    /* forward fft for correlation interpolation (n2x) */
+	struct FFT_PLAN *ihx;    /* inverse fft for correlation interpolation (n2x*interp_factor) */
+	struct FFT_PLAN *fhy;    /* forward fft for correlation interpolation (n2y) */
+	struct FFT_PLAN *ihy;    /* inverse fft for correlation interpolation (n2y*interp_factor) */
 	FILE *data1;             /* data file 1 */
 	FILE *data2;             /* data file 2 */
 	FILE *param;             /* input parameters file */
@@ -0,0 +1,94 @@
+/*	$Id$	*/
+/*--------------------------------------------------------------------------------------*/
+/* zero Doppler time of a target by Newton iterations on the range rate		*/
+/*											*/
+/* zero_doppler_newton(orb_pos, nsamp, ts, xp, tm, rng)					*/
+/*											*/
+/*	orb_pos	t, x, y, z of the orbit sampled every ts seconds (sat_orbit.h)	*/
+/*	nsamp	number of orbit samples							*/
+/*	xp	target position								*/
+/*	tm	input: starting time, output: time of closest approach			*/
+/*	rng	output: range at tm							*/
+/*											*/
+/*	returns the orbit sample closest to the target, or -1 when the iterations	*/
+/*	leave the orbit or do not converge; the caller then falls back to goldop	*/
+/*											*/
+/* orbit_table_state(orb_pos, nsamp, ts, t, s, v, a)					*/
+/*											*/
+/*	position, velocity and acceleration at t from the same samples, returns 0	*/
+/*	outside of them									*/
+/*											*/
+/*	the orbit between samples is a cubic through the four nearest samples so	*/
+/*	position, velocity and acceleration are all continuous enough for Newton	*/
+/*	to converge in two or three steps from a neighbouring point's solution		*/
+/*--------------------------------------------------------------------------------------*/
+#include "gmtsar.h"
+
+#define ZD_MAXIT 10
+#define ZD_TOL 1.e-9 /* seconds */
+
+/*------------------------------------------------------------------------*/
+int orbit_table_state(double **orb_pos, int nsamp, double ts, double t, double *s, double *v, double *a) {
+	int i, k;
+	double u, d0, d1, d2, c1, c2, c3;
+
+	u = (t - orb_pos[0][0]) / ts;
+	i = (int)floor(u);
+	if (i < 1 || i > nsamp - 3)
+		return (0);
+	u -= i;
+
+	for (k = 0; k < 3; k++) {
+		/* work with first differences, the positions themselves are ~7e6 m */
+		d0 = orb_pos[k + 1][i] - orb_pos[k + 1][i - 1];
+		d1 = orb_pos[k + 1][i + 1] - orb_pos[k + 1][i];
+		d2 = orb_pos[k + 1][i + 2] - orb_pos[k + 1][i + 1];
+		c1 = (2. * d0 + 5. * d1 - d2) / 6.;
+		c2 = 0.5 * (d1 - d0);
+		c3 = (d0 - 2. * d1 + d2) / 6.;
+		s[k] = orb_pos[k + 1][i] + u * (c1 + u * (c2 + u * c3));
+		v[k] = (c1 + u * (2. * c2 + 3. * u * c3)) / ts;
+		a[k] = (2. * c2 + 6. * u * c3) / (ts * ts);
+	}
+
+	return (1);
+}
+/*------------------------------------------------------------------------*/
+int zero_doppler_newton(double **orb_pos, int nsamp, double ts, double *xp, double *tm, double *rng) {
+	int k, it, i;
+	double t, dt, f, fp, d[3], s[3], v[3], a[3], r0, r1;
+
+	t = *tm;
+	for (it = 0; it < ZD_MAXIT; it++) {
+		if (!orbit_table_state(orb_pos, nsamp, ts, t, s, v, a))
+			return (-1);
+		f = fp = 0.;
+		for (k = 0; k < 3; k++) {
+			d[k] = s[k] - xp[k];
+			f += d[k] * v[k];
+			fp += v[k] * v[k] + d[k] * a[k];
+		}
+		if (fp <= 0.)
+			return (-1);
+		dt = f / fp;
+		t -= dt;
+		if (fabs(dt) < ZD_TOL)
+			break;
+	}
+	if (it == ZD_MAXIT || !orbit_table_state(orb_pos, nsamp, ts, t, s, v, a))
+		return (-1);
+
+	*tm = t;
+	*rng = sqrt((s[0] - xp[0]) * (s[0] - xp[0]) + (s[1] - xp[1]) * (s[1] - xp[1]) + (s[2] - xp[2]) * (s[2] - xp[2]));
+
+	/* the closer of the two samples around tm */
+	i = (int)floor((t - orb_pos[0][0]) / ts);
+	r0 = r1 = 0.;
+	for (k = 0; k < 3; k++) {
+		r0 += (orb_pos[k + 1][i] - xp[k]) * (orb_pos[k + 1][i] - xp[k]);
+		r1 += (orb_pos[k + 1][i + 1] - xp[k]) * (orb_pos[k + 1][i + 1] - xp[k]);
+	}
+
+	return (r1 < r0 ? i + 1 : i);
+}
+/*------------------------------------------------------------------------*/
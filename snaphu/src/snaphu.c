@@ -8,6 +8,11 @@
 
 *************************************************************************/
 
+/* declare POSIX functions (memory streams, gethostname) under -std=c99 */
+#ifndef _WIN32
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -32,6 +37,7 @@
 #	define pid_t int
 #else
 #	include <sys/wait.h>
+#	include <time.h>
 #	include <sys/time.h>
 #	include <sys/resource.h>
 #endif
@@ -70,8 +76,16 @@ static
 int Unwrap(infileT *infiles, outfileT *outfiles, paramT *params, 
            long linelen, long nlines);
 static
+int UnwrapMaskedRegions(infileT *infiles, outfileT *outfiles, paramT *params,
+                        tileparamT *tileparams, long nlines, long linelen);
+static
 int UnwrapTile(infileT *infiles, outfileT *outfiles, paramT *params, 
                 tileparamT *tileparams, long nlines, long linelen);
+#ifdef TILETHREADS
+static
+int UnwrapTilesThreaded(infileT *infiles, outfileT *outfiles, paramT *params,
+                        signed char **dotilemask, long nlines, long linelen);
+#endif
 
 
 
@@ -112,6 +126,9 @@ int main(int argc, char **argv){
   /* set names of dump files if necessary */
   SetDumpAll(outfiles,params);
 
+  /* read GMT grid inputs into memory and set up grid outputs */
+  ReadGridFiles(infiles,outfiles,&linelen,params);
+
   /* get number of lines in file */
   nlines=GetNLines(infiles,linelen,params);
 
@@ -123,6 +140,9 @@ int main(int argc, char **argv){
 
   /* unwrap, forming tiles and reassembling if necessary */
   Unwrap(infiles,outfiles,params,linelen,nlines);
+
+  /* write GMT grid outputs */
+  WriteGridFiles(infiles,outfiles,linelen,nlines,params);
     
   /* finish up */
   fprintf(sp1,"Program %s done\n",PROGRAMNAME);
@@ -142,18 +162,13 @@ int Unwrap(infileT *infiles, outfileT *outfiles, paramT *params,
            long linelen, long nlines){
 
   long optiter, noptiter;
-  long nexttilerow, nexttilecol, ntilerow, ntilecol, nthreads, nchildren;
-  long sleepinterval;
+  long nexttilerow, nexttilecol, ntilerow, ntilecol, nthreads;
   tileparamT tileparams[1];
   infileT iterinfiles[1];
   outfileT iteroutfiles[1];
   outfileT tileoutfiles[1];
   paramT iterparams[1];
   char tileinitfile[MAXSTRLEN];
-  pid_t pid;
-  int childstatus;
-  double tilecputimestart;
-  time_t tiletstart;
   signed char **dotilemask;
 
 
@@ -229,7 +244,11 @@ int Unwrap(infileT *infiles, outfileT *outfiles, paramT *params,
       tileparams->firstcol=iterparams->piecefirstcol;
       tileparams->nrow=iterparams->piecenrow;
       tileparams->ncol=iterparams->piecencol;
-      UnwrapTile(iterinfiles,iteroutfiles,iterparams,tileparams,nlines,linelen);
+      if(!UnwrapMaskedRegions(iterinfiles,iteroutfiles,iterparams,tileparams,
+                              nlines,linelen)){
+        UnwrapTile(iterinfiles,iteroutfiles,iterparams,tileparams,
+                   nlines,linelen);
+      }
 
     }else{
 
@@ -239,13 +258,35 @@ int Unwrap(infileT *infiles, outfileT *outfiles, paramT *params,
         /* set up mask for which tiles should be unwrapped */
         dotilemask=SetUpDoTileMask(iterinfiles,ntilerow,ntilecol);
 
+#ifdef TILETHREADS
+        /* tile threads keep their temporary files in memory unless told */
+        /*   where to put them or to keep them                           */
+        if(nthreads>1 && !strlen(iterparams->tiledir) && iterparams->rmtmptile){
+          sprintf(iterparams->tiledir,"%s%s%ld",
+                  MEMFILEPREFIX,TMPTILEDIRROOT,iterparams->parentpid);
+        }
+#endif
+
         /* make a temporary directory into which tile files will be written */
         MakeTileDir(iterparams,iteroutfiles);
 
         /* different code for parallel or nonparallel operation */
         if(nthreads>1){
 
-          /* parallel code */
+#ifdef TILETHREADS
+
+          /* parallel code: a pool of threads takes tiles off a queue */
+          UnwrapTilesThreaded(iterinfiles,iteroutfiles,iterparams,dotilemask,
+                              nlines,linelen);
+
+#else
+
+          /* parallel code: fork a child process per tile */
+          long nchildren, sleepinterval;
+          pid_t pid;
+          int childstatus;
+          double tilecputimestart;
+          time_t tiletstart;
 
           /* initialize */
           nexttilerow=0;
@@ -384,6 +425,8 @@ int Unwrap(infileT *infiles, outfileT *outfiles, paramT *params,
           /* return signal handlers to default behavior */
           CatchSignals(SIG_DFL);
 
+#endif
+
         }else{
 
           /* nonparallel code */
@@ -433,6 +476,223 @@ int Unwrap(infileT *infiles, outfileT *outfiles, paramT *params,
 } /* end of Unwrap() */
 
 
+#ifdef TILETHREADS
+
+/* function: UnwrapTilesThreaded()
+ * -------------------------------
+ * Unwraps the tiles marked in dotilemask with a pool of params->nthreads
+ * threads that take tiles off a queue.  The input files are read into
+ * memory once and shared by all tiles, and each tile gets its own copy of
+ * the parameters as a forked child would.  If the tile directory is an
+ * in-memory one, the tile outputs stay in memory until AssembleTiles()
+ * reads and removes them.
+ */
+static
+int UnwrapTilesThreaded(infileT *infiles, outfileT *outfiles, paramT *params,
+                        signed char **dotilemask, long nlines, long linelen){
+
+  long ntilerow, ntilecol, ntiles, tilerow, tilecol, i;
+  long *tilerows, *tilecols;
+  tileparamT *tileparams;
+  outfileT *tileoutfiles;
+
+
+  /* set up all tiles here, since SetupTile() is not reentrant */
+  ntilerow=params->ntilerow;
+  ntilecol=params->ntilecol;
+  tilerows=(long *)MAlloc(ntilerow*ntilecol*sizeof(long));
+  tilecols=(long *)MAlloc(ntilerow*ntilecol*sizeof(long));
+  tileparams=(tileparamT *)MAlloc(ntilerow*ntilecol*sizeof(tileparamT));
+  tileoutfiles=(outfileT *)MAlloc(ntilerow*ntilecol*sizeof(outfileT));
+  ntiles=0;
+  for(tilerow=0;tilerow<ntilerow;tilerow++){
+    for(tilecol=0;tilecol<ntilecol;tilecol++){
+      if(dotilemask[tilerow][tilecol]){
+        memset(&tileparams[ntiles],0,sizeof(tileparamT));
+        memset(&tileoutfiles[ntiles],0,sizeof(outfileT));
+        SetupTile(nlines,linelen,params,&tileparams[ntiles],outfiles,
+                  &tileoutfiles[ntiles],tilerow,tilecol);
+        tilerows[ntiles]=tilerow;
+        tilecols[ntiles]=tilecol;
+        ntiles++;
+      }
+    }
+  }
+
+  /* read the inputs once for all tiles */
+  LoadMemFile(infiles->infile);
+  LoadMemFile(infiles->magfile);
+  LoadMemFile(infiles->ampfile);
+  LoadMemFile(infiles->ampfile2);
+  LoadMemFile(infiles->weightfile);
+  LoadMemFile(infiles->corrfile);
+  LoadMemFile(infiles->estfile);
+  LoadMemFile(infiles->warmstartfile);
+  LoadMemFile(infiles->costinfile);
+  LoadMemFile(infiles->bytemaskfile);
+
+  fprintf(sp1,"Unwrapping %ld tiles with %ld threads\n",
+          ntiles,params->nthreads);
+  fflush(NULL);
+
+  /* the threads start with the stream and cost function pointers of this one */
+#pragma omp parallel for schedule(dynamic,1) num_threads(params->nthreads) \
+  copyin(sp0,sp1,sp2,sp3,CalcCost,EvalCost)
+  for(i=0;i<ntiles;i++){
+
+    infileT tileinfiles[1];
+    paramT tileparamscopy[1];
+    FILE *logfp, *savedsp[4];
+    double tilecputimestart;
+    time_t tiletstart;
+
+    /* start timers for this tile */
+    StartTimers(&tiletstart,&tilecputimestart);
+    fprintf(sp1,"Unwrapping tile at row %ld, column %ld\n",
+            tilerows[i],tilecols[i]);
+
+    /* the tile may change its parameters, so it gets its own copies */
+    memcpy(tileinfiles,infiles,sizeof(infileT));
+    memcpy(tileparamscopy,params,sizeof(paramT));
+
+    /* log to a file per tile as a child would */
+    logfp=ThreadResetStreamPointers(tilerows[i],tilecols[i],tileparamscopy,
+                                    savedsp);
+
+    /* unwrap the tile */
+    UnwrapTile(tileinfiles,&tileoutfiles[i],tileparamscopy,&tileparams[i],
+               nlines,linelen);
+
+    /* log elapsed time */
+    DisplayElapsedTime(tiletstart,tilecputimestart);
+    ThreadRestoreStreamPointers(logfp,savedsp);
+
+    /* nobody reads the log of a tile kept in memory */
+    if(IsMemFile(params->tiledir)){
+      char logfile[MAXSTRLEN];
+      TileLogFileName(logfile,params->tiledir,tilerows[i],tilecols[i]);
+      RemoveFile(logfile);
+    }
+  }
+
+  /* the tiles are done with the inputs */
+  UnloadMemFile(infiles->infile);
+  UnloadMemFile(infiles->magfile);
+  UnloadMemFile(infiles->ampfile);
+  UnloadMemFile(infiles->ampfile2);
+  UnloadMemFile(infiles->weightfile);
+  UnloadMemFile(infiles->corrfile);
+  UnloadMemFile(infiles->estfile);
+  UnloadMemFile(infiles->warmstartfile);
+  UnloadMemFile(infiles->costinfile);
+  UnloadMemFile(infiles->bytemaskfile);
+
+  /* free memory */
+  free(tilerows);
+  free(tilecols);
+  free(tileparams);
+  free(tileoutfiles);
+  return(0);
+
+}
+
+#endif
+
+
+/* function: UnwrapMaskedRegions()
+ * -------------------------------
+ * Unwraps the groups of valid pixels of a single tile that are cut off
+ * from each other by masked pixels one at a time, each on a network
+ * only as large as its bounding box, so that the time spent grows with
+ * the valid rather than the total area.  The connected components are
+ * put together as a single run would number them.  Returns FALSE
+ * without unwrapping if the tile should be unwrapped as a whole, as when
+ * intermediate outputs of the whole tile are asked for.
+ */
+static
+int UnwrapMaskedRegions(infileT *infiles, outfileT *outfiles, paramT *params,
+                        tileparamT *tileparams, long nlines, long linelen){
+
+#ifdef MEMSTREAMS
+  long ibox, nboxes, ncomps;
+  float **mag, **unwrappedphase;
+  unsigned int **conncomps;
+  tileparamT *boxes;
+  outfileT boxoutfiles[1];
+  paramT boxparams[1];
+
+
+  /* see if we should split the tile */
+  if(!params->splitmasked || params->eval || params->regrowconncomps
+     || params->dumpall || strlen(outfiles->initfile) 
+     || strlen(outfiles->flowfile) || strlen(outfiles->eifile)
+     || strlen(outfiles->rowcostfile) || strlen(outfiles->colcostfile)
+     || strlen(outfiles->mstrowcostfile) || strlen(outfiles->mstcolcostfile)
+     || strlen(outfiles->mstcostsfile) || strlen(outfiles->corrdumpfile)
+     || strlen(outfiles->rawcorrdumpfile) || strlen(outfiles->costoutfile)){
+    return(FALSE);
+  }
+  boxes=NULL;
+  nboxes=FindMaskedRegionBoxes(infiles,linelen,nlines,tileparams,params,
+                               &boxes);
+  if(!nboxes){
+    return(FALSE);
+  }
+  fprintf(sp1,"Unwrapping %ld groups of pixels separated by masking\n",
+          nboxes);
+
+  /* box outputs go to memory, with all connected components kept */
+  memset(boxoutfiles,0,sizeof(outfileT));
+  sprintf(boxoutfiles->outfile,"%s%s%ld",
+          MEMFILEPREFIX,MASKBOXROOT,params->parentpid);
+  boxoutfiles->outfileformat=TMPTILEOUTFORMAT;
+  if(strlen(outfiles->conncompfile)){
+    sprintf(boxoutfiles->conncompfile,"%s%s%ld_conncomp",
+            MEMFILEPREFIX,MASKBOXROOT,params->parentpid);
+  }
+  memcpy(boxparams,params,sizeof(paramT));
+  boxparams->conncompnpix=tileparams->nrow*tileparams->ncol;
+  boxparams->maxncomps=LONG_MAX;
+  boxparams->conncompouttype=CONNCOMPOUTTYPEUINT;
+
+  /* unwrap the boxes and put their outputs together */
+  mag=(float **)Get2DMem(tileparams->nrow,tileparams->ncol,
+                         sizeof(float *),sizeof(float));
+  unwrappedphase=(float **)Get2DMem(tileparams->nrow,tileparams->ncol,
+                                    sizeof(float *),sizeof(float));
+  conncomps=NULL;
+  if(strlen(outfiles->conncompfile)){
+    conncomps=(unsigned int **)Get2DMem(tileparams->nrow,tileparams->ncol,
+                                        sizeof(unsigned int *),
+                                        sizeof(unsigned int));
+  }
+  ncomps=0;
+  for(ibox=0;ibox<nboxes;ibox++){
+    fprintf(sp1,"Unwrapping rows %ld-%ld, columns %ld-%ld\n",
+            boxes[ibox].firstrow,boxes[ibox].firstrow+boxes[ibox].nrow-1,
+            boxes[ibox].firstcol,boxes[ibox].firstcol+boxes[ibox].ncol-1);
+    UnwrapTile(infiles,boxoutfiles,boxparams,&boxes[ibox],nlines,linelen);
+    ReadRegionBoxOutputs(mag,unwrappedphase,conncomps,&ncomps,
+                         &boxes[ibox],tileparams,boxoutfiles);
+  }
+  WriteRegionBoxOutputs(mag,unwrappedphase,conncomps,ncomps,
+                        tileparams->nrow,tileparams->ncol,outfiles,params);
+
+  /* free memory */
+  Free2DArray((void **)mag,tileparams->nrow);
+  Free2DArray((void **)unwrappedphase,tileparams->nrow);
+  if(conncomps!=NULL){
+    Free2DArray((void **)conncomps,tileparams->nrow);
+  }
+  free(boxes);
+  return(TRUE);
+#else
+  return(FALSE);
+#endif
+
+} /* end of UnwrapMaskedRegions() */
+
+
 /* function: UnwrapTile()
  * ----------------------
  * This is the main phase unwrapping function for a single tile.
@@ -451,6 +711,7 @@ int UnwrapTile(infileT *infiles, outfileT *outfiles, paramT *params,
   int *nnodesperrow, *narcsperrow;
   short **flows, **mstcosts;
   float **wrappedphase, **unwrappedphase, **mag, **unwrappedest;
+  float **initphase, **warmstart;
   incrcostT **incrcosts;
   void **costs;
   totalcostT totalcost, oldtotalcost, mintotalcost;
@@ -508,6 +769,37 @@ int UnwrapTile(infileT *infiles, outfileT *outfiles, paramT *params,
     return(1);
   }
 
+  /* a fully masked tile of a tiled run has no solution to find, so write */
+  /*   its wrapped phase and empty regions for AssembleTiles() and return */
+  if(allmasked && !params->initonly
+     && (params->ntilerow!=1 || params->ntilecol!=1)){
+    WriteMaskedTileRegions(nrow,ncol,outfiles,params);
+    unwrappedphase=(float **)Get2DMem(nrow,ncol,
+                                      sizeof(float *),sizeof(float));
+    if(flows==NULL){
+      flows=(short **)Get2DRowColZeroMem(nrow,ncol,
+                                         sizeof(short *),sizeof(short));
+    }
+    IntegratePhase(wrappedphase,unwrappedphase,flows,nrow,ncol);
+    if(unwrappedest!=NULL){
+      Add2DFloatArrays(unwrappedphase,unwrappedest,nrow,ncol);
+      Free2DArray((void **)unwrappedest,nrow);
+    }
+    FlipPhaseArraySign(unwrappedphase,params,nrow,ncol);
+    fprintf(sp1,"Writing output to file %s\n",outfiles->outfile);
+    WriteOutputFile(mag,unwrappedphase,outfiles->outfile,outfiles,
+                    nrow,ncol);  
+    Free2DArray((void **)costs,2*nrow-1);
+    if(!params->unwrapped){
+      Free2DArray((void **)mstcosts,2*nrow-1);
+    }
+    Free2DArray((void **)mag,nrow);
+    Free2DArray((void **)wrappedphase,nrow);
+    Free2DArray((void **)unwrappedphase,nrow);
+    Free2DArray((void **)flows,2*nrow-1);
+    return(1);
+  }
+
   /* set network function pointers for grid network */
   SetGridNetworkFunctionPointers();
 
@@ -516,17 +808,26 @@ int UnwrapTile(infileT *infiles, outfileT *outfiles, paramT *params,
   nodes=NULL;
   if(!params->unwrapped){
 
+    /* initialize on the phase flattened by a warm-start phase if given */
+    warmstart=NULL;
+    initphase=wrappedphase;
+    if(strlen(infiles->warmstartfile)){
+      ReadWarmStartFile(&warmstart,infiles,linelen,nlines,params,tileparams);
+      initphase=WarmStartWrappedPhase(wrappedphase,warmstart,unwrappedest,
+                                      nrow,ncol);
+    }
+
     /* see which initialization method to use */
     if(params->initmethod==MSTINIT){
 
       /* use minimum spanning tree (MST) algorithm */
-      MSTInitFlows(wrappedphase,&flows,mstcosts,nrow,ncol,
+      MSTInitFlows(initphase,&flows,mstcosts,nrow,ncol,
                    &nodes,ground,params->initmaxflow);
     
     }else if(params->initmethod==MCFINIT){
 
       /* use minimum cost flow (MCF) algorithm */
-      MCFInitFlows(wrappedphase,&flows,mstcosts,nrow,ncol,
+      MCFInitFlows(initphase,&flows,mstcosts,nrow,ncol,
                    params->cs2scalefactor);
 
     }else{
@@ -535,6 +836,13 @@ int UnwrapTile(infileT *infiles, outfileT *outfiles, paramT *params,
       exit(ABNORMAL_EXIT);
     }
 
+    /* put the warm-start phase back into the initial flows */
+    if(warmstart!=NULL){
+      WarmStartInitFlows(initphase,&flows,warmstart,nrow,ncol);
+      Free2DArray((void **)initphase,nrow);
+      Free2DArray((void **)warmstart,nrow);
+    }
+
     /* integrate the phase and write out if necessary */
     if(params->initonly || strlen(outfiles->initfile)){
       fprintf(sp1,"Integrating phase\n");
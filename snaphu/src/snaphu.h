@@ -8,6 +8,20 @@
 
 *************************************************************************/
 
+/* tiles are unwrapped by a pool of threads if built with OpenMP, */
+/* otherwise by forked child processes                            */
+#if defined(_OPENMP) && !defined(_WIN32)
+#	define TILETHREADS
+#endif
+
+/* in-memory files need the POSIX memory streams */
+#if !defined(_WIN32)
+#	define MEMSTREAMS
+#endif
+#if defined(SNAPHU_GMT) && !defined(MEMSTREAMS)
+#	error "GMT grid support needs POSIX memory streams"
+#endif
+
 /* Avoid some annoying warnings from MS Visual Studio */
 #ifdef _MSC_VER
 #	pragma warning( disable : 4244 )	/* conversion from 'uint64_t' to '::size_t', possible loss of data */
@@ -72,7 +86,9 @@
 #define DEF_CORRFILE         ""     /* "snaphu.corr" */
 #define DEF_ESTFILE          ""     /* "snaphu.est" */
 #define DEF_COSTINFILE       ""
+#define DEF_WARMSTARTFILE    ""
 #define DEF_BYTEMASKFILE     ""
+#define DEF_CORRMASKFILE     ""
 #define DEF_DOTILEMASKFILE   ""
 #define DEF_INITFILE         ""
 #define DEF_FLOWFILE         ""
@@ -129,11 +145,16 @@
 #define SECONDSPERPIXEL      0.000001  /* for delay between thread creations */
 #define MAXTHREADS           64
 #define TMPTILEDIRROOT       "snaphu_tiles_"
+#define MEMFILEPREFIX        "mem:"    /* tile files kept in memory */
+#define GRIDMASKFILE         "mem:gridmask" /* valid pixels of grid input */
 #define TILEDIRMODE          511
 #define TMPTILEROOT          "tmptile_"
 #define TMPTILECOSTSUFFIX    "cost_"
 #define TMPTILEOUTFORMAT     ALT_LINE_DATA
 #define REGIONSUFFIX         "_regions"
+#define MASKBOXROOT          "snaphu_maskbox_"
+#define MASKBOXMARGIN        1         /* masked pixels around region box */
+#define MAXMASKBOXES         1024
 #define LOGFILEROOT          "tmptilelog_"
 #define RIGHT                1
 #define DOWN                 2
@@ -198,6 +219,7 @@
 #define DEF_CSTD3            0.06
 #define DEF_DEFAULTCORR      0.01
 #define DEF_RHOMINFACTOR     1.3
+#define DEF_CORRTHRESH       0.0
 
 
 /* pdf model parameters */
@@ -293,6 +315,7 @@
 #define DEF_TILEDIR          ""
 #define DEF_ASSEMBLEONLY     FALSE
 #define DEF_RMTMPTILE        TRUE
+#define DEF_SPLITMASKED      TRUE
 
 
 /* default connected component parameters */
@@ -310,10 +333,19 @@
 #define DEF_OUTFILEFORMAT             ALT_LINE_DATA
 #define DEF_CORRFILEFORMAT            ALT_LINE_DATA
 #define DEF_ESTFILEFORMAT             ALT_LINE_DATA
+#define DEF_WARMSTARTFILEFORMAT       ALT_LINE_DATA
 #define DEF_AMPFILEFORMAT             ALT_SAMPLE_DATA
 
 /* command-line usage help strings */
 
+#ifdef SNAPHU_GMT
+#define GRIDOPTIONSHELP\
+ "  --corrmask <filename>           mask correlation grid with grid\n"\
+ "  --corrthresh <decimal>          mask correlation grid below value\n"
+#else
+#define GRIDOPTIONSHELP ""
+#endif
+
 #define OPTIONSHELPFULL\
  "usage:  snaphu [options] infile linelength [options]\n"\
  "options:\n"\
@@ -348,6 +380,8 @@
  "  --AA <filename1> <filename2>    read power from next two files\n"\
  "  --costinfile <filename>         read statistical costs from file\n"\
  "  --costoutfile <filename>        write statistical costs to file\n"\
+ GRIDOPTIONSHELP\
+ "  --warmstart <filename>          initialize from unwrapped phase in file\n"\
  "  --tile <nrow> <ncol> <rowovrlp> <colovrlp>  unwrap as nrow x ncol tiles\n"\
  "  --nproc <integer>               number of processors used in tile mode\n"\
  "  --tiledir <dirname>             use specified directory for tiles\n"\
@@ -581,6 +615,7 @@ typedef struct paramST{
   double cstd1,cstd2,cstd3;/* for calculating correlation power given nlooks */
   double defaultcorr;     /* default correlation if no correlation file */
   double rhominfactor;    /* threshold for setting unbiased correlation to 0 */
+  double corrthresh;      /* grid correlation below which pixels are masked */
 
   /* pdf model parameters */
   double dzlaypeak;       /* range pdf peak for no discontinuity when bright */
@@ -661,12 +696,14 @@ typedef struct paramST{
   signed char assembleonly; /* flag for assemble-only (no unwrap) mode */
   signed char rmtmptile;  /* flag for removing temporary tile files */
   char tiledir[MAXSTRLEN];/* directory for temporary tile files */
+  signed char splitmasked;/* unwrap regions apart in masks separately */
 
   /* connected component parameters */
   double minconncompfrac; /* min fraction of pixels in connected component */
   long conncompthresh;    /* cost threshold for connected component */
   long maxncomps;         /* max number of connected components */
   int conncompouttype;    /* flag for type of connected component output file */
+  long conncompnpix;      /* pixels minconncompfrac is of if not whole tile */
   
 }paramT;
 
@@ -681,7 +718,9 @@ typedef struct infileST{
   char corrfile[MAXSTRLEN];           /* correlation file */
   char estfile[MAXSTRLEN];            /* unwrapped estimate */
   char costinfile[MAXSTRLEN];         /* file from which cost data is read */
+  char warmstartfile[MAXSTRLEN];      /* unwrapped phase to initialize from */
   char bytemaskfile[MAXSTRLEN];       /* signed char valid pixel mask */
+  char corrmaskfile[MAXSTRLEN];       /* grid mask for correlation grid */
   char dotilemaskfile[MAXSTRLEN];     /* signed char tile unwrap mask file */
   signed char infileformat;           /* input file format */
   signed char unwrappedinfileformat;  /* input file format if unwrapped */
@@ -690,6 +729,7 @@ typedef struct infileST{
   signed char weightfileformat;       /* weight file format */
   signed char ampfileformat;          /* amplitude file format */
   signed char estfileformat;          /* unwrapped-estimate file format */
+  signed char warmstartfileformat;    /* warm-start file format */
 }infileT;
 
 
@@ -722,6 +762,16 @@ typedef struct tileparamST{
 }tileparamT;
 
 
+/* in-memory file data structure */
+typedef struct memfileST{
+  char filename[MAXSTRLEN];           /* name the file is opened by */
+  char *buf;                          /* contents */
+  size_t size;                        /* number of bytes in buf */
+  int nload;                          /* number of loads not yet unloaded */
+  struct memfileST *next;             /* next file in list */
+}memfileT;
+
+
 /* connectected component size structure */
 typedef struct conncompsizeST{
   unsigned int tilenum;               /* tile index */
@@ -753,6 +803,19 @@ int GrowRegions(void **costs, short **flows, long nrow, long ncol,
 int GrowConnCompsMask(void **costs, short **flows, long nrow, long ncol, 
                       incrcostT **incrcosts, outfileT *outfiles, 
                       paramT *params);
+int WriteMaskedTileRegions(long nrow, long ncol, outfileT *outfiles, 
+                           paramT *params);
+long FindMaskedRegionBoxes(infileT *infiles, long linelen, long nlines, 
+                           tileparamT *tileparams, paramT *params, 
+                           tileparamT **boxesptr);
+int ReadRegionBoxOutputs(float **mag, float **unwrappedphase, 
+                         unsigned int **conncomps, long *ncompsptr, 
+                         tileparamT *box, tileparamT *tileparams, 
+                         outfileT *boxoutfiles);
+int WriteRegionBoxOutputs(float **mag, float **unwrappedphase, 
+                          unsigned int **conncomps, long ncomps, 
+                          long nrow, long ncol, outfileT *outfiles, 
+                          paramT *params);
 int AssembleTiles(outfileT *outfiles, paramT *params, 
                   long nlines, long linelen);
 
@@ -812,6 +875,10 @@ int MSTInitFlows(float **wrappedphase, short ***flowsptr,
                  nodeT ***nodes, nodeT *ground, long maxflow);
 int MCFInitFlows(float **wrappedphase, short ***flowsptr, short **mstcosts, 
                  long nrow, long ncol, long cs2scalefactor);
+float **WarmStartWrappedPhase(float **wrappedphase, float **warmstart, 
+                              float **unwrappedest, long nrow, long ncol);
+int WarmStartInitFlows(float **flatphase, short ***flowsptr, 
+                       float **warmstart, long nrow, long ncol);
 
 
 /* functions in snaphu_cost.c */
@@ -915,6 +982,7 @@ signed char NonNegDataArray(float **arr, long nrow, long ncol);
 signed char IsFinite(double d);
 long LRound(double a);
 long LMin(long a, long b);
+long LMax(long a, long b);
 long LClip(long a, long minval, long maxval);
 long Short2DRowColAbsMax(short **arr, long nrow, long ncol);
 float LinInterp1D(float *arr, double index, long nelem);
@@ -964,6 +1032,11 @@ int ReadMagnitude(float **mag, infileT *infiles, long linelen, long nlines,
                   tileparamT *tileparams);
 int ReadByteMask(float **mag, infileT *infiles, long linelen, long nlines, 
                  tileparamT *tileparams, paramT *params);
+signed char **ReadValidMask(infileT *infiles, long linelen, long nlines, 
+                            tileparamT *tileparams, paramT *params);
+int ReadWarmStartFile(float ***warmstartptr, infileT *infiles, 
+                      long linelen, long nlines, 
+                      paramT *params, tileparamT *tileparams);
 int ReadUnwrappedEstimateFile(float ***unwrappedestptr, infileT *infiles, 
                               long linelen, long nlines, 
                               paramT *params, tileparamT *tileparams);
@@ -991,13 +1064,27 @@ int Read2DRowColFileRows(void ***arr, char *filename, long linelen,
 int SetDumpAll(outfileT *outfiles, paramT *params);
 int SetStreamPointers(void);
 int SetVerboseOut(paramT *params);
+int TileLogFileName(char *logfile, char *tiledir, long tilerow, long tilecol);
 int ChildResetStreamPointers(pid_t pid, long tilerow, long tilecol,
                              paramT *params);
+FILE *ThreadResetStreamPointers(long tilerow, long tilecol, paramT *params,
+                                FILE **savedsp);
+int ThreadRestoreStreamPointers(FILE *logfp, FILE **savedsp);
 int DumpIncrCostFiles(incrcostT **incrcosts, long iincrcostfile, 
                       long nflow, long nrow, long ncol);
 int MakeTileDir(paramT *params, outfileT *outfiles);
 int ParseFilename(char *filename, char *path, char *basename);
 int SetTileInitOutfile(char *outfile, long pid);
+FILE *OpenInputFile(char *filename);
+int IsMemFile(char *filename);
+int LoadMemFile(char *filename);
+int UnloadMemFile(char *filename);
+int RemoveFile(char *filename);
+int IsGridFile(char *filename);
+int ReadGridFiles(infileT *infiles, outfileT *outfiles, long *linelenptr,
+                  paramT *params);
+int WriteGridFiles(infileT *infiles, outfileT *outfiles, long linelen,
+                   long nlines, paramT *params);
 
 
 /* functions in snaphu_cs2.c  */
@@ -1028,6 +1115,11 @@ extern void (*CalcCost)(void **, long, long, long, long, long,
                         paramT *, long *, long *);
 extern long (*EvalCost)(void **, short **, long, long, long, paramT *);
 
+/* every tile thread has its own streams and cost functions */
+#ifdef TILETHREADS
+#pragma omp threadprivate(sp0,sp1,sp2,sp3,CalcCost,EvalCost)
+#endif
+
 /* end of snaphu.h */
 
 
@@ -8,6 +8,11 @@
 
 *************************************************************************/
 
+/* declare POSIX functions (memory streams, gethostname) under -std=c99 */
+#ifndef _WIN32
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -32,6 +37,7 @@
 #	define pid_t int
 #else
 #	include <sys/wait.h>
+#	include <time.h>
 #	include <sys/time.h>
 #	include <sys/resource.h>
 #endif
@@ -42,6 +42,11 @@
 
 /************************************** constants  &  parameters ********/
 
+/* declare POSIX functions (memory streams, gethostname) under -std=c99 */
+#ifndef _WIN32
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -66,6 +71,7 @@
 #	define pid_t int
 #else
 #	include <sys/wait.h>
+#	include <time.h>
 #	include <sys/time.h>
 #	include <sys/resource.h>
 #endif
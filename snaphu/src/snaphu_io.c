@@ -8,6 +8,11 @@
 
 *************************************************************************/
 
+/* declare POSIX functions (memory streams, gethostname) under -std=c99 */
+#ifndef _WIN32
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -32,10 +37,15 @@
 #	define pid_t int
 #else
 #	include <sys/wait.h>
+#	include <time.h>
 #	include <sys/time.h>
 #	include <sys/resource.h>
 #endif
 
+#ifdef SNAPHU_GMT
+#	include "gmt.h"
+#endif
+
 #include "snaphu.h"
 
 
@@ -56,6 +66,17 @@ int WriteAltLineFile(float **mag, float **phase, char *outfile,
 static
 int WriteAltSampFile(float **arr1, float **arr2, char *outfile, 
                      long nrow, long ncol);
+static
+memfileT *FindMemFile(char *filename);
+static
+FILE *OpenMemOutputFile(char *filename);
+
+
+/* static variables local this file */
+
+/* list of files kept in memory: inputs shared by tile threads and */
+/* temporary tile outputs                                          */
+static memfileT *memfiles=NULL;
 
 
 
@@ -79,7 +100,9 @@ int SetDefaults(infileT *infiles, outfileT *outfiles, paramT *params){
   StrNCopy(infiles->estfile,DEF_ESTFILE,MAXSTRLEN);  
   StrNCopy(infiles->magfile,DEF_MAGFILE,MAXSTRLEN);
   StrNCopy(infiles->costinfile,DEF_COSTINFILE,MAXSTRLEN);
+  StrNCopy(infiles->warmstartfile,DEF_WARMSTARTFILE,MAXSTRLEN);
   StrNCopy(infiles->bytemaskfile,DEF_BYTEMASKFILE,MAXSTRLEN);
+  StrNCopy(infiles->corrmaskfile,DEF_CORRMASKFILE,MAXSTRLEN);
   StrNCopy(infiles->dotilemaskfile,DEF_DOTILEMASKFILE,MAXSTRLEN);
 
   /* output and dump files */
@@ -104,6 +127,7 @@ int SetDefaults(infileT *infiles, outfileT *outfiles, paramT *params){
   infiles->magfileformat=DEF_MAGFILEFORMAT;
   infiles->corrfileformat=DEF_CORRFILEFORMAT;
   infiles->estfileformat=DEF_ESTFILEFORMAT;
+  infiles->warmstartfileformat=DEF_WARMSTARTFILEFORMAT;
   infiles->ampfileformat=DEF_AMPFILEFORMAT;
   outfiles->outfileformat=DEF_OUTFILEFORMAT;
 
@@ -158,6 +182,7 @@ int SetDefaults(infileT *infiles, outfileT *outfiles, paramT *params){
   params->cstd3=DEF_CSTD3;
   params->defaultcorr=DEF_DEFAULTCORR;
   params->rhominfactor=DEF_RHOMINFACTOR;
+  params->corrthresh=DEF_CORRTHRESH;
 
   /* pdf model parameters */
   params->dzlaypeak=DEF_DZLAYPEAK;
@@ -230,6 +255,7 @@ int SetDefaults(infileT *infiles, outfileT *outfiles, paramT *params){
   StrNCopy(params->tiledir,DEF_TILEDIR,MAXSTRLEN);
   params->assembleonly=DEF_ASSEMBLEONLY;
   params->rmtmptile=DEF_RMTMPTILE;
+  params->splitmasked=DEF_SPLITMASKED;
   params->tileedgeweight=DEF_TILEEDGEWEIGHT;
 
   /* connected component parameters */
@@ -237,6 +263,7 @@ int SetDefaults(infileT *infiles, outfileT *outfiles, paramT *params){
   params->conncompthresh=DEF_CONNCOMPTHRESH;
   params->maxncomps=DEF_MAXNCOMPS;
   params->conncompouttype=DEF_CONNCOMPOUTTYPE;
+  params->conncompnpix=0;
 
   /* done */
   return(0);
@@ -447,6 +474,29 @@ int ProcessArgs(int argc, char *argv[], infileT *infiles, outfileT *outfiles,
           }else{
             noarg_exit=TRUE;
           }
+        }else if(!strcmp(argv[i],"--corrmask")){
+          if(++i<argc){
+            StrNCopy(infiles->corrmaskfile,argv[i],MAXSTRLEN);
+          }else{
+            noarg_exit=TRUE;
+          }
+        }else if(!strcmp(argv[i],"--corrthresh")){
+          if(++i<argc){
+            if(StringToDouble(argv[i],&(params->corrthresh))){
+              fflush(NULL);
+              fprintf(sp0,"option %s requires decimal argument\n",
+                      argv[i-1]);
+              exit(ABNORMAL_EXIT);
+            }
+          }else{
+            noarg_exit=TRUE;
+          }
+        }else if(!strcmp(argv[i],"--warmstart")){
+          if(++i<argc){
+            StrNCopy(infiles->warmstartfile,argv[i],MAXSTRLEN);
+          }else{
+            noarg_exit=TRUE;
+          }
         }else if(!strcmp(argv[i],"--debug") || !strcmp(argv[i],"--dumpall")){
           params->dumpall=TRUE;
         }else if(!strcmp(argv[i],"--mst")){
@@ -557,7 +607,9 @@ int ProcessArgs(int argc, char *argv[], infileT *infiles, outfileT *outfiles,
   } /* end for loop over arguments */
 
   /* check to make sure we have required arguments */
-  if(!strlen(infiles->infile) || !(*linelenptr)){
+  /* (the line length of a grid input is read from the grid) */
+  if(!strlen(infiles->infile)
+     || (!(*linelenptr) && !IsGridFile(infiles->infile))){
     fflush(NULL);
     fprintf(sp0,"not enough input arguments.  type %s -h for help\n",
             PROGRAMNAME);
@@ -618,6 +670,11 @@ int CheckParams(infileT *infiles, outfileT *outfiles,
     fprintf(sp0,"  initialize-only or Lp-norm modes\n");
     exit(ABNORMAL_EXIT);
   }
+  if(strlen(infiles->warmstartfile) && params->unwrapped){
+    fflush(NULL);
+    fprintf(sp0,"cannot use warm-start file with unwrapped input\n");
+    exit(ABNORMAL_EXIT);
+  }
   if(strlen(infiles->costinfile) && params->costmode==NOSTATCOSTS){
     fflush(NULL);
     fprintf(sp0,"no-statistical-costs option cannot be given\n");
@@ -748,6 +805,11 @@ int CheckParams(infileT *infiles, outfileT *outfiles,
     fprintf(sp0,"parameter rhominfactor must be nonnegative\n");
     exit(ABNORMAL_EXIT);
   }
+  if(params->corrthresh<0 || params->corrthresh>1){
+    fflush(NULL);
+    fprintf(sp0,"correlation threshold must be between 0 and 1\n");
+    exit(ABNORMAL_EXIT);
+  }
   if(params->ncorrlooksaz<1 || params->ncorrlooksrange<1
      || params->nlooksaz<1 || params->nlooksrange<1
      || params->nlooksother<1){
@@ -1321,6 +1383,8 @@ int ParseConfigLine(char *buf, char *conffile, long nlines,
       StrNCopy(infiles->corrfile,str2,MAXSTRLEN);
     }else if(!strcmp(str1,"ESTIMATEFILE")){
       StrNCopy(infiles->estfile,str2,MAXSTRLEN);
+    }else if(!strcmp(str1,"WARMSTARTFILE")){
+      StrNCopy(infiles->warmstartfile,str2,MAXSTRLEN);
     }else if(!strcmp(str1,"LINELENGTH") || !strcmp(str1,"LINELEN")){
       badparam=StringToLong(str2,linelenptr);
     }else if(!strcmp(str1,"STATCOSTMODE")){
@@ -1449,6 +1513,8 @@ int ParseConfigLine(char *buf, char *conffile, long nlines,
       badparam=StringToDouble(str2,&(params->defaultcorr));
     }else if(!strcmp(str1,"RHOMINFACTOR")){
       badparam=StringToDouble(str2,&(params->rhominfactor));
+    }else if(!strcmp(str1,"CORRTHRESH")){
+      badparam=StringToDouble(str2,&(params->corrthresh));
     }else if(!strcmp(str1,"DZLAYPEAK")){
       badparam=StringToDouble(str2,&(params->dzlaypeak));
     }else if(!strcmp(str1,"AZDZFACTOR")){
@@ -1560,6 +1626,8 @@ int ParseConfigLine(char *buf, char *conffile, long nlines,
     }else if(!strcmp(str1,"RMTMPTILE")){
       badparam=SetBooleanSignedChar(&(params->rmtmptile),str2);
       params->rmtileinit=params->rmtmptile;
+    }else if(!strcmp(str1,"SPLITMASKEDREGIONS")){
+      badparam=SetBooleanSignedChar(&(params->splitmasked),str2);
     }else if(!strcmp(str1,"MINCONNCOMPFRAC")){
       badparam=StringToDouble(str2,&(params->minconncompfrac));
     }else if(!strcmp(str1,"CONNCOMPTHRESH")){
@@ -1595,6 +1663,8 @@ int ParseConfigLine(char *buf, char *conffile, long nlines,
       StrNCopy(infiles->costinfile,str2,MAXSTRLEN);
     }else if(!strcmp(str1,"BYTEMASKFILE")){
       StrNCopy(infiles->bytemaskfile,str2,MAXSTRLEN);
+    }else if(!strcmp(str1,"CORRMASKFILE")){
+      StrNCopy(infiles->corrmaskfile,str2,MAXSTRLEN);
     }else if(!strcmp(str1,"DOTILEMASKFILE")){
       StrNCopy(infiles->dotilemaskfile,str2,MAXSTRLEN);
     }else if(!strcmp(str1,"COSTOUTFILE")){
@@ -1675,6 +1745,16 @@ int ParseConfigLine(char *buf, char *conffile, long nlines,
       }else{
         badparam=TRUE;
       }
+    }else if(!strcmp(str1,"WARMSTARTFILEFORMAT")){
+      if(!strcmp(str2,"ALT_LINE_DATA")){
+        infiles->warmstartfileformat=ALT_LINE_DATA;
+      }else if(!strcmp(str2,"ALT_SAMPLE_DATA")){
+        infiles->warmstartfileformat=ALT_SAMPLE_DATA;
+      }else if(!strcmp(str2,"FLOAT_DATA")){
+        infiles->warmstartfileformat=FLOAT_DATA;
+      }else{
+        badparam=TRUE;
+      }
     }else if(!strcmp(str1,"INITFILE")){
       StrNCopy(outfiles->initfile,str2,MAXSTRLEN);
     }else if(!strcmp(str1,"FLOWFILE")){
@@ -1806,9 +1886,11 @@ int WriteConfigLogFile(int argc, char *argv[], infileT *infiles,
     LogStringParam(fp,"MAGFILE",infiles->magfile);
     LogStringParam(fp,"CORRFILE",infiles->corrfile);
     LogStringParam(fp,"ESTIMATEFILE",infiles->estfile);
+    LogStringParam(fp,"WARMSTARTFILE",infiles->warmstartfile);
     LogStringParam(fp,"COSTINFILE",infiles->costinfile);
     LogStringParam(fp,"COSTOUTFILE",outfiles->costoutfile);
     LogStringParam(fp,"BYTEMASKFILE",infiles->bytemaskfile);
+    LogStringParam(fp,"CORRMASKFILE",infiles->corrmaskfile);
     LogStringParam(fp,"LOGFILE",outfiles->logfile);
     if(params->costmode==TOPO){
       fprintf(fp,"STATCOSTMODE  TOPO\n");
@@ -1837,6 +1919,7 @@ int WriteConfigLogFile(int argc, char *argv[], infileT *infiles,
     LogFileFormat(fp,"MAGFILEFORMAT",infiles->magfileformat);
     LogFileFormat(fp,"CORRFILEFORMAT",infiles->corrfileformat);
     LogFileFormat(fp,"ESTFILEFORMAT",infiles->estfileformat);
+    LogFileFormat(fp,"WARMSTARTFILEFORMAT",infiles->warmstartfileformat);
     LogFileFormat(fp,"UNWRAPPEDINFILEFORMAT",infiles->unwrappedinfileformat);
 
     /* SAR and geometry parameters */
@@ -1892,6 +1975,7 @@ int WriteConfigLogFile(int argc, char *argv[], infileT *infiles,
     fprintf(fp,"CSTD3  %.8f\n",params->cstd3);
     fprintf(fp,"DEFAULTCORR  %.8f\n",params->defaultcorr);
     fprintf(fp,"RHOMINFACTOR  %.8f\n",params->rhominfactor);
+    fprintf(fp,"CORRTHRESH  %.8f\n",params->corrthresh);
       
     /* PDF model paramters */
     fprintf(fp,"\n# PDF model parameters\n");
@@ -2000,6 +2084,7 @@ int WriteConfigLogFile(int argc, char *argv[], infileT *infiles,
     LogStringParam(fp,"TILEDIR",params->tiledir);
     LogBoolParam(fp,"ASSEMBLEONLY",params->assembleonly);
     LogBoolParam(fp,"SINGLETILEREOPTIMIZE",params->onetilereopt);
+    LogBoolParam(fp,"SPLITMASKEDREGIONS",params->splitmasked);
 
     /* connected component control */
     fprintf(fp,"\n# Connected component control\n");
@@ -2100,7 +2185,7 @@ long GetNLines(infileT *infiles, long linelen, paramT *params){
   long filesize, datasize;
 
   /* get size of input file in rows and columns */
-  if((fp=fopen(infiles->infile,"r"))==NULL){
+  if((fp=OpenInputFile(infiles->infile))==NULL){
     fflush(NULL);
     fprintf(sp0,"can't open file %s\n",infiles->infile);
     exit(ABNORMAL_EXIT);
@@ -2162,6 +2247,25 @@ FILE *OpenOutputFile(char *outfile, char *realoutfile){
 
   char path[MAXSTRLEN], basename[MAXSTRLEN], dumpfile[MAXSTRLEN];
   FILE *fp;
+  memfileT *mf;
+
+  /* temporary tile files of the threaded tile mode are kept in memory, */
+  /*   as are outputs set up by ReadGridFiles() to be written as grids  */
+#ifdef _OPENMP
+#pragma omp critical(snaphu_memfiles)
+#endif
+  {
+    mf=FindMemFile(outfile);
+  }
+  if(IsMemFile(outfile) || mf!=NULL){
+    if((fp=OpenMemOutputFile(outfile))==NULL){
+      fflush(NULL);
+      fprintf(sp0,"Unable to open in-memory file %s\nAbort\n",outfile);
+      exit(ABNORMAL_EXIT);
+    }
+    StrNCopy(realoutfile,outfile,MAXSTRLEN);
+    return(fp);
+  }
 
   if((fp=fopen(outfile,"w"))==NULL){
 
@@ -2513,50 +2617,106 @@ int ReadMagnitude(float **mag, infileT *infiles, long linelen, long nlines,
 /* function: ReadByteMask()
  * ------------------------
  * Read signed byte mask value; set magnitude to zero where byte mask
- * is zero or where pixel is close enough to edge as defined by
- * edgemask parameters; leave magnitude unchanged otherwise.
+ * is zero, where the grid correlation is invalid, or where pixel is 
+ * close enough to edge as defined by edgemask parameters; leave 
+ * magnitude unchanged otherwise.
  */
 int ReadByteMask(float **mag, infileT *infiles, long linelen, long nlines, 
                  tileparamT *tileparams, paramT *params){
 
+  long row, col, nrow, ncol;
+  signed char **validmask;
+
+  /* set up */
+  nrow=tileparams->nrow;
+  ncol=tileparams->ncol;
+
+  /* zero out magnitude where pixels are not valid */
+  validmask=ReadValidMask(infiles,linelen,nlines,tileparams,params);
+  if(validmask!=NULL){
+    for(row=0;row<nrow;row++){
+      for(col=0;col<ncol;col++){
+        if(!validmask[row][col]){
+          mag[row][col]=0;
+        }
+      }
+    }
+    Free2DArray((void **)validmask,nrow);
+  }
+
+  /* done */
+  return(0);
+
+}
+
+
+/* function: ReadValidMask()
+ * -------------------------
+ * Returns a signed byte array for the tile that is zero where the byte
+ * mask is zero, where the grid correlation read by ReadGridFiles() is
+ * invalid, or where the pixel is within the edge mask, and one
+ * elsewhere.  Returns NULL if none of these masks is in effect.
+ */
+signed char **ReadValidMask(infileT *infiles, long linelen, long nlines, 
+                            tileparamT *tileparams, paramT *params){
+
   long row, col, nrow, ncol, fullrow, fullcol;
-  signed char **bytemask;
+  signed char **validmask, **gridmask;
 
   /* set up */
   nrow=tileparams->nrow;
   ncol=tileparams->ncol;
+  if(!strlen(infiles->bytemaskfile) && !IsGridFile(infiles->corrfile)
+     && !params->edgemasktop && !params->edgemaskbot
+     && !params->edgemaskleft && !params->edgemaskright){
+    return(NULL);
+  }
 
   /* read byte mask (memory allocated by read function) */
-  bytemask=NULL;
+  validmask=NULL;
   if(strlen(infiles->bytemaskfile)){
     fprintf(sp1,"Reading byte mask from file %s\n",infiles->bytemaskfile);
-    Read2DArray((void ***)&bytemask,infiles->bytemaskfile,linelen,nlines,
+    Read2DArray((void ***)&validmask,infiles->bytemaskfile,linelen,nlines,
+                tileparams,sizeof(signed char *),sizeof(signed char));
+  }else{
+    validmask=(signed char **)Get2DMem(nrow,ncol,sizeof(signed char *),
+                                       sizeof(signed char));
+    for(row=0;row<nrow;row++){
+      memset(validmask[row],TRUE,ncol*sizeof(signed char));
+    }
+  }
+
+  /* combine with valid pixels of grid correlation */
+  if(IsGridFile(infiles->corrfile)){
+    gridmask=NULL;
+    Read2DArray((void ***)&gridmask,GRIDMASKFILE,linelen,nlines,
                 tileparams,sizeof(signed char *),sizeof(signed char));
+    for(row=0;row<nrow;row++){
+      for(col=0;col<ncol;col++){
+        if(!gridmask[row][col]){
+          validmask[row][col]=0;
+        }
+      }
+    }
+    Free2DArray((void **)gridmask,nrow);
   }
     
-  /* loop over rows and columns and zero out magnitude where mask is zero */
-  /* also mask edges according to edgemask parameters */
+  /* mask edges according to edgemask parameters */
   for(row=0;row<nrow;row++){
     for(col=0;col<ncol;col++){
       fullrow=tileparams->firstrow+row;
       fullcol=tileparams->firstcol+col;
-      if((bytemask!=NULL && bytemask[row][col]==0)
-         || fullrow<params->edgemasktop
+      if(fullrow<params->edgemasktop
          || fullcol<params->edgemaskleft
          || fullrow>=nlines-params->edgemaskbot
          || fullcol>=linelen-params->edgemaskright){
-        mag[row][col]=0;
+        validmask[row][col]=0;
       }
     }
   }
 
-  /* free bytemask memory */
-  if(bytemask!=NULL){
-    Free2DArray((void **)bytemask,nrow);
-  }
-
   /* done */
-  return(0);
+  return(validmask);
 
 }
 
@@ -2615,6 +2775,56 @@ int ReadUnwrappedEstimateFile(float ***unwrappedestptr, infileT *infiles,
 }
 
 
+/* function: ReadWarmStartFile()
+ * -----------------------------
+ * Reads the unwrapped phase from which to initialize the flows from a
+ * file (assumes file name exists).  NaNs are allowed and mark pixels
+ * for which there is no warm-start value.
+ */
+int ReadWarmStartFile(float ***warmstartptr, infileT *infiles, 
+                      long linelen, long nlines, 
+                      paramT *params, tileparamT *tileparams){
+
+  float **dummy;
+  long nrow, ncol;
+
+
+  /* initialize */
+  dummy=NULL;
+  nrow=tileparams->nrow;
+  ncol=tileparams->ncol;
+
+  /* read data */
+  fprintf(sp1,"Reading warm-start unwrapped phase from file %s\n",
+          infiles->warmstartfile);
+  if(infiles->warmstartfileformat==ALT_LINE_DATA){
+    ReadAltLineFilePhase(warmstartptr,infiles->warmstartfile,
+                         linelen,nlines,tileparams);
+  }else if(infiles->warmstartfileformat==FLOAT_DATA){
+    Read2DArray((void ***)warmstartptr,infiles->warmstartfile,linelen,nlines,
+                tileparams,sizeof(float *),sizeof(float));
+  }else if(infiles->warmstartfileformat==ALT_SAMPLE_DATA){
+    ReadAltSampFile(&dummy,warmstartptr,infiles->warmstartfile,
+                    linelen,nlines,tileparams);
+  }else{
+    fflush(NULL);
+    fprintf(sp0,"Illegal file format specification for file %s\nAbort\n",
+            infiles->warmstartfile);
+    exit(ABNORMAL_EXIT);
+  }
+  if(dummy!=NULL){
+    Free2DArray((void **)dummy,nrow);
+  }
+
+  /* flip the sign of the field if the flip flag is set */
+  FlipPhaseArraySign(*warmstartptr,params,nrow,ncol);
+
+  /* done */
+  return(0);
+
+}
+
+
 /* function: ReadWeightsFile()
  * ---------------------------
  * Read in weights form rowcol format file of short ints.
@@ -2847,7 +3057,7 @@ int ReadAltLineFile(float ***mag, float ***phase, char *alfile,
   long filesize,row,nrow,ncol,padlen;
 
   /* open the file */
-  if((fp=fopen(alfile,"r"))==NULL){
+  if((fp=OpenInputFile(alfile))==NULL){
     fflush(NULL);
     fprintf(sp0,"Can't open file %s\nAbort\n",alfile);
     exit(ABNORMAL_EXIT);
@@ -2916,7 +3126,7 @@ int ReadAltLineFilePhase(float ***phase, char *alfile,
   long filesize,row,nrow,ncol,padlen;
 
   /* open the file */
-  if((fp=fopen(alfile,"r"))==NULL){
+  if((fp=OpenInputFile(alfile))==NULL){
     fflush(NULL);
     fprintf(sp0,"Can't open file %s\nAbort\n",alfile);
     exit(ABNORMAL_EXIT);
@@ -2974,7 +3184,7 @@ int ReadComplexFile(float ***mag, float ***phase, char *rifile,
   float *inpline;
 
   /* open the file */
-  if((fp=fopen(rifile,"r"))==NULL){
+  if((fp=OpenInputFile(rifile))==NULL){
     fflush(NULL);
     fprintf(sp0,"Can't open file %s\nAbort\n",rifile);
     exit(ABNORMAL_EXIT);
@@ -3049,7 +3259,7 @@ int Read2DArray(void ***arr, char *infile, long linelen, long nlines,
   long filesize,row,nrow,ncol,padlen;
 
   /* open the file */
-  if((fp=fopen(infile,"r"))==NULL){
+  if((fp=OpenInputFile(infile))==NULL){
     fflush(NULL);
     fprintf(sp0,"Can't open file %s\nAbort\n",infile);
     exit(ABNORMAL_EXIT);
@@ -3108,7 +3318,7 @@ int ReadAltSampFile(float ***arr1, float ***arr2, char *infile,
   float *inpline;
 
   /* open the file */
-  if((fp=fopen(infile,"r"))==NULL){
+  if((fp=OpenInputFile(infile))==NULL){
     fflush(NULL);
     fprintf(sp0,"Can't open file %s\nAbort\n",infile);
     exit(ABNORMAL_EXIT);
@@ -3175,7 +3385,7 @@ int Read2DRowColFile(void ***arr, char *filename, long linelen, long nlines,
   long row, nel, nrow, ncol, padlen, filelen;
  
   /* open the file */
-  if((fp=fopen(filename,"r"))==NULL){
+  if((fp=OpenInputFile(filename))==NULL){
     fflush(NULL);
     fprintf(sp0,"Can't open file %s\nAbort\n",filename);
     exit(ABNORMAL_EXIT);
@@ -3247,7 +3457,7 @@ int Read2DRowColFileRows(void ***arr, char *filename, long linelen,
   long row, nel, nrow, ncol, padlen, filelen;
  
   /* open the file */
-  if((fp=fopen(filename,"r"))==NULL){
+  if((fp=OpenInputFile(filename))==NULL){
     fflush(NULL);
     fprintf(sp0,"Can't open file %s\nAbort\n",filename);
     exit(ABNORMAL_EXIT);
@@ -3398,6 +3608,23 @@ int SetVerboseOut(paramT *params){
 }
 
 
+/* function: TileLogFileName()
+ * ---------------------------
+ * Puts the name of the log file of a tile in the tile directory into
+ * logfile, which should be MAXSTRLEN long.  The name is truncated if it
+ * does not fit.
+ */
+int TileLogFileName(char *logfile, char *tiledir, long tilerow, long tilecol){
+
+  char tempstr[MAXSTRLEN];
+
+  StrNCopy(logfile,tiledir,MAXSTRLEN);
+  sprintf(tempstr,"/%s%ld_%ld",LOGFILEROOT,tilerow,tilecol);
+  strncat(logfile,tempstr,MAXSTRLEN-strlen(logfile)-1);
+  return(0);
+}
+
+
 /* function: ChildResetStreamPointers()
  * -----------------------------------
  * Reset the global stream pointers for a child.  Streams equal to stdout 
@@ -3410,7 +3637,7 @@ int ChildResetStreamPointers(pid_t pid, long tilerow, long tilecol,
   char logfile[MAXSTRLEN], cwd[MAXSTRLEN];
 
   fflush(NULL);
-  sprintf(logfile,"%s/%s%ld_%ld",params->tiledir,LOGFILEROOT,tilerow,tilecol);
+  TileLogFileName(logfile,params->tiledir,tilerow,tilecol);
   if((logfp=fopen(logfile,"w"))==NULL){
     fflush(NULL);
     fprintf(sp0,"Unable to open log file %s\nAbort\n",logfile);
@@ -3442,6 +3669,63 @@ int ChildResetStreamPointers(pid_t pid, long tilerow, long tilecol,
 }
 
 
+/* function: ThreadResetStreamPointers()
+ * -------------------------------------
+ * Reset the stream pointers of a tile thread as ChildResetStreamPointers()
+ * does for a child.  The stream pointers are private to each thread, but
+ * the streams they point to are shared, so none of them are closed here.
+ * Returns the log file, which is passed to ThreadRestoreStreamPointers()
+ * along with the stream pointers saved in savedsp when the tile is done.
+ */
+FILE *ThreadResetStreamPointers(long tilerow, long tilecol, paramT *params,
+                                FILE **savedsp){
+
+  FILE *logfp;
+  char logfile[MAXSTRLEN], reallogfile[MAXSTRLEN];
+
+  savedsp[0]=sp0;
+  savedsp[1]=sp1;
+  savedsp[2]=sp2;
+  savedsp[3]=sp3;
+  TileLogFileName(logfile,params->tiledir,tilerow,tilecol);
+  logfp=OpenOutputFile(logfile,reallogfile);
+  fprintf(logfp,"%s: unwrapping tile at row %ld, column %ld\n\n",
+          PROGRAMNAME,tilerow,tilecol);
+  if(sp2==stdout || sp2==stderr){
+    sp2=logfp;
+  }
+  if(sp1==stdout || sp1==stderr){
+    sp1=logfp;
+  }
+  if(sp0==stdout || sp0==stderr){
+    sp0=logfp;
+  }
+  if((sp3=fopen(NULLFILE,"w"))==NULL){
+    fflush(NULL);
+    fprintf(savedsp[0],"Unable to open null file %s\n",NULLFILE);
+    exit(ABNORMAL_EXIT);
+  }
+  return(logfp);
+}
+
+
+/* function: ThreadRestoreStreamPointers()
+ * ---------------------------------------
+ * Close the log and null streams opened by ThreadResetStreamPointers()
+ * and return the stream pointers of the thread to their saved values.
+ */
+int ThreadRestoreStreamPointers(FILE *logfp, FILE **savedsp){
+
+  fclose(sp3);
+  fclose(logfp);
+  sp0=savedsp[0];
+  sp1=savedsp[1];
+  sp2=savedsp[2];
+  sp3=savedsp[3];
+  return(0);
+}
+
+
 /* function: DumpIncrCostFiles()
  * -----------------------------
  * Dumps incremental cost arrays, creating file names for them.
@@ -3515,6 +3799,11 @@ int MakeTileDir(paramT *params, outfileT *outfiles){
   memset(basename,0,MAXSTRLEN);
   memset(statbuf,0,sizeof(struct stat));
   
+  /* nothing to create if the tile files are kept in memory */
+  if(IsMemFile(params->tiledir)){
+    return(0);
+  }
+
   /* create name for tile directory if necessary (use pid to make unique) */
   if(!strlen(params->tiledir)){
     ParseFilename(outfiles->outfile,path,basename);
@@ -3625,3 +3914,605 @@ int ParseFilename(char *filename, char *path, char *basename){
   return(0);
 
 }
+
+
+/* function: IsMemFile()
+ * ---------------------
+ * Returns TRUE if the file name is that of a temporary file kept in
+ * memory instead of on disk, FALSE otherwise.
+ */
+int IsMemFile(char *filename){
+
+  return(!strncmp(filename,MEMFILEPREFIX,strlen(MEMFILEPREFIX)));
+}
+
+
+/* function: FindMemFile()
+ * -----------------------
+ * Returns the in-memory file of the given name, or NULL if there is none.
+ * Callers must hold the snaphu_memfiles critical section.
+ */
+static
+memfileT *FindMemFile(char *filename){
+
+  memfileT *mf;
+
+  for(mf=memfiles;mf!=NULL;mf=mf->next){
+    if(!strcmp(mf->filename,filename)){
+      return(mf);
+    }
+  }
+  return(NULL);
+}
+
+
+/* function: OpenMemOutputFile()
+ * -----------------------------
+ * Opens an in-memory file for writing, replacing any earlier contents.
+ * The contents are complete once the returned stream is closed.
+ */
+static
+FILE *OpenMemOutputFile(char *filename){
+
+  FILE *fp;
+  memfileT *mf;
+
+  fp=NULL;
+#ifdef _OPENMP
+#pragma omp critical(snaphu_memfiles)
+#endif
+  {
+    if((mf=FindMemFile(filename))==NULL){
+      mf=(memfileT *)MAlloc(sizeof(memfileT));
+      StrNCopy(mf->filename,filename,MAXSTRLEN);
+      mf->nload=1;
+      mf->next=memfiles;
+      memfiles=mf;
+    }else{
+      free(mf->buf);
+    }
+    mf->buf=NULL;
+    mf->size=0;
+#ifdef MEMSTREAMS
+    fp=open_memstream(&(mf->buf),&(mf->size));
+#endif
+  }
+  return(fp);
+}
+
+
+/* function: OpenInputFile()
+ * -------------------------
+ * Opens a file for reading.  Files loaded with LoadMemFile() or written
+ * as in-memory files are read from memory, all others from disk.
+ * Returns NULL if the file cannot be opened.
+ */
+FILE *OpenInputFile(char *filename){
+
+  FILE *fp;
+  memfileT *mf;
+
+  fp=NULL;
+#ifdef _OPENMP
+#pragma omp critical(snaphu_memfiles)
+#endif
+  {
+    mf=FindMemFile(filename);
+#ifdef MEMSTREAMS
+    if(mf!=NULL && mf->size>0){
+      fp=fmemopen(mf->buf,mf->size,"r");
+    }
+#endif
+  }
+  if(mf==NULL && !IsMemFile(filename)){
+    fp=fopen(filename,"r");
+  }
+  return(fp);
+}
+
+
+/* function: LoadMemFile()
+ * -----------------------
+ * Reads a whole file into memory so that OpenInputFile() serves it from
+ * there.  Used for the inputs that all tiles read parts of.  Each call
+ * should be matched by a call to UnloadMemFile().
+ */
+int LoadMemFile(char *filename){
+
+  FILE *fp;
+  memfileT *mf;
+  long size;
+
+  /* nothing to do if there is no file or it is loaded already */
+  if(!strlen(filename)){
+    return(0);
+  }
+#ifdef _OPENMP
+#pragma omp critical(snaphu_memfiles)
+#endif
+  {
+    if((mf=FindMemFile(filename))!=NULL){
+      mf->nload++;
+    }
+  }
+  if(mf!=NULL){
+    return(0);
+  }
+  if((fp=fopen(filename,"r"))==NULL){
+    fflush(NULL);
+    fprintf(sp0,"Can't open file %s\nAbort\n",filename);
+    exit(ABNORMAL_EXIT);
+  }
+  fseek(fp,0,SEEK_END);
+  size=ftell(fp);
+  rewind(fp);
+  mf=(memfileT *)MAlloc(sizeof(memfileT));
+  StrNCopy(mf->filename,filename,MAXSTRLEN);
+  mf->buf=(char *)MAlloc(size>0 ? size : 1);
+  mf->size=size;
+  mf->nload=1;
+  if(fread(mf->buf,1,size,fp)!=(size_t )size){
+    fflush(NULL);
+    fprintf(sp0,"Error reading file %s\nAbort\n",filename);
+    exit(ABNORMAL_EXIT);
+  }
+  fclose(fp);
+#ifdef _OPENMP
+#pragma omp critical(snaphu_memfiles)
+#endif
+  {
+    mf->next=memfiles;
+    memfiles=mf;
+  }
+  return(0);
+}
+
+
+/* function: UnloadMemFile()
+ * -------------------------
+ * Frees the in-memory copy of a file once it has been unloaded as often
+ * as it was loaded.  Returns TRUE if there was one.
+ */
+int UnloadMemFile(char *filename){
+
+  memfileT *mf, **prev;
+  int found;
+
+  mf=NULL;
+  found=FALSE;
+#ifdef _OPENMP
+#pragma omp critical(snaphu_memfiles)
+#endif
+  {
+    for(prev=&memfiles;*prev!=NULL;prev=&((*prev)->next)){
+      if(!strcmp((*prev)->filename,filename)){
+        mf=*prev;
+        if(--(mf->nload)>0){
+          found=TRUE;
+          mf=NULL;
+        }else{
+          *prev=mf->next;
+        }
+        break;
+      }
+    }
+  }
+  if(mf==NULL){
+    return(found);
+  }
+  free(mf->buf);
+  free(mf);
+  return(TRUE);
+}
+
+
+/* function: RemoveFile()
+ * ----------------------
+ * Removes a temporary file, from memory or from disk.
+ */
+int RemoveFile(char *filename){
+
+  if(!UnloadMemFile(filename) && !IsMemFile(filename)){
+    unlink(filename);
+  }
+  return(0);
+}
+
+
+/* function: IsGridFile()
+ * ----------------------
+ * Returns TRUE if the file is read or written as a GMT grid, which is
+ * the case for names ending in .grd or .nc if built with GMT support,
+ * FALSE otherwise.
+ */
+int IsGridFile(char *filename){
+
+#ifdef SNAPHU_GMT
+  char *ext;
+
+  if((ext=strrchr(filename,'.'))!=NULL
+     && (!strcmp(ext,".grd") || !strcmp(ext,".nc"))){
+    return(TRUE);
+  }
+#endif
+  return(FALSE);
+}
+
+
+#ifdef SNAPHU_GMT
+
+/* function: ReadGrid()
+ * --------------------
+ * Reads a GMT grid and checks its size against the size given, if any.
+ */
+static
+struct GMT_GRID *ReadGrid(void *API, char *filename, long *nrowptr,
+                          long *ncolptr){
+
+  struct GMT_GRID *G;
+
+  if((G=GMT_Read_Data(API,GMT_IS_GRID,GMT_IS_FILE,GMT_IS_SURFACE,
+                      GMT_GRID_ALL,NULL,filename,NULL))==NULL){
+    fflush(NULL);
+    fprintf(sp0,"can't read grid %s\nAbort\n",filename);
+    exit(ABNORMAL_EXIT);
+  }
+  if((*nrowptr && *nrowptr!=G->header->n_rows)
+     || (*ncolptr && *ncolptr!=G->header->n_columns)){
+    fflush(NULL);
+    fprintf(sp0,"size of grid %s does not match other inputs\nAbort\n",
+            filename);
+    exit(ABNORMAL_EXIT);
+  }
+  *nrowptr=G->header->n_rows;
+  *ncolptr=G->header->n_columns;
+  return(G);
+}
+
+
+/* function: OpenGridMemFile()
+ * ---------------------------
+ * Opens the in-memory file into which grid data are converted.
+ */
+static
+FILE *OpenGridMemFile(char *filename){
+
+  FILE *fp;
+
+  if((fp=OpenMemOutputFile(filename))==NULL){
+    fflush(NULL);
+    fprintf(sp0,"Unable to open in-memory file %s\nAbort\n",filename);
+    exit(ABNORMAL_EXIT);
+  }
+  return(fp);
+}
+
+#endif
+
+
+/* function: ReadGridFiles()
+ * -------------------------
+ * Reads the wrapped phase, correlation, correlation mask, and warm-start
+ * phase from GMT grids into in-memory files in FLOAT_DATA format, from
+ * which the usual input functions read them, and takes the line length
+ * from the grids.  NaNs are read as zeros, except in the warm-start
+ * phase, where they mark pixels without a value.  The correlation is
+ * clipped to one and set to zero where it is below the correlation
+ * threshold or where the mask is zero or NaN; these pixels are set to
+ * NaN in the unwrapped grid written by WriteGridFiles().  Grid outputs
+ * are registered as in-memory files to be converted by WriteGridFiles().
+ */
+int ReadGridFiles(infileT *infiles, outfileT *outfiles, long *linelenptr,
+                  paramT *params){
+
+#ifdef SNAPHU_GMT
+  long row, col, nrow, ncol;
+  float *rowbuf, c, m;
+  signed char *validbuf;
+  void *API;
+  struct GMT_GRID *P, *C, *M, *W;
+  FILE *fp, *validfp;
+  gmt_grdfloat *prow, *crow, *mrow, *wrow;
+#endif
+
+  /* mask and threshold are only applied to grid correlation */
+  if((strlen(infiles->corrmaskfile) || params->corrthresh>0)
+     && !IsGridFile(infiles->corrfile)){
+    fflush(NULL);
+    fprintf(sp0,"correlation mask and threshold need a correlation grid\n");
+    exit(ABNORMAL_EXIT);
+  }
+  if(strlen(infiles->corrmaskfile) && !IsGridFile(infiles->corrmaskfile)){
+    fflush(NULL);
+    fprintf(sp0,"correlation mask %s is not a grid\n",infiles->corrmaskfile);
+    exit(ABNORMAL_EXIT);
+  }
+  if((IsGridFile(outfiles->outfile) || IsGridFile(outfiles->conncompfile))
+     && !IsGridFile(infiles->infile)){
+    fflush(NULL);
+    fprintf(sp0,"grid outputs need a grid input file\n");
+    exit(ABNORMAL_EXIT);
+  }
+
+#ifdef SNAPHU_GMT
+
+  /* nothing to do if there are no grids */
+  if(!IsGridFile(infiles->infile) && !IsGridFile(infiles->corrfile)
+     && !IsGridFile(infiles->warmstartfile)){
+    return(0);
+  }
+  if((API=GMT_Create_Session(PROGRAMNAME,0U,0U,NULL))==NULL){
+    fflush(NULL);
+    fprintf(sp0,"can't start GMT session\nAbort\n");
+    exit(ABNORMAL_EXIT);
+  }
+  nrow=0;
+  ncol=(*linelenptr);
+  rowbuf=NULL;
+
+  /* wrapped (or unwrapped) phase */
+  if(IsGridFile(infiles->infile)){
+    fprintf(sp1,"Reading phase from grid %s\n",infiles->infile);
+    P=ReadGrid(API,infiles->infile,&nrow,&ncol);
+    rowbuf=(float *)MAlloc(ncol*sizeof(float));
+    fp=OpenGridMemFile(infiles->infile);
+    for(row=0;row<nrow;row++){
+      prow=P->data+GMT_Get_Index(API,P->header,row,0);
+      for(col=0;col<ncol;col++){
+        rowbuf[col]=isnan(prow[col]) ? 0 : prow[col];
+      }
+      fwrite(rowbuf,sizeof(float),ncol,fp);
+    }
+    fclose(fp);
+    GMT_Destroy_Data(API,&P);
+    infiles->infileformat=FLOAT_DATA;
+    infiles->unwrappedinfileformat=FLOAT_DATA;
+  }
+
+  /* correlation, with the mask and threshold applied */
+  if(IsGridFile(infiles->corrfile)){
+    fprintf(sp1,"Reading correlation from grid %s\n",infiles->corrfile);
+    C=ReadGrid(API,infiles->corrfile,&nrow,&ncol);
+    M=NULL;
+    if(strlen(infiles->corrmaskfile)){
+      fprintf(sp1,"Reading correlation mask from grid %s\n",
+              infiles->corrmaskfile);
+      M=ReadGrid(API,infiles->corrmaskfile,&nrow,&ncol);
+    }
+    if(rowbuf==NULL){
+      rowbuf=(float *)MAlloc(ncol*sizeof(float));
+    }
+    validbuf=(signed char *)MAlloc(ncol*sizeof(signed char));
+    fp=OpenGridMemFile(infiles->corrfile);
+    validfp=OpenGridMemFile(GRIDMASKFILE);
+    for(row=0;row<nrow;row++){
+      crow=C->data+GMT_Get_Index(API,C->header,row,0);
+      mrow=NULL;
+      if(M!=NULL){
+        mrow=M->data+GMT_Get_Index(API,M->header,row,0);
+      }
+      for(col=0;col<ncol;col++){
+        c=crow[col];
+        m=(mrow!=NULL) ? mrow[col] : 1;
+        if(isnan(c) || c<params->corrthresh || isnan(m) || m==0){
+          rowbuf[col]=0;
+          validbuf[col]=FALSE;
+        }else{
+          rowbuf[col]=(c>1) ? 1 : c;
+          validbuf[col]=TRUE;
+        }
+      }
+      fwrite(rowbuf,sizeof(float),ncol,fp);
+      fwrite(validbuf,sizeof(signed char),ncol,validfp);
+    }
+    fclose(fp);
+    fclose(validfp);
+    free(validbuf);
+    GMT_Destroy_Data(API,&C);
+    if(M!=NULL){
+      GMT_Destroy_Data(API,&M);
+    }
+    infiles->corrfileformat=FLOAT_DATA;
+  }
+
+  /* warm-start phase */
+  if(IsGridFile(infiles->warmstartfile)){
+    fprintf(sp1,"Reading warm-start phase from grid %s\n",
+            infiles->warmstartfile);
+    W=ReadGrid(API,infiles->warmstartfile,&nrow,&ncol);
+    if(rowbuf==NULL){
+      rowbuf=(float *)MAlloc(ncol*sizeof(float));
+    }
+    fp=OpenGridMemFile(infiles->warmstartfile);
+    for(row=0;row<nrow;row++){
+      wrow=W->data+GMT_Get_Index(API,W->header,row,0);
+      for(col=0;col<ncol;col++){
+        rowbuf[col]=wrow[col];
+      }
+      fwrite(rowbuf,sizeof(float),ncol,fp);
+    }
+    fclose(fp);
+    GMT_Destroy_Data(API,&W);
+    infiles->warmstartfileformat=FLOAT_DATA;
+  }
+  free(rowbuf);
+  GMT_Destroy_Session(API);
+  *linelenptr=ncol;
+
+  /* outputs go to memory first */
+  if(IsGridFile(outfiles->outfile)){
+    fclose(OpenGridMemFile(outfiles->outfile));
+    outfiles->outfileformat=FLOAT_DATA;
+  }
+  if(IsGridFile(outfiles->conncompfile)){
+    fclose(OpenGridMemFile(outfiles->conncompfile));
+  }
+
+#endif
+
+  /* done */
+  return(0);
+
+}
+
+
+/* function: WriteGridFiles()
+ * --------------------------
+ * Writes the unwrapped phase and connected components registered as
+ * in-memory files by ReadGridFiles() to GMT grids with the header of
+ * the input grid, and frees the in-memory copies of the grid inputs.
+ */
+int WriteGridFiles(infileT *infiles, outfileT *outfiles, long linelen,
+                   long nlines, paramT *params){
+
+#ifdef SNAPHU_GMT
+  long row, col;
+  void *API;
+  struct GMT_GRID *P, *G;
+  FILE *fp, *validfp;
+  gmt_grdfloat *grow;
+  signed char *validbuf;
+  unsigned char *ucharbuf;
+  unsigned int *uintbuf;
+
+
+  /* nothing to do if there are no grids */
+  if(!IsGridFile(infiles->infile) && !IsGridFile(infiles->corrfile)
+     && !IsGridFile(infiles->warmstartfile)){
+    return(0);
+  }
+  if((API=GMT_Create_Session(PROGRAMNAME,0U,0U,NULL))==NULL){
+    fflush(NULL);
+    fprintf(sp0,"can't start GMT session\nAbort\n");
+    exit(ABNORMAL_EXIT);
+  }
+  P=NULL;
+  if(IsGridFile(infiles->infile)
+     && (P=GMT_Read_Data(API,GMT_IS_GRID,GMT_IS_FILE,GMT_IS_SURFACE,
+                         GMT_GRID_HEADER_ONLY,NULL,infiles->infile,
+                         NULL))==NULL){
+    fflush(NULL);
+    fprintf(sp0,"can't read grid %s\nAbort\n",infiles->infile);
+    exit(ABNORMAL_EXIT);
+  }
+
+  /* unwrapped phase, NaN where correlation was masked */
+  if(IsGridFile(outfiles->outfile)
+     && (fp=OpenInputFile(outfiles->outfile))!=NULL){
+    fprintf(sp1,"Writing unwrapped phase to grid %s\n",outfiles->outfile);
+    if((G=GMT_Create_Data(API,GMT_IS_GRID,GMT_IS_SURFACE,GMT_GRID_ALL,NULL,
+                          P->header->wesn,P->header->inc,
+                          P->header->registration,GMT_NOTSET,NULL))==NULL){
+      fflush(NULL);
+      fprintf(sp0,"can't create grid %s\nAbort\n",outfiles->outfile);
+      exit(ABNORMAL_EXIT);
+    }
+    validfp=OpenInputFile(GRIDMASKFILE);
+    validbuf=(signed char *)MAlloc(linelen*sizeof(signed char));
+    for(row=0;row<nlines;row++){
+      grow=G->data+GMT_Get_Index(API,G->header,row,0);
+      if(fread(grow,sizeof(float),linelen,fp)!=(size_t )linelen
+         || (validfp!=NULL
+             && fread(validbuf,sizeof(signed char),linelen,validfp)
+             !=(size_t )linelen)){
+        fflush(NULL);
+        fprintf(sp0,"Error reading in-memory file %s\nAbort\n",
+                outfiles->outfile);
+        exit(ABNORMAL_EXIT);
+      }
+      if(validfp!=NULL){
+        for(col=0;col<linelen;col++){
+          if(!validbuf[col]){
+            grow[col]=NAN;
+          }
+        }
+      }
+    }
+    fclose(fp);
+    if(validfp!=NULL){
+      fclose(validfp);
+    }
+    free(validbuf);
+    GMT_Set_Comment(API,GMT_IS_GRID,GMT_COMMENT_IS_TITLE,
+                    "unwrapped phase",G);
+    if(GMT_Write_Data(API,GMT_IS_GRID,GMT_IS_FILE,GMT_IS_SURFACE,
+                      GMT_GRID_ALL,NULL,outfiles->outfile,G)){
+      fflush(NULL);
+      fprintf(sp0,"can't write grid %s\nAbort\n",outfiles->outfile);
+      exit(ABNORMAL_EXIT);
+    }
+    GMT_Destroy_Data(API,&G);
+  }
+
+  /* connected components */
+  if(IsGridFile(outfiles->conncompfile)
+     && (fp=OpenInputFile(outfiles->conncompfile))!=NULL){
+    fprintf(sp1,"Writing connected components to grid %s\n",
+            outfiles->conncompfile);
+    if((G=GMT_Create_Data(API,GMT_IS_GRID,GMT_IS_SURFACE,GMT_GRID_ALL,NULL,
+                          P->header->wesn,P->header->inc,
+                          P->header->registration,GMT_NOTSET,NULL))==NULL){
+      fflush(NULL);
+      fprintf(sp0,"can't create grid %s\nAbort\n",outfiles->conncompfile);
+      exit(ABNORMAL_EXIT);
+    }
+    ucharbuf=(unsigned char *)MAlloc(linelen*sizeof(unsigned char));
+    uintbuf=(unsigned int *)MAlloc(linelen*sizeof(unsigned int));
+    for(row=0;row<nlines;row++){
+      grow=G->data+GMT_Get_Index(API,G->header,row,0);
+      if(params->conncompouttype==CONNCOMPOUTTYPEUCHAR){
+        if(fread(ucharbuf,sizeof(unsigned char),linelen,fp)
+           !=(size_t )linelen){
+          break;
+        }
+        for(col=0;col<linelen;col++){
+          grow[col]=ucharbuf[col];
+        }
+      }else{
+        if(fread(uintbuf,sizeof(unsigned int),linelen,fp)
+           !=(size_t )linelen){
+          break;
+        }
+        for(col=0;col<linelen;col++){
+          grow[col]=uintbuf[col];
+        }
+      }
+    }
+    if(row<nlines){
+      fflush(NULL);
+      fprintf(sp0,"Error reading in-memory file %s\nAbort\n",
+              outfiles->conncompfile);
+      exit(ABNORMAL_EXIT);
+    }
+    fclose(fp);
+    free(ucharbuf);
+    free(uintbuf);
+    GMT_Set_Comment(API,GMT_IS_GRID,GMT_COMMENT_IS_TITLE,
+                    "connected components",G);
+    if(GMT_Write_Data(API,GMT_IS_GRID,GMT_IS_FILE,GMT_IS_SURFACE,
+                      GMT_GRID_ALL,NULL,outfiles->conncompfile,G)){
+      fflush(NULL);
+      fprintf(sp0,"can't write grid %s\nAbort\n",outfiles->conncompfile);
+      exit(ABNORMAL_EXIT);
+    }
+    GMT_Destroy_Data(API,&G);
+  }
+  if(P!=NULL){
+    GMT_Destroy_Data(API,&P);
+  }
+  GMT_Destroy_Session(API);
+
+  /* free in-memory copies */
+  UnloadMemFile(infiles->infile);
+  UnloadMemFile(infiles->corrfile);
+  UnloadMemFile(infiles->warmstartfile);
+  UnloadMemFile(GRIDMASKFILE);
+  UnloadMemFile(outfiles->outfile);
+  UnloadMemFile(outfiles->conncompfile);
+
+#endif
+
+  /* done */
+  return(0);
+
+}
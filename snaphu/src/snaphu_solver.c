@@ -8,6 +8,11 @@
 
 *************************************************************************/
 
+/* declare POSIX functions (memory streams, gethostname) under -std=c99 */
+#ifndef _WIN32
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -32,6 +37,7 @@
 #	define pid_t int
 #else
 #	include <sys/wait.h>
+#	include <time.h>
 #	include <sys/time.h>
 #	include <sys/resource.h>
 #endif
@@ -47,6 +53,9 @@ static nodeT *(*NeighborNode)(nodeT *, long, long *, nodeT **, nodeT *, long *,
                               nodesuppT **);
 static void (*GetArc)(nodeT *, nodeT *, long *, long *, long *, long, long,
                       nodeT **, nodesuppT **);
+#ifdef TILETHREADS
+#pragma omp threadprivate(NeighborNode,GetArc)
+#endif
 
 /* static (local) function prototypes */
 static
@@ -3765,6 +3774,10 @@ int MCFInitFlows(float **wrappedphase, short ***flowsptr, short **mstcosts,
   CycleResidue(wrappedphase,residue,nrow,ncol);
 
   /* run the solver (memory freed within solver) */
+  /* the CS2 solver keeps its state in globals, so one tile at a time */
+#ifdef TILETHREADS
+#pragma omp critical(snaphu_cs2)
+#endif
   SolveCS2(residue,mstcosts,nrow,ncol,cs2scalefactor,flowsptr);
 
 #endif
@@ -3772,3 +3785,70 @@ int MCFInitFlows(float **wrappedphase, short ***flowsptr, short **mstcosts,
   /* done */
   return(0);
 }
+
+
+
+/* function: WarmStartWrappedPhase()
+ * ---------------------------------
+ * Returns the wrapped phase flattened by an unwrapped phase field such
+ * as the solution for a neighbouring interferogram of a stack or a
+ * model prediction, for the flows to be initialized on it as usual
+ * and put back together with the field by WarmStartInitFlows().  The
+ * cycles of the field then carry over to the initialization where the
+ * flattened phase is smooth.  Pixels where the field is not finite are
+ * set to the wrapped phase.  If there is an unwrapped estimate, it has
+ * already been taken out of the wrapped phase and is taken out of the
+ * field here too.  Memory for the flattened phase is allocated here.
+ */
+float **WarmStartWrappedPhase(float **wrappedphase, float **warmstart, 
+                              float **unwrappedest, long nrow, long ncol){
+
+  long row, col;
+  float **flatphase;
+
+
+  /* subtract the field from the wrapped phase and rewrap */
+  fprintf(sp1,"Flattening wrapped phase with warm-start phase\n");
+  flatphase=(float **)Get2DMem(nrow,ncol,sizeof(float *),sizeof(float));
+  for(row=0;row<nrow;row++){
+    for(col=0;col<ncol;col++){
+      if(!IsFinite(warmstart[row][col])){
+        warmstart[row][col]=wrappedphase[row][col];
+      }else if(unwrappedest!=NULL){
+        warmstart[row][col]-=unwrappedest[row][col];
+      }
+      flatphase[row][col]=wrappedphase[row][col];
+    }
+  }
+  FlattenWrappedPhase(flatphase,warmstart,nrow,ncol);
+
+  /* done */
+  return(flatphase);
+}
+
+
+/* function: WarmStartInitFlows()
+ * ------------------------------
+ * Replaces the flows initialized on the phase flattened by
+ * WarmStartWrappedPhase() with the flows of the unwrapped phase they
+ * give plus the warm-start field, which is congruent with the wrapped
+ * phase.
+ */
+int WarmStartInitFlows(float **flatphase, short ***flowsptr, 
+                       float **warmstart, long nrow, long ncol){
+
+  float **unwrappedphase;
+
+
+  /* integrate the flattened phase and put the field back */
+  unwrappedphase=(float **)Get2DMem(nrow,ncol,sizeof(float *),sizeof(float));
+  IntegratePhase(flatphase,unwrappedphase,*flowsptr,nrow,ncol);
+  Add2DFloatArrays(unwrappedphase,warmstart,nrow,ncol);
+
+  /* get the flows of the sum */
+  CalcFlow(unwrappedphase,flowsptr,nrow,ncol);
+  Free2DArray((void **)unwrappedphase,nrow);
+
+  /* done */
+  return(0);
+}
@@ -8,6 +8,11 @@
 
 *************************************************************************/
 
+/* declare POSIX functions (memory streams, gethostname) under -std=c99 */
+#ifndef _WIN32
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -32,6 +37,7 @@
 #	define pid_t int
 #else
 #	include <sys/wait.h>
+#	include <time.h>
 #	include <sys/time.h>
 #	include <sys/resource.h>
 #endif
@@ -42,6 +48,8 @@
 
 /* static (local) function prototypes */
 static
+long FindRunRoot(long *runparent, long i);
+static
 long ThickenCosts(incrcostT **incrcosts, long nrow, long ncol);
 static
 nodeT *RegionsNeighborNode(nodeT *node1, long *arcnumptr, nodeT **nodes, 
@@ -703,10 +711,14 @@ int GrowConnCompsMask(void **costs, short **flows, long nrow, long ncol,
   
   /* error checking */
   fprintf(sp1,"Growing connected component mask\n");
-  minsize=params->minconncompfrac*nrow*ncol;
+  if(params->conncompnpix>0){
+    minsize=params->minconncompfrac*params->conncompnpix;
+  }else{
+    minsize=params->minconncompfrac*nrow*ncol;
+  }
   maxncomps=params->maxncomps;
   costthresh=params->conncompthresh;
-  if(minsize>nrow*ncol){
+  if(minsize>nrow*ncol && params->conncompnpix<=0){
     fflush(NULL);
     fprintf(sp0,"Minimum region size cannot exceed tile size\nAbort\n");
     exit(ABNORMAL_EXIT);
@@ -953,6 +965,414 @@ int GrowConnCompsMask(void **costs, short **flows, long nrow, long ncol,
 }
 
 
+/* function: WriteMaskedTileRegions()
+ * ----------------------------------
+ * Writes the region and connected component files of a tile in which
+ * every pixel is masked, in place of GrowRegions() and
+ * GrowConnCompsMask().  The whole tile is region zero and no pixel is
+ * in a connected component, as those functions would find.
+ */
+int WriteMaskedTileRegions(long nrow, long ncol, outfileT *outfiles, 
+                           paramT *params){
+
+  short **regions;
+  void **conncomps;
+  char regionfile[MAXSTRLEN];
+  size_t outtypesize;
+
+
+  /* regions */
+  memset(regionfile,0,MAXSTRLEN);
+  regions=(short **)Get2DMem(nrow,ncol,sizeof(short *),sizeof(short));
+  sprintf(regionfile,"%s%s",outfiles->outfile,REGIONSUFFIX);
+  fprintf(sp2,"Writing region data to file %s\n",regionfile);
+  Write2DArray((void **)regions,regionfile,nrow,ncol,sizeof(short));
+  Free2DArray((void **)regions,nrow);
+
+  /* connected components, zero whatever the output type */
+  if(strlen(outfiles->conncompfile)){
+    if(params->conncompouttype==CONNCOMPOUTTYPEUCHAR){
+      outtypesize=sizeof(unsigned char);
+    }else{
+      outtypesize=sizeof(unsigned int);
+    }
+    conncomps=Get2DMem(nrow,ncol,sizeof(void *),outtypesize);
+    fprintf(sp1,"Writing connected components to file %s"
+            " as %d-byte unsigned ints\n",
+            outfiles->conncompfile,((int )outtypesize));
+    Write2DArray(conncomps,outfiles->conncompfile,nrow,ncol,outtypesize);
+    Free2DArray(conncomps,nrow);
+  }
+
+  /* done */
+  return(0);
+
+}
+
+
+/* function: FindMaskedRegionBoxes()
+ * ---------------------------------
+ * Finds the bounding boxes of the groups of valid pixels of a single
+ * tile that are cut off from each other by masked pixels.  Valid pixels
+ * are grouped if they touch, diagonally included, each box is padded by
+ * MASKBOXMARGIN masked pixels, and boxes that overlap are merged, so
+ * the boxes do not overlap and each can be unwrapped on its own.  The
+ * boxes are allocated here and given in full-image coordinates.
+ * Returns the number of boxes, or zero if the tile should be unwrapped
+ * as a whole because nothing is masked, nothing is valid, or the boxes
+ * would cover the whole tile anyway.
+ */
+long FindMaskedRegionBoxes(infileT *infiles, long linelen, long nlines, 
+                           tileparamT *tileparams, paramT *params, 
+                           tileparamT **boxesptr){
+
+  long row, col, nrow, ncol, i, j, iprev, prevfirst, prevlast;
+  long nruns, runslen, nboxes, lastrow, lastcol, lastrowj, lastcolj;
+  long *runrow, *runfirst, *runlast, *runparent, *boxindex;
+  signed char **validmask;
+  signed char merged;
+  tileparamT *boxes;
+
+
+  /* read which pixels are valid */
+  nrow=tileparams->nrow;
+  ncol=tileparams->ncol;
+  validmask=ReadValidMask(infiles,linelen,nlines,tileparams,params);
+  if(validmask==NULL){
+    return(0);
+  }
+
+  /* find runs of valid pixels in each line, joining each run to those */
+  /*   of the previous line that it touches                            */
+  nruns=0;
+  runslen=INITARRSIZE;
+  runrow=(long *)MAlloc(runslen*sizeof(long));
+  runfirst=(long *)MAlloc(runslen*sizeof(long));
+  runlast=(long *)MAlloc(runslen*sizeof(long));
+  runparent=(long *)MAlloc(runslen*sizeof(long));
+  prevfirst=0;
+  prevlast=0;
+  for(row=0;row<nrow;row++){
+    iprev=prevfirst;
+    prevfirst=nruns;
+    col=0;
+    while(col<ncol){
+      if(!validmask[row][col]){
+        col++;
+        continue;
+      }
+      if(nruns>=runslen){
+        runslen+=INITARRSIZE;
+        runrow=(long *)ReAlloc(runrow,runslen*sizeof(long));
+        runfirst=(long *)ReAlloc(runfirst,runslen*sizeof(long));
+        runlast=(long *)ReAlloc(runlast,runslen*sizeof(long));
+        runparent=(long *)ReAlloc(runparent,runslen*sizeof(long));
+      }
+      runrow[nruns]=row;
+      runfirst[nruns]=col;
+      while(col<ncol && validmask[row][col]){
+        col++;
+      }
+      runlast[nruns]=col-1;
+      runparent[nruns]=nruns;
+      while(iprev<prevlast && runlast[iprev]<runfirst[nruns]-1){
+        iprev++;
+      }
+      for(i=iprev;i<prevlast && runfirst[i]<=runlast[nruns]+1;i++){
+        runparent[FindRunRoot(runparent,i)]=FindRunRoot(runparent,nruns);
+      }
+      nruns++;
+    }
+    prevlast=nruns;
+  }
+  Free2DArray((void **)validmask,nrow);
+
+  /* bound the runs of each group, padding the bounds */
+  nboxes=0;
+  boxes=NULL;
+  boxindex=(long *)MAlloc((nruns>0 ? nruns : 1)*sizeof(long));
+  for(i=0;i<nruns;i++){
+    boxindex[i]=-1;
+  }
+  for(i=0;i<nruns;i++){
+    j=FindRunRoot(runparent,i);
+    if(boxindex[j]<0){
+      boxindex[j]=nboxes++;
+      boxes=(tileparamT *)ReAlloc(boxes,nboxes*sizeof(tileparamT));
+      boxes[boxindex[j]].firstrow=runrow[i];
+      boxes[boxindex[j]].firstcol=runfirst[i];
+      boxes[boxindex[j]].nrow=1;
+      boxes[boxindex[j]].ncol=runlast[i]-runfirst[i]+1;
+    }
+    j=boxindex[j];
+    lastrow=LMax(boxes[j].firstrow+boxes[j].nrow-1,runrow[i]);
+    lastcol=LMax(boxes[j].firstcol+boxes[j].ncol-1,runlast[i]);
+    boxes[j].firstrow=LMin(boxes[j].firstrow,runrow[i]);
+    boxes[j].firstcol=LMin(boxes[j].firstcol,runfirst[i]);
+    boxes[j].nrow=lastrow-boxes[j].firstrow+1;
+    boxes[j].ncol=lastcol-boxes[j].firstcol+1;
+  }
+  free(boxindex);
+  free(runrow);
+  free(runfirst);
+  free(runlast);
+  free(runparent);
+  for(i=0;i<nboxes;i++){
+    lastrow=LMin(boxes[i].firstrow+boxes[i].nrow-1+MASKBOXMARGIN,nrow-1);
+    lastcol=LMin(boxes[i].firstcol+boxes[i].ncol-1+MASKBOXMARGIN,ncol-1);
+    boxes[i].firstrow=LMax(boxes[i].firstrow-MASKBOXMARGIN,0);
+    boxes[i].firstcol=LMax(boxes[i].firstcol-MASKBOXMARGIN,0);
+    boxes[i].nrow=lastrow-boxes[i].firstrow+1;
+    boxes[i].ncol=lastcol-boxes[i].firstcol+1;
+  }
+
+  /* use a single box around everything if there are too many to merge */
+  if(nboxes>MAXMASKBOXES){
+    for(i=1;i<nboxes;i++){
+      lastrow=LMax(boxes[0].firstrow+boxes[0].nrow,
+                   boxes[i].firstrow+boxes[i].nrow);
+      lastcol=LMax(boxes[0].firstcol+boxes[0].ncol,
+                   boxes[i].firstcol+boxes[i].ncol);
+      boxes[0].firstrow=LMin(boxes[0].firstrow,boxes[i].firstrow);
+      boxes[0].firstcol=LMin(boxes[0].firstcol,boxes[i].firstcol);
+      boxes[0].nrow=lastrow-boxes[0].firstrow;
+      boxes[0].ncol=lastcol-boxes[0].firstcol;
+    }
+    nboxes=1;
+  }
+
+  /* merge overlapping boxes until none overlap */
+  do{
+    merged=FALSE;
+    for(i=0;i<nboxes;i++){
+      j=i+1;
+      while(j<nboxes){
+        lastrow=boxes[i].firstrow+boxes[i].nrow;
+        lastcol=boxes[i].firstcol+boxes[i].ncol;
+        lastrowj=boxes[j].firstrow+boxes[j].nrow;
+        lastcolj=boxes[j].firstcol+boxes[j].ncol;
+        if(boxes[j].firstrow<lastrow && boxes[i].firstrow<lastrowj
+           && boxes[j].firstcol<lastcol && boxes[i].firstcol<lastcolj){
+          boxes[i].firstrow=LMin(boxes[i].firstrow,boxes[j].firstrow);
+          boxes[i].firstcol=LMin(boxes[i].firstcol,boxes[j].firstcol);
+          boxes[i].nrow=LMax(lastrow,lastrowj)-boxes[i].firstrow;
+          boxes[i].ncol=LMax(lastcol,lastcolj)-boxes[i].firstcol;
+          boxes[j]=boxes[--nboxes];
+          merged=TRUE;
+        }else{
+          j++;
+        }
+      }
+    }
+  }while(merged);
+
+  /* unwrap the tile as a whole if that is what the boxes come to */
+  if(nboxes==0 || (nboxes==1 && boxes[0].nrow==nrow && boxes[0].ncol==ncol)){
+    free(boxes);
+    return(0);
+  }
+
+  /* convert to full-image coordinates */
+  for(i=0;i<nboxes;i++){
+    boxes[i].firstrow+=tileparams->firstrow;
+    boxes[i].firstcol+=tileparams->firstcol;
+  }
+  (*boxesptr)=boxes;
+  return(nboxes);
+
+}
+
+
+/* function: FindRunRoot()
+ * -----------------------
+ * Returns the run at the root of the group of run i, halving the paths
+ * to it along the way.
+ */
+static
+long FindRunRoot(long *runparent, long i){
+
+  while(runparent[i]!=i){
+    runparent[i]=runparent[runparent[i]];
+    i=runparent[i];
+  }
+  return(i);
+
+}
+
+
+/* function: ReadRegionBoxOutputs()
+ * --------------------------------
+ * Reads the unwrapped output and connected components of one of the
+ * boxes of FindMaskedRegionBoxes() into the arrays for the whole tile
+ * and removes the box output files.  The connected components of the
+ * box are numbered after the *ncompsptr already read, which is updated.
+ * The conncomps array may be NULL if there are no connected components.
+ */
+int ReadRegionBoxOutputs(float **mag, float **unwrappedphase, 
+                         unsigned int **conncomps, long *ncompsptr, 
+                         tileparamT *box, tileparamT *tileparams, 
+                         outfileT *boxoutfiles){
+
+  long row, col, rowoffset, coloffset, maxcomp;
+  float **boxmag, **boxphase;
+  unsigned int **boxcomps;
+  tileparamT boxreadparams[1];
+
+
+  /* read the box outputs */
+  boxreadparams->firstrow=0;
+  boxreadparams->firstcol=0;
+  boxreadparams->nrow=box->nrow;
+  boxreadparams->ncol=box->ncol;
+  boxmag=NULL;
+  boxphase=NULL;
+  ReadAltLineFile(&boxmag,&boxphase,boxoutfiles->outfile,
+                  box->ncol,box->nrow,boxreadparams);
+  RemoveFile(boxoutfiles->outfile);
+  boxcomps=NULL;
+  if(conncomps!=NULL){
+    Read2DArray((void ***)&boxcomps,boxoutfiles->conncompfile,
+                box->ncol,box->nrow,boxreadparams,
+                sizeof(unsigned int *),sizeof(unsigned int));
+    RemoveFile(boxoutfiles->conncompfile);
+  }
+
+  /* copy them into the tile arrays */
+  rowoffset=box->firstrow-tileparams->firstrow;
+  coloffset=box->firstcol-tileparams->firstcol;
+  maxcomp=0;
+  for(row=0;row<box->nrow;row++){
+    for(col=0;col<box->ncol;col++){
+      mag[row+rowoffset][col+coloffset]=boxmag[row][col];
+      unwrappedphase[row+rowoffset][col+coloffset]=boxphase[row][col];
+      if(boxcomps!=NULL && boxcomps[row][col]>0){
+        conncomps[row+rowoffset][col+coloffset]
+          =boxcomps[row][col]+(*ncompsptr);
+        if(boxcomps[row][col]>maxcomp){
+          maxcomp=boxcomps[row][col];
+        }
+      }
+    }
+  }
+  (*ncompsptr)+=maxcomp;
+
+  /* free memory */
+  Free2DArray((void **)boxmag,box->nrow);
+  Free2DArray((void **)boxphase,box->nrow);
+  if(boxcomps!=NULL){
+    Free2DArray((void **)boxcomps,box->nrow);
+  }
+  return(0);
+
+}
+
+
+/* function: WriteRegionBoxOutputs()
+ * ---------------------------------
+ * Writes the unwrapped output and connected components of a tile whose
+ * boxes were unwrapped separately.  The connected components are
+ * renumbered in the order in which they are first met going through the
+ * tile and cut to the largest params->maxncomps as in GrowConnCompsMask().
+ */
+int WriteRegionBoxOutputs(float **mag, float **unwrappedphase, 
+                          unsigned int **conncomps, long ncomps, 
+                          long nrow, long ncol, outfileT *outfiles, 
+                          paramT *params){
+
+  long row, col, i, minsize, ntied, nkept;
+  long *compsizes, *sortedcompsizes, *newnums;
+  unsigned long outtypemax;
+  size_t outtypesize;
+
+
+  /* write the unwrapped output */
+  fprintf(sp1,"Writing output to file %s\n",outfiles->outfile);
+  WriteOutputFile(mag,unwrappedphase,outfiles->outfile,outfiles,nrow,ncol);
+  if(conncomps==NULL){
+    return(0);
+  }
+
+  /* get the component sizes and the smallest size kept */
+  compsizes=(long *)CAlloc(ncomps+1,sizeof(long));
+  for(row=0;row<nrow;row++){
+    for(col=0;col<ncol;col++){
+      compsizes[conncomps[row][col]]++;
+    }
+  }
+  minsize=0;
+  ntied=0;
+  if(ncomps>params->maxncomps){
+    fprintf(sp2,"Keeping only %ld connected components\n",params->maxncomps);
+    sortedcompsizes=(long *)MAlloc(ncomps*sizeof(long));
+    for(i=0;i<ncomps;i++){
+      sortedcompsizes[i]=compsizes[i+1];
+    }
+    qsort((void *)sortedcompsizes,ncomps,sizeof(long),LongCompare);
+    minsize=sortedcompsizes[ncomps-params->maxncomps];
+    i=ncomps-params->maxncomps-1;
+    while(i>=0 && sortedcompsizes[i]==minsize){
+      ntied++;
+      i--;
+    }
+    free(sortedcompsizes);
+  }
+
+  /* renumber the components */
+  newnums=(long *)MAlloc((ncomps+1)*sizeof(long));
+  for(i=1;i<=ncomps;i++){
+    newnums[i]=-1;
+  }
+  newnums[0]=0;
+  nkept=0;
+  for(row=0;row<nrow;row++){
+    for(col=0;col<ncol;col++){
+      i=conncomps[row][col];
+      if(newnums[i]<0){
+        if(compsizes[i]<minsize || (compsizes[i]==minsize && (ntied--)>0)){
+          newnums[i]=0;
+        }else{
+          newnums[i]=++nkept;
+        }
+      }
+      conncomps[row][col]=newnums[i];
+    }
+  }
+  free(compsizes);
+  free(newnums);
+  fprintf(sp2,"%ld connected components formed\n",nkept);
+
+  /* write them as the output type, narrowing them in place if need be */
+  if(params->conncompouttype==CONNCOMPOUTTYPEUCHAR){
+    outtypemax=UCHAR_MAX;
+    outtypesize=sizeof(unsigned char);
+  }else{
+    outtypemax=UINT_MAX;
+    outtypesize=sizeof(unsigned int);
+  }
+  if(nkept>outtypemax){
+    fflush(NULL);
+    fprintf(sp0,"Number of connected components too large for output type\n"
+            "Abort\n");
+    exit(ABNORMAL_EXIT);
+  }
+  if(outtypesize==sizeof(unsigned char)){
+    for(row=0;row<nrow;row++){
+      for(col=0;col<ncol;col++){
+        ((unsigned char *)conncomps[row])[col]
+          =(unsigned char )conncomps[row][col];
+      }
+    }
+  }
+  fprintf(sp1,"Writing connected components to file %s"
+          " as %d-byte unsigned ints\n",
+          outfiles->conncompfile,((int )outtypesize));
+  Write2DArray((void **)conncomps,outfiles->conncompfile,
+               nrow,ncol,outtypesize);
+  return(0);
+
+}
+
+
 /* function: ThickenCosts()
  * ------------------------
  */
@@ -1561,12 +1981,13 @@ int AssembleTiles(outfileT *outfiles, paramT *params,
     fprintf(sp1,"Removing temporary directory %s\n",params->tiledir);
     for(tilerow=0;tilerow<ntilerow;tilerow++){
       for(tilecol=0;tilecol<ntilecol;tilecol++){
-        sprintf(filename,"%s/%s%ld_%ld",
-                params->tiledir,LOGFILEROOT,tilerow,tilecol);
-        unlink(filename);
+        TileLogFileName(filename,params->tiledir,tilerow,tilecol);
+        RemoveFile(filename);
       }
     }
-    rmdir(params->tiledir);
+    if(!IsMemFile(params->tiledir)){
+      rmdir(params->tiledir);
+    }
   }
 
   /* Give notice about increasing overlap if there are edge artifacts */
@@ -1845,7 +2266,7 @@ int ReadEdgesAboveAndBelow(long tilerow, long tilecol, long nlines,
 
     /* remove temporary tile cost file unless told to save it */
     if(params->rmtmptile && !strlen(outfiles->costoutfile)){
-      unlink(outfilesabove->costoutfile);
+      RemoveFile(outfilesabove->costoutfile);
     }
   }
 
@@ -1891,7 +2312,7 @@ int ReadEdgesAboveAndBelow(long tilerow, long tilecol, long nlines,
     if(params->rmtmptile && !strlen(outfiles->costoutfile)){
       SetupTile(nlines,linelen,params,tileparams,outfiles,outfilesbelow,
                 tilerow,tilecol);
-      unlink(outfilesbelow->costoutfile);
+      RemoveFile(outfilesbelow->costoutfile);
     }
   }
 
@@ -3690,8 +4111,8 @@ int IntegrateSecondaryFlows(long linelen, long nlines, nodeT **scndrynodes,
 
       /* remove temporary files unless told so save them */
       if(params->rmtmptile){
-        unlink(readtileoutfiles->outfile);
-        unlink(readfile);
+        RemoveFile(readtileoutfiles->outfile);
+        RemoveFile(readfile);
       }
 
       /* zero out primary flow array */
@@ -4169,7 +4590,7 @@ int AssembleTileConnComps(long linelen, long nlines,
           
           /* remove temporary files unless told so save them */
           if(params->rmtmptile){
-            unlink(readtileoutfiles->conncompfile);
+            RemoveFile(readtileoutfiles->conncompfile);
           }
 
         }
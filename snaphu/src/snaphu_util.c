@@ -8,6 +8,11 @@
 
 *************************************************************************/
 
+/* declare POSIX functions (memory streams, gethostname) under -std=c99 */
+#ifndef _WIN32
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -32,6 +37,7 @@
 #	define pid_t int
 #else
 #	include <sys/wait.h>
+#	include <time.h>
 #	include <sys/time.h>
 #	include <sys/resource.h>
 #endif
@@ -699,6 +705,20 @@ long LMin(long a, long b){
 }
 
 
+/* function: LMax()
+ * ----------------
+ * Return the greater of two long integers as a long.
+ */
+long LMax(long a, long b){
+
+  if(a>b){
+    return(a);
+  }else{
+    return(b);
+  }
+}
+
+
 /* function: LClip()
  * -----------------
  * Clips the input long integer so that it is no less than minval and